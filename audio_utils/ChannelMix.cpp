@@ -16,6 +16,13 @@
 
 #include <audio_utils/ChannelMix.h>
 
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <utility>
+
 namespace android::audio_utils::channels {
 
 /**
@@ -145,22 +152,318 @@ std::shared_ptr<IChannelMix> IChannelMix::create(audio_channel_mask_t outputChan
      case AUDIO_CHANNEL_OUT_9POINT1POINT6:
          return std::make_shared<ChannelMix<AUDIO_CHANNEL_OUT_9POINT1POINT6>>();
      default:
+         if (RuntimeChannelMix::isOutputChannelMaskSupported(outputChannelMask)) {
+             return std::make_shared<RuntimeChannelMix>(outputChannelMask);
+         }
          return {};
      }
 }
 
 /* static */
 bool IChannelMix::isOutputChannelMaskSupported(audio_channel_mask_t outputChannelMask) {
+    return RuntimeChannelMix::isOutputChannelMaskSupported(outputChannelMask);
+}
+
+// --------------------------------------------------------------------------------------
+// RuntimeChannelMix
+
+namespace {
+
+constexpr size_t kMaxPositionChannels = FCC_26;
+constexpr float kMinus3dB = M_SQRT1_2;  // -3dB = 0.70710678
+
+bool isSupportedChannelMask(audio_channel_mask_t channelMask) {
+    const size_t channelCount = audio_channel_count_from_out_mask(channelMask);
+    if (channelCount == 0 || channelCount > kMaxPositionChannels) return false;
+    switch (audio_channel_mask_get_representation(channelMask)) {
+    case AUDIO_CHANNEL_REPRESENTATION_POSITION:
+        // not channel position mask, or has unknown channels.
+        return (channelMask & ~((1u << kMaxPositionChannels) - 1)) == 0;
+    case AUDIO_CHANNEL_REPRESENTATION_INDEX:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Dense matrix [input channel][output channel], converted to sparse form when complete.
+using DenseMatrix = std::vector<std::vector<float>>;
+
+template <audio_channel_mask_t OUTPUT_CHANNEL_MASK>
+bool fillFromChannelMix(audio_channel_mask_t inputChannelMask, DenseMatrix& dense) {
+    constexpr size_t OUTPUT_CHANNEL_COUNT = audio_channel_count_from_out_mask(OUTPUT_CHANNEL_MASK);
+    float matrix[kMaxPositionChannels][OUTPUT_CHANNEL_COUNT]{};
+    if (!fillChannelMatrix<OUTPUT_CHANNEL_MASK>(inputChannelMask, matrix)) return false;
+    for (size_t i = 0; i < dense.size(); ++i) {
+        std::copy(matrix[i], matrix[i] + OUTPUT_CHANNEL_COUNT, dense[i].begin());
+    }
+    return true;
+}
+
+// Distance between two channel positions, height differences weighted more
+// than depth so that bed channels stay in the bed where possible.
+int positionDistance(size_t a, size_t b) {
+    return 2 * abs((int)heightFromChannelIdx(a) - (int)heightFromChannelIdx(b))
+            + abs((int)depthFromChannelIdx(a) - (int)depthFromChannelIdx(b));
+}
+
+// Output channels on a given side nearest to input position idx,
+// excluding the LFE channels.  Returns the minimum distance or INT_MAX if none.
+int nearestOnSide(size_t idx, AUDIO_GEOMETRY_SIDE side,
+        const int (&outputOffset)[kMaxPositionChannels], std::vector<int>& nearest) {
+    nearest.clear();
+    int best = INT_MAX;
+    for (size_t j = 0; j < kMaxPositionChannels; ++j) {
+        if (outputOffset[j] < 0 || sideFromChannelIdx(j) != side) continue;
+        if ((1u << j) & (AUDIO_CHANNEL_OUT_LOW_FREQUENCY | AUDIO_CHANNEL_OUT_LOW_FREQUENCY_2)) {
+            continue;
+        }
+        const int distance = positionDistance(idx, j);
+        if (distance < best) {
+            best = distance;
+            nearest.clear();
+        }
+        if (distance == best) nearest.push_back(outputOffset[j]);
+    }
+    return best;
+}
+
+// Adds gain, split power preserving among the output channels.
+void addSplit(std::vector<float>& row, const std::vector<int>& outputs, float gain) {
+    if (outputs.empty()) return;
+    const float split = gain / sqrtf(outputs.size());
+    for (const int j : outputs) row[j] += split;
+}
+
+// Maps each input channel not present in the output to the geometrically
+// nearest output channels on the same side, folding centers into left/right pairs
+// and left/right into centers when the output has no such side.
+void fillGeometricMatrix(audio_channel_mask_t inputChannelMask,
+        audio_channel_mask_t outputChannelMask, DenseMatrix& dense) {
+    int outputOffset[kMaxPositionChannels];
+    std::fill(std::begin(outputOffset), std::end(outputOffset), -1);
+    for (unsigned j = 0, tmp = outputChannelMask; tmp != 0; ++j) {
+        const int idx = __builtin_ctz(tmp);
+        outputOffset[idx] = j;
+        tmp &= tmp - 1;
+    }
+    const int lfe = outputOffset[__builtin_ctz(AUDIO_CHANNEL_OUT_LOW_FREQUENCY)];
+    const int lfe2 = outputOffset[__builtin_ctz(AUDIO_CHANNEL_OUT_LOW_FREQUENCY_2)];
+    const bool inputHasLfe2 = (inputChannelMask & AUDIO_CHANNEL_OUT_LOW_FREQUENCY_2) != 0;
+    constexpr size_t kFrontLeftIdx = 0;  // reference position for LFE folding.
+
+    std::vector<int> left, right, center;
+    for (unsigned i = 0, tmp = inputChannelMask; tmp != 0; ++i) {
+        const int idx = __builtin_ctz(tmp);
+        const unsigned bit = 1u << idx;
+        tmp &= tmp - 1;
+        std::vector<float>& row = dense[i];
+
+        if (outputOffset[idx] >= 0) {
+            row[outputOffset[idx]] = 1.f;
+            continue;
+        }
+        if (bit == AUDIO_CHANNEL_OUT_LOW_FREQUENCY || bit == AUDIO_CHANNEL_OUT_LOW_FREQUENCY_2) {
+            const int other = bit == AUDIO_CHANNEL_OUT_LOW_FREQUENCY ? lfe2 : lfe;
+            if (other >= 0) {
+                row[other] = 1.f;
+                continue;
+            }
+            // As for the stereo downmix: with two LFEs, LFE goes left and LFE2 right,
+            // otherwise the LFE goes to both front channels at 0.5.
+            nearestOnSide(kFrontLeftIdx, AUDIO_GEOMETRY_SIDE_LEFT, outputOffset, left);
+            nearestOnSide(kFrontLeftIdx, AUDIO_GEOMETRY_SIDE_RIGHT, outputOffset, right);
+            if (inputHasLfe2) {
+                addSplit(row, bit == AUDIO_CHANNEL_OUT_LOW_FREQUENCY ? left : right, kMinus3dB);
+            } else if (!left.empty() && !right.empty()) {
+                addSplit(row, left, 0.5f);
+                addSplit(row, right, 0.5f);
+            } else {
+                nearestOnSide(kFrontLeftIdx, AUDIO_GEOMETRY_SIDE_CENTER, outputOffset, center);
+                addSplit(row, center, 0.5f);
+            }
+            continue;
+        }
+
+        const AUDIO_GEOMETRY_SIDE side = sideFromChannelIdx(idx);
+        if (side == AUDIO_GEOMETRY_SIDE_CENTER) {
+            const int centerDistance =
+                    nearestOnSide(idx, AUDIO_GEOMETRY_SIDE_CENTER, outputOffset, center);
+            const int leftDistance =
+                    nearestOnSide(idx, AUDIO_GEOMETRY_SIDE_LEFT, outputOffset, left);
+            nearestOnSide(idx, AUDIO_GEOMETRY_SIDE_RIGHT, outputOffset, right);
+            if (!center.empty() && centerDistance <= leftDistance) {
+                addSplit(row, center, 1.f);
+            } else {
+                addSplit(row, left, kMinus3dB);
+                addSplit(row, right, kMinus3dB);
+            }
+        } else {
+            std::vector<int>& sameSide = side == AUDIO_GEOMETRY_SIDE_LEFT ? left : right;
+            nearestOnSide(idx, side, outputOffset, sameSide);
+            if (!sameSide.empty()) {
+                addSplit(row, sameSide, 1.f);
+            } else {
+                nearestOnSide(idx, AUDIO_GEOMETRY_SIDE_CENTER, outputOffset, center);
+                addSplit(row, center, kMinus3dB);
+            }
+        }
+    }
+}
+
+bool fillDenseMatrix(audio_channel_mask_t inputChannelMask,
+        audio_channel_mask_t outputChannelMask, DenseMatrix& dense) {
+    if (audio_channel_mask_get_representation(inputChannelMask)
+                    == AUDIO_CHANNEL_REPRESENTATION_INDEX
+            || audio_channel_mask_get_representation(outputChannelMask)
+                    == AUDIO_CHANNEL_REPRESENTATION_INDEX) {
+        // Index masks have no geometry, channel i maps to channel i.
+        const size_t channels = std::min(dense.size(), dense.empty() ? 0 : dense[0].size());
+        for (size_t i = 0; i < channels; ++i) dense[i][i] = 1.f;
+        return true;
+    }
     switch (outputChannelMask) {
     case AUDIO_CHANNEL_OUT_STEREO:
+        return fillFromChannelMix<AUDIO_CHANNEL_OUT_STEREO>(inputChannelMask, dense);
     case AUDIO_CHANNEL_OUT_5POINT1:
+        return fillFromChannelMix<AUDIO_CHANNEL_OUT_5POINT1>(inputChannelMask, dense);
     case AUDIO_CHANNEL_OUT_7POINT1:
+        return fillFromChannelMix<AUDIO_CHANNEL_OUT_7POINT1>(inputChannelMask, dense);
     case AUDIO_CHANNEL_OUT_7POINT1POINT4:
+        return fillFromChannelMix<AUDIO_CHANNEL_OUT_7POINT1POINT4>(inputChannelMask, dense);
     case AUDIO_CHANNEL_OUT_9POINT1POINT6:
-        return true;
+        return fillFromChannelMix<AUDIO_CHANNEL_OUT_9POINT1POINT6>(inputChannelMask, dense);
     default:
-        return false;
+        fillGeometricMatrix(inputChannelMask, outputChannelMask, dense);
+        return true;
+    }
+}
+
+std::shared_ptr<const SparseChannelMatrix> computeSparseChannelMatrix(
+        audio_channel_mask_t inputChannelMask, audio_channel_mask_t outputChannelMask) {
+    const size_t inputChannelCount = audio_channel_count_from_out_mask(inputChannelMask);
+    const size_t outputChannelCount = audio_channel_count_from_out_mask(outputChannelMask);
+    DenseMatrix dense(inputChannelCount, std::vector<float>(outputChannelCount));
+    if (!fillDenseMatrix(inputChannelMask, outputChannelMask, dense)) return nullptr;
+
+    auto matrix = std::make_shared<SparseChannelMatrix>();
+    matrix->inputChannelMask = inputChannelMask;
+    matrix->outputChannelMask = outputChannelMask;
+    matrix->inputChannelCount = inputChannelCount;
+    matrix->outputChannelCount = outputChannelCount;
+    matrix->offsets.reserve(outputChannelCount + 1);
+    for (size_t j = 0; j < outputChannelCount; ++j) {
+        matrix->offsets.push_back(matrix->gain.size());
+        for (size_t i = 0; i < inputChannelCount; ++i) {
+            if (dense[i][j] == 0.f) continue;
+            matrix->inputChannel.push_back(i);
+            matrix->gain.push_back(dense[i][j]);
+        }
     }
+    matrix->offsets.push_back(matrix->gain.size());
+    return matrix;
+}
+
+/**
+ * Sparse matrix multiply of src into dst.
+ *
+ * Frames are processed in blocks; for each output channel the nonzero coefficients
+ * are applied as strided gather multiply-adds over the whole block, so the
+ * coefficient loop overhead is amortized over the block and the inner loop
+ * is a simple vectorizable FMA with constant stride.
+ */
+template <bool ACCUMULATE>
+void sparseMatrixProcess(const SparseChannelMatrix& matrix,
+        const float *src, float *dst, size_t frameCount) {
+    constexpr size_t kBlockFrames = 64;
+    const size_t inputChannelCount = matrix.inputChannelCount;
+    const size_t outputChannelCount = matrix.outputChannelCount;
+    const uint32_t* const offsets = matrix.offsets.data();
+    const uint32_t* const inputChannel = matrix.inputChannel.data();
+    const float* const gain = matrix.gain.data();
+    float block[kBlockFrames];
+
+    while (frameCount > 0) {
+        const size_t frames = std::min(frameCount, kBlockFrames);
+        for (size_t j = 0; j < outputChannelCount; ++j) {
+            const uint32_t begin = offsets[j];
+            const uint32_t end = offsets[j + 1];
+            if (begin == end) {
+                std::fill(block, block + frames, 0.f);
+            } else {
+                const float* const in = src + inputChannel[begin];
+                const float g = gain[begin];
+                for (size_t f = 0; f < frames; ++f) {
+                    block[f] = g * in[f * inputChannelCount];
+                }
+                for (uint32_t k = begin + 1; k < end; ++k) {
+                    const float* const in = src + inputChannel[k];
+                    const float g = gain[k];
+                    for (size_t f = 0; f < frames; ++f) {
+                        block[f] += g * in[f * inputChannelCount];
+                    }
+                }
+            }
+            float* const out = dst + j;
+            for (size_t f = 0; f < frames; ++f) {
+                float value = block[f];
+                if constexpr (ACCUMULATE) value += out[f * outputChannelCount];
+                out[f * outputChannelCount] = clamp(value);
+            }
+        }
+        src += frames * inputChannelCount;
+        dst += frames * outputChannelCount;
+        frameCount -= frames;
+    }
+}
+
+} // namespace
+
+std::shared_ptr<const SparseChannelMatrix> getSparseChannelMatrix(
+        audio_channel_mask_t inputChannelMask, audio_channel_mask_t outputChannelMask) {
+    if (!isSupportedChannelMask(inputChannelMask)
+            || !isSupportedChannelMask(outputChannelMask)) {
+        return nullptr;
+    }
+    // The number of distinct mask pairs used by a process is small,
+    // so cached matrices are never evicted.
+    [[clang::no_destroy]] static std::mutex lock;
+    [[clang::no_destroy]] static std::map<std::pair<audio_channel_mask_t, audio_channel_mask_t>,
+            std::shared_ptr<const SparseChannelMatrix>> cache;
+
+    const auto key = std::make_pair(inputChannelMask, outputChannelMask);
+    std::lock_guard lg(lock);
+    auto it = cache.find(key);
+    if (it == cache.end()) {
+        auto matrix = computeSparseChannelMatrix(inputChannelMask, outputChannelMask);
+        if (!matrix) return nullptr;
+        it = cache.emplace(key, std::move(matrix)).first;
+    }
+    return it->second;
+}
+
+bool RuntimeChannelMix::setInputChannelMask(audio_channel_mask_t inputChannelMask) {
+    if (mMatrix && mMatrix->inputChannelMask == inputChannelMask) return true;
+    auto matrix = getSparseChannelMatrix(inputChannelMask, mOutputChannelMask);
+    if (!matrix) return false;
+    mMatrix = std::move(matrix);
+    return true;
+}
+
+bool RuntimeChannelMix::process(const float *src, float *dst, size_t frameCount,
+        bool accumulate) const {
+    if (!mMatrix) return false;
+    if (accumulate) {
+        sparseMatrixProcess<true /* ACCUMULATE */>(*mMatrix, src, dst, frameCount);
+    } else {
+        sparseMatrixProcess<false /* ACCUMULATE */>(*mMatrix, src, dst, frameCount);
+    }
+    return true;
+}
+
+/* static */
+bool RuntimeChannelMix::isOutputChannelMaskSupported(audio_channel_mask_t outputChannelMask) {
+    return isSupportedChannelMask(outputChannelMask);
 }
 
 } // android::audio_utils::channels
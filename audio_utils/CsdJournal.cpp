@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// #define LOG_NDEBUG 0
+#define LOG_TAG "audio_utils_CsdJournal"
+
+#include <audio_utils/CsdJournal.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <errno.h>
+#include <string.h>
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HAVE_MMAP
+#endif
+
+#include <audio_utils/MelAggregator.h>
+#include <utils/Log.h>
+
+namespace android::audio_utils {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x4a445343;  // "CSDJ"
+constexpr uint32_t kVersion = 1;
+
+} // namespace
+
+// static
+std::unique_ptr<CsdJournal> CsdJournal::open(const std::string& path, size_t capacity) {
+    if (capacity < 2) {
+        ALOGE("%s: invalid capacity %zu", __func__, capacity);
+        return nullptr;
+    }
+#ifdef HAVE_MMAP
+    const int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            ALOGW("%s: cannot open %s: %s, recreating", __func__, path.c_str(), strerror(errno));
+        }
+        return create(path, capacity, 0.f, {});
+    }
+
+    struct stat st;
+    Header header;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(header))
+            || pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))
+            || header.magic != kMagic || header.version != kVersion
+            || header.capacity < 2
+            || header.checkpoint.load(std::memory_order_relaxed) >= header.capacity
+            || static_cast<uint64_t>(st.st_size) != (header.capacity + 1) * sizeof(Entry)) {
+        ALOGW("%s: %s is not a valid journal, recreating", __func__, path.c_str());
+        close(fd);
+        return create(path, capacity, 0.f, {});
+    }
+
+    void* const map = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        ALOGE("%s: cannot map %s: %s", __func__, path.c_str(), strerror(errno));
+        close(fd);
+        return nullptr;
+    }
+    std::unique_ptr<CsdJournal> journal(new CsdJournal(path, fd, map, header.capacity));
+    size_t checkpoint = journal->header()->checkpoint.load(std::memory_order_acquire);
+    if (!journal->isCheckpoint(checkpoint)) {
+        // Only the first checkpoint is synced, see checkpoint(), so after a power loss
+        // the header may be on storage without the checkpoint it refers to.
+        ALOGW("%s: %s checkpoint %zu is incomplete, restoring from the first",
+                __func__, path.c_str(), checkpoint);
+        checkpoint = 0;
+        if (!journal->isCheckpoint(checkpoint)) {
+            ALOGE("%s: %s has no valid checkpoint, recreating", __func__, path.c_str());
+            return create(path, capacity, 0.f, {});
+        }
+        journal->header()->checkpoint.store(checkpoint, std::memory_order_release);
+    }
+
+    // Entries after an incomplete write are still valid from before the crash,
+    // they must not be replayed once new entries are appended before them.
+    journal->mSize = journal->findEnd();
+    for (size_t i = journal->mSize; i < journal->mCapacity && journal->entries()[i].checksum != 0;
+            ++i) {
+        journal->entries()[i].checksum = 0;
+    }
+    ALOGV("%s: %s checkpoint %zu size %zu", __func__, path.c_str(), checkpoint, journal->mSize);
+    return journal;
+#else
+    (void)path;
+    ALOGW("%s: memory mapped files are not available", __func__);
+    return nullptr;
+#endif
+}
+
+// static
+std::unique_ptr<CsdJournal> CsdJournal::create(const std::string& path, size_t capacity,
+        float csd, const std::vector<CsdRecord>& records) {
+#ifdef HAVE_MMAP
+    capacity = std::max(capacity, records.size() + 1);
+    const size_t bytes = (capacity + 1) * sizeof(Entry);
+
+    // The new journal replaces the old file only once it is complete.
+    const std::string tmpPath = path + ".tmp";
+    const int fd = ::open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        ALOGE("%s: cannot create %s: %s", __func__, tmpPath.c_str(), strerror(errno));
+        return nullptr;
+    }
+    void* map = MAP_FAILED;
+    if (ftruncate(fd, bytes) == 0) {
+        map = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (map == MAP_FAILED) {
+        ALOGE("%s: cannot map %s: %s", __func__, tmpPath.c_str(), strerror(errno));
+        close(fd);
+        unlink(tmpPath.c_str());
+        return nullptr;
+    }
+    std::unique_ptr<CsdJournal> journal(new CsdJournal(path, fd, map, capacity));
+
+    Header* const header = journal->header();
+    header->magic = kMagic;
+    header->version = kVersion;
+    header->capacity = capacity;
+    header->checkpoint.store(0, std::memory_order_relaxed);
+    journal->writeCheckpoint(0, csd, records);
+    journal->mSize = records.size() + 1;
+
+    if (msync(map, bytes, MS_SYNC) != 0 || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        ALOGE("%s: cannot write %s: %s", __func__, path.c_str(), strerror(errno));
+        unlink(tmpPath.c_str());
+        return nullptr;
+    }
+    return journal;
+#else
+    (void)path;
+    (void)capacity;
+    (void)csd;
+    (void)records;
+    return nullptr;
+#endif
+}
+
+CsdJournal::CsdJournal(std::string path, int fd, void* map, size_t capacity)
+    : mPath(std::move(path))
+    , mFd(fd)
+    , mMap(map)
+    , mCapacity(capacity) {}
+
+CsdJournal::~CsdJournal() {
+#ifdef HAVE_MMAP
+    munmap(mMap, (mCapacity + 1) * sizeof(Entry));
+    close(mFd);
+#endif
+}
+
+// static
+uint32_t CsdJournal::checksum(const Entry& entry, size_t index) {
+    // FNV-1a of the entry content and of its index, so that a torn or
+    // misplaced entry is not mistaken for a valid one.
+    uint32_t hash = 2166136261u;
+    const auto add = [&hash](const void* data, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ static_cast<const uint8_t*>(data)[i]) * 16777619u;
+        }
+    };
+    add(&entry, offsetof(Entry, checksum));
+    const uint64_t index64 = index;
+    add(&index64, sizeof(index64));
+    return hash != 0 ? hash : 1;  // 0 is an unwritten entry
+}
+
+bool CsdJournal::isValid(size_t index) const {
+    const Entry& entry = entries()[index];
+    const uint32_t sum = entry.checksum;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return sum != 0 && sum == checksum(entry, index)
+            && (entry.type == kRecord || entry.type == kCheckpoint);
+}
+
+bool CsdJournal::isCheckpoint(size_t index) const {
+    return index < mCapacity && isValid(index) && entries()[index].type == kCheckpoint;
+}
+
+void CsdJournal::write(size_t index, const Entry& entry) {
+    Entry* const dst = &entries()[index];
+    dst->checksum = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    dst->timestamp = entry.timestamp;
+    dst->duration = entry.duration;
+    dst->value = entry.value;
+    dst->averageMel = entry.averageMel;
+    dst->type = entry.type;
+    std::atomic_thread_fence(std::memory_order_release);
+    dst->checksum = checksum(*dst, index);
+}
+
+void CsdJournal::writeRecord(size_t index, const CsdRecord& record) {
+    write(index, {record.timestamp, static_cast<int64_t>(record.duration), record.value,
+            record.averageMel, kRecord, 0 /* checksum */});
+}
+
+void CsdJournal::writeCheckpoint(size_t index, float csd, const std::vector<CsdRecord>& records) {
+    write(index, {static_cast<int64_t>(records.size()), 0 /* duration */, csd,
+            0.f /* averageMel */, kCheckpoint, 0 /* checksum */});
+    for (size_t i = 0; i < records.size(); ++i) {
+        writeRecord(index + 1 + i, records[i]);
+    }
+}
+
+size_t CsdJournal::findEnd() const {
+    size_t index = header()->checkpoint.load(std::memory_order_acquire);
+    while (index < mCapacity && isValid(index)) {
+        const Entry& entry = entries()[index];
+        if (entry.type == kCheckpoint) {
+            // a checkpoint is only complete with all its records
+            const uint64_t count = entry.timestamp;
+            if (count >= mCapacity - index) break;
+            size_t i = 1;
+            while (i <= count && isValid(index + i) && entries()[index + i].type == kRecord) ++i;
+            if (i <= count) break;
+            index += count + 1;
+        } else {
+            ++index;
+        }
+    }
+    return index;
+}
+
+void CsdJournal::restore(float* csd, std::vector<CsdRecord>* records) const {
+    struct Record {
+        int64_t timestamp;
+        int64_t duration;
+        float value;
+        float averageMel;
+    };
+    std::vector<Record> restored;
+    float restoredCsd = 0.f;
+
+    for (size_t index = header()->checkpoint.load(std::memory_order_acquire); index < mSize; ) {
+        const Entry& entry = entries()[index];
+        if (entry.type == kCheckpoint) {
+            // the last checkpoint may not be in the header if the process crashed after it
+            restoredCsd = entry.value;
+            restored.clear();
+            const size_t count = entry.timestamp;
+            for (size_t i = 1; i <= count; ++i) {
+                const Entry& record = entries()[index + i];
+                restored.push_back({record.timestamp, record.duration, record.value,
+                        record.averageMel});
+            }
+            index += count + 1;
+            continue;
+        }
+        if (std::signbit(entry.value)) {
+            // reverted record, usually the oldest
+            const auto it = std::find_if(restored.begin(), restored.end(),
+                    [&entry](const Record& record) {
+                        return record.timestamp == entry.timestamp
+                                && record.duration == entry.duration;
+                    });
+            if (it != restored.end()) restored.erase(it);
+        } else {
+            restored.push_back({entry.timestamp, entry.duration, entry.value, entry.averageMel});
+        }
+        restoredCsd += entry.value;
+        ++index;
+    }
+
+    *csd = restoredCsd;
+    records->clear();
+    records->reserve(restored.size());
+    for (const Record& record : restored) {
+        records->emplace_back(record.timestamp, record.duration, record.value, record.averageMel);
+    }
+}
+
+status_t CsdJournal::append(const std::vector<CsdRecord>& records) {
+    if (records.size() > mCapacity - mSize) {
+        return NO_MEMORY;
+    }
+    for (const CsdRecord& record : records) {
+        writeRecord(mSize++, record);
+    }
+    mRecordsSinceCheckpoint += records.size();
+    return NO_ERROR;
+}
+
+bool CsdJournal::needsCheckpoint() const {
+    return mRecordsSinceCheckpoint >= kCheckpointInterval;
+}
+
+status_t CsdJournal::checkpoint(float csd, const std::vector<CsdRecord>& records) {
+    const size_t entries = records.size() + 1;
+    if (entries > mCapacity - mSize) {
+        // compact into a new file, large enough for a few checkpoints
+        std::unique_ptr<CsdJournal> journal =
+                create(mPath, std::max(mCapacity, 2 * entries), csd, records);
+        if (journal == nullptr) return NO_INIT;
+        std::swap(mFd, journal->mFd);
+        std::swap(mMap, journal->mMap);
+        std::swap(mCapacity, journal->mCapacity);
+        mSize = journal->mSize;
+        mRecordsSinceCheckpoint = 0;
+        return NO_ERROR;
+    }
+
+    const size_t index = mSize;
+    writeCheckpoint(index, csd, records);
+    mSize += entries;
+    mRecordsSinceCheckpoint = 0;
+
+    // This is called with the MelAggregator lock held, so the file is not synced here,
+    // only when compacted.  If the header reaches storage before the checkpoint,
+    // open() restores from the first checkpoint, which was synced.
+    header()->checkpoint.store(index, std::memory_order_release);
+#ifdef HAVE_MMAP
+    msync(mMap, (mCapacity + 1) * sizeof(Entry), MS_ASYNC);
+#endif
+    return NO_ERROR;
+}
+
+} // namespace android::audio_utils
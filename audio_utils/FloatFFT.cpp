@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// #define LOG_NDEBUG 0
+#define LOG_TAG "audio_utils_FloatFFT"
+
+#include <audio_utils/FloatFFT.h>
+
+#include <cmath>
+#include <log/log.h>
+
+namespace android::audio_utils {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+} // namespace
+
+FloatFFT::FloatFFT(size_t size)
+    : mSize(size)
+    , mHalf(size / 2)
+{
+    LOG_ALWAYS_FATAL_IF(!isValidSize(size), "%s: invalid size %zu", __func__, size);
+
+    size_t log2Half = 0;
+    while ((size_t{1} << log2Half) < mHalf) ++log2Half;
+
+    mBitReverse.resize(mHalf);
+    for (size_t i = 0; i < mHalf; ++i) {
+        uint32_t reversed = 0;
+        for (size_t bit = 0; bit < log2Half; ++bit) {
+            reversed |= ((i >> bit) & 1) << (log2Half - 1 - bit);
+        }
+        mBitReverse[i] = reversed;
+    }
+
+    // Stage twiddles for the complex transform: stage with half span h uses
+    // exp(-pi i j / h) for j in [0, h), stored contiguously at offset h - 1.
+    mStageCos.resize(mHalf - 1);
+    mStageSin.resize(mHalf - 1);
+    for (size_t h = 1; h < mHalf; h <<= 1) {
+        for (size_t j = 0; j < h; ++j) {
+            const double phase = kPi * j / h;
+            mStageCos[h - 1 + j] = std::cos(phase);
+            mStageSin[h - 1 + j] = std::sin(phase);
+        }
+    }
+
+    // Twiddles W^k = exp(-2 pi i k / N) used to split the packed complex transform.
+    mRealCos.resize(mHalf + 1);
+    mRealSin.resize(mHalf + 1);
+    for (size_t k = 0; k <= mHalf; ++k) {
+        const double phase = 2. * kPi * k / mSize;
+        mRealCos[k] = std::cos(phase);
+        mRealSin[k] = -std::sin(phase);
+    }
+
+    mScratchRe.resize(mHalf);
+    mScratchIm.resize(mHalf);
+}
+
+template <bool INVERSE>
+void FloatFFT::complexTransform(float* re, float* im) const {
+    // Iterative radix-2 decimation in time on bit-reversed input.
+    for (size_t h = 1; h < mHalf; h <<= 1) {
+        const float* const wr = &mStageCos[h - 1];
+        const float* const wi = &mStageSin[h - 1];
+        for (size_t s = 0; s < mHalf; s += 2 * h) {
+            float* const ar = re + s;
+            float* const ai = im + s;
+            float* const br = ar + h;
+            float* const bi = ai + h;
+            for (size_t j = 0; j < h; ++j) {
+                float tr, ti;
+                if constexpr (INVERSE) {
+                    tr = br[j] * wr[j] - bi[j] * wi[j];
+                    ti = bi[j] * wr[j] + br[j] * wi[j];
+                } else {
+                    tr = br[j] * wr[j] + bi[j] * wi[j];
+                    ti = bi[j] * wr[j] - br[j] * wi[j];
+                }
+                br[j] = ar[j] - tr;
+                bi[j] = ai[j] - ti;
+                ar[j] += tr;
+                ai[j] += ti;
+            }
+        }
+    }
+}
+
+void FloatFFT::forward(const float* in, float* re, float* im) {
+    float* const zr = mScratchRe.data();
+    float* const zi = mScratchIm.data();
+
+    // Pack z[n] = x[2n] + i x[2n + 1] in bit-reversed order.
+    for (size_t n = 0; n < mHalf; ++n) {
+        const uint32_t r = mBitReverse[n];
+        zr[r] = in[2 * n];
+        zi[r] = in[2 * n + 1];
+    }
+    complexTransform<false /* INVERSE */>(zr, zi);
+
+    // Split Z into the transforms of the even and odd samples and recombine.
+    for (size_t k = 0; k <= mHalf; ++k) {
+        const size_t k1 = k == mHalf ? 0 : k;
+        const size_t k2 = k == 0 ? 0 : mHalf - k;
+        const float er = 0.5f * (zr[k1] + zr[k2]);
+        const float ei = 0.5f * (zi[k1] - zi[k2]);
+        const float orr = 0.5f * (zi[k1] + zi[k2]);
+        const float oi = -0.5f * (zr[k1] - zr[k2]);
+        const float c = mRealCos[k];
+        const float s = mRealSin[k];
+        re[k] = er + c * orr - s * oi;
+        im[k] = ei + c * oi + s * orr;
+    }
+    im[0] = 0.f;
+    im[mHalf] = 0.f;
+}
+
+void FloatFFT::inverse(const float* re, const float* im, float* out) {
+    float* const zr = mScratchRe.data();
+    float* const zi = mScratchIm.data();
+
+    // Rebuild the packed transform Z[k] = Ze[k] + i Zo[k] (scaled by 2) in bit-reversed order.
+    for (size_t k = 0; k < mHalf; ++k) {
+        const size_t k2 = mHalf - k;
+        const float ar = re[k];
+        const float ai = k == 0 ? 0.f : im[k];
+        const float br = re[k2];
+        const float bi = k2 == mHalf ? 0.f : im[k2];
+        const float er = ar + br;
+        const float ei = ai - bi;
+        const float dr = ar - br;
+        const float di = ai + bi;
+        const float c = mRealCos[k];
+        const float s = mRealSin[k];
+        const float orr = dr * c + di * s;
+        const float oi = di * c - dr * s;
+        const uint32_t r = mBitReverse[k];
+        zr[r] = er - oi;
+        zi[r] = ei + orr;
+    }
+    complexTransform<true /* INVERSE */>(zr, zi);
+
+    for (size_t n = 0; n < mHalf; ++n) {
+        out[2 * n] = zr[n];
+        out[2 * n + 1] = zi[n];
+    }
+}
+
+} // namespace android::audio_utils
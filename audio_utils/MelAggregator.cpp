@@ -19,8 +19,8 @@
 
 #include <audio_utils/MelAggregator.h>
 #include <audio_utils/power.h>
+#include <algorithm>
 #include <cinttypes>
-#include <iterator>
 #include <utils/Log.h>
 
 namespace android::audio_utils {
@@ -35,53 +35,38 @@ constexpr float kCsdThreshold = 5760.0f; // 1.6f(Pa^2h) * 3600.0f(s);
 /** Reference energy used for dB calculation in Pa^2. */
 constexpr float kReferenceEnergyPa = 4e-10;
 
-/**
- * Checking the intersection of the time intervals of v1 and v2. Each MelRecord v
- * spawns an interval [t1, t2) if and only if:
- *    v.timestamp == t1 && v.mels.size() == t2 - t1
- **/
-std::pair<int64_t, int64_t> intersectRegion(const MelRecord& v1, const MelRecord& v2)
-{
-    const int64_t maxStart = std::max(v1.timestamp, v2.timestamp);
-    const int64_t v1End = v1.timestamp + v1.mels.size();
-    const int64_t v2End = v2.timestamp + v2.mels.size();
-    const int64_t minEnd = std::min(v1End, v2End);
-    return {maxStart, minEnd};
+float melToEnergy(float mel) {
+    return powf(10.f, mel / 10.f);
 }
 
-float aggregateMels(const float mel1, const float mel2) {
-    return audio_utils_power_from_energy(powf(10.f, mel1 / 10.f) + powf(10.f, mel2 / 10.f));
+float energyToCsd(float energy) {
+    return kReferenceEnergyPa * energy / kCsdThreshold;
 }
 
-float averageMelEnergy(const float mel1,
-                       const int64_t duration1,
-                       const float mel2,
-                       const int64_t duration2) {
-    return audio_utils_power_from_energy((powf(10.f, mel1 / 10.f) * duration1
-        + powf(10.f, mel2 / 10.f) * duration2) / (duration1 + duration2));
-}
+}  // namespace
 
-float melToCsd(float mel) {
-    float energy = powf(10.f, mel / 10.0f);
-    return kReferenceEnergyPa * energy / kCsdThreshold;
+MelAggregator::CsdEntry& MelAggregator::csdEntry_l(size_t index)
+{
+    const size_t position = mCsdRecordsFront + index;
+    return mCsdRecords[position < mCsdRecords.size() ? position : position - mCsdRecords.size()];
 }
 
-CsdRecord createRevertedRecord(const CsdRecord& record) {
-    return {record.timestamp, record.duration, -record.value, record.averageMel};
+const MelAggregator::CsdEntry& MelAggregator::csdEntry_l(size_t index) const
+{
+    const size_t position = mCsdRecordsFront + index;
+    return mCsdRecords[position < mCsdRecords.size() ? position : position - mCsdRecords.size()];
 }
 
-}  // namespace
-
 int64_t MelAggregator::csdTimeIntervalStored_l()
 {
-    return mCsdRecords.rbegin()->second.timestamp + mCsdRecords.rbegin()->second.duration
-        - mCsdRecords.begin()->second.timestamp;
+    const CsdEntry& newest = csdEntry_l(mCsdRecordsSize - 1);
+    return newest.timestamp + newest.duration - csdEntry_l(0).timestamp;
 }
 
-std::map<int64_t, CsdRecord>::iterator MelAggregator::addNewestCsdRecord_l(int64_t timestamp,
-                                                                           int64_t duration,
-                                                                           float csdRecord,
-                                                                           float averageMel)
+CsdRecord MelAggregator::addCsdRecord_l(int64_t timestamp,
+                                        int64_t duration,
+                                        float csdRecord,
+                                        float averageMel)
 {
     ALOGV("%s: add new csd[%" PRId64 ", %" PRId64 "]=%f for MEL avg %f",
                       __func__,
@@ -90,78 +75,161 @@ std::map<int64_t, CsdRecord>::iterator MelAggregator::addNewestCsdRecord_l(int64
                       csdRecord,
                       averageMel);
 
+    if (mCsdRecordsSize == mCsdRecords.size()) {
+        // only grows until the records span the CSD window
+        std::vector<CsdEntry> records(std::max(mCsdRecords.size() * 2, size_t{64}));
+        for (size_t i = 0; i < mCsdRecordsSize; ++i) {
+            records[i] = csdEntry_l(i);
+        }
+        mCsdRecords.swap(records);
+        mCsdRecordsFront = 0;
+    }
+
+    // keep the records sorted, new records are usually the newest
+    size_t index = mCsdRecordsSize++;
+    for (; index > 0 && csdEntry_l(index - 1).timestamp > timestamp; --index) {
+        csdEntry_l(index) = csdEntry_l(index - 1);
+    }
+    csdEntry_l(index) = {timestamp, duration, csdRecord, averageMel};
+
     mCurrentCsd += csdRecord;
-    return mCsdRecords.emplace_hint(mCsdRecords.end(),
-                                    timestamp,
-                                    CsdRecord(timestamp,
-                                              duration,
-                                              csdRecord,
-                                              averageMel));
+    return CsdRecord(timestamp, duration, csdRecord, averageMel);
 }
 
 void MelAggregator::removeOldCsdRecords_l(std::vector<CsdRecord>& removeRecords) {
     // Remove older CSD values
-    while (!mCsdRecords.empty() && csdTimeIntervalStored_l() > mCsdWindowSeconds) {
-        mCurrentCsd -= mCsdRecords.begin()->second.value;
-        removeRecords.emplace_back(createRevertedRecord(mCsdRecords.begin()->second));
-        mCsdRecords.erase(mCsdRecords.begin());
+    while (mCsdRecordsSize > 0 && csdTimeIntervalStored_l() > mCsdWindowSeconds) {
+        const CsdEntry& oldest = csdEntry_l(0);
+        mCurrentCsd -= oldest.value;
+        // reverted record
+        removeRecords.emplace_back(oldest.timestamp, oldest.duration, -oldest.value,
+                                   oldest.averageMel);
+        mCsdRecordsFront = mCsdRecordsFront + 1 < mCsdRecords.size() ? mCsdRecordsFront + 1 : 0;
+        --mCsdRecordsSize;
     }
 }
 
-std::vector<CsdRecord> MelAggregator::updateCsdRecords_l()
+MelAggregator::MelBucket& MelAggregator::melBucket_l(int64_t timestamp)
 {
-    std::vector<CsdRecord> newRecords;
+    const int64_t index = timestamp % kMelCacheSeconds;
+    return mMelBuckets[index >= 0 ? index : index + kMelCacheSeconds];
+}
 
-    // only update if we are above threshold
-    if (mCurrentMelRecordsCsd < kMinCsdRecordToStore) {
-        removeOldCsdRecords_l(newRecords);
-        return newRecords;
+const MelAggregator::MelBucket& MelAggregator::melBucket_l(int64_t timestamp) const
+{
+    const int64_t index = timestamp % kMelCacheSeconds;
+    return mMelBuckets[index >= 0 ? index : index + kMelCacheSeconds];
+}
+
+bool MelAggregator::isMelCached_l(int64_t timestamp) const
+{
+    return timestamp >= mMelCacheStart && timestamp < mMelCacheEnd
+            && melBucket_l(timestamp).energy > 0.f;
+}
+
+void MelAggregator::addMelValues_l(audio_port_handle_t portId,
+                                   const float* mels,
+                                   size_t size,
+                                   int64_t timestamp)
+{
+    // the cached records overlapping [timestamp, end) are merged with the new values
+    const int64_t end = timestamp + static_cast<int64_t>(size);
+    int64_t mergedStart = timestamp;
+    size_t mergedRecords = 0;
+    if (isMelCached_l(timestamp) && !melBucket_l(timestamp).recordStart) {
+        while (!melBucket_l(mergedStart).recordStart) {
+            --mergedStart;
+        }
+        ++mergedRecords;
+    }
+    // the caller ensures that the cache spans at most kMelCacheSeconds, so the
+    // buckets outside of the current span are empty.
+    if (mMelCacheStart == mMelCacheEnd) {
+        mMelCacheStart = timestamp;
+        mMelCacheEnd = end;
+    } else {
+        mMelCacheStart = std::min(mMelCacheStart, timestamp);
+        mMelCacheEnd = std::max(mMelCacheEnd, end);
     }
 
-    float converted = 0.f;
-    float averageMel = 0.f;
-    float csdValue = 0.f;
-    int64_t duration = 0;
-    int64_t timestamp = mMelRecords.begin()->first;
-    for (const auto& storedMel: mMelRecords) {
-        int melsIdx = 0;
-        for (const auto& mel: storedMel.second.mels) {
-            averageMel = averageMelEnergy(averageMel, duration, mel, 1.f);
-            csdValue += melToCsd(mel);
-            ++duration;
-            if (csdValue >= kMinCsdRecordToStore
-                && mCurrentMelRecordsCsd - converted - csdValue >= kMinCsdRecordToStore) {
-                auto it = addNewestCsdRecord_l(timestamp,
-                                               duration,
-                                               csdValue,
-                                               averageMel);
-                newRecords.emplace_back(it->second);
-
-                duration = 0;
-                averageMel = 0.f;
-                converted += csdValue;
-                csdValue = 0.f;
-                timestamp = storedMel.first + melsIdx;
-            }
-            ++ melsIdx;
+    for (size_t i = 0; i < size; ++i) {
+        MelBucket& bucket = melBucket_l(timestamp + static_cast<int64_t>(i));
+        if (bucket.recordStart) {
+            ++mergedRecords;
+            bucket.recordStart = false;
         }
+        const float energy = melToEnergy(mels[i]);
+        bucket.energy += energy;
+        mCurrentMelRecordsCsd += energyToCsd(energy);
     }
 
-    if(csdValue > 0) {
-        auto it = addNewestCsdRecord_l(timestamp,
-                                       duration,
-                                       csdValue,
-                                       averageMel);
-        newRecords.emplace_back(it->second);
+    MelBucket& first = melBucket_l(mergedStart);
+    first.recordStart = true;
+    first.portId = portId;
+    mCachedMelRecords = mCachedMelRecords + 1 - mergedRecords;
+}
+
+void MelAggregator::clearMelCache_l()
+{
+    for (int64_t time = mMelCacheStart; time < mMelCacheEnd; ++time) {
+        melBucket_l(time) = {};
     }
+    mMelCacheStart = mMelCacheEnd = 0;
+    mCachedMelRecords = 0;
+    mCurrentMelRecordsCsd = 0.f;
+}
 
-    removeOldCsdRecords_l(newRecords);
+void MelAggregator::convertCachedMels_l(CsdConversion& conversion,
+                                        std::vector<CsdRecord>& newRecords)
+{
+    for (int64_t time = mMelCacheStart; time < mMelCacheEnd; ++time) {
+        const float melEnergy = melBucket_l(time).energy;
+        if (melEnergy == 0.f) {
+            continue;
+        }
+        if (conversion.duration == 0) {
+            conversion.timestamp = time;
+        }
+        conversion.energy += melEnergy;
+        conversion.csd += energyToCsd(melEnergy);
+        ++conversion.duration;
+        if (conversion.csd >= kMinCsdRecordToStore
+            && conversion.total - conversion.converted - conversion.csd
+                    >= kMinCsdRecordToStore) {
+            conversion.converted += conversion.csd;
+            finishConversion_l(conversion, newRecords);
+        }
+    }
 
     // reset mel values
-    mCurrentMelRecordsCsd = 0.0f;
-    mMelRecords.clear();
+    clearMelCache_l();
+}
 
-    return newRecords;
+void MelAggregator::finishConversion_l(CsdConversion& conversion,
+                                       std::vector<CsdRecord>& newRecords)
+{
+    if (conversion.csd > 0) {
+        newRecords.emplace_back(addCsdRecord_l(conversion.timestamp,
+                                               conversion.duration,
+                                               conversion.csd,
+                                               audio_utils_power_from_energy(
+                                                       conversion.energy / conversion.duration)));
+    }
+    conversion.duration = 0;
+    conversion.energy = 0.f;
+    conversion.csd = 0.f;
+}
+
+void MelAggregator::updateCsdRecords_l(std::vector<CsdRecord>& newRecords)
+{
+    // only update if we are above threshold
+    if (mCurrentMelRecordsCsd >= kMinCsdRecordToStore) {
+        CsdConversion conversion{.total = mCurrentMelRecordsCsd};
+        convertCachedMels_l(conversion, newRecords);
+        finishConversion_l(conversion, newRecords);
+    }
+
+    removeOldCsdRecords_l(newRecords);
 }
 
 std::vector<CsdRecord> MelAggregator::aggregateAndAddNewMelRecord(const MelRecord& mel)
@@ -172,91 +240,129 @@ std::vector<CsdRecord> MelAggregator::aggregateAndAddNewMelRecord(const MelRecor
 
 std::vector<CsdRecord> MelAggregator::aggregateAndAddNewMelRecord_l(const MelRecord& mel)
 {
-    for (const auto& m : mel.mels) {
-        mCurrentMelRecordsCsd += melToCsd(m);
-    }
-    ALOGV("%s: current mel values CSD %f", __func__, mCurrentMelRecordsCsd);
-
-    auto mergeIt = mMelRecords.lower_bound(mel.timestamp);
-
-    if (mergeIt != mMelRecords.begin()) {
-        auto prevMergeIt = std::prev(mergeIt);
-        if (prevMergeIt->second.overlapsEnd(mel)) {
-            mergeIt = prevMergeIt;
-        }
-    }
-
-    int64_t newTimestamp = mel.timestamp;
-    std::vector<float> newMels = mel.mels;
-    auto mergeStart = mergeIt;
-    int overlapStart = 0;
-    while(mergeIt != mMelRecords.end()) {
-        const auto& [melRecordStart, melRecord] = *mergeIt;
-        const auto [regionStart, regionEnd] = intersectRegion(melRecord, mel);
-        if (regionStart >= regionEnd) {
-            // no intersection
-            break;
-        }
-
-        if (melRecordStart < regionStart) {
-            newTimestamp = melRecordStart;
-            overlapStart = regionStart - melRecordStart;
-            newMels.insert(newMels.begin(), melRecord.mels.begin(),
-                           melRecord.mels.begin() + overlapStart);
-        }
+    std::vector<CsdRecord> newRecords;
 
-        for (int64_t aggregateTime = regionStart; aggregateTime < regionEnd; ++aggregateTime) {
-            const int offsetStored = aggregateTime - melRecordStart;
-            const int offsetNew = aggregateTime - mel.timestamp;
-            newMels[overlapStart + offsetNew] =
-                aggregateMels(melRecord.mels[offsetStored], mel.mels[offsetNew]);
+    // Records which do not fit in the cache are added in parts. The cached values
+    // are converted to make room, in the same CSD records as the rest of the record
+    // when their total is above threshold, as if the cache was unbounded.
+    CsdConversion conversion;
+    bool converting = false;
+    size_t offset = 0;
+    do {
+        const size_t size = std::min(mel.mels.size() - offset, size_t{kMelCacheSeconds});
+        const int64_t timestamp = mel.timestamp + static_cast<int64_t>(offset);
+        if (mMelCacheStart != mMelCacheEnd
+                && std::max(mMelCacheEnd, timestamp + static_cast<int64_t>(size))
+                        - std::min(mMelCacheStart, timestamp) > kMelCacheSeconds) {
+            if (!converting) {
+                conversion.total = mCurrentMelRecordsCsd;
+                for (size_t i = offset; i < mel.mels.size(); ++i) {
+                    conversion.total += energyToCsd(melToEnergy(mel.mels[i]));
+                }
+                converting = conversion.total >= kMinCsdRecordToStore;
+            }
+            convertCachedMels_l(conversion, newRecords);
+            if (!converting) {
+                // values below threshold spanning more than the cache
+                finishConversion_l(conversion, newRecords);
+            }
         }
+        addMelValues_l(mel.portId, mel.mels.data() + offset, size, timestamp);
+        offset += size;
+    } while (offset < mel.mels.size());
+    ALOGV("%s: current mel values CSD %f", __func__, mCurrentMelRecordsCsd);
 
-        const int64_t mergeEndTime = melRecordStart + melRecord.mels.size();
-        if (mergeEndTime > regionEnd) {
-            newMels.insert(newMels.end(),
-                           melRecord.mels.end() - mergeEndTime + regionEnd,
-                           melRecord.mels.end());
-        }
+    if (converting) {
+        convertCachedMels_l(conversion, newRecords);
+        finishConversion_l(conversion, newRecords);
+    }
+    updateCsdRecords_l(newRecords);
+    journal_l(newRecords);
+    return newRecords;
+}
 
-        ++mergeIt;
+void MelAggregator::journal_l(const std::vector<CsdRecord>& newRecords)
+{
+    if (mJournal == nullptr || newRecords.empty()) {
+        return;
+    }
+    if (mJournal->append(newRecords) != NO_ERROR || mJournal->needsCheckpoint()) {
+        checkpointJournal_l();
     }
+}
 
-    auto hint = mergeIt;
-    if (mergeStart != mergeIt) {
-        hint = mMelRecords.erase(mergeStart, mergeIt);
+void MelAggregator::checkpointJournal_l()
+{
+    std::vector<CsdRecord> records;
+    records.reserve(mCsdRecordsSize);
+    for (size_t i = 0; i < mCsdRecordsSize; ++i) {
+        const CsdEntry& entry = csdEntry_l(i);
+        records.emplace_back(entry.timestamp, entry.duration, entry.value, entry.averageMel);
+    }
+    if (status_t status = mJournal->checkpoint(mCurrentCsd, records); status != NO_ERROR) {
+        ALOGE("%s: cannot write CSD journal checkpoint: %d", __func__, status);
     }
+}
 
-    mMelRecords.emplace_hint(hint,
-                             newTimestamp,
-                             MelRecord(mel.portId, newMels, newTimestamp));
+status_t MelAggregator::openJournal(const std::string& path)
+{
+    std::unique_ptr<CsdJournal> journal = CsdJournal::open(path);
+    if (journal == nullptr) {
+        return NO_INIT;
+    }
+    float csd;
+    std::vector<CsdRecord> records;
+    journal->restore(&csd, &records);
+    ALOGV("%s: restored %zu CSD records, CSD %f", __func__, records.size(), csd);
 
-    return updateCsdRecords_l();
+    std::lock_guard _l(mLock);
+    reset_l(csd, records);
+    mJournal = std::move(journal);
+    return NO_ERROR;
 }
 
 void MelAggregator::reset(float newCsd, const std::vector<CsdRecord>& newRecords)
 {
     std::lock_guard _l(mLock);
-    mCsdRecords.clear();
-    mMelRecords.clear();
+    reset_l(newCsd, newRecords);
+    if (mJournal != nullptr) {
+        checkpointJournal_l();
+    }
+}
+
+void MelAggregator::reset_l(float newCsd, const std::vector<CsdRecord>& newRecords)
+{
+    clearMelCache_l();
+    mCsdRecordsFront = 0;
+    mCsdRecordsSize = 0;
 
-    mCurrentCsd = newCsd;
     for (const auto& record : newRecords) {
-        mCsdRecords.emplace_hint(mCsdRecords.end(), record.timestamp, record);
+        addCsdRecord_l(record.timestamp, record.duration, record.value, record.averageMel);
     }
+    mCurrentCsd = newCsd;
 }
 
 size_t MelAggregator::getCachedMelRecordsSize() const
 {
     std::lock_guard _l(mLock);
-    return mMelRecords.size();
+    return mCachedMelRecords;
 }
 
 void MelAggregator::foreachCachedMel(const std::function<void(const MelRecord&)>& f) const
 {
      std::lock_guard _l(mLock);
-     for (const auto &melRecord : mMelRecords) {
-         f(melRecord.second);
+     for (int64_t time = mMelCacheStart; time < mMelCacheEnd; ) {
+         const MelBucket& first = melBucket_l(time);
+         if (first.energy == 0.f) {
+             ++time;
+             continue;
+         }
+         MelRecord record(first.portId, {}, time);
+         do {
+             record.mels.push_back(audio_utils_power_from_energy(melBucket_l(time).energy));
+             ++time;
+         } while (isMelCached_l(time) && !melBucket_l(time).recordStart);
+         f(record);
      }
 }
 
@@ -267,14 +373,15 @@ float MelAggregator::getCsd() {
 
 size_t MelAggregator::getCsdRecordsSize() const {
     std::lock_guard _l(mLock);
-    return mCsdRecords.size();
+    return mCsdRecordsSize;
 }
 
 void MelAggregator::foreachCsd(const std::function<void(const CsdRecord&)>& f) const
 {
      std::lock_guard _l(mLock);
-     for (const auto &csdRecord : mCsdRecords) {
-         f(csdRecord.second);
+     for (size_t i = 0; i < mCsdRecordsSize; ++i) {
+         const CsdEntry& entry = csdEntry_l(i);
+         f(CsdRecord(entry.timestamp, entry.duration, entry.value, entry.averageMel));
      }
 }
 
@@ -26,8 +26,13 @@
 #include <audio_utils/MelProcessor.h>
 
 #include <audio_utils/format.h>
+#include <audio_utils/futex.h>
 #include <audio_utils/power.h>
 #include <log/log.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <deque>
 #include <sstream>
 #include <unordered_map>
 #include <utils/threads.h>
@@ -109,6 +114,14 @@ constexpr std::array<std::array<float, kBiquadNumCoefs>, MelProcessor::kCascadeB
                         {1.000000, -2.000000, 1.000000, -1.972625, 0.972709},
                         {1.000000, -2.000000, 1.000000, -1.998652, 0.998653}}};
 
+// Returns the MEL value for the energy per frame summed over all channels.
+static float melFromEnergy(float combinedEnergy, float attenuationDB) {
+    return fmaxf(audio_utils_power_from_energy(combinedEnergy)
+            + kMelAdjustmentDb
+            + kMeldBFSTodBSPLOffset
+            - attenuationDB, 0.0f);
+}
+
 MelProcessor::MelProcessor(uint32_t sampleRate,
         uint32_t channelCount,
         audio_format_t format,
@@ -117,25 +130,21 @@ MelProcessor::MelProcessor(uint32_t sampleRate,
         float rs2Value,
         size_t maxMelsCallback)
     : mCallback(callback),
-      mMelWorker("MelWorker#" + pointerString(), mCallback),
-      mSampleRate(sampleRate),
-      mFramesPerMelValue(sampleRate * kSecondsPerMelValue),
-      mChannelCount(channelCount),
-      mFormat(format),
-      mAWeightSamples(mFramesPerMelValue * mChannelCount),
-      mFloatSamples(mFramesPerMelValue * mChannelCount),
-      mCurrentChannelEnergy(channelCount, 0.0f),
+      mMelWorker("MelWorker#" + pointerString(), mCallback, maxMelsCallback),
+      mState(std::make_unique<AWeightState>(sampleRate, channelCount, format)),
       mMelValues(maxMelsCallback),
       mCurrentIndex(0),
       mDeviceId(deviceId),
-      mRs2UpperBound(rs2Value),
-      mCurrentSamples(0)
+      mRs2UpperBound(rs2Value)
 {
-    createBiquads_l();
-
     mMelWorker.run();
 }
 
+MelProcessor::~MelProcessor() {
+    delete mPendingState.exchange(nullptr);
+    deleteRetiredStates();
+}
+
 static const std::unordered_map<uint32_t, const std::array<std::array<float, kBiquadNumCoefs>,
         MelProcessor::kCascadeBiquadNumber>*>& getSampleRateBiquadCoeffs() {
     static const std::unordered_map<uint32_t, const std::array<std::array<float, kBiquadNumCoefs>,
@@ -159,16 +168,23 @@ static const std::unordered_map<uint32_t, const std::array<std::array<float, kBi
     return sampleRateBiquadCoeffs;
 }
 
-bool MelProcessor::isSampleRateSupported_l() const {
-    return getSampleRateBiquadCoeffs().count(mSampleRate) != 0;
-}
-
-void MelProcessor::createBiquads_l() {
-    if (!isSampleRateSupported_l()) {
+MelProcessor::AWeightState::AWeightState(uint32_t sampleRate,
+                                         uint32_t channelCount,
+                                         audio_format_t format)
+    : mSampleRate(sampleRate),
+      mChannelCount(channelCount),
+      mFormat(format),
+      mFramesPerMelValue(sampleRate * kSecondsPerMelValue),
+      mAWeightSamples(mFramesPerMelValue * mChannelCount),
+      mFloatSamples(mFramesPerMelValue * mChannelCount),
+      mCurrentChannelEnergy(channelCount, 0.0f)
+{
+    const auto it = getSampleRateBiquadCoeffs().find(sampleRate);
+    if (it == getSampleRateBiquadCoeffs().end()) {
         return;
     }
 
-    const auto& biquadCoeffs = getSampleRateBiquadCoeffs().at(mSampleRate); // checked above
+    const auto& biquadCoeffs = it->second;
     mCascadedBiquads =
               {std::make_unique<DefaultBiquadFilter>(mChannelCount, biquadCoeffs->at(0)),
                std::make_unique<DefaultBiquadFilter>(mChannelCount, biquadCoeffs->at(1)),
@@ -217,58 +233,76 @@ void MelProcessor::updateAudioFormat(uint32_t sampleRate,
                                      audio_format_t format) {
     ALOGV("%s: update audio format %u, %u, %d", __func__, sampleRate, channelCount, format);
 
+    // allocate here rather than in process(), which adopts the state on its next call.
+    auto state = std::make_unique<AWeightState>(sampleRate, channelCount, format);
+
     std::lock_guard l(mLock);
+    deleteRetiredStates();
+    // a pending state which was not adopted yet is replaced
+    delete mPendingState.exchange(state.release());
+}
 
-    bool differentSampleRate = (mSampleRate != sampleRate);
-    bool differentChannelCount = (mChannelCount != channelCount);
+void MelProcessor::adoptState(AWeightState* state) {
+    // keep accumulating the current MEL value if the frame layout is unchanged
+    if (state->mChannelCount == mState->mChannelCount
+            && mState->mCurrentSamples < state->mFramesPerMelValue * state->mChannelCount) {
+        std::copy(mState->mCurrentChannelEnergy.begin(), mState->mCurrentChannelEnergy.end(),
+                  state->mCurrentChannelEnergy.begin());
+        state->mCurrentSamples = mState->mCurrentSamples;
+    }
+    retireState(mState.release());
+    mState.reset(state);
+}
 
-    mSampleRate = sampleRate;
-    mFramesPerMelValue = sampleRate * kSecondsPerMelValue;
-    mChannelCount = channelCount;
-    mFormat = format;
+void MelProcessor::retireState(AWeightState* state) {
+    AWeightState* head = mRetiredStates.load();
+    do {
+        state->mNextRetired = head;
+    } while (!mRetiredStates.compare_exchange_weak(head, state));
+}
 
-    if (differentSampleRate || differentChannelCount) {
-        mAWeightSamples.resize(mFramesPerMelValue * mChannelCount);
-        mFloatSamples.resize(mFramesPerMelValue * mChannelCount);
-    }
-    if (differentChannelCount) {
-        mCurrentChannelEnergy.resize(channelCount);
+void MelProcessor::deleteRetiredStates() {
+    AWeightState* state = mRetiredStates.exchange(nullptr);
+    while (state != nullptr) {
+        AWeightState* const next = state->mNextRetired;
+        delete state;
+        state = next;
     }
-
-    createBiquads_l();
 }
 
-void MelProcessor::applyAWeight_l(const void* buffer, size_t samples)
+void MelProcessor::applyAWeight(const void* buffer, size_t samples)
 {
-    memcpy_by_audio_format(mFloatSamples.data(), AUDIO_FORMAT_PCM_FLOAT, buffer, mFormat, samples);
+    AWeightState& state = *mState;
+    memcpy_by_audio_format(state.mFloatSamples.data(), AUDIO_FORMAT_PCM_FLOAT, buffer,
+                           state.mFormat, samples);
 
-    float* tempFloat[2] = { mFloatSamples.data(), mAWeightSamples.data() };
+    float* tempFloat[2] = { state.mFloatSamples.data(), state.mAWeightSamples.data() };
     int inIdx = 1, outIdx = 0;
-    const size_t frames = samples / mChannelCount;
-    for (const auto& biquad : mCascadedBiquads) {
+    const size_t frames = samples / state.mChannelCount;
+    for (const auto& biquad : state.mCascadedBiquads) {
         outIdx ^= 1;
         inIdx ^= 1;
         biquad->process(tempFloat[outIdx], tempFloat[inIdx], frames);
     }
 
     // should not be the case since the size is odd
-    if (!(mCascadedBiquads.size() & 1)) {
-        std::swap(mFloatSamples, mAWeightSamples);
+    if (!(state.mCascadedBiquads.size() & 1)) {
+        std::swap(state.mFloatSamples, state.mAWeightSamples);
     }
 }
 
-float MelProcessor::getCombinedChannelEnergy_l() {
+float MelProcessor::getCombinedChannelEnergy() {
     float combinedEnergy = 0.0f;
-    for (auto& energy: mCurrentChannelEnergy) {
+    for (auto& energy: mState->mCurrentChannelEnergy) {
         combinedEnergy += energy;
         energy = 0;
     }
 
-    combinedEnergy /= (float) mFramesPerMelValue;
+    combinedEnergy /= (float) mState->mFramesPerMelValue;
     return combinedEnergy;
 }
 
-void MelProcessor::addMelValue_l(float mel) {
+void MelProcessor::addMelValue(float mel) {
     mMelValues[mCurrentIndex] = mel;
     ALOGV("%s: writing MEL %f at index %d for device %d",
           __func__,
@@ -298,7 +332,7 @@ void MelProcessor::addMelValue_l(float mel) {
     }
 
     if (notifyWorker) {
-        mMelWorker.mCondVar.notify_one();
+        mMelWorker.notify();
     }
 }
 
@@ -307,55 +341,205 @@ int32_t MelProcessor::process(const void* buffer, size_t bytes) {
         return 0;
     }
 
-    // should be uncontested and not block if process method is called from a single thread
-    std::lock_guard<std::mutex> guard(mLock);
+    // adopt the state published by updateAudioFormat(), if any
+    if (mPendingState.load(std::memory_order_relaxed) != nullptr) {
+        adoptState(mPendingState.exchange(nullptr));
+    }
+    AWeightState& state = *mState;
 
-    if (!isSampleRateSupported_l()) {
+    if (!state.isSampleRateSupported()) {
         return 0;
     }
 
-    const size_t bytes_per_sample = audio_bytes_per_sample(mFormat);
+    const size_t bytes_per_sample = audio_bytes_per_sample(state.mFormat);
     size_t samples = bytes_per_sample > 0 ? bytes / bytes_per_sample : 0;
     while (samples > 0) {
         const size_t requiredSamples =
-            mFramesPerMelValue * mChannelCount - mCurrentSamples;
+            state.mFramesPerMelValue * state.mChannelCount - state.mCurrentSamples;
         size_t processSamples = std::min(requiredSamples, samples);
-        processSamples -= processSamples % mChannelCount;
+        processSamples -= processSamples % state.mChannelCount;
 
-        applyAWeight_l(buffer, processSamples);
+        applyAWeight(buffer, processSamples);
 
-        audio_utils_accumulate_energy(mAWeightSamples.data(),
+        audio_utils_accumulate_energy(state.mAWeightSamples.data(),
                                       AUDIO_FORMAT_PCM_FLOAT,
                                       processSamples,
-                                      mChannelCount,
-                                      mCurrentChannelEnergy.data());
-        mCurrentSamples += processSamples;
+                                      state.mChannelCount,
+                                      state.mCurrentChannelEnergy.data());
+        state.mCurrentSamples += processSamples;
 
         ALOGVV(
             "required:%zu, process:%zu, mCurrentChannelEnergy[0]:%f, mCurrentSamples:%zu",
             requiredSamples,
             processSamples,
-            mCurrentChannelEnergy[0],
-            mCurrentSamples.load());
+            state.mCurrentChannelEnergy[0],
+            state.mCurrentSamples);
         if (processSamples < requiredSamples) {
             return static_cast<int32_t>(bytes);
         }
 
-        addMelValue_l(fmaxf(
-            audio_utils_power_from_energy(getCombinedChannelEnergy_l())
-                + kMelAdjustmentDb
-                + kMeldBFSTodBSPLOffset
-                - mAttenuationDB, 0.0f));
+        addMelValue(melFromEnergy(getCombinedChannelEnergy(), mAttenuationDB));
 
         samples -= processSamples;
         buffer =
             (const uint8_t*) buffer + processSamples * bytes_per_sample;
-        mCurrentSamples = 0;
+        state.mCurrentSamples = 0;
     }
 
     return static_cast<int32_t>(bytes);
 }
 
+// Computes in mels the MEL values of seconds [first, last) of buffer, starting from the
+// A-weighting filter state reached after the second preceding first, if any.
+static void computeMelRange(const void* buffer,
+                            audio_format_t format,
+                            uint32_t sampleRate,
+                            uint32_t channelCount,
+                            float attenuationDB,
+                            size_t first,
+                            size_t last,
+                            float* mels) {
+    using DefaultBiquadFilter = BiquadFilter<float, true, details::DefaultBiquadConstOptions>;
+    const auto& biquadCoeffs = getSampleRateBiquadCoeffs().at(sampleRate);
+    std::array<std::unique_ptr<DefaultBiquadFilter>, MelProcessor::kCascadeBiquadNumber> biquads =
+              {std::make_unique<DefaultBiquadFilter>(channelCount, biquadCoeffs->at(0)),
+               std::make_unique<DefaultBiquadFilter>(channelCount, biquadCoeffs->at(1)),
+               std::make_unique<DefaultBiquadFilter>(channelCount, biquadCoeffs->at(2))};
+
+    const size_t frames = sampleRate * kSecondsPerMelValue;
+    const size_t samples = frames * channelCount;
+    const size_t bytesPerSecond = samples * audio_bytes_per_sample(format);
+    std::vector<float> temp[2] = { std::vector<float>(samples), std::vector<float>(samples) };
+    std::vector<float> channelEnergy(channelCount);
+
+    for (size_t second = first > 0 ? first - 1 : first; second < last; ++second) {
+        memcpy_by_audio_format(temp[0].data(), AUDIO_FORMAT_PCM_FLOAT,
+                (const uint8_t*)buffer + second * bytesPerSecond, format, samples);
+        // the cascade has an odd number of biquads, the result is in temp[1].
+        int inIdx = 1, outIdx = 0;
+        for (const auto& biquad : biquads) {
+            outIdx ^= 1;
+            inIdx ^= 1;
+            biquad->process(temp[outIdx].data(), temp[inIdx].data(), frames);
+        }
+        if (second < first) {
+            continue;  // warm up only
+        }
+
+        std::fill(channelEnergy.begin(), channelEnergy.end(), 0.f);
+        audio_utils_accumulate_energy(temp[outIdx].data(), AUDIO_FORMAT_PCM_FLOAT,
+                                      samples, channelCount, channelEnergy.data());
+        float combinedEnergy = 0.f;
+        for (const float energy : channelEnergy) {
+            combinedEnergy += energy;
+        }
+        mels[second - first] = melFromEnergy(combinedEnergy / (float) frames, attenuationDB);
+    }
+}
+
+// Splits seconds [first, last) of buffer among up to threadCount threads.
+static void computeMelRangeParallel(const void* buffer,
+                                    audio_format_t format,
+                                    uint32_t sampleRate,
+                                    uint32_t channelCount,
+                                    float attenuationDB,
+                                    size_t first,
+                                    size_t last,
+                                    size_t threadCount,
+                                    float* mels) {
+    const size_t seconds = last - first;
+    threadCount = std::min(threadCount, seconds);
+    if (threadCount <= 1) {
+        computeMelRange(buffer, format, sampleRate, channelCount, attenuationDB,
+                        first, last, mels);
+        return;
+    }
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < threadCount; ++i) {
+        const size_t begin = first + seconds * i / threadCount;
+        const size_t end = first + seconds * (i + 1) / threadCount;
+        threads.emplace_back(computeMelRange, buffer, format, sampleRate, channelCount,
+                             attenuationDB, begin, end, mels + (begin - first));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+static size_t getBatchThreadCount(size_t threadCount) {
+    return threadCount != 0 ? threadCount : std::max(1U, std::thread::hardware_concurrency());
+}
+
+// static
+std::vector<float> MelProcessor::computeMels(const void* buffer,
+                                             size_t bytes,
+                                             uint32_t sampleRate,
+                                             uint32_t channelCount,
+                                             audio_format_t format,
+                                             float attenuationDB,
+                                             size_t threadCount) {
+    if (getSampleRateBiquadCoeffs().count(sampleRate) == 0 || channelCount == 0
+            || !audio_utils_is_compute_power_format_supported(format)) {
+        ALOGE("%s: unsupported sample rate %u, channel count %u or format %#x",
+              __func__, sampleRate, channelCount, format);
+        return {};
+    }
+    const size_t bytesPerSecond = (size_t) sampleRate * kSecondsPerMelValue * channelCount
+            * audio_bytes_per_sample(format);
+    std::vector<float> mels(bytes / bytesPerSecond);
+    computeMelRangeParallel(buffer, format, sampleRate, channelCount, attenuationDB,
+                            0, mels.size(), getBatchThreadCount(threadCount), mels.data());
+    return mels;
+}
+
+// static
+std::vector<float> MelProcessor::computeMels(const FrameReader& reader,
+                                             uint32_t sampleRate,
+                                             uint32_t channelCount,
+                                             float attenuationDB,
+                                             size_t threadCount) {
+    if (getSampleRateBiquadCoeffs().count(sampleRate) == 0 || channelCount == 0) {
+        ALOGE("%s: unsupported sample rate %u or channel count %u",
+              __func__, sampleRate, channelCount);
+        return {};
+    }
+    threadCount = getBatchThreadCount(threadCount);
+    const size_t framesPerSecond = sampleRate * kSecondsPerMelValue;
+    const size_t samplesPerSecond = framesPerSecond * channelCount;
+    // at most kBatchBufferBytes, including the warm-up second, however many threads.
+    const size_t bufferSeconds = kBatchBufferBytes / (samplesPerSecond * sizeof(float));
+    const size_t blockSeconds = std::min(kBatchSecondsPerThread * threadCount,
+                                         std::max(bufferSeconds, size_t{2}) - 1);
+    const size_t blockFrames = blockSeconds * framesPerSecond;
+
+    // a block of seconds, preceded after the first block by the last second of the
+    // previous block to warm up the A-weighting filters.
+    std::vector<float> samples(samplesPerSecond + blockFrames * channelCount);
+    std::vector<float> mels;
+    for (size_t first = 0; ; first = 1) {
+        size_t frames = 0;
+        while (frames < blockFrames) {
+            const size_t read = reader(&samples[first * samplesPerSecond + frames * channelCount],
+                                       blockFrames - frames);
+            if (read == 0) break;
+            frames += read;
+        }
+        const size_t seconds = frames / framesPerSecond;
+        if (seconds == 0) break;
+
+        const size_t offset = mels.size();
+        mels.resize(offset + seconds);
+        computeMelRangeParallel(samples.data(), AUDIO_FORMAT_PCM_FLOAT, sampleRate, channelCount,
+                                attenuationDB, first, first + seconds, threadCount,
+                                mels.data() + offset);
+        if (frames < blockFrames) break;
+
+        std::copy_n(&samples[(first + seconds - 1) * samplesPerSecond], samplesPerSecond,
+                    samples.begin());
+    }
+    return mels;
+}
+
 void MelProcessor::setAttenuation(float attenuationDB) {
     ALOGV("%s: setting the attenuation %f", __func__, attenuationDB);
     mAttenuationDB = attenuationDB;
@@ -363,7 +547,7 @@ void MelProcessor::setAttenuation(float attenuationDB) {
 
 void MelProcessor::onLastStrongRef(const void* id __attribute__((unused))) {
    mMelWorker.stop();
-   ALOGV("%s: Stopped thread: %s for device %d", __func__, mMelWorker.mThreadName.c_str(),
+   ALOGV("%s: Stopped worker: %s for device %d", __func__, mMelWorker.mName.c_str(),
          mDeviceId.load());
 }
 
@@ -374,56 +558,238 @@ std::string MelProcessor::pointerString() const {
     return aStream.str();
 }
 
-void MelProcessor::MelWorker::run() {
-    mThread = std::thread([&]{
+// Process-wide pool of threads executing the MelWorker callbacks. A MelWorker
+// with pending callbacks is queued once; the thread which dequeues it executes
+// all its callbacks, so that the callbacks of one MelProcessor stay ordered.
+//
+// schedule() is called from process() and must not lock nor allocate: workers are
+// pushed on a lock-free stack and the pool threads are woken up with a futex, or with
+// std::atomic wait and notify where there is no futex. The pool threads move the
+// pending workers to their queue under the pool lock.
+class MelProcessor::MelWorkerPool {
+public:
+    static MelWorkerPool& getInstance() {
+        // never deleted, detached pool threads may outlive static destruction.
+        static MelWorkerPool* const instance = new MelWorkerPool();
+        return *instance;
+    }
+
+    void setThreadCount(size_t threadCount) {
+        LOG_ALWAYS_FATAL_IF(threadCount == 0, "%s: invalid thread count", __func__);
+        std::lock_guard l(mLock);
+        mTargetThreadCount = threadCount;
+        if (mStarted) {
+            startThreads_l();
+        }
+        wake(INT_MAX);  // surplus threads exit
+    }
+
+    size_t getThreadCount() {
+        std::lock_guard l(mLock);
+        return mThreadCount;
+    }
+
+    void start() {
+        std::lock_guard l(mLock);
+        mStarted = true;
+        startThreads_l();
+    }
+
+    void schedule(MelWorker* worker) {
+        // a scheduled worker is requeued by its pool thread if new callbacks arrived.
+        if (worker->mStopRequested || worker->mScheduled.exchange(true)) {
+            return;
+        }
+        MelWorker* head = mPending.load();
+        do {
+            worker->mNextPending = head;
+        } while (!mPending.compare_exchange_weak(head, worker));
+        wake(1);
+    }
+
+    void cancel(MelWorker* worker) {
+        LOG_ALWAYS_FATAL_IF(tCurrentWorker == worker,
+                "%s: %s cannot be stopped from its own callback",
+                __func__, worker->mName.c_str());
+        std::unique_lock l(mLock);
+        worker->mStopRequested = true;
+        // the worker may have been pushed before the stop request.
+        queuePending_l();
+        if (worker->mQueued) {
+            mQueue.erase(std::find(mQueue.begin(), mQueue.end(), worker));
+            worker->mQueued = false;
+        }
+        mIdleCondVar.wait(l, [&] { return !worker->mRunning; });
+    }
+
+private:
+    MelWorkerPool() = default;
+
+    void startThreads_l() REQUIRES(mLock) {
+        while (mThreadCount < mTargetThreadCount) {
+            const size_t index = mThreadIndex++;
+            std::thread([this, index] { threadLoop(index); }).detach();
+            ++mThreadCount;
+        }
+    }
+
+    // wakes up to count pool threads waiting for workers, lock-free
+    void wake(int count) {
+        mWakeSequence.fetch_add(1);
+        if (mSleepingThreads.load() > 0
+                && sys_futex(&mWakeSequence, FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0) != 0
+                && errno == ENOSYS) {
+            // no futex on this platform, see waitForWork_l().
+            if (count == 1) {
+                mWakeSequence.notify_one();
+            } else {
+                mWakeSequence.notify_all();
+            }
+        }
+    }
+
+    // moves the pending workers to the queue, in the order they were pushed
+    void queuePending_l() REQUIRES(mLock) {
+        const size_t size = mQueue.size();
+        for (MelWorker* worker = mPending.exchange(nullptr); worker != nullptr;
+                worker = worker->mNextPending) {
+            mQueue.push_back(worker);
+        }
+        std::reverse(mQueue.begin() + size, mQueue.end());
+        for (auto it = mQueue.begin() + size; it != mQueue.end(); ) {
+            MelWorker* const worker = *it;
+            if (worker->mStopRequested) {
+                it = mQueue.erase(it);
+            } else {
+                worker->mQueued = true;
+                ++it;
+            }
+        }
+    }
+
+    // waits with the pool lock released until a worker is pushed or wake() is called
+    void waitForWork_l(std::unique_lock<std::mutex>& l) REQUIRES(mLock) {
+        // incrementing before reading the sequence ensures wake() sees a sleeping thread
+        // or the futex wait sees a new sequence.
+        ++mSleepingThreads;
+        const int32_t sequence = mWakeSequence.load();
+        if (mPending.load() == nullptr) {
+            l.unlock();
+            if (sys_futex(&mWakeSequence, FUTEX_WAIT_PRIVATE, sequence, nullptr, nullptr, 0) != 0
+                    && errno == ENOSYS) {
+                // no futex on this platform, returns once wake() changed the sequence.
+                mWakeSequence.wait(sequence);
+            }
+            l.lock();
+        }
+        --mSleepingThreads;
+    }
+
+    void threadLoop(size_t index) {
         // name the thread to help identification
-        androidSetThreadName(mThreadName.c_str());
-        ALOGV("%s::run(): Started thread", mThreadName.c_str());
+        androidSetThreadName(("MelWorker#" + std::to_string(index)).c_str());
+        ALOGV("%s: started thread %zu", __func__, index);
 
+        std::unique_lock l(mLock);
         while (true) {
-            std::unique_lock l(mCondVarMutex);
-            if (mStopRequested) {
+            queuePending_l();
+            if (mThreadCount > mTargetThreadCount) {
+                --mThreadCount;
+                ALOGV("%s: stopped thread %zu", __func__, index);
+                // pass on the wake up which may have been meant for a remaining thread.
+                if (!mQueue.empty()) wake(1);
                 return;
             }
-            mCondVar.wait(l, [&] { return (mRbReadPtr != mRbWritePtr) || mStopRequested; });
-
-            while (mRbReadPtr != mRbWritePtr && !mStopRequested) {
-                ALOGV("%s::run(): new callbacks, rb idx read=%zu, write=%zu",
-                      mThreadName.c_str(),
-                      mRbReadPtr.load(),
-                      mRbWritePtr.load());
-                auto callback = mCallback.promote();
-                if (callback == nullptr) {
-                    ALOGW("%s::run(): MelCallback is null, quitting MelWorker",
-                          mThreadName.c_str());
-                    return;
-                }
-
-                MelCallbackData data = mCallbackRingBuffer[mRbReadPtr];
-                if (data.mMel != 0.f) {
-                    callback->onMomentaryExposure(data.mMel, data.mPort);
-                } else if (data.mMelsSize != 0) {
-                    callback->onNewMelValues(data.mMels, 0, data.mMelsSize,
-                                             data.mPort, /*attenuated=*/true);
-                } else {
-                    ALOGE("%s::run(): Invalid MEL data. Skipping callback", mThreadName.c_str());
-                }
-                incRingBufferIndex(mRbReadPtr);
+            if (mQueue.empty()) {
+                waitForWork_l(l);
+                continue;
+            }
+
+            MelWorker* const worker = mQueue.front();
+            mQueue.pop_front();
+            worker->mQueued = false;
+            worker->mRunning = true;
+            if (!mQueue.empty()) wake(1);  // let another thread serve the next worker
+            l.unlock();
+
+            tCurrentWorker = worker;
+            worker->dispatch();
+            tCurrentWorker = nullptr;
+
+            l.lock();
+            worker->mRunning = false;
+            // callbacks added after dispatch() returned must be rescheduled.
+            worker->mScheduled = false;
+            if (!worker->mStopRequested && !worker->ringBufferIsEmpty()
+                    && !worker->mScheduled.exchange(true)) {
+                worker->mQueued = true;
+                mQueue.push_back(worker);
             }
+            mIdleCondVar.notify_all();
         }
-    });
+    }
+
+    static thread_local MelWorker* tCurrentWorker;
+
+    std::mutex mLock;
+    std::condition_variable mIdleCondVar;      // a worker has finished its callbacks
+    std::atomic<MelWorker*> mPending = nullptr;  // lock-free stack of scheduled workers
+    std::atomic<int32_t> mWakeSequence = 0;    // futex word, incremented by wake()
+    std::atomic<int32_t> mSleepingThreads = 0;
+    std::deque<MelWorker*> mQueue GUARDED_BY(mLock);
+    bool mStarted GUARDED_BY(mLock) = false;
+    size_t mTargetThreadCount GUARDED_BY(mLock) = kDefaultWorkerThreadCount;
+    size_t mThreadCount GUARDED_BY(mLock) = 0;
+    size_t mThreadIndex GUARDED_BY(mLock) = 0;
+};
+
+thread_local MelProcessor::MelWorker* MelProcessor::MelWorkerPool::tCurrentWorker = nullptr;
+
+// static
+void MelProcessor::setWorkerThreadCount(size_t threadCount) {
+    MelWorkerPool::getInstance().setThreadCount(threadCount);
+}
+
+// static
+size_t MelProcessor::getWorkerThreadCount() {
+    return MelWorkerPool::getInstance().getThreadCount();
+}
+
+void MelProcessor::MelWorker::run() {
+    MelWorkerPool::getInstance().start();
 }
 
 void MelProcessor::MelWorker::stop() {
-    bool oldValue;
-    {
-        std::lock_guard l(mCondVarMutex);
-        oldValue = mStopRequested;
-        mStopRequested = true;
-    }
-    if (!oldValue) {
-        mCondVar.notify_one();
-        mThread.join();
+    MelWorkerPool::getInstance().cancel(this);
+}
+
+void MelProcessor::MelWorker::notify() {
+    MelWorkerPool::getInstance().schedule(this);
+}
+
+void MelProcessor::MelWorker::dispatch() {
+    while (mRbReadPtr != mRbWritePtr && !mStopRequested) {
+        ALOGV("%s::dispatch(): new callbacks, rb idx read=%zu, write=%zu",
+              mName.c_str(),
+              mRbReadPtr.load(),
+              mRbWritePtr.load());
+        auto callback = mCallback.promote();
+        if (callback == nullptr) {
+            ALOGW("%s::dispatch(): MelCallback is null, dropping callbacks", mName.c_str());
+            mRbReadPtr = mRbWritePtr.load();
+            return;
+        }
+
+        MelCallbackData data = mCallbackRingBuffer[mRbReadPtr];
+        if (data.mMel != 0.f) {
+            callback->onMomentaryExposure(data.mMel, data.mPort);
+        } else if (data.mMelsSize != 0) {
+            callback->onNewMelValues(data.mMels, 0, data.mMelsSize,
+                                     data.mPort, /*attenuated=*/true);
+        } else {
+            ALOGE("%s::dispatch(): Invalid MEL data. Skipping callback", mName.c_str());
+        }
+        incRingBufferIndex(mRbReadPtr);
     }
 }
 
@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// #define LOG_NDEBUG 0
+#define LOG_TAG "audio_utils_PartitionedConvolver"
+
+#include <audio_utils/PartitionedConvolver.h>
+
+#include <algorithm>
+#include <string.h>
+
+#include <audio_utils/roundup.h>
+#include <log/log.h>
+
+namespace android::audio_utils {
+
+namespace {
+
+constexpr bool isPowerOf2(size_t v) {
+    return v != 0 && (v & (v - 1)) == 0;
+}
+
+} // namespace
+
+// static
+std::unique_ptr<PartitionedConvolver> PartitionedConvolver::create(
+        size_t channelCount,
+        const std::vector<std::vector<float>>& impulseResponses,
+        size_t headSize, size_t maxBlockSize) {
+    if (channelCount == 0) {
+        ALOGE("%s: invalid channelCount %zu", __func__, channelCount);
+        return nullptr;
+    }
+    if (impulseResponses.size() != 1 && impulseResponses.size() != channelCount) {
+        ALOGE("%s: %zu impulse responses for %zu channels",
+                __func__, impulseResponses.size(), channelCount);
+        return nullptr;
+    }
+    if (std::all_of(impulseResponses.begin(), impulseResponses.end(),
+            [](const auto& response) { return response.empty(); })) {
+        ALOGE("%s: empty impulse response", __func__);
+        return nullptr;
+    }
+    if (headSize < 2 || !isPowerOf2(headSize)) {
+        ALOGE("%s: invalid headSize %zu", __func__, headSize);
+        return nullptr;
+    }
+    if (maxBlockSize == 0) maxBlockSize = headSize;
+    if (maxBlockSize < headSize || !isPowerOf2(maxBlockSize)) {
+        ALOGE("%s: invalid maxBlockSize %zu", __func__, maxBlockSize);
+        return nullptr;
+    }
+    return std::unique_ptr<PartitionedConvolver>(new PartitionedConvolver(
+            channelCount, impulseResponses, headSize, maxBlockSize));
+}
+
+PartitionedConvolver::PartitionedConvolver(size_t channelCount,
+        const std::vector<std::vector<float>>& impulseResponses,
+        size_t headSize, size_t maxBlockSize)
+    : mChannelCount(channelCount)
+    , mResponseCount(impulseResponses.size())
+    , mHeadSize(headSize)
+{
+    for (const auto& response : impulseResponses) {
+        mLength = std::max(mLength, response.size());
+    }
+    const auto tap = [&impulseResponses](size_t response, size_t index) {
+        const auto& taps = impulseResponses[response];
+        return index < taps.size() ? taps[index] : 0.f;
+    };
+
+    // Direct-form head.
+    mHeadReversed.resize(mResponseCount * mHeadSize);
+    for (size_t r = 0; r < mResponseCount; ++r) {
+        for (size_t i = 0; i < mHeadSize; ++i) {
+            mHeadReversed[r * mHeadSize + i] = tap(r, mHeadSize - 1 - i);
+        }
+    }
+    mHeadHistory.resize(mChannelCount * (2 * mHeadSize - 1));
+
+    // Partition the tail: two partitions per block size while doubling up to
+    // maxBlockSize, then as many partitions of maxBlockSize as needed.
+    size_t maxOffset = 0;
+    for (size_t offset = mHeadSize, blockSize = mHeadSize; offset < mLength; ) {
+        size_t partitions = (mLength - offset + blockSize - 1) / blockSize;
+        const bool grow = blockSize < maxBlockSize && partitions > 2;
+        if (grow) partitions = 2;
+
+        Level level{};
+        level.blockSize = blockSize;
+        level.offset = offset;
+        level.partitions = partitions;
+        level.bins = blockSize + 1;
+        level.fft = std::make_unique<FloatFFT>(2 * blockSize);
+        level.filterRe.resize(mResponseCount * partitions * level.bins);
+        level.filterIm.resize(mResponseCount * partitions * level.bins);
+        level.delayRe.resize(mChannelCount * partitions * level.bins);
+        level.delayIm.resize(mChannelCount * partitions * level.bins);
+        level.delayIndex = 0;
+
+        std::vector<float> segment(2 * blockSize);
+        const float scale = 1.f / (2 * blockSize);  // fold in the inverse FFT normalization
+        for (size_t r = 0; r < mResponseCount; ++r) {
+            for (size_t p = 0; p < partitions; ++p) {
+                for (size_t i = 0; i < blockSize; ++i) {
+                    segment[i] = tap(r, offset + p * blockSize + i) * scale;
+                }
+                std::fill(segment.begin() + blockSize, segment.end(), 0.f);
+                const size_t base = (r * partitions + p) * level.bins;
+                level.fft->forward(segment.data(),
+                        &level.filterRe[base], &level.filterIm[base]);
+            }
+        }
+        ALOGV("%s: level blockSize:%zu offset:%zu partitions:%zu",
+                __func__, blockSize, offset, partitions);
+
+        maxOffset = offset;
+        offset += partitions * blockSize;
+        mLevels.push_back(std::move(level));
+        if (grow) blockSize *= 2;
+    }
+
+    const size_t largestBlock = mLevels.empty() ? mHeadSize : mLevels.back().blockSize;
+    mInputRingSize = roundup(2 * largestBlock);
+    mInputRing.resize(mChannelCount * mInputRingSize);
+    mOutputRingSize = roundup(std::max(maxOffset, mHeadSize));
+    mOutputRing.resize(mChannelCount * mOutputRingSize);
+
+    mTimeScratch.resize(2 * largestBlock);
+    mAccRe.resize(largestBlock + 1);
+    mAccIm.resize(largestBlock + 1);
+}
+
+void PartitionedConvolver::reset() {
+    std::fill(mHeadHistory.begin(), mHeadHistory.end(), 0.f);
+    std::fill(mInputRing.begin(), mInputRing.end(), 0.f);
+    std::fill(mOutputRing.begin(), mOutputRing.end(), 0.f);
+    for (auto& level : mLevels) {
+        std::fill(level.delayRe.begin(), level.delayRe.end(), 0.f);
+        std::fill(level.delayIm.begin(), level.delayIm.end(), 0.f);
+        level.delayIndex = 0;
+    }
+    mFrames = 0;
+}
+
+void PartitionedConvolver::process(const float* in, float* out, size_t frameCount) {
+    const size_t channels = mChannelCount;
+    const size_t headSize = mHeadSize;
+    const size_t historySize = 2 * headSize - 1;
+    const size_t inputMask = mInputRingSize - 1;
+    const size_t outputMask = mOutputRingSize - 1;
+
+    while (frameCount > 0) {
+        // Chunks never cross a head block boundary, which is also a boundary
+        // for every FFT level since all block sizes are multiples of headSize.
+        const uint64_t frames = mFrames;  // local copy, out may alias members for the compiler
+        const size_t phase = frames & (headSize - 1);
+        const size_t chunk = std::min(frameCount, headSize - phase);
+
+        // Consume all input first, so that in may alias out.
+        for (size_t c = 0; c < channels; ++c) {
+            float* const history = &mHeadHistory[c * historySize] + headSize - 1 + phase;
+            float* const ring = &mInputRing[c * mInputRingSize];
+            for (size_t i = 0; i < chunk; ++i) {
+                const float x = in[i * channels + c];
+                history[i] = x;
+                ring[(frames + i) & inputMask] = x;
+            }
+        }
+
+        for (size_t c = 0; c < channels; ++c) {
+            const float* const taps =
+                    &mHeadReversed[(mResponseCount == 1 ? 0 : c) * headSize];
+            const float* const history = &mHeadHistory[c * historySize] + phase;
+            float* const ring = &mOutputRing[c * mOutputRingSize];
+            for (size_t i = 0; i < chunk; ++i) {
+                // Independent partial sums allow vectorization without -ffast-math.
+                float accum0 = 0.f;
+                float accum1 = 0.f;
+                for (size_t j = 0; j < headSize; j += 2) {
+                    accum0 += taps[j] * history[i + j];
+                    accum1 += taps[j + 1] * history[i + j + 1];
+                }
+                const size_t index = (frames + i) & outputMask;
+                out[i * channels + c] = accum0 + accum1 + ring[index];
+                ring[index] = 0.f;
+            }
+        }
+
+        mFrames = frames + chunk;
+        in += chunk * channels;
+        out += chunk * channels;
+        frameCount -= chunk;
+
+        if (phase + chunk == headSize) {
+            for (size_t c = 0; c < channels; ++c) {
+                float* const history = &mHeadHistory[c * historySize];
+                memmove(history, history + headSize, (headSize - 1) * sizeof(float));
+            }
+            for (auto& level : mLevels) {
+                if ((mFrames & (level.blockSize - 1)) == 0) processLevel(level);
+            }
+        }
+    }
+}
+
+void PartitionedConvolver::processLevel(Level& level) {
+    const size_t blockSize = level.blockSize;
+    const size_t partitions = level.partitions;
+    const size_t bins = level.bins;
+    const size_t inputMask = mInputRingSize - 1;
+    const size_t outputMask = mOutputRingSize - 1;
+    const size_t slot = level.delayIndex + 1 == partitions ? 0 : level.delayIndex + 1;
+    float* const time = mTimeScratch.data();
+    float* const accRe = mAccRe.data();
+    float* const accIm = mAccIm.data();
+
+    // Input window for overlap-save is the last 2 * blockSize frames;
+    // unsigned wraparound before the first 2 * blockSize frames reads zeros.
+    const uint64_t windowStart = mFrames - 2 * blockSize;
+    // Output for the last blockSize frames is due offset frames later.
+    const uint64_t outputStart = mFrames - blockSize + level.offset;
+
+    for (size_t c = 0; c < mChannelCount; ++c) {
+        const float* const input = &mInputRing[c * mInputRingSize];
+        for (size_t i = 0; i < 2 * blockSize; ++i) {
+            time[i] = input[(windowStart + i) & inputMask];
+        }
+        float* const delayRe = &level.delayRe[c * partitions * bins];
+        float* const delayIm = &level.delayIm[c * partitions * bins];
+        level.fft->forward(time, delayRe + slot * bins, delayIm + slot * bins);
+
+        // Multiply-accumulate the delay line against the filter partitions.
+        const size_t response = mResponseCount == 1 ? 0 : c;
+        std::fill(accRe, accRe + bins, 0.f);
+        std::fill(accIm, accIm + bins, 0.f);
+        for (size_t p = 0, s = slot; p < partitions; ++p, s = s == 0 ? partitions - 1 : s - 1) {
+            const float* const xr = delayRe + s * bins;
+            const float* const xi = delayIm + s * bins;
+            const float* const hr = &level.filterRe[(response * partitions + p) * bins];
+            const float* const hi = &level.filterIm[(response * partitions + p) * bins];
+            for (size_t k = 0; k < bins; ++k) {
+                accRe[k] += xr[k] * hr[k] - xi[k] * hi[k];
+                accIm[k] += xr[k] * hi[k] + xi[k] * hr[k];
+            }
+        }
+        level.fft->inverse(accRe, accIm, time);
+
+        float* const output = &mOutputRing[c * mOutputRingSize];
+        for (size_t i = 0; i < blockSize; ++i) {
+            output[(outputStart + i) & outputMask] += time[blockSize + i];
+        }
+    }
+    level.delayIndex = slot;
+}
+
+} // namespace android::audio_utils
@@ -87,7 +87,9 @@ std::string PowerLogBase::dumpToString(
         const char *prefix, size_t lines, int64_t limitNs, bool logPlot) const
 {
     const size_t maxColumns = 10;
-    const size_t numberOfEntries = mEntries.size();
+    size_t nextIdx;
+    const auto entries = snapshotEntries(&nextIdx);
+    const size_t numberOfEntries = entries.size();
     if (lines == 0) lines = SIZE_MAX;
 
     // compute where to start logging
@@ -100,10 +102,10 @@ std::string PowerLogBase::dumpToString(
     size_t nonzeros = 0;
     ssize_t offset; // TODO doesn't dump if # entries exceeds SSIZE_MAX
     for (offset = 0; offset < (ssize_t)numberOfEntries && count < lines; ++offset) {
-        const size_t idx = (mIdx + numberOfEntries - offset - 1) % numberOfEntries;
+        const size_t idx = (nextIdx + numberOfEntries - offset - 1) % numberOfEntries;
                                                                                 // reverse direction
-        const int64_t time = mEntries[idx].first;
-        const float energy = mEntries[idx].second;
+        const int64_t time = entries[idx].first;
+        const float energy = entries[idx].second;
 
         if (state == AT_END) {
             if (energy == 0.f) {
@@ -154,9 +156,9 @@ std::string PowerLogBase::dumpToString(
         bool start = false;
         float cumulative = 0.f;
         for (; offset >= 0; --offset) {
-            const size_t idx = (mIdx + numberOfEntries - offset - 1) % numberOfEntries;
-            const int64_t time = mEntries[idx].first;
-            const float energy = mEntries[idx].second;
+            const size_t idx = (nextIdx + numberOfEntries - offset - 1) % numberOfEntries;
+            const int64_t time = entries[idx].first;
+            const float energy = entries[idx].second;
 
             if (energy == 0.f) {
                 if (!first) {
@@ -207,22 +209,43 @@ std::string PowerLogBase::dumpToString(
     return ss.str();
 }
 
+std::vector<std::pair<int64_t, float>> PowerLogBase::snapshotEntries(size_t *idx) const
+{
+    const size_t size = mEntries.size();
+    std::vector<std::pair<int64_t, float>> entries(size);
+    const uint64_t count = mCount.load(std::memory_order_acquire);
+    for (uint64_t i = count - std::min<uint64_t>(count, size); i < count; ++i) {
+        Entry entry;
+        uint64_t tag;
+        if (!mEntries[i % size].try_load(&entry, &tag) || tag != i) {
+            continue;  // being overwritten, the oldest entry
+        }
+        entries[i % size] = std::make_pair(entry.time, entry.energy);
+    }
+    *idx = count % size;
+    return entries;
+}
+
+void PowerLogBase::writeEntry(int64_t time, float energy) {
+    // Publish the entry to the readers, see snapshotEntries().
+    const uint64_t count = mCount.load(std::memory_order_relaxed);
+    mEntries[count % mEntries.size()].store(Entry{time, energy}, count);
+    mCount.store(count + 1, std::memory_order_release);
+}
+
 void PowerLogBase::flushEntry() {
     // We store the data as normalized energy per sample. The energy sequence is
     // zero terminated. Consecutive zero entries are ignored.
     if (mCurrentEnergy == 0.f) {
         if (mConsecutiveZeroes++ == 0) {
-            mEntries[mIdx++] = std::make_pair(mCurrentTime, 0.f);
+            writeEntry(mCurrentTime, 0.f);
             // zero terminate the signal sequence.
         }
     } else {
         mConsecutiveZeroes = 0;
-        mEntries[mIdx++] = std::make_pair(mCurrentTime, mCurrentEnergy);
+        writeEntry(mCurrentTime, mCurrentEnergy);
         ALOGV("writing %lld %f", (long long)mCurrentTime, mCurrentEnergy);
     }
-    if (mIdx >= mEntries.size()) {
-        mIdx -= mEntries.size();
-    }
     mCurrentTime = 0;
     mCurrentEnergy = 0;
     mCurrentFrames = 0;
@@ -230,7 +253,6 @@ void PowerLogBase::flushEntry() {
 
 void PowerLog::log(const void *buffer, size_t frames, int64_t nowNs) {
     if (frames == 0) return;
-    std::lock_guard <std::mutex> guard(mMutex);
 
     const size_t bytes_per_sample = audio_bytes_per_sample(mFormat);
     while (true) {
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdarg>
+
+#include <benchmark/benchmark.h>
+
+#include <audio_utils/ErrorLog.h>
+#include <audio_utils/LockFreeLog.h>
+#include <audio_utils/SimpleLog.h>
+
+using android::ErrorLog;
+using android::LockFreeErrorLog;
+using android::LockFreeSimpleLog;
+using android::SimpleLog;
+
+/*
+ * Each benchmark thread logs one line per iteration to a shared log.
+ * The lock-free logs have a Writer per thread.
+ *
+ * The logs are not recreated per run, as the threads other than thread 0
+ * may start before thread 0 has set up a run.
+ */
+
+static SimpleLog gSimpleLog;
+
+static void BM_SimpleLog(benchmark::State& state) {
+    int i = 0;
+    for (auto _ : state) {
+        gSimpleLog.log("buffer %d frames %zu gain %f", ++i, (size_t)480, 0.5f);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static LockFreeSimpleLog<4 /* Writers */> gLockFreeSimpleLog;
+
+static void BM_LockFreeSimpleLog(benchmark::State& state) {
+    auto writer = gLockFreeSimpleLog.createWriter();
+    int i = 0;
+    for (auto _ : state) {
+        writer->log("buffer %d frames %zu gain %f", ++i, (size_t)480, 0.5f);
+    }
+    state.SetItemsProcessed(state.iterations());
+    gLockFreeSimpleLog.releaseWriter(writer);
+}
+
+static ErrorLog<int32_t> gErrorLog(64 /* entries */);
+
+static void BM_ErrorLog(benchmark::State& state) {
+    int64_t nowNs = 0;
+    for (auto _ : state) {
+        nowNs += 10'000'000;
+        gErrorLog.log(nowNs / 1'000'000'000 % 3 /* code */, nowNs);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static LockFreeErrorLog<int32_t, 4 /* Writers */> gLockFreeErrorLog;
+
+static void BM_LockFreeErrorLog(benchmark::State& state) {
+    auto writer = gLockFreeErrorLog.createWriter();
+    int64_t nowNs = 0;
+    for (auto _ : state) {
+        nowNs += 10'000'000;
+        writer->log(nowNs / 1'000'000'000 % 3 /* code */, nowNs);
+    }
+    state.SetItemsProcessed(state.iterations());
+    gLockFreeErrorLog.releaseWriter(writer);
+}
+
+// The cost of a dump, which for the lock-free logs includes the formatting.
+static void BM_SimpleLog_dumpToString(benchmark::State& state) {
+    for (int i = 0; i < 100; ++i) {
+        gSimpleLog.log("buffer %d frames %zu gain %f", i, (size_t)480, 0.5f);
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(gSimpleLog.dumpToString());
+    }
+}
+
+static void BM_LockFreeSimpleLog_dumpToString(benchmark::State& state) {
+    auto writer = gLockFreeSimpleLog.createWriter();
+    for (int i = 0; i < 100; ++i) {
+        writer->log("buffer %d frames %zu gain %f", i, (size_t)480, 0.5f);
+    }
+    gLockFreeSimpleLog.releaseWriter(writer);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(gLockFreeSimpleLog.dumpToString());
+    }
+}
+
+BENCHMARK(BM_SimpleLog)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_LockFreeSimpleLog)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_ErrorLog)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_LockFreeErrorLog)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_SimpleLog_dumpToString);
+BENCHMARK(BM_LockFreeSimpleLog_dumpToString);
+
+BENCHMARK_MAIN();
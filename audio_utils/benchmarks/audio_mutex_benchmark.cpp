@@ -236,6 +236,21 @@ static void BM_systemTime(benchmark::State &state) {
 
 BENCHMARK(BM_systemTime);
 
+// Benchmark log2_histogram::add().  The mutex statistics use this for the wait time
+// of a contended lock and, if mutex_hold_time_enabled_, for the hold time of every lock,
+// which also costs two systemTime() calls, see BM_AudioUtilsHoldTimeMutexLockUnlock.
+static void BM_log2_histogram_add(benchmark::State &state) {
+    android::audio_utils::mutex::mutex_stat_t::histogram_t histogram;
+    int64_t value = 1;
+    while (state.KeepRunning()) {
+        histogram.add(value);
+        value = (value * 3) & 0xffffff;  // spread over the buckets
+    }
+    ALOGD("%s: count:%llu", __func__, (unsigned long long)histogram.count());
+}
+
+BENCHMARK(BM_log2_histogram_add);
+
 // Benchmark access to 8 thread local storage variables by compiler built_in __thread.
 __thread volatile int tls_value1 = 1;
 __thread volatile int tls_value2 = 2;
@@ -349,6 +364,45 @@ public:
     AudioPIMutex() : android::audio_utils::mutex(true /* priority_inheritance */) {}
 };
 
+// audio_utils mutex with adaptive spinning before blocking on contention.
+class AudioSpinMutex : public android::audio_utils::mutex {
+public:
+    AudioSpinMutex() : android::audio_utils::mutex(false /* priority_inheritance */,
+            android::audio_utils::MutexOrder::kOtherMutex, true /* adaptive_spin */) {}
+};
+
+// audio_utils mutex with priority inheritance and adaptive spinning.
+class AudioPISpinMutex : public android::audio_utils::mutex {
+public:
+    AudioPISpinMutex() : android::audio_utils::mutex(true /* priority_inheritance */,
+            android::audio_utils::MutexOrder::kOtherMutex, true /* adaptive_spin */) {}
+};
+
+// audio_utils mutex with the hold time histogram, which is disabled by default.
+class HoldTimeAttributes : public android::audio_utils::AudioMutexAttributes {
+public:
+    static constexpr bool mutex_hold_time_enabled_ = true;
+};
+
+// The statistics and registry of each mutex_impl instantiation, as in mutex.cpp.
+template<>
+android::audio_utils::mutex_impl<HoldTimeAttributes>::stat_array_t& android::audio_utils::mutex_impl<HoldTimeAttributes>::get_mutex_stat_array() {
+    static constinit stat_array_t stat_array{};
+    return stat_array;
+}
+
+template<>
+android::audio_utils::mutex_impl<HoldTimeAttributes>::thread_registry_t& android::audio_utils::mutex_impl<HoldTimeAttributes>::get_registry() {
+    static thread_registry_t thread_registry{};
+    return thread_registry;
+}
+
+class AudioHoldTimeMutex : public android::audio_utils::mutex_impl<HoldTimeAttributes> {
+public:
+    AudioHoldTimeMutex()
+        : android::audio_utils::mutex_impl<HoldTimeAttributes>(false /* priority_inheritance */) {}
+};
+
 template <typename Mutex>
 void MutexLockUnlock(benchmark::State& state) {
     Mutex m;
@@ -402,6 +456,18 @@ static void BM_AudioUtilsPIMutexLockUnlock(benchmark::State &state) {
 
 BENCHMARK(BM_AudioUtilsPIMutexLockUnlock);
 
+static void BM_AudioUtilsSpinMutexLockUnlock(benchmark::State &state) {
+    MutexLockUnlock<AudioSpinMutex>(state);
+}
+
+BENCHMARK(BM_AudioUtilsSpinMutexLockUnlock);
+
+static void BM_AudioUtilsHoldTimeMutexLockUnlock(benchmark::State &state) {
+    MutexLockUnlock<AudioHoldTimeMutex>(state);
+}
+
+BENCHMARK(BM_AudioUtilsHoldTimeMutexLockUnlock);
+
 // ---
 
 template <typename Mutex>
@@ -614,6 +680,26 @@ static void BM_AudioUtilsPIMutexScopedLockUnlock(benchmark::State &state) {
 
 BENCHMARK(BM_AudioUtilsPIMutexScopedLockUnlock)->ThreadRange(1, THREADS_SCOPED);
 
+MutexScopedLockUnlock<AudioSpinMutex,
+        android::audio_utils::scoped_lock<
+                AudioSpinMutex, AudioSpinMutex>> ScopedAuSpin;
+
+static void BM_AudioUtilsSpinMutexScopedLockUnlock(benchmark::State &state) {
+    ScopedAuSpin.run(state);
+}
+
+BENCHMARK(BM_AudioUtilsSpinMutexScopedLockUnlock)->ThreadRange(1, THREADS_SCOPED);
+
+MutexScopedLockUnlock<AudioPISpinMutex,
+        android::audio_utils::scoped_lock<
+                AudioPISpinMutex, AudioPISpinMutex>> ScopedAuPISpin;
+
+static void BM_AudioUtilsPISpinMutexScopedLockUnlock(benchmark::State &state) {
+    ScopedAuPISpin.run(state);
+}
+
+BENCHMARK(BM_AudioUtilsPISpinMutexScopedLockUnlock)->ThreadRange(1, THREADS_SCOPED);
+
 MutexScopedLockUnlock<std::mutex,
         std::scoped_lock<std::mutex, std::mutex>> ReverseScopedStd(true);
 
@@ -278,6 +278,56 @@ static void BenchmarkPower(benchmark::State& state) {
     state.SetLabel(audio_channel_out_mask_to_string(channelMask));
 }
 
+/*
+ * Parameterized Test BM_EnergyAndPeak_X/A/B
+ * <A> is the channel count.
+ * <B> is 1 to also compute the peak (audio_utils_accumulate_energy_and_peak),
+ *     0 for energy only (audio_utils_accumulate_energy).
+ * Items processed are frames, so the per channel throughput is
+ * items_per_second * channel count.
+ */
+template<audio_format_t FORMAT>
+static void BenchmarkEnergyAndPeak(benchmark::State& state) {
+    const size_t channels = state.range(0);
+    const bool computePeak = state.range(1);
+
+    // set up random generator.
+    constexpr float amplitude = 0.01f;
+    std::minstd_rand gen(channels);
+    std::uniform_real_distribution<> dis(-amplitude, amplitude);
+
+    // get random audio data.
+    constexpr size_t frameCount = 1024;
+    std::vector<float> input(channels * frameCount);
+    for (auto& in : input) {
+        in = dis(gen);
+    }
+
+    // convert to proper PCM format.
+    std::vector<uint8_t> buffer(channels * frameCount *  audio_bytes_per_sample(FORMAT));
+    memcpy_by_audio_format(buffer.data(), FORMAT, input.data(),
+                           AUDIO_FORMAT_PCM_FLOAT, input.size());
+
+    std::vector<float> energy(channels);
+    std::vector<float> peak(channels);
+
+    // run the test
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(buffer);
+        if (computePeak) {
+            audio_utils_accumulate_energy_and_peak(buffer.data(), FORMAT, input.size(),
+                    channels, energy.data(), peak.data());
+        } else {
+            audio_utils_accumulate_energy(buffer.data(), FORMAT, input.size(),
+                    channels, energy.data());
+        }
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * frameCount);
+    state.SetBytesProcessed(state.iterations() * buffer.size());
+}
+
 static void ChannelArgs(benchmark::internal::Benchmark* b) {
     for (int i = 0; i < (int)std::size(kChannelPositionMasks); i++) {
         b->Args({i});
@@ -300,9 +350,39 @@ static void BM_Power_FLOAT(benchmark::State& state) {
     BenchmarkPower<AUDIO_FORMAT_PCM_FLOAT>(state);
 }
 
+static void EnergyAndPeakArgs(benchmark::internal::Benchmark* b) {
+    // 9 channels does not have a fixed channel count kernel.
+    for (int channels : { 1, 2, 6, 8, 9, 12, 16, 24 }) {
+        for (int computePeak : { 0, 1 }) {
+            b->Args({channels, computePeak});
+        }
+    }
+}
+
+static void BM_EnergyAndPeak_PCM16(benchmark::State& state) {
+    BenchmarkEnergyAndPeak<AUDIO_FORMAT_PCM_16_BIT>(state);
+}
+
+static void BM_EnergyAndPeak_PCM24(benchmark::State& state) {
+    BenchmarkEnergyAndPeak<AUDIO_FORMAT_PCM_24_BIT_PACKED>(state);
+}
+
+static void BM_EnergyAndPeak_PCM32(benchmark::State& state) {
+    BenchmarkEnergyAndPeak<AUDIO_FORMAT_PCM_32_BIT>(state);
+}
+
+static void BM_EnergyAndPeak_FLOAT(benchmark::State& state) {
+    BenchmarkEnergyAndPeak<AUDIO_FORMAT_PCM_FLOAT>(state);
+}
+
 BENCHMARK(BM_Power_PCM16)->Apply(ChannelArgs);
 BENCHMARK(BM_Power_PCM24)->Apply(ChannelArgs);
 BENCHMARK(BM_Power_PCM32)->Apply(ChannelArgs);
 BENCHMARK(BM_Power_FLOAT)->Apply(ChannelArgs);
 
+BENCHMARK(BM_EnergyAndPeak_PCM16)->Apply(EnergyAndPeakArgs);
+BENCHMARK(BM_EnergyAndPeak_PCM24)->Apply(EnergyAndPeakArgs);
+BENCHMARK(BM_EnergyAndPeak_PCM32)->Apply(EnergyAndPeakArgs);
+BENCHMARK(BM_EnergyAndPeak_FLOAT)->Apply(EnergyAndPeakArgs);
+
 BENCHMARK_MAIN();
@@ -225,6 +225,72 @@ static void BM_ChannelMix_9Point1Point6(benchmark::State& state) {
     BenchmarkChannelMix<AUDIO_CHANNEL_OUT_9POINT1POINT6>(state);
 }
 
+/*
+ * Parameterized Test BM_RuntimeChannelMix_X/A
+ * <A> is the index into kChannelPositionMasks for the input channel mask.
+ * The first five output masks are also handled by the templated ChannelMix above,
+ * so those results may be compared directly against BM_ChannelMix_X/A.
+ */
+static void BenchmarkRuntimeChannelMix(
+        benchmark::State& state, audio_channel_mask_t outputChannelMask) {
+    const audio_channel_mask_t channelMask = kChannelPositionMasks[state.range(0)];
+    using namespace ::android::audio_utils::channels;
+    RuntimeChannelMix channelMix(outputChannelMask);
+    channelMix.setInputChannelMask(channelMask);
+    const size_t outChannels = audio_channel_count_from_out_mask(outputChannelMask);
+    constexpr size_t frameCount = 1024;
+    size_t inChannels = audio_channel_count_from_out_mask(channelMask);
+    std::vector<float> input(inChannels * frameCount);
+    std::vector<float> output(outChannels * frameCount);
+    constexpr float amplitude = 0.01f;
+
+    std::minstd_rand gen(channelMask);
+    std::uniform_real_distribution<> dis(-amplitude, amplitude);
+    for (auto& in : input) {
+        in = dis(gen);
+    }
+
+    assert(channelMix.getInputChannelMask() != AUDIO_CHANNEL_NONE);
+    // Run the test
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(input.data());
+        benchmark::DoNotOptimize(output.data());
+        channelMix.process(input.data(), output.data(), frameCount, false /* accumulate */);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetComplexityN(inChannels);
+    state.SetLabel(audio_channel_out_mask_to_string(channelMask));
+}
+
+static void BM_RuntimeChannelMix_Stereo(benchmark::State& state) {
+    BenchmarkRuntimeChannelMix(state, AUDIO_CHANNEL_OUT_STEREO);
+}
+
+static void BM_RuntimeChannelMix_5Point1(benchmark::State& state) {
+    BenchmarkRuntimeChannelMix(state, AUDIO_CHANNEL_OUT_5POINT1);
+}
+
+static void BM_RuntimeChannelMix_7Point1(benchmark::State& state) {
+    BenchmarkRuntimeChannelMix(state, AUDIO_CHANNEL_OUT_7POINT1);
+}
+
+static void BM_RuntimeChannelMix_7Point1Point4(benchmark::State& state) {
+    BenchmarkRuntimeChannelMix(state, AUDIO_CHANNEL_OUT_7POINT1POINT4);
+}
+
+static void BM_RuntimeChannelMix_9Point1Point6(benchmark::State& state) {
+    BenchmarkRuntimeChannelMix(state, AUDIO_CHANNEL_OUT_9POINT1POINT6);
+}
+
+static void BM_RuntimeChannelMix_5Point1Point2(benchmark::State& state) {
+    BenchmarkRuntimeChannelMix(state, AUDIO_CHANNEL_OUT_5POINT1POINT2);
+}
+
+static void BM_RuntimeChannelMix_22Point2(benchmark::State& state) {
+    BenchmarkRuntimeChannelMix(state, AUDIO_CHANNEL_OUT_22POINT2);
+}
+
 static void ChannelMixArgs(benchmark::internal::Benchmark* b) {
     for (int i = 0; i < (int)std::size(kChannelPositionMasks); i++) {
         b->Args({i});
@@ -241,4 +307,18 @@ BENCHMARK(BM_ChannelMix_7Point1Point4)->Apply(ChannelMixArgs);
 
 BENCHMARK(BM_ChannelMix_9Point1Point6)->Apply(ChannelMixArgs);
 
+BENCHMARK(BM_RuntimeChannelMix_Stereo)->Apply(ChannelMixArgs);
+
+BENCHMARK(BM_RuntimeChannelMix_5Point1)->Apply(ChannelMixArgs);
+
+BENCHMARK(BM_RuntimeChannelMix_7Point1)->Apply(ChannelMixArgs);
+
+BENCHMARK(BM_RuntimeChannelMix_7Point1Point4)->Apply(ChannelMixArgs);
+
+BENCHMARK(BM_RuntimeChannelMix_9Point1Point6)->Apply(ChannelMixArgs);
+
+BENCHMARK(BM_RuntimeChannelMix_5Point1Point2)->Apply(ChannelMixArgs);
+
+BENCHMARK(BM_RuntimeChannelMix_22Point2)->Apply(ChannelMixArgs);
+
 BENCHMARK_MAIN();
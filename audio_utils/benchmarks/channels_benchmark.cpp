@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <audio_utils/channels.h>
+
+static constexpr size_t kFrameCount = 1024;  // frames per call, a typical USB period is smaller.
+
+using adjust_channels_t = size_t (*)(const void*, size_t, void*, size_t, unsigned, size_t);
+
+static void benchmarkAdjustChannels(benchmark::State& state, adjust_channels_t adjust) {
+    const unsigned sampleSize = state.range(0);
+    const size_t inChannels = state.range(1);
+    const size_t outChannels = state.range(2);
+    const bool inPlace = state.range(3);
+
+    // For non destructive conversion, the input and output buffers must be the same size.
+    const size_t maxChannels = std::max(inChannels, outChannels);
+    std::vector<uint8_t> in(kFrameCount * maxChannels * sampleSize);
+    std::vector<uint8_t> out(in.size());
+
+    // Initialize in buffer with deterministic pseudo-random values
+    std::minstd_rand gen(inChannels << 8 | outChannels);
+    std::uniform_int_distribution<> dis(0, 255);
+    for (auto& byte : in) {
+        byte = dis(gen);
+    }
+    const size_t numInBytes = kFrameCount * inChannels * sampleSize;
+
+    // Run the test
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(in.data());
+        benchmark::DoNotOptimize(out.data());
+        if (inPlace) {
+            // the in place conversion always starts from valid input, it need not be restored.
+            adjust(out.data(), inChannels, out.data(), outChannels, sampleSize, numInBytes);
+        } else {
+            adjust(in.data(), inChannels, out.data(), outChannels, sampleSize, numInBytes);
+        }
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * kFrameCount);
+    state.SetBytesProcessed(state.iterations() * numInBytes);
+}
+
+/*
+ * Parameterized Test BM_adjust_channels/A/B/C/D
+ * <A> is the sample size in bytes (3 is packed 24 bit, 4 is int32_t or float).
+ * <B> is the number of input channels.
+ * <C> is the number of output channels.
+ * <D> is 1 for in place conversion.
+ */
+static void BM_adjust_channels(benchmark::State& state) {
+    benchmarkAdjustChannels(state, adjust_channels);
+}
+
+/*
+ * Parameterized Test BM_adjust_selected_channels/A/B/C/D
+ * Parameters are as for BM_adjust_channels.
+ */
+static void BM_adjust_selected_channels(benchmark::State& state) {
+    benchmarkAdjustChannels(state, adjust_selected_channels);
+}
+
+/*
+ * Parameterized Test BM_adjust_channels_non_destructive/A/B/C/D
+ * Parameters are as for BM_adjust_channels.
+ */
+static void BM_adjust_channels_non_destructive(benchmark::State& state) {
+    benchmarkAdjustChannels(state, adjust_channels_non_destructive);
+}
+
+static void AdjustChannelsArgs(benchmark::internal::Benchmark* b) {
+    // 1 <-> 2, 2 <-> 4, 2 <-> 8 have fixed channel count kernels for 16 and 32 bit samples,
+    // 4 <-> 6 is handled one sample at a time for comparison.
+    static constexpr int kChannelPairs[][2] = {
+        {1, 2}, {2, 1}, {2, 4}, {4, 2}, {2, 8}, {8, 2}, {4, 6}, {6, 4},
+    };
+    for (int sampleSize : { 2, 3, 4 }) {
+        for (const auto& pair : kChannelPairs) {
+            for (int inPlace : { 0, 1 }) {
+                b->Args({sampleSize, pair[0], pair[1], inPlace});
+            }
+        }
+    }
+}
+
+BENCHMARK(BM_adjust_channels)->Apply(AdjustChannelsArgs);
+
+BENCHMARK(BM_adjust_selected_channels)->Apply(AdjustChannelsArgs);
+
+BENCHMARK(BM_adjust_channels_non_destructive)->Apply(AdjustChannelsArgs);
+
+BENCHMARK_MAIN();
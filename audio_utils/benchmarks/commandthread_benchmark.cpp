@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include <benchmark/benchmark.h>
+
+#include <audio_utils/CommandThread.h>
+#include <audio_utils/LockFreeCommandThread.h>
+
+using android::audio_utils::CommandThread;
+using android::audio_utils::LockFreeCommandThread;
+
+static std::atomic<int64_t> gExecuted;
+
+// A command capturing only a pointer, which fits in SmallFunction.
+struct SmallCommand {
+    std::atomic<int64_t>* executed;
+    void operator()() const { executed->fetch_add(1, std::memory_order_relaxed); }
+};
+
+// A command capturing 64 bytes, which is stored on the heap by both
+// std::function and the default SmallFunction.
+struct LargeCommand {
+    std::atomic<int64_t>* executed;
+    std::array<int64_t, 7> payload;
+    void operator()() const { executed->fetch_add(1 + payload[0], std::memory_order_relaxed); }
+};
+
+template <typename Command>
+Command makeCommand() {
+    if constexpr (std::is_same_v<Command, SmallCommand>) {
+        return {&gExecuted};
+    } else {
+        return {&gExecuted, {}};
+    }
+}
+
+static void waitForExecuted(int64_t count) {
+    while (gExecuted.load(std::memory_order_relaxed) < count) {
+        std::this_thread::yield();
+    }
+}
+
+/*
+ * Each benchmark thread is a producer which adds one command per iteration
+ * to a shared command thread, and the command thread executes them.
+ * The time per iteration is the cost of add() when the queue is not full,
+ * including the contention with the other producers and with the worker thread.
+ */
+
+static std::unique_ptr<CommandThread> gCommandThread;
+
+template <typename Command>
+static void BM_CommandThread(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        gExecuted = 0;
+        gCommandThread = std::make_unique<CommandThread>();
+    }
+    for (auto _ : state) {
+        gCommandThread->add("command", makeCommand<Command>());
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        waitForExecuted(state.iterations() * state.threads());
+        gCommandThread.reset();
+    }
+}
+
+using BenchLockFreeCommandThread = LockFreeCommandThread<1 /* Lanes */, 1024 /* Capacity */>;
+static std::unique_ptr<BenchLockFreeCommandThread> gLockFreeCommandThread;
+
+template <typename Command>
+static void BM_LockFreeCommandThread(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        gExecuted = 0;
+        gLockFreeCommandThread = std::make_unique<BenchLockFreeCommandThread>();
+    }
+    int64_t full = 0;
+    for (auto _ : state) {
+        while (!gLockFreeCommandThread->add(makeCommand<Command>())) {
+            ++full;
+            std::this_thread::yield();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["full"] = full;
+    if (state.thread_index() == 0) {
+        waitForExecuted(state.iterations() * state.threads());
+        gLockFreeCommandThread.reset();
+    }
+}
+
+BENCHMARK(BM_CommandThread<SmallCommand>)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_CommandThread<LargeCommand>)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_LockFreeCommandThread<SmallCommand>)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_LockFreeCommandThread<LargeCommand>)->ThreadRange(1, 4)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <climits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <audio_utils/fifo.h>
+#include <audio_utils/fifo_shared.h>
+
+#include "futex_counter.h"
+
+static constexpr uint32_t kFrameCount = 4096;
+static constexpr size_t kBytesPerIteration = 1 << 20;
+static constexpr size_t kTransfersPerPublish = 16;  // bursts per period when deferred
+
+using Frame = int32_t;
+
+/*
+ * Parameterized Test BM_Fifo/A/B/C
+ * <A> is the number of frames per write and per read.
+ * <B> is 1 to defer publication to one publish() every kTransfersPerPublish transfers,
+ *     or 0 to publish on every release().
+ * <C> is the index width: 32 for a multi-process FIFO with 32-bit indices,
+ *     which wakes on every publication, or 64 for a single-process FIFO with 64-bit
+ *     indices, which only wakes a waiting partner.
+ *
+ * A writer thread and a reader transfer kBytesPerIteration per iteration,
+ * the reader throttles the writer and both sides block.
+ */
+static void BM_Fifo(benchmark::State& state) {
+    const size_t transfer = state.range(0);
+    const bool deferred = state.range(1) != 0;
+    const bool index64 = state.range(2) == 64;
+
+    std::vector<Frame> buffer(kFrameCount);
+    audio_utils_fifo_index rear32;
+    audio_utils_fifo_index front32;
+    std::unique_ptr<audio_utils_fifo> fifo = index64
+            ? std::make_unique<audio_utils_fifo>(kFrameCount, sizeof(Frame), buffer.data(),
+                    true /*throttlesWriter*/)
+            : std::make_unique<audio_utils_fifo>(kFrameCount, sizeof(Frame), buffer.data(),
+                    rear32, &front32);
+    audio_utils_fifo_reader reader(*fifo, true /*throttlesWriter*/);
+    reader.setDeferredPublish(deferred);
+
+    std::atomic<bool> stop{false};
+    std::atomic<bool> done{false};
+    std::thread writerThread([&] {
+        audio_utils_fifo_writer writer(*fifo);
+        writer.setDeferredPublish(deferred);
+        const struct timespec timeout = {1 /*tv_sec*/, 0 /*tv_nsec*/};
+        std::vector<Frame> data(transfer);
+        for (size_t transfers = 0; !stop.load(std::memory_order_relaxed); ) {
+            if (writer.write(data.data(), transfer, &timeout) > 0
+                    && ++transfers % kTransfersPerPublish == 0) {
+                writer.publish();
+            }
+        }
+        writer.publish();
+        done.store(true);
+    });
+
+    const struct timespec forever = {LONG_MAX /*tv_sec*/, 0 /*tv_nsec*/};
+    std::vector<Frame> data(transfer);
+    const uint64_t waits = futex_counter_waits();
+    const uint64_t wakes = futex_counter_wakes();
+    size_t transfers = 0;
+    for (auto _ : state) {
+        for (size_t bytes = 0; bytes < kBytesPerIteration; ) {
+            const ssize_t actual = reader.read(data.data(), transfer, &forever);
+            if (actual > 0) {
+                bytes += actual * sizeof(Frame);
+                if (++transfers % kTransfersPerPublish == 0) {
+                    reader.publish();
+                }
+            }
+        }
+        benchmark::ClobberMemory();
+    }
+    const double megabytes = state.iterations() * (double) kBytesPerIteration / (1 << 20);
+    state.counters["waits_per_MB"] = (futex_counter_waits() - waits) / megabytes;
+    state.counters["wakes_per_MB"] = (futex_counter_wakes() - wakes) / megabytes;
+    state.SetBytesProcessed(state.iterations() * kBytesPerIteration);
+
+    // drain until the writer sees the stop request
+    stop.store(true);
+    reader.setDeferredPublish(false);
+    while (!done.load()) {
+        (void) reader.read(data.data(), transfer, nullptr /*timeout*/);
+    }
+    writerThread.join();
+}
+
+static void FifoArgs(benchmark::internal::Benchmark* b) {
+    for (int transfer : {4, 64, 1024}) {
+        for (int deferred : {0, 1}) {
+            for (int width : {32, 64}) {
+                b->Args({transfer, deferred, width});
+            }
+        }
+    }
+}
+
+BENCHMARK(BM_Fifo)->Apply(FifoArgs)->UseRealTime();
+
+// The rear index and the front index slot on the same cache line.
+struct alignas(audio_utils_fifo_shared::kIndexAlignment) PackedIndices {
+    audio_utils_fifo_index64 mRear;
+    audio_utils_fifo_index64 mFront{audio_utils_fifo_index64::kUnregistered};
+};
+
+/*
+ * Parameterized Test BM_FifoIndexLayout/A/B
+ * <A> is the number of frames per write and per read.
+ * <B> is 0 for the rear and front indices packed in one cache line,
+ *     or 1 for the padded layout of audio_utils_fifo_shared.
+ *
+ * A writer thread and a reader transfer kBytesPerIteration per iteration without blocking,
+ * each polling the index of the other, so the cost of the index cache line dominates.
+ */
+static void BM_FifoIndexLayout(benchmark::State& state) {
+    const size_t transfer = state.range(0);
+    const bool padded = state.range(1) != 0;
+
+    std::vector<Frame> buffer(kFrameCount);
+    PackedIndices packed;
+    std::unique_ptr<audio_utils_fifo> packedFifo;
+    std::unique_ptr<audio_utils_fifo_shared> shared;
+    audio_utils_fifo *fifo;
+    if (padded) {
+        shared = audio_utils_fifo_shared::create(kFrameCount, sizeof(Frame),
+                1 /*throttleFrontCount*/);
+        if (shared == nullptr) {
+            state.SkipWithError("audio_utils_fifo_shared::create failed");
+            return;
+        }
+        fifo = &shared->fifo();
+    } else {
+        packedFifo = std::make_unique<audio_utils_fifo>(kFrameCount, sizeof(Frame),
+                buffer.data(), packed.mRear, &packed.mFront, 1 /*throttleFrontCount*/);
+        fifo = packedFifo.get();
+    }
+    audio_utils_fifo_reader reader(*fifo, true /*throttlesWriter*/);
+
+    std::atomic<bool> stop{false};
+    std::thread writerThread([&] {
+        audio_utils_fifo_writer writer(*fifo);
+        std::vector<Frame> data(transfer);
+        while (!stop.load(std::memory_order_relaxed)) {
+            (void) writer.write(data.data(), transfer);
+        }
+    });
+
+    std::vector<Frame> data(transfer);
+    for (auto _ : state) {
+        for (size_t bytes = 0; bytes < kBytesPerIteration; ) {
+            const ssize_t actual = reader.read(data.data(), transfer);
+            if (actual > 0) {
+                bytes += actual * sizeof(Frame);
+            }
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * kBytesPerIteration);
+
+    stop.store(true);
+    writerThread.join();
+}
+
+BENCHMARK(BM_FifoIndexLayout)->ArgsProduct({{1, 16, 256}, {0, 1}})->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Counts the futex syscalls of audio_utils_fifo, by interposing the libc syscall() wrapper
+// which sys_futex() calls.  This is in C, as the C++ declarations of syscall() differ
+// in exception specification between C libraries.
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE  // RTLD_NEXT
+#endif
+
+#include <dlfcn.h>
+#include <linux/futex.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "futex_counter.h"
+
+static uint64_t sWaits;
+static uint64_t sWakes;
+
+long syscall(long number, ...)
+{
+    static long (*real)(long, ...);
+    if (real == NULL) {
+        real = (long (*)(long, ...)) dlsym(RTLD_NEXT, "syscall");
+    }
+    // The kernel takes at most 6 arguments, unused ones are ignored.
+    va_list ap;
+    va_start(ap, number);
+    long args[6];
+    for (int i = 0; i < 6; i++) {
+        args[i] = va_arg(ap, long);
+    }
+    va_end(ap);
+    if (number == SYS_futex) {
+        switch (args[1] & FUTEX_CMD_MASK) {
+        case FUTEX_WAIT:
+            __atomic_fetch_add(&sWaits, 1, __ATOMIC_RELAXED);
+            break;
+        case FUTEX_WAKE:
+            __atomic_fetch_add(&sWakes, 1, __ATOMIC_RELAXED);
+            break;
+        default:
+            break;
+        }
+    }
+    return real(number, args[0], args[1], args[2], args[3], args[4], args[5]);
+}
+
+uint64_t futex_counter_waits(void)
+{
+    return __atomic_load_n(&sWaits, __ATOMIC_RELAXED);
+}
+
+uint64_t futex_counter_wakes(void)
+{
+    return __atomic_load_n(&sWakes, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <audio_utils/MelAggregator.h>
+
+using android::audio_utils::MelAggregator;
+using android::audio_utils::MelRecord;
+
+static constexpr int64_t kWeekSeconds = 7 * 24 * 3600;  // default CSD window
+static constexpr size_t kMelsPerRecord = 3;  // MelProcessor::kMaxMelValues
+
+/*
+ * Parameterized Test BM_MelAggregator_Week/A
+ * <A> is the number of streams playing simultaneously, each reporting
+ *     kMelsPerRecord MEL values every kMelsPerRecord seconds.
+ *
+ * Each iteration aggregates a week of MEL values, which fills the CSD window.
+ */
+static void BM_MelAggregator_Week(benchmark::State& state) {
+    const int64_t streams = state.range(0);
+
+    // MEL values between 80 and 99 dB, the records of each stream are shifted by a second.
+    std::vector<MelRecord> records;
+    for (int64_t time = 0; time < kWeekSeconds; time += kMelsPerRecord) {
+        for (int64_t stream = 0; stream < streams; ++stream) {
+            const float mel = 80.f + (time / 60 + stream) % 20;
+            records.emplace_back(stream, std::vector<float>(kMelsPerRecord, mel), time + stream);
+        }
+    }
+
+    size_t csdRecords = 0;
+    for (auto _ : state) {
+        MelAggregator aggregator(kWeekSeconds);
+        for (const auto& record : records) {
+            benchmark::DoNotOptimize(aggregator.aggregateAndAddNewMelRecord(record));
+        }
+        csdRecords = aggregator.getCsdRecordsSize();
+    }
+    state.SetItemsProcessed(state.iterations() * records.size());
+    state.counters["csd_records"] = csdRecords;
+}
+
+BENCHMARK(BM_MelAggregator_Week)->Arg(1)->Arg(2)->Arg(4)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
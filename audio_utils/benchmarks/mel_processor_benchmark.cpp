@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <audio_utils/MelProcessor.h>
+
+using android::sp;
+using android::audio_utils::MelProcessor;
+
+static constexpr uint32_t kSampleRate = 48000;
+
+class NullMelCallback : public MelProcessor::MelCallback {
+public:
+    void onNewMelValues(const std::vector<float>& /* mels */, size_t /* offset */,
+                        size_t /* length */, audio_port_handle_t /* deviceId */,
+                        bool /* attenuated */) const override {}
+
+    void onMomentaryExposure(float /* currentMel */,
+                             audio_port_handle_t /* deviceId */) const override {}
+};
+
+/*
+ * Parameterized Test BM_MelProcessor/A/B
+ * <A> is the channel count.
+ * <B> is the number of frames per process() call, at 48kHz.
+ */
+static void BM_MelProcessor(benchmark::State& state) {
+    const uint32_t channelCount = state.range(0);
+    const size_t frames = state.range(1);
+
+    // one second of a 1kHz sine wave at -20dBFS, which is above RS1.
+    std::vector<float> buffer(kSampleRate * channelCount);
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        buffer[i] = 0.1f * sinf(2.f * (float) M_PI * 1000.f * (i / channelCount) / kSampleRate);
+    }
+    // the processor does not own the callback.
+    const sp<NullMelCallback> callback = sp<NullMelCallback>::make();
+    auto processor = sp<MelProcessor>::make(kSampleRate, channelCount, AUDIO_FORMAT_PCM_FLOAT,
+                                            callback, 0 /* deviceId */, 100.f /* rs2Value */);
+
+    const size_t bufferFrames = kSampleRate / frames * frames;
+    size_t frame = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(processor->process(
+                &buffer[frame * channelCount], frames * channelCount * sizeof(float)));
+        frame += frames;
+        if (frame == bufferFrames) frame = 0;
+    }
+    state.SetItemsProcessed(state.iterations() * frames);
+}
+
+static void MelProcessorArgs(benchmark::internal::Benchmark* b) {
+    for (int channelCount : { 2, 8 }) {
+        for (int frames : { 48, 192, 480, 960 }) {
+            b->Args({channelCount, frames});
+        }
+    }
+}
+
+BENCHMARK(BM_MelProcessor)->Apply(MelProcessorArgs);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <audio_utils/FloatFFT.h>
+#include <audio_utils/PartitionedConvolver.h>
+
+using android::audio_utils::FloatFFT;
+using android::audio_utils::PartitionedConvolver;
+
+static constexpr size_t kFrameCount = 1024;  // frames per process() call
+
+static std::vector<float> randomVector(size_t size) {
+    constexpr std::minstd_rand::result_type SEED = 42; // arbitrary choice.
+    std::minstd_rand gen(SEED);
+    std::uniform_real_distribution<float> dis(-1.f, 1.f);
+    std::vector<float> v(size);
+    for (auto& x : v) x = dis(gen);
+    return v;
+}
+
+// Direct-form FIR on interleaved data, the baseline to beat.
+class DirectFir {
+public:
+    DirectFir(size_t channelCount, std::vector<float> taps)
+        : mChannelCount(channelCount)
+        , mTaps(taps.rbegin(), taps.rend())
+        , mHistory(channelCount * (mTaps.size() - 1 + kFrameCount)) {}
+
+    void process(const float* in, float* out, size_t frameCount) {
+        const size_t taps = mTaps.size();
+        const size_t stride = taps - 1 + kFrameCount;
+        for (size_t c = 0; c < mChannelCount; ++c) {
+            float* const history = &mHistory[c * stride];
+            for (size_t i = 0; i < frameCount; ++i) {
+                history[taps - 1 + i] = in[i * mChannelCount + c];
+            }
+            for (size_t i = 0; i < frameCount; ++i) {
+                float accum = 0.f;
+                for (size_t j = 0; j < taps; ++j) {
+                    accum += mTaps[j] * history[i + j];
+                }
+                out[i * mChannelCount + c] = accum;
+            }
+            std::copy(history + frameCount, history + frameCount + taps - 1, history);
+        }
+    }
+
+private:
+    const size_t mChannelCount;
+    const std::vector<float> mTaps;  // reversed
+    std::vector<float> mHistory;
+};
+
+/*
+ * Parameterized Test BM_FloatFFT/A
+ * <A> is the real transform size.
+ */
+static void BM_FloatFFT(benchmark::State& state) {
+    const size_t size = state.range(0);
+    FloatFFT fft(size);
+    const std::vector<float> input = randomVector(size);
+    std::vector<float> re(fft.bins()), im(fft.bins()), output(size);
+
+    while (state.KeepRunning()) {
+        fft.forward(input.data(), re.data(), im.data());
+        fft.inverse(re.data(), im.data(), output.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetComplexityN(size);
+}
+
+BENCHMARK(BM_FloatFFT)->RangeMultiplier(4)->Range(64, 16384);
+
+/*
+ * Parameterized Test BM_DirectFir/A/B
+ * <A> is the channel count.
+ * <B> is the number of taps.
+ */
+static void BM_DirectFir(benchmark::State& state) {
+    const size_t channelCount = state.range(0);
+    const size_t taps = state.range(1);
+    DirectFir fir(channelCount, randomVector(taps));
+    const std::vector<float> input = randomVector(channelCount * kFrameCount);
+    std::vector<float> output(channelCount * kFrameCount);
+
+    while (state.KeepRunning()) {
+        fir.process(input.data(), output.data(), kFrameCount);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kFrameCount);
+}
+
+/*
+ * Parameterized Test BM_PartitionedConvolver/A/B/C
+ * <A> is the channel count.
+ * <B> is the number of taps.
+ * <C> is the maximum block size, 0 for uniform partitions of the 64 frame head size.
+ */
+static void BM_PartitionedConvolver(benchmark::State& state) {
+    const size_t channelCount = state.range(0);
+    const size_t taps = state.range(1);
+    const size_t maxBlockSize = state.range(2);
+    auto convolver = PartitionedConvolver::create(channelCount, {randomVector(taps)},
+            PartitionedConvolver::kDefaultHeadSize, maxBlockSize);
+    const std::vector<float> input = randomVector(channelCount * kFrameCount);
+    std::vector<float> output(channelCount * kFrameCount);
+
+    while (state.KeepRunning()) {
+        convolver->process(input.data(), output.data(), kFrameCount);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kFrameCount);
+}
+
+static void DirectFirArgs(benchmark::internal::Benchmark* b) {
+    for (int channelCount : { 1, 2 }) {
+        for (int taps : { 64, 256, 1024, 4096 }) {
+            b->Args({channelCount, taps});
+        }
+    }
+}
+
+static void PartitionedConvolverArgs(benchmark::internal::Benchmark* b) {
+    for (int channelCount : { 1, 2 }) {
+        for (int taps : { 64, 256, 1024, 4096, 16384 }) {
+            for (int maxBlockSize : { 0, 1024 }) {
+                b->Args({channelCount, taps, maxBlockSize});
+            }
+        }
+    }
+}
+
+BENCHMARK(BM_DirectFir)->Apply(DirectFirArgs);
+BENCHMARK(BM_PartitionedConvolver)->Apply(PartitionedConvolverArgs);
+
+BENCHMARK_MAIN();
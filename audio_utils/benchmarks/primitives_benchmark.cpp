@@ -15,6 +15,8 @@
  */
 
 #include <cstddef>
+#include <cstring>
+#include <iterator>
 #include <random>
 #include <vector>
 
@@ -137,4 +139,86 @@ static void BM_MemcpyToI16FromFloat(benchmark::State& state) {
 
 BENCHMARK(BM_MemcpyToI16FromFloat)->RangeMultiplier(2)->Ranges({{10, 8<<12}});
 
+// Channel reorderings for BM_MemcpyByIndexArray and BM_MemcpyByIndexArrayWithPlan,
+// each is { src_channels, dst_channels, idxary[dst_channels] }.
+static const struct {
+    uint32_t src_channels;
+    uint32_t dst_channels;
+    int8_t idxary[8];
+} kIndexArrays[] = {
+    { 2, 2, { 1, 0 } },                          // swap stereo
+    { 1, 2, { 0, 0 } },                          // mono to stereo
+    { 6, 6, { 0, 1, 4, 5, 2, 3 } },              // 5.1 side to back order
+    { 6, 8, { 0, 1, 2, 3, 4, 5, -1, -1 } },      // 5.1 to 7.1, zero fill
+    { 8, 8, { 0, 1, 2, 3, 6, 7, 4, 5 } },        // 7.1 reorder
+    { 8, 2, { 0, 1 } },                          // 7.1 to stereo, drop channels
+};
+
+static void benchmarkMemcpyByIndexArray(benchmark::State& state, bool withPlan) {
+    const auto& arrangement = kIndexArrays[state.range(0)];
+    const size_t sampleSize = state.range(1);
+    constexpr size_t count = 1024;  // frames
+
+    std::vector<uint8_t> src(count * arrangement.src_channels * sampleSize);
+    std::vector<uint8_t> dst(count * arrangement.dst_channels * sampleSize);
+    std::vector<uint8_t> expected(dst.size());
+
+    // Initialize src buffer with deterministic pseudo-random values
+    std::minstd_rand gen(count);
+    std::uniform_int_distribution<> dis(0, 255);
+    for (auto& byte : src) {
+        byte = dis(gen);
+    }
+    memcpy_by_index_array(expected.data(), arrangement.dst_channels,
+            src.data(), arrangement.src_channels, arrangement.idxary, sampleSize, count);
+
+    memcpy_by_index_array_plan_t plan;
+    if (memcpy_by_index_array_plan_initialization(&plan, arrangement.dst_channels,
+            arrangement.src_channels, arrangement.idxary, sampleSize) != 0) {
+        state.SkipWithError("Invalid plan!");
+        return;
+    }
+
+    // Run the test
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(src.data());
+        benchmark::DoNotOptimize(dst.data());
+        if (withPlan) {
+            memcpy_by_index_array_with_plan(dst.data(), src.data(), &plan, count);
+        } else {
+            memcpy_by_index_array(dst.data(), arrangement.dst_channels,
+                    src.data(), arrangement.src_channels, arrangement.idxary, sampleSize, count);
+        }
+        benchmark::ClobberMemory();
+    }
+
+    if (expected != dst) {
+        state.SkipWithError("Incorrect copy!");
+    }
+    state.SetBytesProcessed(state.iterations() * dst.size());
+}
+
+/*
+ * Parameterized Test BM_MemcpyByIndexArray/A/B
+ * <A> is the index into kIndexArrays.
+ * <B> is the sample size in bytes.
+ */
+static void BM_MemcpyByIndexArray(benchmark::State& state) {
+    benchmarkMemcpyByIndexArray(state, false /* withPlan */);
+}
+
+BENCHMARK(BM_MemcpyByIndexArray)->ArgsProduct({
+        benchmark::CreateDenseRange(0, std::size(kIndexArrays) - 1, 1), {2, 3, 4}});
+
+/*
+ * Parameterized Test BM_MemcpyByIndexArrayWithPlan/A/B
+ * Parameters are as for BM_MemcpyByIndexArray.
+ */
+static void BM_MemcpyByIndexArrayWithPlan(benchmark::State& state) {
+    benchmarkMemcpyByIndexArray(state, true /* withPlan */);
+}
+
+BENCHMARK(BM_MemcpyByIndexArrayWithPlan)->ArgsProduct({
+        benchmark::CreateDenseRange(0, std::size(kIndexArrays) - 1, 1), {2, 3, 4}});
+
 BENCHMARK_MAIN();
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <audio_utils/sndfile.h>
+
+/*
+ * Reads and writes of a 1 GiB stereo .wav file, in blocks of kBlockFrames
+ * unless given.  The read benchmarks use the file written by the previous write benchmark,
+ * so they mostly measure reading from the page cache rather than the storage.
+ */
+
+#ifdef __ANDROID__
+static const std::string kPath = "/data/local/tmp/sndfile_benchmark.wav";
+#else
+static const std::string kPath = "/tmp/sndfile_benchmark.wav";
+#endif
+
+constexpr int kChannels = 2;
+constexpr size_t kFileBytes = 1 << 30;
+constexpr sf_count_t kBlockFrames = 4096;
+
+static size_t bytesPerSample(int format) {
+    switch (format) {
+    case SF_FORMAT_PCM_U8: return 1;
+    case SF_FORMAT_PCM_16: return 2;
+    case SF_FORMAT_PCM_24: return 3;
+    default: return 4;
+    }
+}
+
+static sf_count_t fileFrames(int format) {
+    return kFileBytes / (kChannels * bytesPerSample(format));
+}
+
+// Writes the file from float samples, converted to format.
+// Arguments: format, open mode, block frames.
+static void BM_WriteFloat(benchmark::State& state) {
+    const int format = state.range(0);
+    const int mode = state.range(1);
+    const sf_count_t blockFrames = state.range(2);
+    const sf_count_t frames = fileFrames(format);
+    std::vector<float> block(blockFrames * kChannels);
+    for (size_t i = 0; i < block.size(); ++i) {
+        block[i] = std::sin(i * 0.01f) * 0.5f;
+    }
+    for (auto _ : state) {
+        SF_INFO info{};
+        info.samplerate = 48000;
+        info.channels = kChannels;
+        info.format = SF_FORMAT_WAV | format;
+        SNDFILE *handle = sf_open(kPath.c_str(), mode, &info);
+        if (handle == nullptr) {
+            state.SkipWithError("sf_open failed");
+            return;
+        }
+        for (sf_count_t written = 0; written < frames; written += blockFrames) {
+            if (sf_writef_float(handle, block.data(), blockFrames) != blockFrames) {
+                state.SkipWithError("sf_writef_float failed");
+                break;
+            }
+        }
+        sf_close(handle);
+    }
+    state.SetBytesProcessed(state.iterations() * kFileBytes);
+}
+
+// Reads the file as float samples, converted from format.
+// Arguments: format, open mode.
+static void BM_ReadFloat(benchmark::State& state) {
+    const int format = state.range(0);
+    const int mode = state.range(1);
+    std::vector<float> block(kBlockFrames * kChannels);
+    for (auto _ : state) {
+        SF_INFO info{};
+        SNDFILE *handle = sf_open(kPath.c_str(), mode, &info);
+        if (handle == nullptr || (info.format & SF_FORMAT_SUBMASK) != format) {
+            state.SkipWithError("sf_open failed");
+            return;
+        }
+        while (sf_readf_float(handle, block.data(), kBlockFrames) > 0) {
+            benchmark::DoNotOptimize(block.data());
+            benchmark::ClobberMemory();
+        }
+        sf_close(handle);
+    }
+    state.SetBytesProcessed(state.iterations() * kFileBytes);
+}
+
+// Reads the 16 bit file in place with sf_readf_mapped(), touching each sample.
+static void BM_ReadMapped16(benchmark::State& state) {
+    for (auto _ : state) {
+        SF_INFO info{};
+        SNDFILE *handle = sf_open(kPath.c_str(), SFM_READ | SFM_MMAP, &info);
+        if (handle == nullptr || (info.format & SF_FORMAT_SUBMASK) != SF_FORMAT_PCM_16) {
+            state.SkipWithError("sf_open failed");
+            return;
+        }
+        const void *data;
+        sf_count_t frames;
+        int64_t sum = 0;
+        while ((frames = sf_readf_mapped(handle, &data, kBlockFrames)) > 0) {
+            const int16_t *samples = (const int16_t *) data;
+            for (sf_count_t i = 0; i < frames * kChannels; ++i) {
+                sum += samples[i];
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+        sf_close(handle);
+    }
+    state.SetBytesProcessed(state.iterations() * kFileBytes);
+}
+
+// The 16 bit reads follow the 16 bit writes, and the float reads the float writes.
+BENCHMARK(BM_WriteFloat)->Args({SF_FORMAT_PCM_16, SFM_WRITE, kBlockFrames})
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_WriteFloat)->Args({SF_FORMAT_PCM_16, SFM_WRITE | SFM_BUFFERED, kBlockFrames})
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ReadFloat)->Args({SF_FORMAT_PCM_16, SFM_READ})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ReadFloat)->Args({SF_FORMAT_PCM_16, SFM_READ | SFM_MMAP})
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ReadMapped16)->Unit(benchmark::kMillisecond);
+
+// small blocks, such as those of a capture callback
+BENCHMARK(BM_WriteFloat)->Args({SF_FORMAT_FLOAT, SFM_WRITE, 64})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_WriteFloat)->Args({SF_FORMAT_FLOAT, SFM_WRITE | SFM_BUFFERED, 64})
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_WriteFloat)->Args({SF_FORMAT_FLOAT, SFM_WRITE, kBlockFrames})
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_WriteFloat)->Args({SF_FORMAT_FLOAT, SFM_WRITE | SFM_BUFFERED, kBlockFrames})
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ReadFloat)->Args({SF_FORMAT_FLOAT, SFM_READ})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ReadFloat)->Args({SF_FORMAT_FLOAT, SFM_READ | SFM_MMAP})
+        ->Unit(benchmark::kMillisecond);
+
+int main(int argc, char **argv) {
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    remove(kPath.c_str());
+    return 0;
+}
@@ -15,6 +15,7 @@
  */
 
 #include <cstddef>
+#include <mutex>
 #include <random>
 #include <vector>
 
@@ -145,4 +146,111 @@ static auto BM_MeanVariance_float_double_double_alpha(benchmark::State &state) {
 
 BENCHMARK(BM_MeanVariance_float_double_double_alpha);
 
+// Test case:
+// Scaling of statistics gathered from many threads: each benchmark thread adds
+// to a shared object, a Statistics under a mutex or a ShardedStatistics.
+static std::mutex gStatisticsMutex;
+static android::audio_utils::Statistics<double> gStatistics;
+static android::audio_utils::ShardedStatistics<> gShardedStatistics;
+
+static void BM_MutexStatistics_add(benchmark::State &state) {
+    double value = state.thread_index();
+    for (auto _ : state) {
+        std::lock_guard l(gStatisticsMutex);
+        gStatistics.add(value);
+        value += 1.;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_MutexStatistics_add)->ThreadRange(1, 32)->UseRealTime();
+
+static void BM_ShardedStatistics_add(benchmark::State &state) {
+    double value = state.thread_index();
+    for (auto _ : state) {
+        gShardedStatistics.add(value);
+        value += 1.;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_ShardedStatistics_add)->ThreadRange(1, 32)->UseRealTime();
+
+// Cost of merging the shards on read.
+static void BM_ShardedStatistics_get(benchmark::State &state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(gShardedStatistics.get());
+    }
+}
+
+BENCHMARK(BM_ShardedStatistics_get);
+
+// Test case:
+// Cost of adding a sample to a QuantileSketch, for latencies in ns
+// spanning several decades.
+template <typename T>
+static void BM_QuantileSketch_add(benchmark::State &state) {
+    android::audio_utils::QuantileSketch<T> sketch;
+    constexpr size_t count = 1 << 20;
+    std::vector<T> data(count);
+    std::minstd_rand gen(count);
+    std::lognormal_distribution<T> dis(T(14.), T(1.));  // median 1.2 ms
+    for (auto &datum : data) {
+        datum = dis(gen);
+    }
+
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(data.data());
+        for (const auto &datum : data) {
+            sketch.add(datum);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+    printf("%s\n", sketch.toString().c_str());
+}
+
+BENCHMARK(BM_QuantileSketch_add<float>);
+BENCHMARK(BM_QuantileSketch_add<double>);
+
+// Test case:
+// Cost of reading p50, p95 and p99, and of merging the sketches of 4 threads.
+static void BM_QuantileSketch_getQuantile(benchmark::State &state) {
+    android::audio_utils::QuantileSketch<double> sketch;
+    std::minstd_rand gen(42);
+    std::lognormal_distribution<double> dis(14., 1.);
+    for (size_t i = 0; i < 1 << 16; ++i) {
+        sketch.add(dis(gen));
+    }
+
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(sketch.getQuantile(0.5));
+        benchmark::DoNotOptimize(sketch.getQuantile(0.95));
+        benchmark::DoNotOptimize(sketch.getQuantile(0.99));
+    }
+}
+
+BENCHMARK(BM_QuantileSketch_getQuantile);
+
+static void BM_QuantileSketch_merge(benchmark::State &state) {
+    android::audio_utils::QuantileSketch<double> sketches[4];
+    std::minstd_rand gen(42);
+    std::lognormal_distribution<double> dis(14., 1.);
+    for (auto &sketch : sketches) {
+        for (size_t i = 0; i < 1 << 14; ++i) {
+            sketch.add(dis(gen));
+        }
+    }
+
+    while (state.KeepRunning()) {
+        android::audio_utils::QuantileSketch<double> merged;
+        for (const auto &sketch : sketches) {
+            merged.merge(sketch);
+        }
+        benchmark::DoNotOptimize(merged.getQuantile(0.99));
+    }
+}
+
+BENCHMARK(BM_QuantileSketch_merge);
+
 BENCHMARK_MAIN();
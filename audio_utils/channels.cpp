@@ -18,6 +18,7 @@
 #include <audio_utils/channels.h>
 #include "private/private.h"
 
+#include <algorithm>
 #include <vector>
 
 /*
@@ -370,6 +371,265 @@ struct __get_type_
     return num_out_samples * sizeof(*(out_buff)); \
 }
 
+/* Fixed channel count kernels for the most common channel count pairs.
+ *
+ * The macros above work one sample at a time with the channel counts known only at run time.
+ * The templates below instead move blocks of frames through a local buffer with the channel
+ * counts known at compile time, so that the compiler can turn the (de)interleave into vector
+ * loads, shuffles and stores. Reading each block into the local buffer before writing it also
+ * removes the input/output aliasing that otherwise prevents vectorizing in-place conversion.
+ *
+ * Only 16 bit and 32 bit (integer or float) samples are handled; other sample sizes and
+ * channel count pairs use the macros above.
+ */
+
+/* Frames per block of the fixed channel count kernels. */
+static constexpr size_t kFixedBlockFrames = 32;
+
+/* How expand_fixed() fills the output channels not present in the input. */
+enum class expand_mode {
+    ZERO_FILL,  // zero the extra channels, a mono input is duplicated to the first 2 channels.
+    SELECTED,   // leave the extra channels alone.
+};
+
+template <typename T, size_t IN, size_t OUT, expand_mode MODE>
+static inline void expand_fixed_block(const T* in_buff, T* out_buff, size_t frames)
+{
+    T block[kFixedBlockFrames * IN];
+    memcpy(block, in_buff, frames * IN * sizeof(T));
+    for (size_t i = 0; i < frames; ++i) {
+        const T* const src = block + i * IN;
+        T* const dst = out_buff + i * OUT;
+        if constexpr (MODE == expand_mode::ZERO_FILL && IN == 1) {
+            dst[0] = src[0];
+            dst[1] = src[0];
+            for (size_t c = 2; c < OUT; ++c) dst[c] = T{};
+        } else {
+            for (size_t c = 0; c < IN; ++c) dst[c] = src[c];
+            if constexpr (MODE == expand_mode::ZERO_FILL) {
+                for (size_t c = IN; c < OUT; ++c) dst[c] = T{};
+            }
+        }
+    }
+}
+
+/* Channel expands IN to OUT channels, see EXPAND_CHANNELS(), EXPAND_MONO_TO_MULTI()
+ * and EXPAND_SELECTED_CHANNELS().
+ *
+ * Move blocks from back to front so that the conversion can be done in-place.
+ * The output of a block never overlaps the input of the blocks before it.
+ */
+template <typename T, size_t IN, size_t OUT, expand_mode MODE>
+static void expand_fixed(const T* in_buff, T* out_buff, size_t frames)
+{
+    const size_t partial = frames % kFixedBlockFrames;
+    for (size_t frame = frames; frame > partial; ) {
+        frame -= kFixedBlockFrames;
+        expand_fixed_block<T, IN, OUT, MODE>(
+                in_buff + frame * IN, out_buff + frame * OUT, kFixedBlockFrames);
+    }
+    if (partial > 0) {
+        expand_fixed_block<T, IN, OUT, MODE>(in_buff, out_buff, partial);
+    }
+}
+
+template <typename T, size_t IN, size_t OUT>
+static inline void contract_fixed_block(const T* in_buff, T* out_buff, T* extra_buff,
+        size_t frames)
+{
+    T block[kFixedBlockFrames * IN];
+    memcpy(block, in_buff, frames * IN * sizeof(T));
+    if (OUT == 1 && extra_buff == nullptr) {
+        /* average the first two channels without overflow, see CONTRACT_TO_MONO() */
+        for (size_t i = 0; i < frames; ++i) {
+            const int32_t temp0 = block[i * IN];
+            const int32_t temp1 = block[i * IN + 1];
+            out_buff[i] = (temp0 & temp1) + ((temp0 ^ temp1) >> 1);
+        }
+        return;
+    }
+    for (size_t i = 0; i < frames; ++i) {
+        for (size_t c = 0; c < OUT; ++c) out_buff[i * OUT + c] = block[i * IN + c];
+    }
+    if (extra_buff != nullptr) {
+        for (size_t i = 0; i < frames; ++i) {
+            for (size_t c = OUT; c < IN; ++c) {
+                extra_buff[i * (IN - OUT) + c - OUT] = block[i * IN + c];
+            }
+        }
+    }
+}
+
+/* Channel contracts IN to OUT channels, see CONTRACT_CHANNELS() and CONTRACT_TO_MONO().
+ * If extra_buff is not null, the removed channels are stored there as in
+ * CONTRACT_CHANNELS_NON_DESTRUCTIVE(), and a mono output is not mixed.
+ *
+ * Move blocks from front to back so that the conversion can be done in-place.
+ */
+template <typename T, size_t IN, size_t OUT>
+static void contract_fixed(const T* in_buff, T* out_buff, T* extra_buff, size_t frames)
+{
+    size_t frame = 0;
+    for (; frame + kFixedBlockFrames <= frames; frame += kFixedBlockFrames) {
+        contract_fixed_block<T, IN, OUT>(in_buff + frame * IN, out_buff + frame * OUT,
+                extra_buff == nullptr ? nullptr : extra_buff + frame * (IN - OUT),
+                kFixedBlockFrames);
+    }
+    if (frame < frames) {
+        contract_fixed_block<T, IN, OUT>(in_buff + frame * IN, out_buff + frame * OUT,
+                extra_buff == nullptr ? nullptr : extra_buff + frame * (IN - OUT),
+                frames - frame);
+    }
+}
+
+template <typename T, size_t IN, size_t OUT>
+static inline void interleave_fixed_block(const T* front_buff, const T* back_buff, T* out_buff,
+        size_t frames)
+{
+    T front[kFixedBlockFrames * IN];
+    T back[kFixedBlockFrames * (OUT - IN)];
+    memcpy(front, front_buff, frames * IN * sizeof(T));
+    memcpy(back, back_buff, frames * (OUT - IN) * sizeof(T));
+    for (size_t i = 0; i < frames; ++i) {
+        T* const dst = out_buff + i * OUT;
+        for (size_t c = 0; c < IN; ++c) dst[c] = front[i * IN + c];
+        for (size_t c = IN; c < OUT; ++c) dst[c] = back[i * (OUT - IN) + c - IN];
+    }
+}
+
+/* Interleaves IN channels from front_buff with OUT - IN channels from back_buff,
+ * see EXPAND_CHANNELS_NON_DESTRUCTIVE().
+ *
+ * Move blocks from front to back; back_buff may be the end of out_buff, as
+ * the output of a block never overlaps the back channels of the blocks after it.
+ */
+template <typename T, size_t IN, size_t OUT>
+static void interleave_fixed(const T* front_buff, const T* back_buff, T* out_buff,
+        size_t frames)
+{
+    size_t frame = 0;
+    for (; frame + kFixedBlockFrames <= frames; frame += kFixedBlockFrames) {
+        interleave_fixed_block<T, IN, OUT>(front_buff + frame * IN,
+                back_buff + frame * (OUT - IN), out_buff + frame * OUT, kFixedBlockFrames);
+    }
+    if (frame < frames) {
+        interleave_fixed_block<T, IN, OUT>(front_buff + frame * IN,
+                back_buff + frame * (OUT - IN), out_buff + frame * OUT, frames - frame);
+    }
+}
+
+static constexpr size_t channel_pair(size_t in_buff_chans, size_t out_buff_chans)
+{
+    return in_buff_chans << 8 | out_buff_chans;
+}
+
+/* Returns the fixed channel count kernels for the channel pair, or nullptr if there is none. */
+template <typename T, expand_mode MODE>
+static auto get_expand_fixed(size_t in_buff_chans, size_t out_buff_chans)
+        -> void (*)(const T*, T*, size_t)
+{
+    switch (channel_pair(in_buff_chans, out_buff_chans)) {
+    case channel_pair(1, 2): return expand_fixed<T, 1, 2, MODE>;
+    case channel_pair(2, 4): return expand_fixed<T, 2, 4, MODE>;
+    case channel_pair(2, 6): return expand_fixed<T, 2, 6, MODE>;
+    case channel_pair(2, 8): return expand_fixed<T, 2, 8, MODE>;
+    default: return nullptr;
+    }
+}
+
+template <typename T>
+static auto get_contract_fixed(size_t in_buff_chans, size_t out_buff_chans)
+        -> void (*)(const T*, T*, T*, size_t)
+{
+    switch (channel_pair(in_buff_chans, out_buff_chans)) {
+    case channel_pair(2, 1): return contract_fixed<T, 2, 1>;
+    case channel_pair(4, 2): return contract_fixed<T, 4, 2>;
+    case channel_pair(6, 2): return contract_fixed<T, 6, 2>;
+    case channel_pair(8, 2): return contract_fixed<T, 8, 2>;
+    default: return nullptr;
+    }
+}
+
+template <typename T>
+static auto get_interleave_fixed(size_t in_buff_chans, size_t out_buff_chans)
+        -> void (*)(const T*, const T*, T*, size_t)
+{
+    switch (channel_pair(in_buff_chans, out_buff_chans)) {
+    case channel_pair(1, 2): return interleave_fixed<T, 1, 2>;
+    case channel_pair(2, 4): return interleave_fixed<T, 2, 4>;
+    case channel_pair(2, 6): return interleave_fixed<T, 2, 6>;
+    case channel_pair(2, 8): return interleave_fixed<T, 2, 8>;
+    default: return nullptr;
+    }
+}
+
+/* The following return true if the conversion was done by a fixed channel count kernel,
+ * or false if there is none for the channel pair. Parameters are as for the corresponding
+ * functions below, and the number of bytes generated is always
+ * num_in_bytes * out_buff_chans / in_buff_chans.
+ */
+
+template <typename T, expand_mode MODE>
+static bool expand_channels_fixed(const void* in_buff, size_t in_buff_chans,
+                                  void* out_buff, size_t out_buff_chans, size_t num_in_bytes)
+{
+    const auto expand = get_expand_fixed<T, MODE>(in_buff_chans, out_buff_chans);
+    if (expand == nullptr) return false;
+    expand((const T*)in_buff, (T*)out_buff, num_in_bytes / (in_buff_chans * sizeof(T)));
+    return true;
+}
+
+template <typename T>
+static bool contract_channels_fixed(const void* in_buff, size_t in_buff_chans,
+                                    void* out_buff, size_t out_buff_chans, size_t num_in_bytes)
+{
+    const auto contract = get_contract_fixed<T>(in_buff_chans, out_buff_chans);
+    if (contract == nullptr) return false;
+    contract((const T*)in_buff, (T*)out_buff, nullptr /* extra_buff */,
+            num_in_bytes / (in_buff_chans * sizeof(T)));
+    return true;
+}
+
+template <typename T>
+static bool contract_channels_non_destructive_fixed(const void* in_buff, size_t in_buff_chans,
+                                                    void* out_buff, size_t out_buff_chans,
+                                                    size_t num_in_bytes)
+{
+    const auto contract = get_contract_fixed<T>(in_buff_chans, out_buff_chans);
+    if (contract == nullptr) return false;
+    const size_t frames = num_in_bytes / (in_buff_chans * sizeof(T));
+    T* const extra_ptr = (T*)out_buff + frames * out_buff_chans;
+    /* if in-place, store the removed channels to a temp buffer instead of out buffer */
+    if (in_buff == out_buff) {
+        std::vector<T> buffer(frames * (in_buff_chans - out_buff_chans));
+        contract((const T*)in_buff, (T*)out_buff, buffer.data(), frames);
+        memcpy(extra_ptr, buffer.data(), buffer.size() * sizeof(T));
+    } else {
+        contract((const T*)in_buff, (T*)out_buff, extra_ptr, frames);
+    }
+    return true;
+}
+
+template <typename T>
+static bool expand_channels_non_destructive_fixed(const void* in_buff, size_t in_buff_chans,
+                                                  void* out_buff, size_t out_buff_chans,
+                                                  size_t num_in_bytes)
+{
+    const auto interleave = get_interleave_fixed<T>(in_buff_chans, out_buff_chans);
+    if (interleave == nullptr) return false;
+    const size_t frames = num_in_bytes / (in_buff_chans * sizeof(T));
+    const T* const back_ptr = (const T*)in_buff + frames * in_buff_chans;
+    /* if in-place, copy input channels to a temp buffer */
+    if (in_buff == out_buff) {
+        std::vector<T> buffer(frames * in_buff_chans);
+        memcpy(buffer.data(), in_buff, num_in_bytes);
+        interleave(buffer.data(), back_ptr, (T*)out_buff, frames);
+    } else {
+        interleave((const T*)in_buff, back_ptr, (T*)out_buff, frames);
+    }
+    return true;
+}
+
 /*
  * Convert a buffer of N-channel, interleaved samples to M-channel
  * (where N > M).
@@ -390,6 +650,22 @@ static size_t contract_channels(const void* in_buff, size_t in_buff_chans,
                                 void* out_buff, size_t out_buff_chans,
                                 unsigned sample_size_in_bytes, size_t num_in_bytes)
 {
+    /* common channel pairs use the fixed channel count kernels */
+    switch (sample_size_in_bytes) {
+    case 2:
+        if (contract_channels_fixed<int16_t>(
+                in_buff, in_buff_chans, out_buff, out_buff_chans, num_in_bytes)) {
+            return num_in_bytes * out_buff_chans / in_buff_chans;
+        }
+        break;
+    case 4:
+        if (contract_channels_fixed<int32_t>(
+                in_buff, in_buff_chans, out_buff, out_buff_chans, num_in_bytes)) {
+            return num_in_bytes * out_buff_chans / in_buff_chans;
+        }
+        break;
+    }
+
     switch (sample_size_in_bytes) {
     case 1:
         if (out_buff_chans == 1) {
@@ -462,6 +738,22 @@ static size_t contract_channels_non_destructive(const void* in_buff, size_t in_b
                                 void* out_buff, size_t out_buff_chans,
                                 unsigned sample_size_in_bytes, size_t num_in_bytes)
 {
+    /* common channel pairs use the fixed channel count kernels */
+    switch (sample_size_in_bytes) {
+    case 2:
+        if (contract_channels_non_destructive_fixed<int16_t>(
+                in_buff, in_buff_chans, out_buff, out_buff_chans, num_in_bytes)) {
+            return num_in_bytes * out_buff_chans / in_buff_chans;
+        }
+        break;
+    case 4:
+        if (contract_channels_non_destructive_fixed<int32_t>(
+                in_buff, in_buff_chans, out_buff, out_buff_chans, num_in_bytes)) {
+            return num_in_bytes * out_buff_chans / in_buff_chans;
+        }
+        break;
+    }
+
     switch (sample_size_in_bytes) {
     case 1:
         CONTRACT_CHANNELS_NON_DESTRUCTIVE((const uint8_t*)in_buff, in_buff_chans,
@@ -510,6 +802,22 @@ static size_t expand_channels(const void* in_buff, size_t in_buff_chans,
 {
     static const uint8x3_t packed24_zero{}; /* zero 24 bit sample */
 
+    /* common channel pairs use the fixed channel count kernels */
+    switch (sample_size_in_bytes) {
+    case 2:
+        if (expand_channels_fixed<int16_t, expand_mode::ZERO_FILL>(
+                in_buff, in_buff_chans, out_buff, out_buff_chans, num_in_bytes)) {
+            return num_in_bytes * out_buff_chans / in_buff_chans;
+        }
+        break;
+    case 4:
+        if (expand_channels_fixed<int32_t, expand_mode::ZERO_FILL>(
+                in_buff, in_buff_chans, out_buff, out_buff_chans, num_in_bytes)) {
+            return num_in_bytes * out_buff_chans / in_buff_chans;
+        }
+        break;
+    }
+
     switch (sample_size_in_bytes) {
     case 1:
         if (in_buff_chans == 1) {
@@ -588,6 +896,22 @@ static size_t expand_selected_channels(const void* in_buff, size_t in_buff_chans
                               void* out_buff, size_t out_buff_chans,
                               unsigned sample_size_in_bytes, size_t num_in_bytes)
 {
+    /* common channel pairs use the fixed channel count kernels */
+    switch (sample_size_in_bytes) {
+    case 2:
+        if (expand_channels_fixed<int16_t, expand_mode::SELECTED>(
+                in_buff, in_buff_chans, out_buff, out_buff_chans, num_in_bytes)) {
+            return num_in_bytes * out_buff_chans / in_buff_chans;
+        }
+        break;
+    case 4:
+        if (expand_channels_fixed<int32_t, expand_mode::SELECTED>(
+                in_buff, in_buff_chans, out_buff, out_buff_chans, num_in_bytes)) {
+            return num_in_bytes * out_buff_chans / in_buff_chans;
+        }
+        break;
+    }
+
     switch (sample_size_in_bytes) {
     case 1:
 
@@ -643,6 +967,22 @@ static size_t expand_channels_non_destructive(const void* in_buff, size_t in_buf
                               void* out_buff, size_t out_buff_chans,
                               unsigned sample_size_in_bytes, size_t num_in_bytes)
 {
+    /* common channel pairs use the fixed channel count kernels */
+    switch (sample_size_in_bytes) {
+    case 2:
+        if (expand_channels_non_destructive_fixed<int16_t>(
+                in_buff, in_buff_chans, out_buff, out_buff_chans, num_in_bytes)) {
+            return num_in_bytes * out_buff_chans / in_buff_chans;
+        }
+        break;
+    case 4:
+        if (expand_channels_non_destructive_fixed<int32_t>(
+                in_buff, in_buff_chans, out_buff, out_buff_chans, num_in_bytes)) {
+            return num_in_bytes * out_buff_chans / in_buff_chans;
+        }
+        break;
+    }
+
     switch (sample_size_in_bytes) {
     case 1:
 
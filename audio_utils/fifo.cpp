@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <audio_utils/clock.h>
 #include <audio_utils/clock_nanosleep.h>
 #include <audio_utils/fifo.h>
 #include <audio_utils/futex.h>
@@ -40,20 +41,44 @@ audio_utils_fifo_base::audio_utils_fifo_base(uint32_t frameCount,
         __attribute__((no_sanitize("integer"))) :
     mFrameCount(frameCount), mFrameCountP2(roundup(frameCount)),
     mFudgeFactor(mFrameCountP2 - mFrameCount),
+    mIndexMask(UINT32_MAX),
     // FIXME need an API to configure the sync types
-    mWriterRear(writerRear), mWriterRearSync(sync),
-    mThrottleFront(throttleFront), mThrottleFrontSync(sync),
+    mWriterRear(&writerRear), mWriterRearSync(sync),
+    mThrottleFront(throttleFront), mThrottleFronts(NULL), mThrottleFrontCount(0),
+    mThrottleFrontStride(sizeof(audio_utils_fifo_index64)),
+    mThrottleFrontSync(sync),
     mIsShutdown(false)
 {
     // actual upper bound on frameCount will depend on the frame size
     LOG_ALWAYS_FATAL_IF(frameCount == 0 || frameCount > ((uint32_t) INT32_MAX));
 }
 
+audio_utils_fifo_base::audio_utils_fifo_base(uint32_t frameCount,
+        audio_utils_fifo_index64& writerRear, audio_utils_fifo_index64 *throttleFronts,
+        uint32_t throttleFrontCount, audio_utils_fifo_sync sync, size_t throttleFrontStride)
+        __attribute__((no_sanitize("integer"))) :
+    mFrameCount(frameCount), mFrameCountP2(roundup(frameCount)),
+    mFudgeFactor(mFrameCountP2 - mFrameCount),
+    mIndexMask(audio_utils_fifo_index64::kMask),
+    mWriterRear(&writerRear), mWriterRearSync(sync),
+    mThrottleFront(throttleFrontCount == 0 ? throttleFronts : NULL),
+    mThrottleFronts(throttleFrontCount > 0 ? throttleFronts : NULL),
+    mThrottleFrontCount(throttleFronts != NULL ? throttleFrontCount : 0),
+    mThrottleFrontStride(throttleFrontStride),
+    mThrottleFrontSync(sync),
+    mIsShutdown(false)
+{
+    LOG_ALWAYS_FATAL_IF(frameCount == 0 || frameCount > ((uint32_t) INT32_MAX));
+    LOG_ALWAYS_FATAL_IF(throttleFrontCount > kMaxThrottleFronts);
+    LOG_ALWAYS_FATAL_IF(throttleFrontStride == 0 ||
+            throttleFrontStride % sizeof(audio_utils_fifo_index64) != 0);
+}
+
 audio_utils_fifo_base::~audio_utils_fifo_base()
 {
 }
 
-uint32_t audio_utils_fifo_base::sum(uint32_t index, uint32_t increment) const
+uint64_t audio_utils_fifo_base::sum(uint64_t index, uint32_t increment) const
         __attribute__((no_sanitize("integer")))
 {
     if (mFudgeFactor > 0) {
@@ -65,13 +90,13 @@ uint32_t audio_utils_fifo_base::sum(uint32_t index, uint32_t increment) const
         }
         index += increment;
         ALOG_ASSERT((index & mask) < mFrameCount);
-        return index;
+        return index & mIndexMask;
     } else {
-        return index + increment;
+        return (index + increment) & mIndexMask;
     }
 }
 
-int32_t audio_utils_fifo_base::diff(uint32_t rear, uint32_t front, size_t *lost, bool flush) const
+int32_t audio_utils_fifo_base::diff(uint64_t rear, uint64_t front, size_t *lost, bool flush) const
         __attribute__((no_sanitize("integer")))
 {
     // TODO replace multiple returns by a single return point so this isn't needed
@@ -81,9 +106,9 @@ int32_t audio_utils_fifo_base::diff(uint32_t rear, uint32_t front, size_t *lost,
     if (mIsShutdown) {
         return -EIO;
     }
-    uint32_t diff = rear - front;
+    uint64_t diff = (rear - front) & mIndexMask;
     if (mFudgeFactor > 0) {
-        uint32_t mask = mFrameCountP2 - 1;
+        uint64_t mask = mFrameCountP2 - 1;
         uint32_t rearOffset = rear & mask;
         uint32_t frontOffset = front & mask;
         if (rearOffset >= mFrameCount || frontOffset >= mFrameCount) {
@@ -94,7 +119,7 @@ int32_t audio_utils_fifo_base::diff(uint32_t rear, uint32_t front, size_t *lost,
         }
         // genDiff is the difference between the generation count fields of rear and front,
         // and is always a multiple of mFrameCountP2.
-        uint32_t genDiff = (rear & ~mask) - (front & ~mask);
+        uint64_t genDiff = ((rear & ~mask) - (front & ~mask)) & mIndexMask;
         // It's OK for writer to be one generation beyond reader,
         // but reader has lost frames if writer is further than one generation beyond.
         if (genDiff > mFrameCountP2) {
@@ -124,6 +149,46 @@ int32_t audio_utils_fifo_base::diff(uint32_t rear, uint32_t front, size_t *lost,
     return (int32_t) diff;
 }
 
+int32_t audio_utils_fifo_base::throttleFilled(uint64_t rear, uint64_t *front,
+        audio_utils_fifo_index_ref *frontIndex) const
+{
+    if (mThrottleFronts == NULL) {
+        *frontIndex = mThrottleFront;
+        *front = mThrottleFrontSync == AUDIO_UTILS_FIFO_SYNC_SINGLE_THREADED ?
+                mThrottleFront.loadSingleThreaded() : mThrottleFront.loadAcquire();
+        // returns -EIO if mIsShutdown
+        return diff(rear, *front);
+    }
+    // The slowest registered reader determines the fill level, and is the one to wait for.
+    *frontIndex = audio_utils_fifo_index_ref();
+    int32_t maxFilled = 0;
+    for (uint32_t i = 0; i < mThrottleFrontCount; i++) {
+        audio_utils_fifo_index64& index = throttleFrontSlot(i);
+        const uint64_t value = mThrottleFrontSync == AUDIO_UTILS_FIFO_SYNC_SINGLE_THREADED ?
+                index.loadSingleThreaded() : index.loadAcquire();
+        if (value == audio_utils_fifo_index64::kUnregistered) {
+            continue;
+        }
+        int32_t filled = diff(rear, value);
+        if (filled == -EOVERFLOW) {
+            // reader registered while the writer was more than a buffer ahead of it,
+            // it catches up on its next obtain()
+            filled = mFrameCount;
+        } else if (filled < 0) {
+            return filled;
+        }
+        if (frontIndex->isNull() || filled > maxFilled) {
+            maxFilled = filled;
+            *front = value;
+            *frontIndex = &index;
+        }
+    }
+    if (frontIndex->isNull() && mIsShutdown) {
+        return -EIO;
+    }
+    return maxFilled;
+}
+
 void audio_utils_fifo_base::shutdown() const
 {
     ALOGE("%s", __func__);
@@ -144,6 +209,18 @@ audio_utils_fifo::audio_utils_fifo(uint32_t frameCount, uint32_t frameSize, void
             frameCount > ((uint32_t) INT32_MAX) / frameSize);
 }
 
+audio_utils_fifo::audio_utils_fifo(uint32_t frameCount, uint32_t frameSize, void *buffer,
+        audio_utils_fifo_index64& writerRear, audio_utils_fifo_index64 *throttleFronts,
+        uint32_t throttleFrontCount, size_t throttleFrontStride)
+        __attribute__((no_sanitize("integer"))) :
+    audio_utils_fifo_base(frameCount, writerRear, throttleFronts, throttleFrontCount,
+            AUDIO_UTILS_FIFO_SYNC_SHARED, throttleFrontStride),
+    mFrameSize(frameSize), mBuffer(buffer)
+{
+    LOG_ALWAYS_FATAL_IF(frameCount == 0 || frameSize == 0 || buffer == NULL ||
+            frameCount > ((uint32_t) INT32_MAX) / frameSize);
+}
+
 audio_utils_fifo::audio_utils_fifo(uint32_t frameCount, uint32_t frameSize, void *buffer,
         bool throttlesWriter, audio_utils_fifo_sync sync) :
     audio_utils_fifo(frameCount, frameSize, buffer, mSingleProcessSharedRear,
@@ -159,7 +236,7 @@ audio_utils_fifo::~audio_utils_fifo()
 ////////////////////////////////////////////////////////////////////////////////
 
 audio_utils_fifo_provider::audio_utils_fifo_provider(audio_utils_fifo& fifo) :
-    mFifo(fifo), mObtained(0), mTotalReleased(0)
+    mFifo(fifo), mObtained(0), mDeferredPublish(false), mUnpublished(0), mTotalReleased(0)
 {
 }
 
@@ -167,6 +244,14 @@ audio_utils_fifo_provider::~audio_utils_fifo_provider()
 {
 }
 
+void audio_utils_fifo_provider::setDeferredPublish(bool deferred)
+{
+    mDeferredPublish = deferred;
+    if (!deferred) {
+        publish();
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 audio_utils_fifo_writer::audio_utils_fifo_writer(audio_utils_fifo& fifo) :
@@ -179,6 +264,7 @@ audio_utils_fifo_writer::audio_utils_fifo_writer(audio_utils_fifo& fifo) :
 
 audio_utils_fifo_writer::~audio_utils_fifo_writer()
 {
+    publish();
 }
 
 ssize_t audio_utils_fifo_writer::write(const void *buffer, size_t count,
@@ -201,20 +287,31 @@ ssize_t audio_utils_fifo_writer::write(const void *buffer, size_t count,
 }
 
 // iovec == NULL is not part of the public API, but internally it means don't set mObtained
+static int64_t monotonicNs()
+{
+    struct timespec now;
+    (void) clock_gettime(CLOCK_MONOTONIC, &now);
+    return audio_utils_ns_from_timespec(&now);
+}
+
 ssize_t audio_utils_fifo_writer::obtain(audio_utils_iovec iovec[2], size_t count,
         const struct timespec *timeout)
         __attribute__((no_sanitize("integer")))
 {
     int err = 0;
     size_t availToWrite;
-    if (mFifo.mThrottleFront != NULL) {
+    if (mFifo.isThrottled()) {
+        // With several throttling readers, a wake by one reader is followed by another wait
+        // for the slowest, which is bounded by a deadline set at the first wait.
+        const struct timespec *requestedTimeout = timeout;
+        int64_t deadlineNs = -1;
+        struct timespec remaining;
         int retries = kRetries;
         for (;;) {
-            uint32_t front = mFifo.mThrottleFrontSync == AUDIO_UTILS_FIFO_SYNC_SINGLE_THREADED ?
-                    mFifo.mThrottleFront->loadSingleThreaded() :
-                    mFifo.mThrottleFront->loadAcquire();
+            uint64_t front;
+            audio_utils_fifo_index_ref frontIndex;
             // returns -EIO if mIsShutdown
-            int32_t filled = mFifo.diff(mLocalRear, front);
+            int32_t filled = mFifo.throttleFilled(mLocalRear, &front, &frontIndex);
             if (filled < 0) {
                 // on error, return an empty slice
                 err = filled;
@@ -224,10 +321,17 @@ ssize_t audio_utils_fifo_writer::obtain(audio_utils_iovec iovec[2], size_t count
             availToWrite = mEffectiveFrames > (uint32_t) filled ?
                     mEffectiveFrames - (uint32_t) filled : 0;
             // TODO pull out "count == 0"
-            if (count == 0 || availToWrite > 0 || timeout == NULL ||
+            // frontIndex is empty only if no reader is registered, and then there is
+            // no reader to wait for.
+            if (count == 0 || availToWrite > 0 || frontIndex.isNull() || timeout == NULL ||
                     (timeout->tv_sec == 0 && timeout->tv_nsec == 0)) {
                 break;
             }
+            if (mUnpublished > 0) {
+                // the reader cannot make room while it does not see the deferred frames
+                publish();
+                continue;
+            }
             // TODO add comments
             // TODO abstract out switch and replace by general sync object
             //      the high level code (synchronization, sleep, futex, iovec) should be completely
@@ -253,12 +357,30 @@ ssize_t audio_utils_fifo_writer::obtain(audio_utils_iovec iovec[2], size_t count
             case AUDIO_UTILS_FIFO_SYNC_SHARED:
                 if (timeout->tv_sec == LONG_MAX) {
                     timeout = NULL;
+                } else if (mFifo.mThrottleFronts != NULL && deadlineNs < 0) {
+                    deadlineNs = monotonicNs() + audio_utils_ns_from_timespec(timeout);
+                }
+                err = frontIndex.wait(op, front, timeout);
+                if (err == 0 && mFifo.mThrottleFronts != NULL) {
+                    // Woken by the reader we waited for, but another reader may be as slow.
+                    if (timeout == NULL) {
+                        timeout = requestedTimeout;  // infinite
+                    } else {
+                        // a zero timeout returns at the next iteration
+                        int64_t remainingNs = deadlineNs - monotonicNs();
+                        if (remainingNs < 0) {
+                            remainingNs = 0;
+                        }
+                        remaining.tv_sec = remainingNs / 1000000000;
+                        remaining.tv_nsec = remainingNs % 1000000000;
+                        timeout = &remaining;
+                    }
+                    continue;
                 }
-                err = mFifo.mThrottleFront->wait(op, front, timeout);
                 if (err < 0) {
                     switch (errno) {
                     case EWOULDBLOCK:
-                        // Benign race condition with partner: mFifo.mThrottleFront->mIndex
+                        // Benign race condition with partner: the front index
                         // changed value between the earlier atomic_load_explicit() and sys_futex().
                         // Try to load index again, but give up if we are unable to converge.
                         if (retries-- > 0) {
@@ -320,57 +442,74 @@ void audio_utils_fifo_writer::release(size_t count)
             mFifo.shutdown();
             return;
         }
-        if (mFifo.mThrottleFront != NULL) {
-            uint32_t front = mFifo.mThrottleFrontSync == AUDIO_UTILS_FIFO_SYNC_SINGLE_THREADED ?
-                    mFifo.mThrottleFront->loadSingleThreaded() :
-                    mFifo.mThrottleFront->loadAcquire();
+        mLocalRear = mFifo.sum(mLocalRear, count);
+        mUnpublished += count;
+        mObtained -= count;
+        mTotalReleased += count;
+        if (!mDeferredPublish) {
+            publish();
+        }
+    }
+}
+
+void audio_utils_fifo_writer::publish()
+        __attribute__((no_sanitize("integer")))
+{
+    if (mUnpublished == 0) {
+        return;
+    }
+    const uint32_t count = mUnpublished;
+    mUnpublished = 0;
+    if (mFifo.mWriterRearSync == AUDIO_UTILS_FIFO_SYNC_SINGLE_THREADED) {
+        mFifo.mWriterRear.storeSingleThreaded(mLocalRear);
+        return;
+    }
+    // Only wake if a reader may be waiting, as told by the waiter flag of a 64-bit index.
+    const bool waiting = mFifo.mWriterRear.storeRelease(mLocalRear);
+    bool wake = false;
+    // TODO add comments
+    int op = FUTEX_WAKE;
+    switch (mFifo.mWriterRearSync) {
+    case AUDIO_UTILS_FIFO_SYNC_SLEEP:
+        break;
+    case AUDIO_UTILS_FIFO_SYNC_PRIVATE:
+        op = FUTEX_WAKE_PRIVATE;
+        FALLTHROUGH_INTENDED;
+    case AUDIO_UTILS_FIFO_SYNC_SHARED:
+        if (mFifo.isThrottled()) {
+            uint64_t front;
+            audio_utils_fifo_index_ref frontIndex;
             // returns -EIO if mIsShutdown
-            int32_t filled = mFifo.diff(mLocalRear, front);
-            mLocalRear = mFifo.sum(mLocalRear, count);
-            if (mFifo.mWriterRearSync == AUDIO_UTILS_FIFO_SYNC_SINGLE_THREADED) {
-                mFifo.mWriterRear.storeSingleThreaded(mLocalRear);
-            } else {
-                mFifo.mWriterRear.storeRelease(mLocalRear);
-            }
-            // TODO add comments
-            int op = FUTEX_WAKE;
-            switch (mFifo.mWriterRearSync) {
-            case AUDIO_UTILS_FIFO_SYNC_SINGLE_THREADED:
-            case AUDIO_UTILS_FIFO_SYNC_SLEEP:
-                break;
-            case AUDIO_UTILS_FIFO_SYNC_PRIVATE:
-                op = FUTEX_WAKE_PRIVATE;
-                FALLTHROUGH_INTENDED;
-            case AUDIO_UTILS_FIFO_SYNC_SHARED:
-                if (filled >= 0) {
-                    if ((uint32_t) filled < mArmLevel) {
-                        mIsArmed = true;
-                    }
-                    if (mIsArmed && filled + count > mTriggerLevel) {
-                        int err = mFifo.mWriterRear.wake(op, INT32_MAX /*waiters*/);
-                        // err is number of processes woken up
-                        if (err < 0) {
-                            LOG_ALWAYS_FATAL("%s: unexpected err=%d errno=%d",
-                                    __func__, err, errno);
-                        }
-                        mIsArmed = false;
-                    }
+            int32_t filled = mFifo.throttleFilled(mLocalRear, &front, &frontIndex);
+            if (filled >= 0) {
+                // hysteresis uses the fill level before and after the published frames
+                uint32_t filledBefore = (uint32_t) filled > count ? (uint32_t) filled - count : 0;
+                if (filledBefore < mArmLevel) {
+                    mIsArmed = true;
+                }
+                if (mIsArmed && (uint32_t) filled > mTriggerLevel) {
+                    wake = true;
+                    mIsArmed = false;
                 }
-                break;
-            default:
-                LOG_ALWAYS_FATAL("mFifo.mWriterRearSync=%d", mFifo.mWriterRearSync);
-                break;
             }
         } else {
-            mLocalRear = mFifo.sum(mLocalRear, count);
-            if (mFifo.mWriterRearSync == AUDIO_UTILS_FIFO_SYNC_SINGLE_THREADED) {
-                mFifo.mWriterRear.storeSingleThreaded(mLocalRear);
-            } else {
-                mFifo.mWriterRear.storeRelease(mLocalRear);
+            // without a waiter flag, readers of an unthrottled FIFO are not woken
+            wake = mFifo.mWriterRear.hasWaiterFlag();
+        }
+        if (waiting && wake) {
+            int err = mFifo.mWriterRear.wake(op, INT32_MAX /*waiters*/);
+            // err is number of processes woken up
+            if (err < 0) {
+                LOG_ALWAYS_FATAL("%s: unexpected err=%d errno=%d", __func__, err, errno);
             }
+        } else if (waiting) {
+            // pass the waiter flag on to the next publication
+            mFifo.mWriterRear.setWaiting();
         }
-        mObtained -= count;
-        mTotalReleased += count;
+        break;
+    default:
+        LOG_ALWAYS_FATAL("mFifo.mWriterRearSync=%d", mFifo.mWriterRearSync);
+        break;
     }
 }
 
@@ -438,19 +577,51 @@ audio_utils_fifo_reader::audio_utils_fifo_reader(audio_utils_fifo& fifo, bool th
     // current value of writer's rear.  This avoids an immediate -EOVERFLOW (overrun) in the case
     // where reader starts out more than one buffer behind writer.  The initial catch-up does not
     // contribute towards the totalLost, totalFlushed, or totalReleased counters.
-    mLocalFront(throttlesWriter ? 0 : mFifo.mWriterRear.loadAcquire()),
+    mLocalFront(throttlesWriter && mFifo.mThrottleFronts == NULL ?
+            0 : mFifo.mWriterRear.loadAcquire()),
 
-    mThrottleFront(throttlesWriter ? mFifo.mThrottleFront : NULL),
+    mThrottleFront(throttlesWriter ? mFifo.mThrottleFront : audio_utils_fifo_index_ref()),
+    mRegistered(false),
     mFlush(flush),
     mArmLevel(-1), mTriggerLevel(mFifo.mFrameCount),
     mIsArmed(true), // because initial fill level of zero is > mArmLevel
     mTotalLost(0), mTotalFlushed(0)
 {
+    if (throttlesWriter && mFifo.mThrottleFronts != NULL) {
+        // Register in the first free slot, starting at the current writer's rear.
+        for (uint32_t i = 0; i < mFifo.mThrottleFrontCount; i++) {
+            uint64_t expected = audio_utils_fifo_index64::kUnregistered;
+            if (mFifo.throttleFrontSlot(i).compareExchange(&expected, mLocalFront)) {
+                mThrottleFront = &mFifo.throttleFrontSlot(i);
+                mRegistered = true;
+                break;
+            }
+        }
+        if (!mRegistered) {
+            ALOGE("%s: all %u throttling reader slots are in use",
+                    __func__, mFifo.mThrottleFrontCount);
+        }
+    }
 }
 
 audio_utils_fifo_reader::~audio_utils_fifo_reader()
 {
+    publish();
     // TODO Need a way to pass throttle capability to the another reader, should one reader exit.
+    if (mRegistered &&
+            mThrottleFront.storeRelease(audio_utils_fifo_index64::kUnregistered)) {
+        // The writer is waiting for this reader, wake it so that it finds the next slowest.
+        switch (mFifo.mThrottleFrontSync) {
+        case AUDIO_UTILS_FIFO_SYNC_PRIVATE:
+            (void) mThrottleFront.wake(FUTEX_WAKE_PRIVATE, 1 /*waiters*/);
+            break;
+        case AUDIO_UTILS_FIFO_SYNC_SHARED:
+            (void) mThrottleFront.wake(FUTEX_WAKE, 1 /*waiters*/);
+            break;
+        default:
+            break;
+        }
+    }
 }
 
 ssize_t audio_utils_fifo_reader::read(void *buffer, size_t count, const struct timespec *timeout,
@@ -489,51 +660,71 @@ void audio_utils_fifo_reader::release(size_t count)
             mFifo.shutdown();
             return;
         }
-        if (mThrottleFront != NULL) {
-            uint32_t rear = mFifo.mWriterRearSync == AUDIO_UTILS_FIFO_SYNC_SINGLE_THREADED ?
-                    mFifo.mWriterRear.loadSingleThreaded() : mFifo.mWriterRear.loadAcquire();
-            // returns -EIO if mIsShutdown
-            int32_t filled = mFifo.diff(rear, mLocalFront);
-            mLocalFront = mFifo.sum(mLocalFront, count);
-            if (mFifo.mThrottleFrontSync == AUDIO_UTILS_FIFO_SYNC_SINGLE_THREADED) {
-                mThrottleFront->storeSingleThreaded(mLocalFront);
-            } else {
-                mThrottleFront->storeRelease(mLocalFront);
-            }
-            // TODO add comments
-            int op = FUTEX_WAKE;
-            switch (mFifo.mThrottleFrontSync) {
-            case AUDIO_UTILS_FIFO_SYNC_SINGLE_THREADED:
-            case AUDIO_UTILS_FIFO_SYNC_SLEEP:
-                break;
-            case AUDIO_UTILS_FIFO_SYNC_PRIVATE:
-                op = FUTEX_WAKE_PRIVATE;
-                FALLTHROUGH_INTENDED;
-            case AUDIO_UTILS_FIFO_SYNC_SHARED:
-                if (filled >= 0) {
-                    if (filled > mArmLevel) {
-                        mIsArmed = true;
-                    }
-                    if (mIsArmed && filled - count < mTriggerLevel) {
-                        int err = mThrottleFront->wake(op, 1 /*waiters*/);
-                        // err is number of processes woken up
-                        if (err < 0 || err > 1) {
-                            LOG_ALWAYS_FATAL("%s: unexpected err=%d errno=%d",
-                                    __func__, err, errno);
-                        }
-                        mIsArmed = false;
-                    }
-                }
-                break;
-            default:
-                LOG_ALWAYS_FATAL("mFifo.mThrottleFrontSync=%d", mFifo.mThrottleFrontSync);
-                break;
-            }
-        } else {
-            mLocalFront = mFifo.sum(mLocalFront, count);
+        mLocalFront = mFifo.sum(mLocalFront, count);
+        if (!mThrottleFront.isNull()) {
+            mUnpublished += count;
         }
         mObtained -= count;
         mTotalReleased += count;
+        if (!mDeferredPublish) {
+            publish();
+        }
+    }
+}
+
+void audio_utils_fifo_reader::publish()
+        __attribute__((no_sanitize("integer")))
+{
+    // only a throttling reader publishes its front index
+    if (mUnpublished == 0) {
+        return;
+    }
+    const uint32_t count = mUnpublished;
+    mUnpublished = 0;
+    if (mFifo.mThrottleFrontSync == AUDIO_UTILS_FIFO_SYNC_SINGLE_THREADED) {
+        mThrottleFront.storeSingleThreaded(mLocalFront);
+        return;
+    }
+    // Only wake if the writer may be waiting, as told by the waiter flag of a 64-bit index.
+    const bool waiting = mThrottleFront.storeRelease(mLocalFront);
+    bool wake = false;
+    // TODO add comments
+    int op = FUTEX_WAKE;
+    switch (mFifo.mThrottleFrontSync) {
+    case AUDIO_UTILS_FIFO_SYNC_SLEEP:
+        break;
+    case AUDIO_UTILS_FIFO_SYNC_PRIVATE:
+        op = FUTEX_WAKE_PRIVATE;
+        FALLTHROUGH_INTENDED;
+    case AUDIO_UTILS_FIFO_SYNC_SHARED: {
+        uint64_t rear = mFifo.mWriterRear.loadAcquire();
+        // returns -EIO if mIsShutdown
+        int32_t filled = mFifo.diff(rear, mLocalFront);
+        if (filled >= 0) {
+            // hysteresis uses the fill level before and after the published frames
+            if ((int32_t) (filled + count) > mArmLevel) {
+                mIsArmed = true;
+            }
+            if (mIsArmed && (uint32_t) filled < mTriggerLevel) {
+                wake = true;
+                mIsArmed = false;
+            }
+        }
+        if (waiting && wake) {
+            int err = mThrottleFront.wake(op, 1 /*waiters*/);
+            // err is number of processes woken up
+            if (err < 0 || err > 1) {
+                LOG_ALWAYS_FATAL("%s: unexpected err=%d errno=%d", __func__, err, errno);
+            }
+        } else if (waiting) {
+            // pass the waiter flag on to the next publication
+            mThrottleFront.setWaiting();
+        }
+        break;
+    }
+    default:
+        LOG_ALWAYS_FATAL("mFifo.mThrottleFrontSync=%d", mFifo.mThrottleFrontSync);
+        break;
     }
 }
 
@@ -544,7 +735,7 @@ ssize_t audio_utils_fifo_reader::obtain(audio_utils_iovec iovec[2], size_t count
 {
     int err = 0;
     int retries = kRetries;
-    uint32_t rear;
+    uint64_t rear;
     for (;;) {
         rear = mFifo.mWriterRearSync == AUDIO_UTILS_FIFO_SYNC_SINGLE_THREADED ?
                 mFifo.mWriterRear.loadSingleThreaded() : mFifo.mWriterRear.loadAcquire();
@@ -553,6 +744,11 @@ ssize_t audio_utils_fifo_reader::obtain(audio_utils_iovec iovec[2], size_t count
                 (timeout->tv_sec == 0 && timeout->tv_nsec == 0)) {
             break;
         }
+        if (mUnpublished > 0) {
+            // the writer may be waiting for room which it does not see
+            publish();
+            continue;
+        }
         // TODO add comments
         int op = FUTEX_WAIT;
         switch (mFifo.mWriterRearSync) {
@@ -580,7 +776,7 @@ ssize_t audio_utils_fifo_reader::obtain(audio_utils_iovec iovec[2], size_t count
             if (err < 0) {
                 switch (errno) {
                 case EWOULDBLOCK:
-                    // Benign race condition with partner: mFifo.mWriterRear->mIndex
+                    // Benign race condition with partner: mFifo.mWriterRear
                     // changed value between the earlier atomic_load_explicit() and sys_futex().
                     // Try to load index again, but give up if we are unable to converge.
                     if (retries-- > 0) {
@@ -615,7 +811,7 @@ ssize_t audio_utils_fifo_reader::obtain(audio_utils_iovec iovec[2], size_t count
     if (filled < 0) {
         if (filled == -EOVERFLOW) {
             // catch up with writer, but preserve the still valid frames in buffer
-            mLocalFront = rear - (mFlush ? 0 : mFifo.mFrameCountP2 /*sic*/);
+            mLocalFront = (rear - (mFlush ? 0 : mFifo.mFrameCountP2 /*sic*/)) & mFifo.mIndexMask;
         }
         // on error, return an empty slice
         err = filled;
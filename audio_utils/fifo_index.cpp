@@ -56,120 +56,74 @@ int audio_utils_fifo_index::wake(int op, int waiters)
     return sys_futex(&mIndex, op, waiters, NULL, NULL, 0);
 }
 
-// ----------------------------------------------------------------------------
-
-#if 0   // TODO not currently used, review this code later: bug 150627616
-
-RefIndexDeferredStoreReleaseDeferredWake::RefIndexDeferredStoreReleaseDeferredWake(
-        audio_utils_fifo_index& index)
-    : mIndex(index), mValue(0), mWriteback(false), mWaiters(0), mWakeOp(FUTEX_WAIT_PRIVATE)
-{
-}
-
-RefIndexDeferredStoreReleaseDeferredWake::~RefIndexDeferredStoreReleaseDeferredWake()
-{
-    writeback();
-    wakeNowIfNeeded();
-}
-
-void RefIndexDeferredStoreReleaseDeferredWake::set(uint32_t value) {
-    mValue = value;
-    mWriteback = true;
-}
-
-void RefIndexDeferredStoreReleaseDeferredWake::writeback()
-{
-    if (mWriteback) {
-        // TODO When part of a collection, should use relaxed for all but the last writeback
-        mIndex.storeRelease(mValue);
-        mWriteback = false;
-    }
-}
-
-void RefIndexDeferredStoreReleaseDeferredWake::writethrough(uint32_t value) {
-    set(value);
-    writeback();
-}
-
-void RefIndexDeferredStoreReleaseDeferredWake::wakeDeferred(int op, int waiters)
+uint64_t audio_utils_fifo_index64::loadSingleThreaded()
 {
-    if (waiters <= 0) {
-        return;
-    }
-    // default is FUTEX_WAKE_PRIVATE
-    if (op == FUTEX_WAKE) {
-        mWakeOp = FUTEX_WAKE;
-    }
-    if (waiters < INT_MAX - mWaiters) {
-        mWaiters += waiters;
-    } else {
-        mWaiters = INT_MAX;
-    }
+    return atomic_load_explicit(&mIndex, std::memory_order_relaxed) & kMask;
 }
 
-void RefIndexDeferredStoreReleaseDeferredWake::wakeNowIfNeeded()
+uint64_t audio_utils_fifo_index64::loadAcquire()
 {
-    if (mWaiters > 0) {
-        mIndex.wake(mWakeOp, mWaiters);
-        mWaiters = 0;
-        mWakeOp = FUTEX_WAKE_PRIVATE;
-    }
+    return atomic_load_explicit(&mIndex, std::memory_order_acquire) & kMask;
 }
 
-void RefIndexDeferredStoreReleaseDeferredWake::wakeNow(int op, int waiters)
-{
-    wakeDeferred(op, waiters);
-    wakeNowIfNeeded();
-}
-
-////
-
-RefIndexCachedLoadAcquireDeferredWait::RefIndexCachedLoadAcquireDeferredWait(
-        audio_utils_fifo_index& index)
-    : mIndex(index), mValue(0), mLoaded(false)
+void audio_utils_fifo_index64::storeSingleThreaded(uint64_t value)
 {
+    atomic_store_explicit(&mIndex, value, std::memory_order_relaxed);
 }
 
-RefIndexCachedLoadAcquireDeferredWait::~RefIndexCachedLoadAcquireDeferredWait()
+bool audio_utils_fifo_index64::storeRelease(uint64_t value)
 {
+    // An exchange rather than a store, to find out whether the partner set the waiter flag
+    // before it went to sleep.  A waiter which sets the flag after the exchange sees the new
+    // value, and does not go to sleep.
+    return (atomic_exchange_explicit(&mIndex, value, std::memory_order_acq_rel) & kWaiting) != 0;
 }
 
-uint32_t RefIndexCachedLoadAcquireDeferredWait::get()
+void audio_utils_fifo_index64::setWaiting()
 {
-    prefetch();
-    return mValue;
+    (void) atomic_fetch_or_explicit(&mIndex, kWaiting, std::memory_order_relaxed);
 }
 
-void RefIndexCachedLoadAcquireDeferredWait::prefetch()
+bool audio_utils_fifo_index64::compareExchange(uint64_t *expected, uint64_t desired)
 {
-    if (!mLoaded) {
-        // TODO When part of a collection, should use relaxed for all but the last load
-        mValue = mIndex.loadAcquire();
-        mLoaded = true;
+    // a waiter which gave up may have left its flag behind
+    uint64_t actual = atomic_load_explicit(&mIndex, std::memory_order_relaxed);
+    for (;;) {
+        if ((actual & kMask) != *expected) {
+            *expected = actual & kMask;
+            return false;
+        }
+        if (atomic_compare_exchange_weak_explicit(&mIndex, &actual, desired,
+                std::memory_order_acq_rel, std::memory_order_acquire)) {
+            return true;
+        }
     }
 }
 
-void RefIndexCachedLoadAcquireDeferredWait::invalidate()
+// The futex is the low-order 32 bits of the index, wherever they are in memory.
+static inline void *futexWord(std::atomic_uint_least64_t *index)
 {
-    mLoaded = false;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return (uint32_t *) index + 1;
+#else
+    return index;
+#endif
 }
 
-#if 0
-uint32_t RefIndexCachedLoadAcquireDeferredWait::readthrough()
+int audio_utils_fifo_index64::wait(int op, uint64_t expected, const struct timespec *timeout)
 {
-    invalidate();
-    return get();
+    // The flag must be set before the futex compares the value, so that a concurrent
+    // storeRelease() either sees the flag or changes the value compared by the futex.
+    const uint64_t previous = atomic_fetch_or_explicit(&mIndex, kWaiting,
+            std::memory_order_seq_cst);
+    if ((previous & kMask) != (expected & kMask)) {
+        errno = EWOULDBLOCK;
+        return -1;
+    }
+    return sys_futex(futexWord(&mIndex), op, (uint32_t) expected, timeout, NULL, 0);
 }
-#endif
 
-int RefIndexCachedLoadAcquireDeferredWait::wait(int op, const struct timespec *timeout)
+int audio_utils_fifo_index64::wake(int op, int waiters)
 {
-    if (!mLoaded) {
-        return -EINVAL;
-    }
-    int err = mIndex.wait(op, mValue /*expected*/, timeout);
-    invalidate();
-    return err;
+    return sys_futex(futexWord(&mIndex), op, waiters, NULL, NULL, 0);
 }
-
-#endif  // 0
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "audio_utils_fifo_shared"
+
+#include <errno.h>
+#include <string.h>
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <new>
+
+#include <audio_utils/fifo_shared.h>
+#include <log/log.h>
+
+namespace {
+
+const size_t kRearOffset = audio_utils_fifo_shared::kIndexAlignment;
+const size_t kFrontsOffset = 2 * audio_utils_fifo_shared::kIndexAlignment;
+
+size_t bufferOffset(uint32_t throttleFrontCount)
+{
+    return kFrontsOffset + throttleFrontCount * audio_utils_fifo_shared::kIndexAlignment;
+}
+
+#ifdef __linux__
+
+const uint32_t kMagic = 0x4f464946;    // "FIFO"
+const uint32_t kVersion = 1;
+
+// At offset 0 of the region, written once by the creator.
+struct Header {
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint32_t mFrameCount;
+    uint32_t mFrameSize;
+    uint32_t mThrottleFrontCount;
+};
+
+static_assert(sizeof(Header) <= audio_utils_fifo_shared::kIndexAlignment, "Header too large");
+
+// Return the size of the region in bytes, or 0 if the parameters are invalid.
+size_t regionSize(uint32_t frameCount, uint32_t frameSize, uint32_t throttleFrontCount)
+{
+    if (frameCount == 0 || frameSize == 0 || frameCount > ((uint32_t) INT32_MAX) / frameSize ||
+            throttleFrontCount > audio_utils_fifo_base::kMaxThrottleFronts) {
+        return 0;
+    }
+    const size_t pageSize = getpagesize();
+    const size_t size = bufferOffset(throttleFrontCount) + (size_t) frameCount * frameSize;
+    return (size + pageSize - 1) & ~(pageSize - 1);
+}
+
+#endif  // __linux__
+
+}   // namespace
+
+audio_utils_fifo_shared::audio_utils_fifo_shared(int fd, void *region, size_t size,
+        uint32_t frameCount, uint32_t frameSize, uint32_t throttleFrontCount) :
+    mFd(fd), mRegion(region), mSize(size),
+    mFifo(frameCount, frameSize, (char *) region + bufferOffset(throttleFrontCount),
+            *(audio_utils_fifo_index64 *) ((char *) region + kRearOffset),
+            throttleFrontCount > 0 ?
+                    (audio_utils_fifo_index64 *) ((char *) region + kFrontsOffset) : NULL,
+            throttleFrontCount, kIndexAlignment)
+{
+}
+
+audio_utils_fifo_shared::~audio_utils_fifo_shared()
+{
+#ifdef __linux__
+    (void) munmap(mRegion, mSize);
+    (void) close(mFd);
+#endif
+}
+
+// static
+std::unique_ptr<audio_utils_fifo_shared> audio_utils_fifo_shared::create(uint32_t frameCount,
+        uint32_t frameSize, uint32_t throttleFrontCount, const char *name)
+{
+#ifdef __linux__
+    const size_t size = regionSize(frameCount, frameSize, throttleFrontCount);
+    if (size == 0) {
+        ALOGE("%s: invalid frameCount=%u frameSize=%u throttleFrontCount=%u",
+                __func__, frameCount, frameSize, throttleFrontCount);
+        return nullptr;
+    }
+    // memfd_create() is not in the C library of all the supported API levels
+    const int fd = syscall(__NR_memfd_create, name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        ALOGE("%s: memfd_create failed: %s", __func__, strerror(errno));
+        return nullptr;
+    }
+    // The seals prevent a peer from shrinking the region under the mappings of the others.
+    if (ftruncate(fd, size) != 0 ||
+            fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0) {
+        ALOGE("%s: cannot size memfd: %s", __func__, strerror(errno));
+        (void) close(fd);
+        return nullptr;
+    }
+    void *region = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, (off_t) 0);
+    if (region == MAP_FAILED) {
+        ALOGE("%s: mmap failed: %s", __func__, strerror(errno));
+        (void) close(fd);
+        return nullptr;
+    }
+
+    // index constructors must execute exactly once, so the creator does it
+    (void) new((char *) region + kRearOffset) audio_utils_fifo_index64();
+    for (uint32_t i = 0; i < throttleFrontCount; i++) {
+        (void) new((char *) region + kFrontsOffset + i * kIndexAlignment)
+                audio_utils_fifo_index64(audio_utils_fifo_index64::kUnregistered);
+    }
+    Header *header = (Header *) region;
+    header->mMagic = kMagic;
+    header->mVersion = kVersion;
+    header->mFrameCount = frameCount;
+    header->mFrameSize = frameSize;
+    header->mThrottleFrontCount = throttleFrontCount;
+
+    return std::unique_ptr<audio_utils_fifo_shared>(new audio_utils_fifo_shared(fd, region, size,
+            frameCount, frameSize, throttleFrontCount));
+#else
+    (void) frameCount;
+    (void) frameSize;
+    (void) throttleFrontCount;
+    (void) name;
+    ALOGE("%s: not supported", __func__);
+    return nullptr;
+#endif
+}
+
+// static
+std::unique_ptr<audio_utils_fifo_shared> audio_utils_fifo_shared::map(int fd)
+{
+#ifdef __linux__
+    // A region which can be shrunk could fault on access, so it must be sealed.
+    const int seals = fcntl(fd, F_GET_SEALS);
+    struct stat st;
+    if (seals < 0 || (seals & F_SEAL_SHRINK) == 0 || fstat(fd, &st) != 0 ||
+            st.st_size < (off_t) kIndexAlignment) {
+        ALOGE("%s: fd %d is not a sealed shared FIFO region", __func__, fd);
+        return nullptr;
+    }
+    const int dupFd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (dupFd < 0) {
+        ALOGE("%s: dup failed: %s", __func__, strerror(errno));
+        return nullptr;
+    }
+    const size_t size = st.st_size;
+    void *region = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, dupFd, (off_t) 0);
+    if (region == MAP_FAILED) {
+        ALOGE("%s: mmap failed: %s", __func__, strerror(errno));
+        (void) close(dupFd);
+        return nullptr;
+    }
+
+    // Copy the header, as the peer could still change it.
+    Header header;
+    memcpy(&header, region, sizeof(header));
+    if (header.mMagic != kMagic || header.mVersion != kVersion ||
+            regionSize(header.mFrameCount, header.mFrameSize, header.mThrottleFrontCount) !=
+                    size) {
+        ALOGE("%s: invalid header magic=%#x version=%u frameCount=%u frameSize=%u"
+                " throttleFrontCount=%u size=%zu", __func__, header.mMagic, header.mVersion,
+                header.mFrameCount, header.mFrameSize, header.mThrottleFrontCount, size);
+        (void) munmap(region, size);
+        (void) close(dupFd);
+        return nullptr;
+    }
+    return std::unique_ptr<audio_utils_fifo_shared>(new audio_utils_fifo_shared(dupFd, region,
+            size, header.mFrameCount, header.mFrameSize, header.mThrottleFrontCount));
+#else
+    (void) fd;
+    ALOGE("%s: not supported", __func__);
+    return nullptr;
+#endif
+}
@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "audio_utils_fifo_transform"
+
+#include <errno.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <audio_utils/channels.h>
+#include <audio_utils/fifo_transform.h>
+#include <audio_utils/format.h>
+#include <log/log.h>
+
+namespace {
+
+// Walk the fragments of the destination and source slices in step, and process each
+// virtually contiguous run of frames.  count must be <= the length of both slices.
+void transformSlices(const audio_utils_fifo_transform& transform,
+        void *dstBuffer, const audio_utils_iovec dst[2],
+        const void *srcBuffer, const audio_utils_iovec src[2], size_t count)
+{
+    const uint32_t dstFrameSize = transform.dstFrameSize();
+    const uint32_t srcFrameSize = transform.srcFrameSize();
+    int d = 0;
+    int s = 0;
+    uint32_t dstDone = 0;   // frames done in dst[d]
+    uint32_t srcDone = 0;   // frames done in src[s]
+    while (count > 0) {
+        size_t frames = std::min(dst[d].mLength - dstDone, src[s].mLength - srcDone);
+        if (frames > count) {
+            frames = count;
+        }
+        transform.process(
+                (char *) dstBuffer + (size_t) (dst[d].mOffset + dstDone) * dstFrameSize,
+                (const char *) srcBuffer + (size_t) (src[s].mOffset + srcDone) * srcFrameSize,
+                frames);
+        count -= frames;
+        dstDone += frames;
+        if (dstDone == dst[d].mLength) {
+            d++;
+            dstDone = 0;
+        }
+        srcDone += frames;
+        if (srcDone == src[s].mLength) {
+            s++;
+            srcDone = 0;
+        }
+    }
+}
+
+}   // namespace
+
+audio_utils_fifo_transform::audio_utils_fifo_transform(uint32_t srcFrameSize,
+        uint32_t dstFrameSize) :
+    mSrcFrameSize(srcFrameSize), mDstFrameSize(dstFrameSize)
+{
+    LOG_ALWAYS_FATAL_IF(srcFrameSize == 0 || dstFrameSize == 0,
+            "%s: srcFrameSize=%u dstFrameSize=%u", __func__, srcFrameSize, dstFrameSize);
+}
+
+audio_utils_fifo_transform::~audio_utils_fifo_transform()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+audio_utils_fifo_copy_transform::audio_utils_fifo_copy_transform(uint32_t frameSize) :
+    audio_utils_fifo_transform(frameSize, frameSize)
+{
+}
+
+void audio_utils_fifo_copy_transform::process(void *dst, const void *src,
+        size_t frameCount) const
+{
+    memcpy(dst, src, frameCount * srcFrameSize());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+audio_utils_fifo_format_transform::audio_utils_fifo_format_transform(audio_format_t dstFormat,
+        audio_format_t srcFormat, uint32_t channelCount) :
+    audio_utils_fifo_transform(audio_bytes_per_sample(srcFormat) * channelCount,
+            audio_bytes_per_sample(dstFormat) * channelCount),
+    mDstFormat(dstFormat), mSrcFormat(srcFormat), mChannelCount(channelCount)
+{
+}
+
+void audio_utils_fifo_format_transform::process(void *dst, const void *src,
+        size_t frameCount) const
+{
+    memcpy_by_audio_format(dst, mDstFormat, src, mSrcFormat, frameCount * mChannelCount);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+audio_utils_fifo_channel_transform::audio_utils_fifo_channel_transform(uint32_t dstChannelCount,
+        uint32_t srcChannelCount, uint32_t sampleSize) :
+    audio_utils_fifo_transform(srcChannelCount * sampleSize, dstChannelCount * sampleSize),
+    mDstChannelCount(dstChannelCount), mSrcChannelCount(srcChannelCount),
+    mSampleSize(sampleSize)
+{
+}
+
+void audio_utils_fifo_channel_transform::process(void *dst, const void *src,
+        size_t frameCount) const
+{
+    (void) adjust_channels(src, mSrcChannelCount, dst, mDstChannelCount, mSampleSize,
+            frameCount * srcFrameSize());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+audio_utils_fifo_gain_transform::audio_utils_fifo_gain_transform(uint32_t channelCount,
+        float gain) :
+    audio_utils_fifo_transform(channelCount * sizeof(float), channelCount * sizeof(float)),
+    mChannelCount(channelCount), mGain(gain)
+{
+}
+
+void audio_utils_fifo_gain_transform::process(void *dst, const void *src,
+        size_t frameCount) const
+{
+    float *out = (float *) dst;
+    const float *in = (const float *) src;
+    const float gain = mGain;
+    for (size_t i = frameCount * mChannelCount; i > 0; --i) {
+        *out++ = *in++ * gain;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ssize_t audio_utils_fifo_transfer(audio_utils_fifo_reader& reader,
+        audio_utils_fifo_writer& writer, const audio_utils_fifo_transform& transform,
+        size_t count, const struct timespec *timeout, size_t *lost)
+{
+    audio_utils_fifo& src = reader.fifo();
+    audio_utils_fifo& dst = writer.fifo();
+    if (src.frameSize() != transform.srcFrameSize() ||
+            dst.frameSize() != transform.dstFrameSize()) {
+        ALOGE("%s: frame sizes %u -> %u don't match transform %u -> %u", __func__,
+                src.frameSize(), dst.frameSize(), transform.srcFrameSize(),
+                transform.dstFrameSize());
+        return -EINVAL;
+    }
+    audio_utils_iovec srcIovec[2];
+    ssize_t availToRead = reader.obtain(srcIovec, count, timeout, lost);
+    if (availToRead <= 0) {
+        return availToRead;
+    }
+    audio_utils_iovec dstIovec[2];
+    ssize_t availToWrite = writer.obtain(dstIovec, availToRead, timeout);
+    if (availToWrite > 0) {
+        transformSlices(transform, dst.buffer(), dstIovec, src.buffer(), srcIovec,
+                availToWrite);
+        writer.release(availToWrite);
+        reader.release(availToWrite);
+    }
+    return availToWrite;
+}
+
+ssize_t audio_utils_fifo_read(audio_utils_fifo_reader& reader, void *buffer,
+        const audio_utils_fifo_transform& transform, size_t count,
+        const struct timespec *timeout, size_t *lost)
+{
+    audio_utils_fifo& src = reader.fifo();
+    if (src.frameSize() != transform.srcFrameSize()) {
+        ALOGE("%s: frame size %u doesn't match transform %u", __func__,
+                src.frameSize(), transform.srcFrameSize());
+        return -EINVAL;
+    }
+    audio_utils_iovec srcIovec[2];
+    ssize_t availToRead = reader.obtain(srcIovec, count, timeout, lost);
+    if (availToRead > 0) {
+        const audio_utils_iovec dstIovec[2] = {{0, (uint32_t) availToRead}, {0, 0}};
+        transformSlices(transform, buffer, dstIovec, src.buffer(), srcIovec, availToRead);
+        reader.release(availToRead);
+    }
+    return availToRead;
+}
+
+ssize_t audio_utils_fifo_write(audio_utils_fifo_writer& writer, const void *buffer,
+        const audio_utils_fifo_transform& transform, size_t count,
+        const struct timespec *timeout)
+{
+    audio_utils_fifo& dst = writer.fifo();
+    if (dst.frameSize() != transform.dstFrameSize()) {
+        ALOGE("%s: frame size %u doesn't match transform %u", __func__,
+                dst.frameSize(), transform.dstFrameSize());
+        return -EINVAL;
+    }
+    audio_utils_iovec dstIovec[2];
+    ssize_t availToWrite = writer.obtain(dstIovec, count, timeout);
+    if (availToWrite > 0) {
+        const audio_utils_iovec srcIovec[2] = {{0, (uint32_t) availToWrite}, {0, 0}};
+        transformSlices(transform, dst.buffer(), dstIovec, buffer, srcIovec, availToWrite);
+        writer.release(availToWrite);
+    }
+    return availToWrite;
+}
@@ -17,6 +17,8 @@
 #pragma once
 #include "channels.h"
 #include <math.h>
+#include <memory>
+#include <vector>
 
 namespace android::audio_utils::channels {
 
@@ -604,7 +606,12 @@ public:
     virtual bool process(const float *src, float *dst, size_t frameCount, bool accumulate,
             audio_channel_mask_t inputChannelMask) = 0;
 
-    /** Built in ChannelMix factory. */
+    /**
+     * Built in ChannelMix factory.
+     *
+     * Stereo, 5.1, 7.1, 7.1.4 and 9.1.6 outputs use the compile-time optimized ChannelMix;
+     * any other valid positional or index output mask uses RuntimeChannelMix.
+     */
     static std::shared_ptr<IChannelMix> create(audio_channel_mask_t outputChannelMask);
 
     /** Returns true if the Built-in factory supports the outputChannelMask */
@@ -819,4 +826,80 @@ private:
     }
 };
 
+/**
+ * A channel mix matrix for an input and output channel mask pair.
+ *
+ * Only the nonzero coefficients are stored, grouped by output channel
+ * (compressed sparse row form where each row is an output channel):
+ * the coefficients for output channel j are at indices [offsets[j], offsets[j + 1])
+ * of inputChannel and gain.
+ */
+struct SparseChannelMatrix {
+    audio_channel_mask_t inputChannelMask = AUDIO_CHANNEL_NONE;
+    audio_channel_mask_t outputChannelMask = AUDIO_CHANNEL_NONE;
+    size_t inputChannelCount = 0;
+    size_t outputChannelCount = 0;
+    std::vector<uint32_t> offsets;       // outputChannelCount + 1 entries
+    std::vector<uint32_t> inputChannel;  // input channel offset within the frame
+    std::vector<float> gain;
+};
+
+/**
+ * Returns the channel mix matrix for the mask pair.
+ *
+ * The matrix is computed on first use and cached for the life of the process,
+ * so subsequent calls for the same pair only perform a locked lookup.
+ * Stereo, 5.1, 7.1, 7.1.4 and 9.1.6 outputs use the same coefficients as ChannelMix;
+ * other positional outputs map each missing input channel to the geometrically
+ * nearest output channels.  Index masks (on either side) are mapped by channel index.
+ *
+ * \return the matrix, or nullptr if the pair is not supported.
+ */
+std::shared_ptr<const SparseChannelMatrix> getSparseChannelMatrix(
+        audio_channel_mask_t inputChannelMask, audio_channel_mask_t outputChannelMask);
+
+/**
+ * RuntimeChannelMix
+ *
+ * Converts audio streams between arbitrary positional or index channel masks
+ * chosen at runtime, using cached sparse matrices from getSparseChannelMatrix()
+ * instead of per mask pair template instantiation.
+ */
+class RuntimeChannelMix : public IChannelMix {
+public:
+    /**
+     * Creates a RuntimeChannelMix object.
+     *
+     * \param outputChannelMask channel position or index mask for output audio data.
+     *                          Use isOutputChannelMaskSupported() to check validity.
+     */
+    explicit RuntimeChannelMix(audio_channel_mask_t outputChannelMask)
+        : mOutputChannelMask(outputChannelMask) {}
+
+    bool setInputChannelMask(audio_channel_mask_t inputChannelMask) override;
+
+    audio_channel_mask_t getInputChannelMask() const override {
+        return mMatrix ? mMatrix->inputChannelMask : AUDIO_CHANNEL_NONE;
+    }
+
+    audio_channel_mask_t getOutputChannelMask() const {
+        return mOutputChannelMask;
+    }
+
+    bool process(const float *src, float *dst, size_t frameCount,
+            bool accumulate) const override;
+
+    bool process(const float *src, float *dst, size_t frameCount,
+            bool accumulate, audio_channel_mask_t inputChannelMask) override {
+        return setInputChannelMask(inputChannelMask) && process(src, dst, frameCount, accumulate);
+    }
+
+    /** Returns true if outputChannelMask is a valid position or index mask. */
+    static bool isOutputChannelMaskSupported(audio_channel_mask_t outputChannelMask);
+
+private:
+    const audio_channel_mask_t mOutputChannelMask;
+    std::shared_ptr<const SparseChannelMatrix> mMatrix;
+};
+
 } // android::audio_utils::channels
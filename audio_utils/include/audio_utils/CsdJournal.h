@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <audio_utils/libaudioutils_export.h>
+#include <utils/Errors.h>
+
+namespace android::audio_utils {
+
+struct CsdRecord;
+
+/**
+ * \brief Append-only, memory mapped journal of the CSD records of a MelAggregator,
+ * so that the CSD can be restored after a restart or a crash.
+ *
+ * The file starts with a header followed by fixed size entries:
+ *
+ *   checkpoint      the CSD value and the number of records which follow it
+ *   record * N      the CSD records at the time of the checkpoint
+ *   record ...      the CSD records added since, and the removed ones with a negative value
+ *
+ * The header holds the index of the last complete checkpoint, so that restoring
+ * only reads that checkpoint and the records appended after it.
+ *
+ * The checksum of an entry is written after its content. An entry which was not
+ * completely written when the process crashed, and everything after it, is ignored.
+ * When the file is full, a new file starting with a checkpoint is synced to storage,
+ * then replaces it with an atomic rename.  The later checkpoints are not synced,
+ * so if the header refers to an incomplete checkpoint after a power loss,
+ * the journal is restored from the first checkpoint.
+ *
+ * The journal is not available where memory mapped files are not, e.g. with MSVC.
+ *
+ * The methods are not thread-safe, MelAggregator calls them with its lock held.
+ */
+class LIBAUDIOUTILS_EXPORT CsdJournal {
+public:
+    /** Default number of entries in the journal file. */
+    static constexpr size_t kDefaultCapacity = 16384;
+
+    /** Number of records appended after which needsCheckpoint() returns true. */
+    static constexpr size_t kCheckpointInterval = 1024;
+
+    /**
+     * \brief Opens the journal at path, creating it if it does not exist.
+     *
+     * A file which is not a valid journal is replaced by an empty journal.
+     *
+     * \param path         path of the journal file.
+     * \param capacity     number of entries of a new file, at least 2.
+     * \return the journal, or nullptr if the file cannot be created or mapped,
+     *   or if memory mapped files are not available.
+     */
+    static std::unique_ptr<CsdJournal> open(const std::string& path,
+                                            size_t capacity = kDefaultCapacity);
+
+    ~CsdJournal();
+
+    /**
+     * \brief Returns the CSD records and CSD value stored in the journal, from the last
+     * complete checkpoint followed by the records appended after it.
+     */
+    void restore(float* csd, std::vector<CsdRecord>* records) const;
+
+    /**
+     * \brief Appends CSD records, as returned by MelAggregator::aggregateAndAddNewMelRecord().
+     *
+     * \return NO_ERROR, or NO_MEMORY if the journal is full, in which case a
+     *   checkpoint must be written.
+     */
+    status_t append(const std::vector<CsdRecord>& records);
+
+    /** Returns true if a checkpoint should be written to bound the restore time. */
+    bool needsCheckpoint() const;
+
+    /**
+     * \brief Writes a checkpoint with the current CSD value and records, compacting
+     * the journal into a new file if the records do not fit.
+     *
+     * \return NO_ERROR, or an error if the new file cannot be written, in which
+     *   case the journal is unchanged.
+     */
+    status_t checkpoint(float csd, const std::vector<CsdRecord>& records);
+
+    /** Returns the number of entries written, including the checkpoint. */
+    size_t size() const { return mSize; }
+
+    /** Returns the number of entries of the journal file. */
+    size_t capacity() const { return mCapacity; }
+
+private:
+    enum EntryType : uint32_t {
+        kRecord = 1,
+        kCheckpoint = 2,
+    };
+
+    // Entries are 32 bytes, the checksum is written last.
+    struct Entry {
+        int64_t timestamp;     // checkpoint: number of records which follow
+        int64_t duration;
+        float value;           // checkpoint: CSD value
+        float averageMel;
+        uint32_t type;
+        uint32_t checksum;     // of the fields above and of the entry index, never 0
+    };
+    static_assert(sizeof(Entry) == 32);
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t capacity;
+        std::atomic<uint64_t> checkpoint;  // index of the last complete checkpoint
+        uint8_t reserved[sizeof(Entry) - 24];
+    };
+    static_assert(sizeof(Header) == sizeof(Entry));
+
+    CsdJournal(std::string path, int fd, void* map, size_t capacity);
+
+    static std::unique_ptr<CsdJournal> create(const std::string& path, size_t capacity,
+                                              float csd, const std::vector<CsdRecord>& records);
+
+    static uint32_t checksum(const Entry& entry, size_t index);
+
+    Header* header() const { return static_cast<Header*>(mMap); }
+    Entry* entries() const { return static_cast<Entry*>(mMap) + 1; }
+    bool isValid(size_t index) const;
+    bool isCheckpoint(size_t index) const;
+    void write(size_t index, const Entry& entry);
+    void writeRecord(size_t index, const CsdRecord& record);
+    void writeCheckpoint(size_t index, float csd, const std::vector<CsdRecord>& records);
+    size_t findEnd() const;
+
+    const std::string mPath;
+    int mFd;
+    void* mMap;
+    size_t mCapacity;
+    size_t mSize = 0;                 // index of the next entry
+    size_t mRecordsSinceCheckpoint = 0;
+};
+
+}  // namespace android::audio_utils
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_UTILS_FLOAT_FFT_H
+#define ANDROID_AUDIO_UTILS_FLOAT_FFT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include <audio_utils/libaudioutils_export.h>
+
+namespace android::audio_utils {
+
+/**
+ * \brief Real-input single precision FFT.
+ *
+ * Computes the forward transform of a real sequence of length size()
+ * into bins() = size() / 2 + 1 complex bins stored in split (separate real
+ * and imaginary array) form, and the corresponding inverse transform.
+ *
+ * Internally a size() / 2 point complex radix-2 FFT is used with
+ * the standard even/odd packing of the real input.  Twiddle factors are
+ * precomputed per stage so that every butterfly loop is unit stride
+ * and amenable to compiler vectorization.
+ *
+ * The transforms are unnormalized: inverse(forward(x)) == size() * x.
+ * Callers that apply a fixed filter typically fold 1 / size() into the
+ * filter spectrum.
+ *
+ * forward() and inverse() do not allocate, but use internal scratch
+ * memory, so an instance must not be used concurrently by multiple threads.
+ */
+class LIBAUDIOUTILS_EXPORT FloatFFT {
+public:
+    /**
+     * \param size the transform length, a power of 2 no less than 4.
+     *             Use isValidSize() to check before construction.
+     */
+    explicit FloatFFT(size_t size);
+
+    static constexpr bool isValidSize(size_t size) {
+        return size >= 4 && (size & (size - 1)) == 0;
+    }
+
+    /** Returns the real transform length. */
+    size_t size() const { return mSize; }
+
+    /** Returns the number of complex bins, size() / 2 + 1. */
+    size_t bins() const { return mHalf + 1; }
+
+    /**
+     * \brief Forward transform X[k] = sum_n x[n] exp(-2 pi i k n / size()).
+     *
+     * \param in   size() real samples.
+     * \param re   bins() real parts of the output.
+     * \param im   bins() imaginary parts of the output (im[0] and im[size() / 2] are 0).
+     */
+    void forward(const float* in, float* re, float* im);
+
+    /**
+     * \brief Unnormalized inverse transform.
+     *
+     * The imaginary parts of the DC and Nyquist bins are ignored.
+     *
+     * \param re   bins() real parts of the input.
+     * \param im   bins() imaginary parts of the input.
+     * \param out  size() real samples, scaled by size().
+     */
+    void inverse(const float* re, const float* im, float* out);
+
+private:
+    template <bool INVERSE>
+    void complexTransform(float* re, float* im) const;
+
+    const size_t mSize;   // real transform length N
+    const size_t mHalf;   // complex transform length M = N / 2
+    std::vector<uint32_t> mBitReverse;  // M permutation indices
+    std::vector<float> mStageCos;       // M - 1 per-stage twiddles, stage h at offset h - 1
+    std::vector<float> mStageSin;
+    std::vector<float> mRealCos;        // M + 1 twiddles exp(-2 pi i k / N) for real packing
+    std::vector<float> mRealSin;
+    std::vector<float> mScratchRe;      // M complex scratch
+    std::vector<float> mScratchIm;
+};
+
+} // namespace android::audio_utils
+
+#endif // !ANDROID_AUDIO_UTILS_FLOAT_FFT_H
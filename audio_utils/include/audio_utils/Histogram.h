@@ -18,12 +18,27 @@
 #define AUDIO_UTILS_HISTOGRAM_H
 
 #include <assert.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <limits>
 #include <memory>
 #include <sstream>
+#include <string>
 #include <vector>
 
 namespace android::audio_utils {
 
+/**
+ * Returns the power of 2 bucket of value: 0 for value <= 0, else bucket i > 0
+ * for 2^(i-1) <= value < 2^i, that is floor(log2(value)) + 1.
+ * Used by LogHistogram and by log2_histogram in mutex.h.
+ */
+inline constexpr size_t log2_bucket(int64_t value) {
+    return value <= 0 ? 0 : std::bit_width(static_cast<uint64_t>(value));
+}
+
 class Histogram {
 public:
     /**
@@ -150,5 +165,255 @@ private:
     std::vector<uint64_t> mLastItemNumbers; // number of the last item added this bin
 };
 
+/**
+ * LogHistogram is a log-linear (HDR style) histogram of integer values,
+ * typically times in ns, which resolves values from 1 to 2^MaxBits - 1
+ * with a bounded relative error and a fixed memory.
+ *
+ * Values below 2^SubBucketBits have a bin each.  Above that, each power of 2
+ * range [2^e, 2^(e+1)) is split into 2^SubBucketBits bins of equal width,
+ * so a bin is at most 2^-SubBucketBits of its lowest value wide.
+ * With the defaults, 4 and 40, that is 6.25% over 1 ns to 18 minutes in 592 bins.
+ * Values <= 0 are counted in the first bin, and values >= 2^MaxBits in the last bin;
+ * getMin() and getMax() are exact.
+ *
+ * add() and merge() update the bins with relaxed atomics and no lock,
+ * so they may be called from multiple threads, including SCHED_FIFO threads,
+ * concurrently with the readers.  A reader copies the bins one at a time,
+ * so it may see a slightly inconsistent snapshot, like log2_histogram in mutex.h.
+ * clear() and deserialize() must not be called concurrently with add().
+ *
+ * Threads adding at a high rate to the same histogram contend for its cache lines;
+ * prefer one histogram per thread and merge() them when read.
+ */
+template <size_t SubBucketBits = 4, size_t MaxBits = 40>
+class LogHistogram {
+    static_assert(SubBucketBits > 0 && SubBucketBits < MaxBits && MaxBits < 64);
+    static_assert(std::atomic<uint64_t>::is_always_lock_free);
+    static_assert(std::atomic<int64_t>::is_always_lock_free);
+
+public:
+    static constexpr size_t kNumBins = (MaxBits - SubBucketBits + 1) << SubBucketBits;
+
+    /**
+     * @return index of the bin counting value.
+     */
+    static constexpr size_t getBinIndex(int64_t value) {
+        if (value <= 0) return 0;
+        const uint64_t v = value;
+        if (v < kSubBuckets) return v;
+        if (v >> MaxBits) return kNumBins - 1;
+        const size_t exponent = log2_bucket(value) - 1;  // >= SubBucketBits
+        const size_t group = exponent - SubBucketBits + 1;
+        return (group << SubBucketBits) + (v >> (exponent - SubBucketBits)) - kSubBuckets;
+    }
+
+    /**
+     * @return lowest value counted in the bin, for binIndex < kNumBins.
+     */
+    static constexpr int64_t getBinStart(size_t binIndex) {
+        const size_t group = binIndex >> SubBucketBits;
+        if (group == 0) return binIndex;
+        const uint64_t subBucket = binIndex & (kSubBuckets - 1);
+        return (kSubBuckets + subBucket) << (group - 1);
+    }
+
+    /**
+     * @return width of the bin, for binIndex < kNumBins.
+     */
+    static constexpr int64_t getBinWidth(size_t binIndex) {
+        const size_t group = binIndex >> SubBucketBits;
+        return group == 0 ? 1 : int64_t{1} << (group - 1);
+    }
+
+    /**
+     * Add an item to the histogram.  Wait-free, except for
+     * the compare and exchange loops when the item is a new min or max.
+     */
+    void add(int64_t value) {
+        mBins[getBinIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        updateMinMax(value, value);
+    }
+
+    /**
+     * Add the items of another histogram to this one.
+     * other may be updated concurrently, but should not be this histogram.
+     */
+    void merge(const LogHistogram& other) {
+        bool empty = true;
+        for (size_t i = 0; i < kNumBins; ++i) {
+            const uint64_t count = other.mBins[i].load(std::memory_order_relaxed);
+            if (count == 0) continue;
+            mBins[i].fetch_add(count, std::memory_order_relaxed);
+            empty = false;
+        }
+        if (!empty) {
+            updateMinMax(other.mMin.load(std::memory_order_relaxed),
+                    other.mMax.load(std::memory_order_relaxed));
+        }
+    }
+
+    /**
+     * Reset all counters to zero.
+     */
+    void clear() {
+        for (auto& bin : mBins) bin.store(0, std::memory_order_relaxed);
+        mMin.store(std::numeric_limits<int64_t>::max(), std::memory_order_relaxed);
+        mMax.store(std::numeric_limits<int64_t>::min(), std::memory_order_relaxed);
+    }
+
+    /**
+     * @return number of items in the bin, for binIndex < kNumBins.
+     */
+    uint64_t getCount(size_t binIndex) const {
+        return mBins[binIndex].load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return total number of items added
+     */
+    uint64_t getCount() const {
+        uint64_t count = 0;
+        for (const auto& bin : mBins) count += bin.load(std::memory_order_relaxed);
+        return count;
+    }
+
+    /**
+     * @return the smallest item added, or 0 if none.
+     */
+    int64_t getMin() const {
+        const int64_t min = mMin.load(std::memory_order_relaxed);
+        return min == std::numeric_limits<int64_t>::max() ? 0 : min;
+    }
+
+    /**
+     * @return the largest item added, or 0 if none.
+     */
+    int64_t getMax() const {
+        const int64_t max = mMax.load(std::memory_order_relaxed);
+        return max == std::numeric_limits<int64_t>::min() ? 0 : max;
+    }
+
+    /**
+     * Returns an estimate of the percentile, between 0 and 100, of the items,
+     * interpolated linearly within its bin and clamped to [getMin(), getMax()].
+     * Returns 0 if there are no items.
+     */
+    double getPercentile(double percentile) const {
+        std::array<uint64_t, kNumBins> bins;
+        uint64_t count = 0;
+        for (size_t i = 0; i < kNumBins; ++i) {
+            bins[i] = mBins[i].load(std::memory_order_relaxed);
+            count += bins[i];
+        }
+        if (count == 0) return 0.;
+        const double min = getMin();
+        const double max = getMax();
+        const double rank = std::clamp(percentile, 0., 100.) * 0.01 * count;
+        double below = 0.;
+        for (size_t i = 0; i < kNumBins; ++i) {
+            if (bins[i] == 0) continue;
+            if (below + bins[i] >= rank) {
+                const double fraction = (rank - below) / bins[i];
+                const double value = getBinStart(i) + fraction * getBinWidth(i);
+                return std::clamp(value, min, max);
+            }
+            below += bins[i];
+        }
+        return max;
+    }
+
+    /**
+     * Returns a compact string of the histogram for a dump, which can be
+     * read back by deserialize():
+     *
+     *   SubBucketBits MaxBits min max [delta:count]...
+     *
+     * where each nonzero bin is given by the difference of its index
+     * from that of the previous nonzero bin (or from 0) and its count.
+     */
+    std::string serialize() const {
+        std::stringstream ss;
+        ss << SubBucketBits << " " << MaxBits << " " << getMin() << " " << getMax();
+        size_t previous = 0;
+        for (size_t i = 0; i < kNumBins; ++i) {
+            const uint64_t count = mBins[i].load(std::memory_order_relaxed);
+            if (count == 0) continue;
+            ss << " " << (i - previous) << ":" << count;
+            previous = i;
+        }
+        return ss.str();
+    }
+
+    /**
+     * Replaces the contents with those of a string from serialize().
+     *
+     * @return true on success, false if the string is malformed or from a
+     *         histogram with different template parameters, in which case
+     *         the histogram is cleared.
+     */
+    bool deserialize(const std::string& s) {
+        clear();
+        std::istringstream is(s);
+        size_t subBucketBits, maxBits;
+        int64_t min, max;
+        if (!(is >> subBucketBits >> maxBits >> min >> max)
+                || subBucketBits != SubBucketBits || maxBits != MaxBits) {
+            return false;
+        }
+        size_t index = 0;
+        size_t delta;
+        char separator;
+        uint64_t count;
+        bool empty = true;
+        while (is >> delta >> separator >> count) {
+            index += delta;
+            if (separator != ':' || index >= kNumBins) {
+                clear();
+                return false;
+            }
+            mBins[index].store(count, std::memory_order_relaxed);
+            empty = false;
+        }
+        if (!is.eof()) {
+            clear();
+            return false;
+        }
+        if (!empty) updateMinMax(min, max);
+        return true;
+    }
+
+    /**
+     * @return a summary of the percentiles, for a dump.
+     */
+    std::string toString() const {
+        std::stringstream ss;
+        ss << "n=" << getCount()
+                << " min=" << getMin()
+                << " p50=" << getPercentile(50.)
+                << " p90=" << getPercentile(90.)
+                << " p99=" << getPercentile(99.)
+                << " p99.9=" << getPercentile(99.9)
+                << " max=" << getMax();
+        return ss.str();
+    }
+
+private:
+    static constexpr uint64_t kSubBuckets = uint64_t{1} << SubBucketBits;
+
+    void updateMinMax(int64_t min, int64_t max) {
+        int64_t current = mMin.load(std::memory_order_relaxed);
+        while (min < current && !mMin.compare_exchange_weak(current, min,
+                std::memory_order_relaxed)) {}
+        current = mMax.load(std::memory_order_relaxed);
+        while (max > current && !mMax.compare_exchange_weak(current, max,
+                std::memory_order_relaxed)) {}
+    }
+
+    std::array<std::atomic<uint64_t>, kNumBins> mBins{};
+    std::atomic<int64_t> mMin{std::numeric_limits<int64_t>::max()};
+    std::atomic<int64_t> mMax{std::numeric_limits<int64_t>::min()};
+};
+
 } // namespace
 #endif //AUDIO_UTILS_HISTOGRAM_H
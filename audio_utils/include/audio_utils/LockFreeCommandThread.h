@@ -0,0 +1,380 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <errno.h>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include <audio_utils/futex.h>
+
+namespace android::audio_utils {
+
+/**
+ * SmallFunction is a move-only void() callable, like std::function
+ * but storing callables of up to InlineSize bytes in place, so that
+ * constructing one from a lambda with a small capture does not allocate.
+ * Larger callables are stored on the heap.
+ */
+template <size_t InlineSize>
+class SmallFunction {
+    static_assert(InlineSize >= sizeof(void*), "InlineSize must hold a pointer");
+
+public:
+    /**
+     * Returns true if a callable of type F is stored in place.
+     */
+    template <typename F>
+    static constexpr bool fitsInline() {
+        using T = std::decay_t<F>;
+        return sizeof(T) <= InlineSize && alignof(T) <= alignof(std::max_align_t)
+                && std::is_nothrow_move_constructible_v<T>;
+    }
+
+    SmallFunction() = default;
+
+    template <typename F,
+            typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, SmallFunction>>>
+    SmallFunction(F&& func) {  // NOLINT(google-explicit-constructor)
+        using T = std::decay_t<F>;
+        if constexpr (fitsInline<F>()) {
+            new (mStorage) T(std::forward<F>(func));
+            mOps = &kInlineOps<T>;
+        } else {
+            *reinterpret_cast<T**>(mStorage) = new T(std::forward<F>(func));
+            mOps = &kHeapOps<T>;
+        }
+    }
+
+    SmallFunction(SmallFunction&& other) noexcept {
+        moveFrom(other);
+    }
+
+    SmallFunction& operator=(SmallFunction&& other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    ~SmallFunction() {
+        reset();
+    }
+
+    explicit operator bool() const { return mOps != nullptr; }
+
+    void operator()() { mOps->invoke(mStorage); }
+
+    /**
+     * Destroys the callable, if any.
+     */
+    void reset() {
+        if (mOps != nullptr) {
+            mOps->destroy(mStorage);
+            mOps = nullptr;
+        }
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*move)(void* dst, void* src);  // move constructs dst and destroys src
+        void (*destroy)(void* storage);
+    };
+
+    template <typename T>
+    static constexpr Ops kInlineOps = {
+        [](void* storage) { (*static_cast<T*>(storage))(); },
+        [](void* dst, void* src) {
+            new (dst) T(std::move(*static_cast<T*>(src)));
+            static_cast<T*>(src)->~T();
+        },
+        [](void* storage) { static_cast<T*>(storage)->~T(); },
+    };
+
+    template <typename T>
+    static constexpr Ops kHeapOps = {
+        [](void* storage) { (**static_cast<T**>(storage))(); },
+        [](void* dst, void* src) { *static_cast<T**>(dst) = *static_cast<T**>(src); },
+        [](void* storage) { delete *static_cast<T**>(storage); },
+    };
+
+    void moveFrom(SmallFunction& other) {
+        mOps = other.mOps;
+        if (mOps != nullptr) {
+            mOps->move(mStorage, other.mStorage);
+            other.mOps = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) std::byte mStorage[InlineSize];
+    const Ops* mOps = nullptr;
+};
+
+/**
+ * MpscQueue is a bounded multiple-producer single-consumer queue.
+ *
+ * push() is lock-free and does not allocate, so it may be called from
+ * any thread, including one which must not block on a mutex.
+ * pop() must only be called from a single consumer thread at a time.
+ *
+ * Each slot has a sequence number, which tells the producers that the slot
+ * is free and the consumer that the slot is filled (Vyukov's bounded queue).
+ * A producer that is preempted after claiming a slot but before filling it
+ * holds back the consumer from the slots after it until it resumes.
+ *
+ * T must be default constructible and move assignable.
+ */
+template <typename T, size_t Capacity>
+class MpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+            "Capacity must be a power of 2");
+
+public:
+    MpscQueue() {
+        for (size_t i = 0; i < Capacity; ++i) {
+            mSlots[i].mSequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Appends value to the queue.
+     *
+     * @return true if value was moved to the queue,
+     *         false if the queue was full, and value is untouched.
+     */
+    bool push(T&& value) {
+        size_t pos = mTail.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &mSlots[pos & (Capacity - 1)];
+            const size_t sequence = slot->mSequence.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+            if (diff == 0) {
+                if (mTail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // the consumer has not yet emptied the slot
+            } else {
+                pos = mTail.load(std::memory_order_relaxed);  // another producer took it
+            }
+        }
+        slot->mValue = std::move(value);
+        slot->mSequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Removes the value at the head of the queue.  Consumer thread only.
+     *
+     * @return true if value was set, false if the queue was empty.
+     */
+    bool pop(T& value) {
+        const size_t pos = mHead.load(std::memory_order_relaxed);
+        Slot& slot = mSlots[pos & (Capacity - 1)];
+        if (slot.mSequence.load(std::memory_order_acquire) != pos + 1) return false;
+        value = std::move(slot.mValue);
+        slot.mSequence.store(pos + Capacity, std::memory_order_release);
+        mHead.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * Returns true if there is a value to pop().  Consumer thread only.
+     */
+    bool ready() const {
+        const size_t pos = mHead.load(std::memory_order_relaxed);
+        return mSlots[pos & (Capacity - 1)].mSequence.load(std::memory_order_acquire)
+                == pos + 1;
+    }
+
+    /**
+     * Returns the approximate number of values in the queue.
+     */
+    size_t size() const {
+        const size_t head = mHead.load(std::memory_order_relaxed);
+        const size_t tail = mTail.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+private:
+    // Producers and consumer write separate cache lines.
+    static constexpr size_t kAlignment = 128;
+
+    struct Slot {
+        std::atomic<size_t> mSequence;
+        T mValue{};
+    };
+
+    alignas(kAlignment) std::atomic<size_t> mTail{0};
+    alignas(kAlignment) std::atomic<size_t> mHead{0};
+    alignas(kAlignment) std::array<Slot, Capacity> mSlots;
+};
+
+/**
+ * LockFreeCommandThread is used for serial execution of commands
+ * on a single worker thread, like CommandThread, but add() neither
+ * takes a mutex nor, for small captures, allocates, so it may be called
+ * from a thread which must not block.
+ *
+ * Commands are queued on one of Lanes bounded queues of Capacity commands.
+ * Lane 0 has the highest priority: the worker thread runs the commands of
+ * the highest priority non-empty lane, up to kMaxBatch of them before it looks
+ * again for a higher priority command.  Commands of a lane run in order of add().
+ *
+ * The worker thread only sleeps when all lanes are empty, and add() only
+ * makes a wake syscall if the worker thread is sleeping, so a burst of commands
+ * costs at most one wake.
+ *
+ * Unlike CommandThread, commands have no name, and there is no dump().
+ *
+ * This class is thread-safe.
+ */
+template <size_t Lanes = 1, size_t Capacity = 64, size_t InlineSize = 48>
+class LockFreeCommandThread {
+    static_assert(Lanes > 0, "Lanes must be positive");
+
+public:
+    using Function = SmallFunction<InlineSize>;
+
+    /** Maximum number of commands of a lane run before looking at higher lanes. */
+    static constexpr size_t kMaxBatch = 16;
+
+    LockFreeCommandThread() {
+        // threadLoop() should be started after the class is initialized.
+        mThread = std::thread([this](){this->threadLoop();});
+    }
+
+    ~LockFreeCommandThread() {
+        quit();
+        mThread.join();
+        // discard commands added concurrently with quit()
+        Function func;
+        for (auto& lane : mLanes) {
+            while (lane.pop(func)) func.reset();
+        }
+    }
+
+    /**
+     * Add a command to the command queue of a lane.
+     *
+     * If the func is a closure containing references, suggest using shared_ptr
+     * instead to maintain proper lifetime.
+     *
+     * @param func command to execute.  No allocation occurs if
+     *             Function::fitsInline<F>(), see SmallFunction.
+     * @param lane priority of the command, 0 is the highest, < Lanes.
+     * @return true if the command was added, false if the lane is full
+     *         or the thread has quit, in which case func is destroyed.
+     */
+    template <typename F>
+    bool add(F&& func, size_t lane = 0) {
+        if (lane >= Lanes || mQuit.load(std::memory_order_relaxed)) return false;
+        Function function(std::forward<F>(func));
+        if (!mLanes[lane].push(std::move(function))) return false;
+        // Pairs with the fence in threadLoop(): either we see the worker waiting,
+        // or the worker sees the command.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mWaiting.load(std::memory_order_relaxed)
+                && mWaiting.exchange(false, std::memory_order_relaxed)) {
+            wake();
+        }
+        return true;
+    }
+
+    /**
+     * Quits the command thread.  Commands which have not started are discarded
+     * by the worker thread.
+     */
+    void quit() {
+        if (mQuit.exchange(true)) return;
+        wake();
+    }
+
+    /**
+     * Returns the approximate number of commands on the queues.
+     */
+    size_t size() const {
+        size_t size = 0;
+        for (const auto& lane : mLanes) size += lane.size();
+        return size;
+    }
+
+private:
+    std::thread mThread;
+    std::atomic<bool> mQuit{false};
+    std::atomic<bool> mWaiting{false};
+    std::atomic<int32_t> mWakeSequence{0};  // futex word, or std::atomic wait without futex
+    std::array<MpscQueue<Function, Capacity>, Lanes> mLanes;
+
+    void wake() {
+        mWakeSequence.fetch_add(1, std::memory_order_release);
+        if (sys_futex(&mWakeSequence, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0) < 0
+                && errno == ENOSYS) {
+            mWakeSequence.notify_one();  // no futex
+        }
+    }
+
+    bool ready() const {
+        for (const auto& lane : mLanes) {
+            if (lane.ready()) return true;
+        }
+        return false;
+    }
+
+    void threadLoop() {
+        Function func;
+        while (!mQuit.load(std::memory_order_acquire)) {
+            bool ran = false;
+            for (auto& lane : mLanes) {
+                for (size_t i = 0; i < kMaxBatch
+                        && !mQuit.load(std::memory_order_relaxed) && lane.pop(func); ++i) {
+                    func();
+                    func.reset();
+                    ran = true;
+                }
+                if (ran) break;  // look again from the highest lane
+            }
+            if (ran) continue;
+
+            // All lanes are empty: announce that we are waiting, then check again.
+            const int32_t sequence = mWakeSequence.load(std::memory_order_acquire);
+            mWaiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!ready() && !mQuit.load(std::memory_order_relaxed)) {
+                if (sys_futex(&mWakeSequence, FUTEX_WAIT_PRIVATE, sequence, nullptr, nullptr, 0)
+                        < 0 && errno == ENOSYS) {
+                    mWakeSequence.wait(sequence, std::memory_order_acquire);  // no futex
+                }
+            }
+            mWaiting.store(false, std::memory_order_relaxed);
+        }
+        for (auto& lane : mLanes) {
+            while (lane.pop(func)) func.reset();
+        }
+    }
+};
+
+}  // namespace android::audio_utils
@@ -0,0 +1,488 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include <audio_utils/clock.h>
+#include <audio_utils/seqlock.h>
+#include <utils/Errors.h>
+
+namespace android {
+
+/**
+ * LogRing is a bounded ring of trivially copyable records, keeping the
+ * most recent Capacity records, with a single writer and any number of readers.
+ *
+ * push() and replaceLast() are wait-free and do not allocate.
+ * snapshot() copies the records without a lock, concurrently with the writer;
+ * a record overwritten while being copied is skipped.
+ *
+ * Each slot is a seqlock tagged with the record number.
+ */
+template <typename T, size_t Capacity>
+class LogRing {
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+    static_assert(Capacity > 0, "Capacity must be positive");
+
+public:
+    /**
+     * Appends a record, overwriting the oldest if the ring is full.  Writer thread only.
+     */
+    void push(const T& record) {
+        const uint64_t count = mCount.load(std::memory_order_relaxed);
+        write(count, record);
+        mCount.store(count + 1, std::memory_order_release);
+    }
+
+    /**
+     * Replaces the most recent record, which must exist.  Writer thread only.
+     */
+    void replaceLast(const T& record) {
+        write(mCount.load(std::memory_order_relaxed) - 1, record);
+    }
+
+    /**
+     * Appends the records to records, oldest first.
+     */
+    void snapshot(std::vector<T>& records) const {
+        const uint64_t count = mCount.load(std::memory_order_acquire);
+        for (uint64_t index = count - std::min<uint64_t>(count, Capacity);
+                index < count; ++index) {
+            T record;
+            uint64_t tag;
+            if (!mSlots[index % Capacity].try_load(&record, &tag) || tag != index) {
+                continue;  // being written or overwritten
+            }
+            records.push_back(record);
+        }
+    }
+
+    /**
+     * Returns the total number of records pushed, including those overwritten.
+     */
+    uint64_t count() const {
+        return mCount.load(std::memory_order_relaxed);
+    }
+
+private:
+    void write(uint64_t index, const T& record) {
+        mSlots[index % Capacity].store(record, index);
+    }
+
+    std::atomic<uint64_t> mCount{0};
+    std::array<audio_utils::seqlock<T>, Capacity> mSlots;
+};
+
+/**
+ * LockFreeSimpleLog is a variant of SimpleLog which may be logged to from
+ * a sched_fifo thread.
+ *
+ * Each logging thread obtains a Writer with createWriter(), typically when
+ * the thread starts, and logs through it.  Writer::log() stores a binary record
+ * of the time, the format string pointer and the arguments in the Writer's
+ * LogRing, without a lock, allocation or system call.  The formatting is deferred
+ * to dumpToString(), which merges the records of all Writers by time.
+ *
+ * Because formatting is deferred:
+ * - The format must be a string literal, or otherwise outlive the log.
+ * - The arguments are copied by value and must be arithmetic, enum, or
+ *   (for %p) non-char pointer types; strings are not supported.
+ * - Format errors are not detected at compile time.
+ *
+ * Writers keep the most recent Capacity records each, and the dump output
+ * is that of SimpleLog.
+ */
+template <size_t Writers = 4, size_t Capacity = 64>
+class LockFreeSimpleLog {
+public:
+    static constexpr size_t kMaxArgs = 6;
+
+private:
+    using FormatFn = int (*)(char *buffer, size_t size, const char *format, const uint64_t *args);
+
+    struct Record {
+        int64_t timeNs;
+        const char *format;
+        FormatFn formatFn;       // formats the args with their types
+        uint64_t args[kMaxArgs];
+    };
+
+public:
+    class Writer {
+    public:
+        /**
+         * \brief Adds a record into the log.
+         *
+         * Time is automatically associated with the record by audio_utils_get_real_time_ns().
+         *
+         * \param format            the format string, similar to printf().
+         * \param args              up to kMaxArgs arguments.
+         */
+        template <typename... Args>
+        void log(const char *format, Args... args) {
+            log(audio_utils_get_real_time_ns(), format, args...);
+        }
+
+        /**
+         * \brief Adds a record into the log with time.
+         *
+         * \param nowNs             the time to use for logging.
+         * \param format            the format string, similar to printf().
+         * \param args              up to kMaxArgs arguments.
+         */
+        template <typename... Args>
+        void log(int64_t nowNs, const char *format, Args... args) {
+            static_assert(sizeof...(Args) <= kMaxArgs, "too many arguments");
+            static_assert((isLoggable<Args>() && ...),
+                    "arguments must be arithmetic, enum or non-char pointer types");
+            Record record{nowNs, format, &formatRecord<Stored<Args>...>, {}};
+            size_t i = 0;
+            ((storeArg(record.args[i++], static_cast<Stored<Args>>(args))), ...);
+            mRing.push(record);
+        }
+
+    private:
+        friend class LockFreeSimpleLog;
+        std::atomic<bool> mClaimed{false};
+        LogRing<Record, Capacity> mRing;
+    };
+
+    LockFreeSimpleLog() = default;
+    LockFreeSimpleLog(const LockFreeSimpleLog&) = delete;
+    LockFreeSimpleLog& operator=(const LockFreeSimpleLog&) = delete;
+
+    /**
+     * \brief Returns an unused Writer, or nullptr if all Writers are in use.
+     *
+     * The Writer must only be used by one thread at a time.  Its records remain
+     * in the log after releaseWriter().
+     */
+    Writer *createWriter() {
+        for (auto& writer : mWriters) {
+            bool claimed = false;
+            if (writer.mClaimed.compare_exchange_strong(claimed, true)) return &writer;
+        }
+        return nullptr;
+    }
+
+    /**
+     * \brief Returns a Writer for reuse by createWriter().
+     */
+    void releaseWriter(Writer *writer) {
+        writer->mClaimed.store(false);
+    }
+
+    /**
+     * \brief Dumps the log to a string, merging the Writers by time.
+     *
+     * \param prefix            the prefix to use for each line
+     *                          (generally a null terminated string of spaces).
+     * \param lines             maximum number of lines to output (0 disables).
+     * \param limitNs           limit dump to data more recent than limitNs (0 disables).
+     * \return a string object for the log.
+     */
+    std::string dumpToString(const char *prefix = "", size_t lines = 0, int64_t limitNs = 0) const
+    {
+        std::vector<Record> records;
+        for (const auto& writer : mWriters) {
+            writer.mRing.snapshot(records);
+        }
+        std::stable_sort(records.begin(), records.end(),
+                [](const Record& a, const Record& b) { return a.timeNs < b.timeNs; });
+
+        // Note: this restricts the lines before checking the time constraint.
+        auto it = records.begin();
+        if (lines != 0 && records.size() > lines) {
+            it += (records.size() - lines);
+        }
+        std::stringstream ss;
+        for (; it != records.end(); ++it) {
+            if (it->timeNs < limitNs) continue;  // too old
+            char buffer[kMaxStringLength];
+            int length = it->formatFn(buffer, sizeof(buffer), it->format, it->args);
+            if (length < 0) { // encoding error
+                strcpy(buffer, "invalid format");
+                length = strlen(buffer);
+            } else if (length >= (signed)sizeof(buffer)) {
+                length = sizeof(buffer) - 1;
+            }
+            // strip out trailing newlines
+            while (length > 0 && buffer[length - 1] == '\n') {
+                buffer[--length] = '\0';
+            }
+            ss << prefix << audio_utils_time_string_from_ns(it->timeNs).time
+                    << " " << buffer << "\n";
+        }
+        return ss.str();
+    }
+
+    /**
+     * \brief Dumps the log to a raw file descriptor.
+     *
+     * \param fd                file descriptor to use.
+     * \param prefix            the prefix to use for each line
+     *                          (generally a null terminated string of spaces).
+     * \param lines             maximum number of lines to output (0 disables).
+     * \param limitNs           limit dump to data more recent than limitNs (0 disables).
+     * \return
+     *   NO_ERROR on success or a negative number (-errno) on failure of write().
+     */
+    status_t dump(int fd, const char *prefix = "", size_t lines = 0, int64_t limitNs = 0) const
+    {
+        const std::string s = dumpToString(prefix, lines, limitNs);
+        if (s.size() > 0 && write(fd, s.c_str(), s.size()) < 0) {
+            return -errno;
+        }
+        return NO_ERROR;
+    }
+
+private:
+    static const size_t kMaxStringLength = 1024;  // maximum formatted string length
+
+    // The type an argument is stored and formatted as, following the
+    // default argument promotions of printf for enums and floats.
+    template <typename A, typename = void>
+    struct StoredType { using type = A; };
+    template <typename A>
+    struct StoredType<A, std::enable_if_t<std::is_enum_v<A>>> {
+        using type = std::underlying_type_t<A>;
+    };
+    template <typename A>
+    struct StoredType<A, std::enable_if_t<std::is_floating_point_v<A>>> { using type = double; };
+    template <typename A>
+    using Stored = typename StoredType<A>::type;
+
+    template <typename A>
+    static constexpr bool isLoggable() {
+        if constexpr (std::is_pointer_v<A>) {
+            using P = std::remove_cv_t<std::remove_pointer_t<A>>;
+            return !std::is_same_v<P, char> && !std::is_same_v<P, signed char>
+                    && !std::is_same_v<P, unsigned char>;
+        }
+        return std::is_arithmetic_v<A> || std::is_enum_v<A>;
+    }
+
+    template <typename A>
+    static void storeArg(uint64_t& word, A arg) {
+        static_assert(sizeof(A) <= sizeof(uint64_t));
+        memcpy(&word, &arg, sizeof(A));
+    }
+
+    template <typename A>
+    static A loadArg(const uint64_t& word) {
+        A arg;
+        memcpy(&arg, &word, sizeof(A));
+        return arg;
+    }
+
+    template <typename... Args, size_t... Is>
+    static int formatRecordImpl(char *buffer, size_t size, const char *format, const uint64_t *args,
+            std::index_sequence<Is...>) {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"  // the format is that passed to log()
+#pragma GCC diagnostic ignored "-Wformat-security"
+        return snprintf(buffer, size, format, loadArg<Args>(args[Is])...);
+#pragma GCC diagnostic pop
+    }
+
+    template <typename... Args>
+    static int formatRecord(char *buffer, size_t size, const char *format, const uint64_t *args) {
+        return formatRecordImpl<Args...>(buffer, size, format, args,
+                std::index_sequence_for<Args...>{});
+    }
+
+    std::array<Writer, Writers> mWriters;
+};
+
+/**
+ * LockFreeErrorLog is a variant of ErrorLog which may be logged to from
+ * a sched_fifo thread.
+ *
+ * Each logging thread obtains a Writer with createWriter() and logs through it.
+ * Writer::log() aggregates consecutive identical error codes of the Writer
+ * within aggregateNs into an entry, like ErrorLog, and publishes the entry
+ * to the Writer's LogRing without a lock or allocation.  dumpToString() merges
+ * the entries of all Writers by their first time, in the format of ErrorLog.
+ *
+ * The type T is the error code type, which must be trivially copyable,
+ * equality comparable, and printable to a std::ostream.
+ */
+template <typename T, size_t Writers = 4, size_t Capacity = 64>
+class LockFreeErrorLog {
+public:
+    struct Entry {
+        T mCode;            // error code
+        uint32_t mCount;    // number of consecutive errors of the same code.
+        int64_t mFirstTime; // first time of the error code.
+        int64_t mLastTime;  // last time of the error code.
+    };
+
+    class Writer {
+    public:
+        /**
+         * \brief Adds new error code to the error log.
+         *
+         * Consecutive errors with the same code will be aggregated
+         * if they occur within aggregateNs.
+         *
+         * \param code              error code of type T.
+         * \param nowNs             current time in nanoseconds.
+         */
+        void log(const T &code, int64_t nowNs) {
+            mErrors.store(mErrors.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+            if (mEntry.mCount > 0 && code == mEntry.mCode
+                    && nowNs - mEntry.mLastTime < mAggregateNs) {
+                mEntry.mCount++;
+                mEntry.mLastTime = nowNs;
+                mRing.replaceLast(mEntry);
+                return;
+            }
+            mEntry = {code, 1 /* mCount */, nowNs, nowNs};
+            mRing.push(mEntry);
+        }
+
+    private:
+        friend class LockFreeErrorLog;
+        std::atomic<bool> mClaimed{false};
+        int64_t mAggregateNs = 0;
+        Entry mEntry{};                     // the last entry, writer thread only.
+        std::atomic<int64_t> mErrors{0};    // number of errors logged by the Writer
+        LogRing<Entry, Capacity> mRing;
+    };
+
+    /**
+     * \brief Creates a LockFreeErrorLog object
+     *
+     * \param aggregateNs       the maximum time in nanoseconds between identical error codes
+     *                          to be aggregated into a single entry.
+     */
+    explicit LockFreeErrorLog(int64_t aggregateNs = 1000000000 /* one second */)
+    {
+        for (auto& writer : mWriters) {
+            writer.mAggregateNs = aggregateNs;
+        }
+    }
+
+    LockFreeErrorLog(const LockFreeErrorLog&) = delete;
+    LockFreeErrorLog& operator=(const LockFreeErrorLog&) = delete;
+
+    /**
+     * \brief Returns an unused Writer, or nullptr if all Writers are in use.
+     *
+     * The Writer must only be used by one thread at a time.  Its entries remain
+     * in the log after releaseWriter().
+     */
+    Writer *createWriter() {
+        for (auto& writer : mWriters) {
+            bool claimed = false;
+            if (writer.mClaimed.compare_exchange_strong(claimed, true)) return &writer;
+        }
+        return nullptr;
+    }
+
+    /**
+     * \brief Returns a Writer for reuse by createWriter().
+     */
+    void releaseWriter(Writer *writer) {
+        writer->mClaimed.store(false);
+    }
+
+    /**
+     * \brief Dumps the log to a std::string, merging the Writers by time.
+     * \param prefix            the prefix to use for each line
+     *                          (generally a null terminated string of spaces).
+     * \param lines             maximum number of lines to output (0 disables).
+     * \param limitNs           limit dump to data more recent than limitNs (0 disables).
+     * \return std::string of the dump.
+     */
+    std::string dumpToString(const char *prefix = "", size_t lines = 0, int64_t limitNs = 0) const
+    {
+        std::vector<Entry> entries;
+        int64_t errors = 0;
+        for (const auto& writer : mWriters) {
+            errors += writer.mErrors.load(std::memory_order_relaxed);
+            writer.mRing.snapshot(entries);
+        }
+        std::stable_sort(entries.begin(), entries.end(),
+                [](const Entry& a, const Entry& b) { return a.mFirstTime < b.mFirstTime; });
+
+        std::stringstream ss;
+        const size_t headerLines = 2;
+        if (lines == 0) {
+            lines = SIZE_MAX;
+        }
+        ss << prefix << "Errors: " << errors << "\n";
+        if (errors == 0 || lines <= headerLines) {
+            return ss.str();
+        }
+
+        // compute where to start dump log
+        lines = std::min(lines - headerLines, entries.size());
+        size_t start = entries.size();
+        while (entries.size() - start < lines && entries[start - 1].mLastTime >= limitNs) {
+            --start;
+        }
+        if (start < entries.size()) {
+            ss << prefix << " Code  Freq          First time           Last time\n";
+            for (auto it = entries.begin() + start; it != entries.end(); ++it) {
+                ss << prefix << std::setw(5) << it->mCode
+                        << " " << std::setw(5) << it->mCount
+                        << "  " << audio_utils_time_string_from_ns(it->mFirstTime).time
+                        << "  " << audio_utils_time_string_from_ns(it->mLastTime).time << "\n";
+            }
+        }
+        return ss.str();
+    }
+
+    /**
+     * \brief Dumps the log to a raw file descriptor.
+     * \param fd                file descriptor to use.
+     * \param prefix            the prefix to use for each line
+     *                          (generally a null terminated string of spaces).
+     * \param lines             maximum number of lines to output (0 disables).
+     * \param limitNs           limit dump to data more recent than limitNs (0 disables).
+     * \return
+     *   NO_ERROR on success or a negative number (-errno) on failure of write().
+     */
+    status_t dump(int fd, const char *prefix = "", size_t lines = 0, int64_t limitNs = 0) const
+    {
+        const std::string s = dumpToString(prefix, lines, limitNs);
+        if (s.size() > 0 && write(fd, s.c_str(), s.size()) < 0) {
+            return -errno;
+        }
+        return NO_ERROR;
+    }
+
+private:
+    std::array<Writer, Writers> mWriters;
+};
+
+} // namespace android
@@ -17,9 +17,12 @@
 #pragma once
 
 #include <android-base/thread_annotations.h>
+#include <audio_utils/CsdJournal.h>
 #include <audio_utils/MelProcessor.h>
-#include <map>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <vector>
 
 #include <audio_utils/libaudioutils_export.h>
 
@@ -71,12 +74,24 @@ struct CsdRecord {
  * simultaneously.
  *
  * The public methods are internally protected by a mutex to be thread-safe.
+ *
+ * The MEL values not yet converted to CSD are cached in a ring of per second
+ * buckets and the CSD records in a ring sorted by timestamp, so that adding a
+ * record costs O(record length) and does not allocate in the steady state.
  */
 class LIBAUDIOUTILS_EXPORT MelAggregator : public RefBase {
 public:
 
+    /**
+     * Maximum time span in seconds of the cached MEL values. Cached values which
+     * would span a longer time are converted to CSD early, even if their CSD is
+     * lower than the minimum CSD record value.
+     */
+    static constexpr int64_t kMelCacheSeconds = 4096;
+
     explicit MelAggregator(int64_t csdWindowSeconds)
-        : mCsdWindowSeconds(csdWindowSeconds) {}
+        : mCsdWindowSeconds(csdWindowSeconds),
+          mMelBuckets(kMelCacheSeconds) {}
 
     /**
      * \returns the size of the stored CSD values.
@@ -120,33 +135,117 @@ public:
      * uses the passed records for the new callbacks.
      **/
     void reset(float newCsd, const std::vector<CsdRecord>& newRecords);
+
+    /**
+     * \brief Restores the CSD records from the journal at path, then journals the
+     * CSD record changes so that they are restored after a restart.
+     *
+     * The cached MEL values which did not contribute to a CSD record yet are not
+     * journaled.
+     *
+     * \param path       path of the journal file, created if it does not exist.
+     * \return NO_ERROR on success, NO_INIT if the journal cannot be opened, e.g. where
+     *   memory mapped files are not available, in which case the aggregator runs
+     *   without a journal.
+     */
+    status_t openJournal(const std::string& path);
 private:
+    /** Aggregated MEL of one second, empty if the energy is 0. */
+    struct MelBucket {
+        float energy = 0.f;
+        /** Set on the first second of a cached MelRecord. */
+        bool recordStart = false;
+        /** Port of the MelRecord, only valid on its first second. */
+        audio_port_handle_t portId = AUDIO_PORT_HANDLE_NONE;
+    };
+
+    /** Conversion of cached MEL values to CSD records, possibly across several caches. */
+    struct CsdConversion {
+        /** CSD of all the MEL values to convert. */
+        float total = 0.f;
+        /** CSD of the records already added. */
+        float converted = 0.f;
+        /** Record being accumulated. */
+        int64_t timestamp = 0;
+        int64_t duration = 0;
+        float energy = 0.f;
+        float csd = 0.f;
+    };
+
+    /** Assignable CsdRecord. */
+    struct CsdEntry {
+        int64_t timestamp;
+        int64_t duration;
+        float value;
+        float averageMel;
+    };
+
     /** Locked aggregateAndAddNewMelRecord method. */
     std::vector<CsdRecord> aggregateAndAddNewMelRecord_l(const MelRecord& record) REQUIRES(mLock);
 
+    MelBucket& melBucket_l(int64_t timestamp) REQUIRES(mLock);
+
+    const MelBucket& melBucket_l(int64_t timestamp) const REQUIRES(mLock);
+
+    bool isMelCached_l(int64_t timestamp) const REQUIRES(mLock);
+
+    void addMelValues_l(audio_port_handle_t portId, const float* mels, size_t size,
+                        int64_t timestamp) REQUIRES(mLock);
+
+    void clearMelCache_l() REQUIRES(mLock);
+
+    void convertCachedMels_l(CsdConversion& conversion,
+                             std::vector<CsdRecord>& newRecords) REQUIRES(mLock);
+
+    void finishConversion_l(CsdConversion& conversion,
+                            std::vector<CsdRecord>& newRecords) REQUIRES(mLock);
+
+    void reset_l(float newCsd, const std::vector<CsdRecord>& newRecords) REQUIRES(mLock);
+
+    void journal_l(const std::vector<CsdRecord>& newRecords) REQUIRES(mLock);
+
+    void checkpointJournal_l() REQUIRES(mLock);
+
     void removeOldCsdRecords_l(std::vector<CsdRecord>& removeRecords) REQUIRES(mLock);
 
-    std::vector<CsdRecord> updateCsdRecords_l() REQUIRES(mLock);
+    void updateCsdRecords_l(std::vector<CsdRecord>& newRecords) REQUIRES(mLock);
 
     int64_t csdTimeIntervalStored_l() REQUIRES(mLock);
 
-    std::map<int64_t, CsdRecord>::iterator addNewestCsdRecord_l(int64_t timestamp,
-                                                                int64_t duration,
-                                                                 float csdRecord,
-                                                                 float averageMel) REQUIRES(mLock);
+    CsdEntry& csdEntry_l(size_t index) REQUIRES(mLock);
+
+    const CsdEntry& csdEntry_l(size_t index) const REQUIRES(mLock);
+
+    CsdRecord addCsdRecord_l(int64_t timestamp,
+                             int64_t duration,
+                             float csdRecord,
+                             float averageMel) REQUIRES(mLock);
 
     const int64_t mCsdWindowSeconds;
 
     mutable std::mutex mLock;
 
-    std::map<int64_t, MelRecord> mMelRecords GUARDED_BY(mLock);
-    std::map<int64_t, CsdRecord> mCsdRecords GUARDED_BY(mLock);
+    /** MEL cache, the bucket of a second is at its timestamp modulo kMelCacheSeconds. */
+    std::vector<MelBucket> mMelBuckets GUARDED_BY(mLock);
+    /** Time span [start, end) of the cached MEL values, empty if start == end. */
+    int64_t mMelCacheStart GUARDED_BY(mLock) = 0;
+    int64_t mMelCacheEnd GUARDED_BY(mLock) = 0;
+    /** Number of time-continuous MEL records in the cache. */
+    size_t mCachedMelRecords GUARDED_BY(mLock) = 0;
+
+    /** Ring of CSD records sorted by timestamp, grows when full. */
+    std::vector<CsdEntry> mCsdRecords GUARDED_BY(mLock);
+    size_t mCsdRecordsFront GUARDED_BY(mLock) = 0;
+    size_t mCsdRecordsSize GUARDED_BY(mLock) = 0;
 
-    /** Current CSD value in mMelRecords. */
+    /** Current CSD value of the cached MEL values. */
     float mCurrentMelRecordsCsd GUARDED_BY(mLock) = 0.f;
 
     /** CSD value containing sum of all CSD values stored. */
     float mCurrentCsd GUARDED_BY(mLock) = 0.f;
+
+    /** Journal of the CSD records, if opened. */
+    std::unique_ptr<CsdJournal> mJournal GUARDED_BY(mLock);
 };
 
 }  // naemspace android::audio_utils
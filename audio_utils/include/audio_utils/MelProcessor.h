@@ -18,8 +18,10 @@
 
 #include <array>
 #include <condition_variable>
+#include <functional>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 #include <android-base/thread_annotations.h>
 #include <audio_utils/BiquadFilter.h>
@@ -94,6 +96,8 @@ public:
                  float rs2Value,
                  size_t maxMelsCallback = kMaxMelValues);
 
+    ~MelProcessor() override;
+
     /**
      * Sets the output RS2 upper bound for momentary exposure warnings. Default value
      * is 100dBA as specified in IEC62368-1 3rd edition. Must not be higher than
@@ -114,7 +118,10 @@ public:
     /** Returns the device id. */
     audio_port_handle_t getDeviceId();
 
-    /** Update the format to use for the input frames to process. */
+    /**
+     * Update the format to use for the input frames to process. The new format
+     * is applied by the next process() call.
+     */
     void updateAudioFormat(uint32_t sampleRate, uint32_t channelCount, audio_format_t newFormat);
 
     /**
@@ -127,6 +134,9 @@ public:
      *
      * \return the number of bytes that were processed. Note: the method will
      *   output 0 if the processor is paused or the sample rate is not supported.
+     *
+     * The method neither locks nor allocates memory, and can be called from a real-time
+     * thread. It must not be called concurrently from multiple threads.
      */
     int32_t process(const void* buffer, size_t bytes);
 
@@ -149,6 +159,79 @@ public:
 
     void onLastStrongRef(const void* id) override;
 
+    /**
+     * Reads up to frames interleaved float frames into buffer.
+     * Returns the number of frames read, 0 at the end of the stream.
+     */
+    using FrameReader = std::function<size_t(float* buffer, size_t frames)>;
+
+    /**
+     * \brief Computes the MEL values of a whole recording in one call, without callbacks.
+     *
+     * The seconds are split among threads. Each thread warms up its A-weighting filters
+     * on the second preceding its first one, so that the MEL values are the same as the
+     * ones computed by process() up to floating point precision.
+     *
+     * \param buffer           pointer to the audio data buffer.
+     * \param bytes            buffer size in bytes, a trailing partial second is ignored.
+     * \param sampleRate       sample rate of the audio data.
+     * \param channelCount     channel count of the audio data.
+     * \param format           format of the audio data, as for process().
+     * \param attenuationDB    attenuation to use on computed MEL values.
+     * \param threadCount      number of threads to use, 0 for one per hardware thread.
+     *
+     * \return the MEL value of each second, including the ones below RS1, or an
+     *   empty vector if the sample rate, channel count or format is not supported.
+     */
+    static std::vector<float> computeMels(const void* buffer,
+                                          size_t bytes,
+                                          uint32_t sampleRate,
+                                          uint32_t channelCount,
+                                          audio_format_t format,
+                                          float attenuationDB = 0.f,
+                                          size_t threadCount = 0);
+
+    /**
+     * \brief Computes the MEL values of a float stream, e.g. read with tinysndfile
+     * sf_readf_float(), in blocks of kBatchSecondsPerThread seconds per thread,
+     * buffering at most kBatchBufferBytes (or two seconds if these are larger).
+     *
+     * \param reader           reads the interleaved float frames.
+     * \param sampleRate       sample rate of the audio data.
+     * \param channelCount     channel count of the audio data.
+     * \param attenuationDB    attenuation to use on computed MEL values.
+     * \param threadCount      number of threads to use, 0 for one per hardware thread.
+     *
+     * \return as computeMels() above.
+     */
+    static std::vector<float> computeMels(const FrameReader& reader,
+                                          uint32_t sampleRate,
+                                          uint32_t channelCount,
+                                          float attenuationDB = 0.f,
+                                          size_t threadCount = 0);
+
+    /** Seconds of audio buffered per thread by the FrameReader computeMels(). */
+    static constexpr size_t kBatchSecondsPerThread = 60;
+
+    /** Maximum bytes of audio buffered by the FrameReader computeMels(), for all threads. */
+    static constexpr size_t kBatchBufferBytes = 64 * 1024 * 1024;
+
+    /** Default number of threads executing the callbacks of all MelProcessor instances. */
+    static constexpr size_t kDefaultWorkerThreadCount = 2;
+
+    /**
+     * Sets the number of threads in the process-wide pool executing the callbacks
+     * of all MelProcessor instances. The callbacks of one MelProcessor are always
+     * executed one at a time and in order. Threads are started with the first
+     * MelProcessor, surplus threads exit once they are idle.
+     *
+     * \param threadCount     number of threads, must be at least 1.
+     */
+    static void setWorkerThreadCount(size_t threadCount);
+
+    /** Returns the number of threads currently running in the callback pool. */
+    static size_t getWorkerThreadCount();
+
 private:
     /** Struct to store the possible callback data. */
     struct MelCallbackData {
@@ -162,19 +245,27 @@ private:
         audio_port_handle_t mPort = AUDIO_PORT_HANDLE_NONE;
     };
 
-    // class used to asynchronously execute all MelProcessor callbacks
+    class MelWorkerPool;
+
+    // class used to queue the callbacks of one MelProcessor, which are executed
+    // asynchronously by the shared MelWorkerPool
     class LIBAUDIOUTILS_EXPORT MelWorker {
     public:
         static constexpr int kRingBufferSize = 32;
 
-        MelWorker(std::string threadName, const wp<MelCallback>& callback)
+        MelWorker(std::string name, const wp<MelCallback>& callback, size_t maxMels)
             : mCallback(callback),
-              mThreadName(std::move(threadName)),
-              mCallbackRingBuffer(kRingBufferSize) {};
-
+              mName(std::move(name)),
+              mCallbackRingBuffer(kRingBufferSize) {
+            for (auto& data : mCallbackRingBuffer) {
+                data.mMels.resize(maxMels);
+            }
+        }
+
+        // makes sure the pool threads are running
         void run();
 
-        // blocks until the MelWorker thread is stopped
+        // blocks until no pool thread executes callbacks of this worker
         void stop();
 
         // callback methods for new MEL values
@@ -183,67 +274,97 @@ private:
                           size_t melsSize,
                           audio_port_handle_t port);
 
+        // schedules the execution of the queued callbacks on the pool, lock-free
+        void notify();
+
+        // executes the queued callbacks, called from a pool thread
+        void dispatch();
+
         static void incRingBufferIndex(std::atomic_size_t& idx);
         bool ringBufferIsFull() const;
+        bool ringBufferIsEmpty() const { return mRbReadPtr == mRbWritePtr; }
 
         const wp<MelCallback> mCallback;
-        const std::string mThreadName;
-        std::vector<MelCallbackData> mCallbackRingBuffer GUARDED_BY(mCondVarMutex);
+        const std::string mName;
+        std::vector<MelCallbackData> mCallbackRingBuffer;
 
         std::atomic_size_t mRbReadPtr = 0;
         std::atomic_size_t mRbWritePtr = 0;
 
-        std::thread mThread;
-        std::condition_variable mCondVar;
-        std::mutex mCondVarMutex;
-        bool mStopRequested GUARDED_BY(mCondVarMutex) = false;
+        std::atomic_bool mStopRequested = false;
+        // set while the worker is pending, queued or executed by a pool thread
+        std::atomic_bool mScheduled = false;
+        // next worker in the lock-free stack of workers pending for the pool
+        MelWorker* mNextPending = nullptr;
+        // the following are guarded by the MelWorkerPool lock
+        bool mQueued = false;                  // waiting in the pool queue
+        bool mRunning = false;                 // executed by a pool thread
+    };
+
+    using DefaultBiquadFilter = BiquadFilter<float, true, details::DefaultBiquadConstOptions>;
+
+    // A-weighting and energy accumulation state for one audio format. Each state is
+    // allocated by the constructor or updateAudioFormat() and then only used by process().
+    struct AWeightState {
+        AWeightState(uint32_t sampleRate, uint32_t channelCount, audio_format_t format);
+
+        bool isSampleRateSupported() const { return mCascadedBiquads[0] != nullptr; }
+
+        // audio data sample rate
+        const uint32_t mSampleRate;
+        // audio data channel count
+        const uint32_t mChannelCount;
+        // audio data format
+        const audio_format_t mFormat;
+        // number of audio frames per MEL value
+        const size_t mFramesPerMelValue;
+        // contains the A-weighted input samples to be processed
+        std::vector<float> mAWeightSamples;
+        // contains the input samples converted to float
+        std::vector<float> mFloatSamples;
+        // local energy accumulation
+        std::vector<float> mCurrentChannelEnergy;
+        // number of samples in the energy
+        size_t mCurrentSamples = 0;
+        // Biquads used for the A-weighting, null if the sample rate is not supported
+        std::array<std::unique_ptr<DefaultBiquadFilter>, kCascadeBiquadNumber> mCascadedBiquads;
+        // next state in the lock-free stack of states replaced by process()
+        AWeightState* mNextRetired = nullptr;
     };
 
     std::string pointerString() const;
-    void createBiquads_l() REQUIRES(mLock);
-    bool isSampleRateSupported_l() const REQUIRES(mLock);
-    void applyAWeight_l(const void* buffer, size_t frames) REQUIRES(mLock);
-    float getCombinedChannelEnergy_l() REQUIRES(mLock);
-    void addMelValue_l(float mel) REQUIRES(mLock);
+    void adoptState(AWeightState* state);
+    void retireState(AWeightState* state);
+    void deleteRetiredStates();
+    void applyAWeight(const void* buffer, size_t samples);
+    float getCombinedChannelEnergy();
+    void addMelValue(float mel);
 
     const wp<MelCallback> mCallback;           // callback to notify about new MEL values
                                                // and momentary exposure warning
                                                // does not own the callback, must outlive
 
-    MelWorker mMelWorker;                      // spawns thread for asynchronous callbacks,
+    MelWorker mMelWorker;                      // queues callbacks for the shared pool,
                                                // worker is thread-safe
 
-    mutable std::mutex mLock;                  // monitor mutex
-    // audio data sample rate
-    uint32_t mSampleRate GUARDED_BY(mLock);
-    // number of audio frames per MEL value
-    size_t mFramesPerMelValue GUARDED_BY(mLock);
-    // audio data channel count
-    uint32_t mChannelCount GUARDED_BY(mLock);
-    // audio data format
-    audio_format_t mFormat GUARDED_BY(mLock);
-    // contains the A-weighted input samples to be processed
-    std::vector<float> mAWeightSamples GUARDED_BY(mLock);
-    // contains the input samples converted to float
-    std::vector<float> mFloatSamples GUARDED_BY(mLock);
-    // local energy accumulation
-    std::vector<float> mCurrentChannelEnergy GUARDED_BY(mLock);
-    // accumulated MEL values
-    std::vector<float> mMelValues GUARDED_BY(mLock);
-    // current index to store the MEL values
-    uint32_t mCurrentIndex GUARDED_BY(mLock);
-    using DefaultBiquadFilter = BiquadFilter<float, true, details::DefaultBiquadConstOptions>;
-    // Biquads used for the A-weighting
-    std::array<std::unique_ptr<DefaultBiquadFilter>, kCascadeBiquadNumber>
-        mCascadedBiquads GUARDED_BY(mLock);
+    // serializes the configuration changes, never taken by process()
+    std::mutex mLock;
+    // state for the current audio format, only used by process()
+    std::unique_ptr<AWeightState> mState;
+    // state for a new audio format, adopted by the next process() call
+    std::atomic<AWeightState*> mPendingState = nullptr;
+    // states replaced by process(), deleted outside of process()
+    std::atomic<AWeightState*> mRetiredStates = nullptr;
+    // accumulated MEL values, only used by process()
+    std::vector<float> mMelValues;
+    // current index to store the MEL values, only used by process()
+    uint32_t mCurrentIndex;
 
     std::atomic<float> mAttenuationDB = 0.f;
     // device id used for the callbacks
     std::atomic<audio_port_handle_t> mDeviceId;
     // Value used for momentary exposure
     std::atomic<float> mRs2UpperBound;
-    // number of samples in the energy
-    std::atomic_size_t mCurrentSamples;
     std::atomic_bool mPaused;
 };
 
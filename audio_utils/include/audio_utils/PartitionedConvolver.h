@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_UTILS_PARTITIONED_CONVOLVER_H
+#define ANDROID_AUDIO_UTILS_PARTITIONED_CONVOLVER_H
+
+#include <memory>
+#include <vector>
+
+#include <audio_utils/FloatFFT.h>
+#include <audio_utils/libaudioutils_export.h>
+
+namespace android::audio_utils {
+
+/**
+ * \brief Zero latency FIR convolution for long impulse responses.
+ *
+ * The impulse response is split into a direct-form head and a sequence of
+ * FFT partitions processed by overlap-save with a frequency-domain delay line:
+ *
+ *   taps [0, H)                       direct-form FIR (H = headSize)
+ *   taps [H, H + P0 * H)              P0 partitions of block size H
+ *   taps [.., .. + P1 * 2H)           P1 partitions of block size 2H
+ *   ...                               up to maxBlockSize
+ *
+ * Every FFT partition of block size B starts at a tap offset of at least B,
+ * so its block result is always due in the future when the input block
+ * completes; results are accumulated into an output ring and the convolver
+ * has no algorithmic latency.
+ *
+ * With maxBlockSize == headSize the partitioning is uniform.  Larger
+ * maxBlockSize values (non-uniform partitioning) reduce the average cost for
+ * very long responses, at the expense of more uneven per-call cost, as the
+ * larger blocks are computed synchronously at their block boundaries.
+ *
+ * Audio is float, interleaved, with each channel filtered independently by
+ * its own impulse response (or one response shared by all channels).
+ *
+ * process() does not allocate or lock; it is not thread-safe.
+ */
+class LIBAUDIOUTILS_EXPORT PartitionedConvolver {
+public:
+    /**
+     * \brief Creates a convolver.
+     *
+     * \param channelCount      number of interleaved channels, >= 1.
+     * \param impulseResponses  either one impulse response shared by all channels,
+     *                          or channelCount impulse responses, one per channel.
+     *                          Responses may have different lengths; at least one
+     *                          must be non-empty.
+     * \param headSize          length of the direct-form head, which is also the
+     *                          smallest FFT block size.  A power of 2, >= 2.
+     * \param maxBlockSize      largest FFT block size, a power of 2 >= headSize.
+     *                          0 selects uniform partitioning (maxBlockSize == headSize).
+     * \return the convolver, or nullptr if the parameters are invalid.
+     */
+    static std::unique_ptr<PartitionedConvolver> create(
+            size_t channelCount,
+            const std::vector<std::vector<float>>& impulseResponses,
+            size_t headSize = kDefaultHeadSize,
+            size_t maxBlockSize = 0);
+
+    static constexpr size_t kDefaultHeadSize = 64;
+
+    /**
+     * \brief Filters interleaved audio.
+     *
+     * \param in          channelCount * frameCount input samples.
+     * \param out         channelCount * frameCount output samples, may be the same as in.
+     * \param frameCount  any number of frames; output is not delayed with respect to input.
+     */
+    void process(const float* in, float* out, size_t frameCount);
+
+    /** Clears the filter state, as if only zeros had been processed. */
+    void reset();
+
+    size_t getChannelCount() const { return mChannelCount; }
+
+    /** Returns the length in taps of the longest impulse response. */
+    size_t getLength() const { return mLength; }
+
+    size_t getHeadSize() const { return mHeadSize; }
+
+    /** Returns the number of FFT partition sizes (levels) used. */
+    size_t getLevelCount() const { return mLevels.size(); }
+
+private:
+    // A group of equally sized FFT partitions covering taps
+    // [offset, offset + partitions * blockSize).
+    struct Level {
+        size_t blockSize;     // B
+        size_t offset;        // tap offset D, D >= B
+        size_t partitions;    // P
+        size_t bins;          // B + 1
+        std::unique_ptr<FloatFFT> fft;  // size 2B
+        // Filter spectra [response][partition][bin], split complex, scaled by 1 / 2B.
+        std::vector<float> filterRe;
+        std::vector<float> filterIm;
+        // Input spectra delay line [channel][slot][bin], slot is circular over P.
+        std::vector<float> delayRe;
+        std::vector<float> delayIm;
+        size_t delayIndex;    // slot of the most recent input spectrum
+    };
+
+    PartitionedConvolver(size_t channelCount,
+            const std::vector<std::vector<float>>& impulseResponses,
+            size_t headSize, size_t maxBlockSize);
+
+    void processLevel(Level& level);
+
+    const size_t mChannelCount;
+    const size_t mResponseCount;  // 1 (shared) or mChannelCount
+    const size_t mHeadSize;       // H
+    size_t mLength = 0;
+
+    // Reversed head taps [response][H] for a forward dot product with the history.
+    std::vector<float> mHeadReversed;
+    // Per channel linear history [channel][H - 1 + H]: last H - 1 samples, then the chunk.
+    std::vector<float> mHeadHistory;
+
+    std::vector<Level> mLevels;
+
+    // Per channel input ring [channel][mInputRingSize], power of 2 >= 2 * maxBlockSize.
+    size_t mInputRingSize = 0;
+    std::vector<float> mInputRing;
+    // Per channel output accumulation ring [channel][mOutputRingSize].
+    size_t mOutputRingSize = 0;
+    std::vector<float> mOutputRing;
+
+    uint64_t mFrames = 0;         // frames processed since reset
+
+    // Scratch for one block: time domain (2 * maxBlockSize) and spectrum accumulators.
+    std::vector<float> mTimeScratch;
+    std::vector<float> mAccRe;
+    std::vector<float> mAccIm;
+};
+
+} // namespace android::audio_utils
+
+#endif // !ANDROID_AUDIO_UTILS_PARTITIONED_CONVOLVER_H
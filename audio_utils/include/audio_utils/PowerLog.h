@@ -19,12 +19,16 @@
 
 #ifdef __cplusplus
 
-#include <mutex>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
 #include <vector>
 #include <system/audio.h>
 #include <utils/Errors.h>
 
 #include <audio_utils/libaudioutils_export.h>
+#include <audio_utils/seqlock.h>
 
 namespace android {
 
@@ -37,6 +41,11 @@ namespace android {
  *
  * Call framesToProcess() to determine the maximum number of frames to process.
  * Then call processEnergy() with a frame count, and the energy, and the time.
+ *
+ * framesToProcess() and processEnergy() must be called from a single writer thread.
+ * They do not block: completed entries are published to a ring of seqlocked
+ * slots, and dumpToString() copies the ring from any thread without a lock,
+ * so the formatting does not delay the writer.
  */
 class LIBAUDIOUTILS_EXPORT PowerLogBase {
 public:
@@ -58,6 +67,17 @@ public:
 
 private:
     void flushEntry();
+    void writeEntry(int64_t time, float energy);
+
+    // Returns a copy of the entries, with entries being overwritten as zero,
+    // and sets *idx to the next index to write.
+    std::vector<std::pair<int64_t /* real time ns */, float /* energy */>> snapshotEntries(
+            size_t *idx) const;
+
+    struct Entry {
+        int64_t time;  // real time ns
+        float energy;
+    };
 
     const uint32_t mSampleRate;   // audio data sample rate
     const uint32_t mChannelCount; // audio data channel count
@@ -67,12 +87,14 @@ private:
     const int64_t mMaxTimeSlipNs; // maximum time incoming audio can
                                   // be offset by before we flush current entry
 
+    // Writer thread state.
     int64_t mCurrentTime = 0;     // time of first frame in buffer
     float mCurrentEnergy = 0.f;   // local energy accumulation
     size_t mCurrentFrames = 0;    // number of frames in the energy
-    size_t mIdx = 0;              // next usable index in mEntries
     size_t mConsecutiveZeroes = 1; // current run of consecutive zero entries
-    std::vector<std::pair<int64_t /* real time ns */, float /* energy */>> mEntries;
+
+    std::atomic<uint64_t> mCount{0}; // number of entries written, mCount % size is next index
+    std::vector<audio_utils::seqlock<Entry>> mEntries;  // tagged with the entry number
 };
 
 /**
@@ -85,7 +107,10 @@ private:
  * No distinction is made between channels in an audio frame; they are all
  * summed together for energy purposes.
  *
- * The public methods are internally protected by a mutex to be thread-safe.
+ * log() must be called from a single thread at a time, typically the audio thread.
+ * It is wait-free: it computes the energy and publishes completed entries
+ * without a lock.  dumpToString() and dump() may be called from any thread,
+ * concurrently with log(), and never block it.
  */
 class LIBAUDIOUTILS_EXPORT PowerLog {
 public:
@@ -128,6 +153,8 @@ public:
     /**
      * \brief Adds new audio data to the power log.
      *
+     * This must not be called concurrently from multiple threads.
+     *
      * \param buffer            pointer to the audio data buffer.
      * \param frames            buffer size in audio frames.
      * \param nowNs             current time in nanoseconds.
@@ -164,7 +191,6 @@ public:
     const audio_format_t mFormat; // audio data format
     const uint32_t mSampleRate;
 
-    mutable std::mutex mMutex;    // monitor mutex governs access through mBase.
     const std::vector<std::shared_ptr<PowerLogBase>> mBase;
 };
 
@@ -21,11 +21,16 @@
 
 #ifdef __cplusplus
 
+#include "seqlock.h"
 #include "variadic_utils.h"
 
 // variadic_utils already contains stl headers; in addition:
+#include <algorithm>
+#include <atomic>
 #include <deque> // for ReferenceStatistics implementation
+#include <limits>
 #include <sstream>
+#include <thread>
 
 namespace android {
 namespace audio_utils {
@@ -306,6 +311,35 @@ public:
         */
     }
 
+    /**
+     * Adds the samples of other to this, as if they were added here, by the
+     * parallel algorithm for the mean and variance:
+     * https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance#Parallel_algorithm
+     *
+     * This is exact for alpha == 1.  Otherwise each Statistics has weighted its own
+     * samples, and the combination weights them by their weight sum, keeping the
+     * alpha of this.
+     */
+    constexpr void merge(const Statistics &other) {
+        if (other.mN == 0) return;
+        if (mN == 0) {
+            const A alpha = mAlpha;
+            *this = other;
+            mAlpha = alpha;
+            return;
+        }
+        mMax = audio_utils::max(mMax, other.mMax);
+        mMin = audio_utils::min(mMin, other.mMin);
+        mN += other.mN;
+        const A weight = mWeight + other.mWeight;
+        const D delta = D(other.mMean) - D(mMean);
+        const D meanDelta = delta * (other.mWeight / weight);
+        mMean += meanDelta;
+        mM2 = mM2 + other.mM2 + (mWeight * other.mWeight / weight) * PRODUCT()(delta, delta);
+        mWeight = weight;
+        mWeight2 += other.mWeight2;
+    }
+
     constexpr int64_t getN() const {
         return mN;
     }
@@ -546,6 +580,386 @@ private:
     }
 };
 
+/**
+ * ShardedStatistics gathers statistics from many threads, e.g. the cycle time of
+ * all the mixer threads of a process, without a mutex shared by the threads.
+ *
+ * It keeps Shards copies of Stats, each on its own cache line.  A thread adds
+ * to the shard given by a sequential id assigned on its first add, so up to Shards
+ * threads add without contention.  Beyond that, a thread finding its shard being
+ * written by another thread tries the following shards, and the sample is dropped
+ * (counted by getDropped()) only if all of them are being written.
+ *
+ * A reader takes a consistent copy of each shard without blocking the writers
+ * (a seqlock), and combines them with Stats::merge().  Stats must be trivially
+ * copyable, which Statistics is for arithmetic and std::array types.
+ *
+ * add() never waits, so it is safe to call from a SCHED_FIFO thread.
+ * get() and reset() are not real time.
+ */
+template <
+    typename Stats = Statistics<double>, // statistics type, with add() and merge()
+    size_t Shards = 16                   // number of shards
+    >
+class ShardedStatistics {
+    static_assert(std::is_trivially_copyable_v<Stats>, "Stats must be trivially copyable");
+    static_assert(Shards > 0, "Shards must be positive");
+
+public:
+    /** args are passed to the Stats constructor of each shard, e.g. alpha. */
+    template <typename... Args>
+    explicit ShardedStatistics(const Args&... args) {
+        for (auto &shard : mShards) {
+            shard.mStats = Stats(args...);
+            shard.mSeqlock.store(shard.mStats);
+        }
+    }
+
+    template <typename T>
+    void add(const T &value) {
+        const size_t id = getThreadShardId();
+        for (size_t i = 0; i < Shards; ++i) {
+            Shard &shard = mShards[(id + i) % Shards];
+            if (shard.mSeqlock.try_begin_write()) {
+                shard.mStats.add(value);
+                shard.mSeqlock.end_write(shard.mStats);
+                return;
+            }
+        }
+        mDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /** Returns the merged statistics of all the shards. */
+    Stats get() const {
+        Stats stats = snapshot(mShards[0]);
+        for (size_t i = 1; i < Shards; ++i) {
+            stats.merge(snapshot(mShards[i]));
+        }
+        return stats;
+    }
+
+    void reset() {
+        for (auto &shard : mShards) {
+            while (!shard.mSeqlock.try_begin_write()) {
+                std::this_thread::yield();
+            }
+            shard.mStats.reset();
+            shard.mSeqlock.end_write(shard.mStats);
+        }
+        mDropped.store(0, std::memory_order_relaxed);
+    }
+
+    /** Returns the number of samples dropped because all the shards were being written. */
+    int64_t getDropped() const {
+        return mDropped.load(std::memory_order_relaxed);
+    }
+
+    std::string toString() const {
+        return get().toString();
+    }
+
+    /** Returns a sequential id for the calling thread, assigned on first call. */
+    static size_t getThreadShardId() {
+        static std::atomic<size_t> sNextId{0};
+        thread_local const size_t tId = sNextId.fetch_add(1, std::memory_order_relaxed);
+        return tId;
+    }
+
+private:
+    static constexpr size_t kCacheLineSize = 64;
+
+    struct alignas(kCacheLineSize) Shard {
+        seqlock<Stats> mSeqlock;  // mStats for readers.
+        Stats mStats;             // accessed by the writer of mSeqlock.
+    };
+
+    static Stats snapshot(const Shard &shard) {
+        Stats stats;
+        while (!shard.mSeqlock.try_load(&stats)) {
+            std::this_thread::yield();
+        }
+        return stats;
+    }
+
+    std::array<Shard, Shards> mShards;
+    std::atomic<int64_t> mDropped{0};
+};
+
+/**
+ * QuantileSketch estimates quantiles, e.g. the median, p95 and p99, of a sample stream
+ * with a guaranteed relative accuracy in a fixed amount of memory.
+ * Statistics provides the mean and variance but no quantiles, and Histogram uses
+ * linear bins, which must be chosen in advance for the range of the data.
+ *
+ * This is the DDSketch algorithm:
+ * https://arxiv.org/abs/1908.10693
+ *
+ * A sample x is counted in the logarithmic bucket i = ceil(log_gamma(|x|)) of its sign,
+ * where gamma = (1 + accuracy) / (1 - accuracy), or as a zero.  A quantile is returned
+ * as 2 gamma^i / (gamma + 1) for its bucket, which is within the relative accuracy
+ * of every sample of the bucket, so of the exact quantile.
+ *
+ * Each sign has N buckets, which cover a ratio of gamma^N between the largest and
+ * the smallest magnitude (7.6e8 for the default accuracy of 1% and N of 1024).
+ * If the samples span more than that, the buckets of the smallest magnitudes are
+ * collapsed together, keeping the accuracy for the largest magnitudes, which are
+ * the tail of interest for latencies.
+ *
+ * Sketches of the same accuracy and N can be merged, e.g. the sketches of several
+ * threads, with exactly the result of a single sketch of all the samples
+ * (if no buckets were collapsed).
+ *
+ * The QuantileSketch is safe to call from a SCHED_FIFO thread with the exception of
+ * the toString() method.  It does not allocate, and add() is constant time, except
+ * when the range of buckets moves, which is O(N).  It is not thread-safe: use one
+ * sketch per thread, and merge() them from a reader thread under a lock.
+ */
+template <
+    typename T = double, // input data type
+    size_t N = 1024      // number of buckets for each sign
+    >
+class QuantileSketch {
+    static_assert(N >= 2, "N must be at least 2");
+
+public:
+    /** accuracy is the relative accuracy of the quantiles, between 0 and 1. */
+    explicit QuantileSketch(double accuracy = 0.01)
+        : mAccuracy(accuracy)
+        , mGamma((1. + accuracy) / (1. - accuracy))
+        , mInvLogGamma(1. / std::log(mGamma))
+    { }
+
+    void add(const T &value) {
+        const double x = value;
+        if (std::isnan(x)) return;
+        mMax = std::max(mMax, value);
+        mMin = std::min(mMin, value);
+        ++mN;
+        if (x >= kMinMagnitude) {
+            mPositive.add(index(x), 1);
+        } else if (x <= -kMinMagnitude) {
+            mNegative.add(index(-x), 1);
+        } else {
+            ++mZeroCount;
+        }
+    }
+
+    /**
+     * Adds the samples of other to this sketch.
+     *
+     * Returns false, and leaves this sketch unchanged, if the accuracy differs.
+     */
+    bool merge(const QuantileSketch &other) {
+        if (other.mAccuracy != mAccuracy) return false;
+        if (other.mN == 0) return true;
+        mMax = std::max(mMax, other.mMax);
+        mMin = std::min(mMin, other.mMin);
+        mN += other.mN;
+        mZeroCount += other.mZeroCount;
+        mPositive.merge(other.mPositive);
+        mNegative.merge(other.mNegative);
+        return true;
+    }
+
+    /**
+     * Returns the estimate of the q quantile, 0 <= q <= 1, being the sample of
+     * rank floor(q * (getN() - 1)) in sorted order.  The 0 and 1 quantiles are
+     * the exact min and max.  Returns NaN if there are no samples.
+     */
+    double getQuantile(double q) const {
+        if (mN == 0 || !(q >= 0. && q <= 1.)) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        const int64_t rank = static_cast<int64_t>(q * (mN - 1));
+        if (rank == 0) return mMin;
+        if (rank == mN - 1) return mMax;
+        double estimate = mMax;
+        int64_t count = mNegative.getN();
+        if (rank < count) {  // negative samples from the largest magnitude.
+            estimate = -value(mNegative.indexOfRank(count - 1 - rank));
+        } else if (rank < (count += mZeroCount)) {
+            estimate = 0.;
+        } else if (rank < count + mPositive.getN()) {
+            estimate = value(mPositive.indexOfRank(rank - count));
+        }
+        return std::clamp(estimate, double(mMin), double(mMax));
+    }
+
+    int64_t getN() const {
+        return mN;
+    }
+
+    T getMin() const {
+        return mMin;
+    }
+
+    T getMax() const {
+        return mMax;
+    }
+
+    double getAccuracy() const {
+        return mAccuracy;
+    }
+
+    void reset() {
+        mMin = StatisticsConstants<T>::positiveInfinity();
+        mMax = StatisticsConstants<T>::negativeInfinity();
+        mN = 0;
+        mZeroCount = 0;
+        mPositive.reset();
+        mNegative.reset();
+    }
+
+    std::string toString() const {
+        if (mN == 0) return "unavail";
+
+        std::stringstream ss;
+        ss << "p50=" << getQuantile(0.5);
+        ss << " p95=" << getQuantile(0.95);
+        ss << " p99=" << getQuantile(0.99);
+        ss << " min=" << getMin();
+        ss << " max=" << getMax();
+        return ss.str();
+    }
+
+private:
+    // Smaller magnitudes are counted as zero, as their log is not finite for float.
+    static constexpr double kMinMagnitude = std::numeric_limits<float>::min();
+
+    // N contiguous buckets of indices mOffset to mOffset + N - 1.
+    class Store {
+    public:
+        void add(int32_t index, int64_t count) {
+            if (mN == 0) {
+                // center the first bucket, as the next may be on either side.
+                mOffset = index - static_cast<int32_t>(N / 2);
+                mMinIndex = mMaxIndex = index;
+            } else if (index >= mOffset + static_cast<int32_t>(N)) {
+                setOffset(index - static_cast<int32_t>(N) + 1);  // collapses the lowest.
+            } else if (index < mOffset) {
+                // move down as far as the highest bucket permits.
+                setOffset(std::max(index, mMaxIndex - static_cast<int32_t>(N) + 1));
+            }
+            index = std::max(index, mOffset);  // collapsed into the lowest bucket.
+            mCounts[index - mOffset] += count;
+            mN += count;
+            mMinIndex = std::min(mMinIndex, index);
+            mMaxIndex = std::max(mMaxIndex, index);
+        }
+
+        void merge(const Store &other) {
+            if (other.mN == 0) return;
+            // add the highest first, so that the buckets move up at most once.
+            for (int32_t i = other.mMaxIndex; i >= other.mMinIndex; --i) {
+                const int64_t count = other.mCounts[i - other.mOffset];
+                if (count != 0) add(i, count);
+            }
+        }
+
+        // Returns the index of the bucket of the sample of rank, 0 <= rank < getN().
+        int32_t indexOfRank(int64_t rank) const {
+            int64_t count = 0;
+            for (int32_t i = mMinIndex; i < mMaxIndex; ++i) {
+                count += mCounts[i - mOffset];
+                if (count > rank) return i;
+            }
+            return mMaxIndex;
+        }
+
+        int64_t getN() const {
+            return mN;
+        }
+
+        void reset() {
+            mCounts.fill(0);
+            mN = 0;
+        }
+
+    private:
+        void setOffset(int32_t offset) {
+            const int32_t shift = offset - mOffset;
+            if (shift > 0) {
+                // collapse the buckets below offset into the bucket of offset.
+                const size_t collapsed = std::min(static_cast<size_t>(shift), N);
+                int64_t sum = 0;
+                for (size_t i = 0; i < collapsed; ++i) sum += mCounts[i];
+                std::copy(mCounts.begin() + collapsed, mCounts.end(), mCounts.begin());
+                std::fill(mCounts.end() - collapsed, mCounts.end(), 0);
+                mCounts[0] += sum;
+                mMinIndex = std::max(mMinIndex, offset);
+                mMaxIndex = std::max(mMaxIndex, offset);
+            } else if (shift < 0) {
+                // caller ensures that mMaxIndex remains in range.
+                std::copy_backward(mCounts.begin(), mCounts.end() + shift, mCounts.end());
+                std::fill(mCounts.begin(), mCounts.begin() - shift, 0);
+            }
+            mOffset = offset;
+        }
+
+        std::array<int64_t, N> mCounts{};
+        int64_t mN = 0;
+        int32_t mOffset = 0;    // index of mCounts[0]
+        int32_t mMinIndex = 0;  // lowest non-empty bucket if mN > 0
+        int32_t mMaxIndex = 0;  // highest non-empty bucket if mN > 0
+    };
+
+    int32_t index(double magnitude) const {
+        return static_cast<int32_t>(std::ceil(std::log(magnitude) * mInvLogGamma));
+    }
+
+    double value(int32_t index) const {
+        return 2. * std::pow(mGamma, index) / (mGamma + 1.);
+    }
+
+    double mAccuracy;
+    double mGamma;
+    double mInvLogGamma;
+    T mMin{StatisticsConstants<T>::positiveInfinity()};
+    T mMax{StatisticsConstants<T>::negativeInfinity()};
+    int64_t mN = 0;
+    int64_t mZeroCount = 0;
+    Store mPositive;
+    Store mNegative;  // of the magnitude of negative samples.
+};
+
+/**
+ * ReferenceQuantile is a naive implementation of quantiles, which keeps and sorts
+ * all the samples.  It is provided for comparison and testing of QuantileSketch.
+ * Do not call from a SCHED_FIFO thread!
+ */
+template <typename T>
+class ReferenceQuantile {
+public:
+    void add(const T &value) {
+        mData.push_back(value);
+        mSorted = false;
+    }
+
+    int64_t getN() const {
+        return mData.size();
+    }
+
+    void reset() {
+        mData.clear();
+    }
+
+    /** Returns the sample of rank floor(q * (getN() - 1)) in sorted order. */
+    double getQuantile(double q) {
+        if (mData.empty() || !(q >= 0. && q <= 1.)) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        if (!mSorted) {
+            std::sort(mData.begin(), mData.end());
+            mSorted = true;
+        }
+        return mData[static_cast<size_t>(q * (mData.size() - 1))];
+    }
+
+private:
+    std::deque<T> mData;
+    bool mSorted = false;
+};
+
 /**
  * Least squares fitting of a 2D straight line based on the covariance matrix.
  *
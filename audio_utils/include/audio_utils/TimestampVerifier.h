@@ -21,6 +21,10 @@
 #include <audio_utils/clock.h>
 #include <audio_utils/Statistics.h>
 
+#include <cmath>
+#include <limits>
+#include <vector>
+
 namespace android {
 
 /** Verifies that a sequence of timestamps (a frame count, time pair)
@@ -160,6 +164,15 @@ public:
         ++mTimestamps;
     }
 
+    /** adds count timestamps of a stream, from arrays of frames and timeNs,
+     * as if add() were called for each.
+     */
+    constexpr void add(const F *frames, const T *timeNs, size_t count, uint32_t sampleRate) {
+        for (size_t i = 0; i < count; ++i) {
+            add(frames[i], timeNs[i], sampleRate);
+        }
+    }
+
     // How a discontinuity affects frame position.
     enum DiscontinuityMode : int32_t {
         DISCONTINUITY_MODE_CONTINUOUS, // frame position is unaffected.
@@ -317,6 +330,256 @@ private:
     }
 };
 
+/** returns the relative drift in parts per million between the clocks of two
+ * streams, from their estimated sample rates relative to their nominal sample rates.
+ *
+ * Streams sharing a device clock have a drift near 0; a drift of more than
+ * a few ppm indicates a clock domain mismatch.
+ * Returns NaN if either stream has no sample rate estimate.
+ */
+template <typename F, typename T>
+double estimateDriftPpm(
+        const TimestampVerifier<F, T> &first, const TimestampVerifier<F, T> &second) {
+    double a, b1, b2, r2;
+    first.estimateSampleRate(a, b1, r2);
+    second.estimateSampleRate(a, b2, r2);
+    if (first.getSampleRate() == 0 || second.getSampleRate() == 0
+            || !(b1 > 0.) || !(b2 > 0.)) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return (b1 * second.getSampleRate() / (b2 * first.getSampleRate()) - 1.) * 1e6;
+}
+
+/** Verifies the timestamps of many streams, for example in a telemetry service,
+ * with the per stream state stored as a structure of arrays.
+ *
+ * F is the type of frame counts (for example int64_t)
+ * T is the type of time in Ns (for example int64_t ns)
+ *
+ * Each stream has jitter statistics and a local sample rate estimate,
+ * both exponentially weighted like those of TimestampVerifier, but without
+ * its cold start detection or timestamp correction.
+ *
+ * add(frames, timeNs) takes one timestamp for every stream; the state is kept
+ * as a structure of arrays, and the update of each stream is free of branches
+ * and independent of the other streams, so the compiler may vectorize the loop.
+ * estimateDriftPpm() compares two streams, for example those sharing a device,
+ * to detect a clock domain mismatch.
+ *
+ * Construction allocates; the other methods except toString() do not,
+ * and may be called from a SCHED_FIFO thread.
+ */
+template <typename F /* frame count */, typename T /* time units */>
+class MultiTimestampVerifier {
+public:
+    MultiTimestampVerifier(size_t streams, uint32_t sampleRate,
+            double alphaJitter = kDefaultAlphaJitter,
+            double alphaEstimator = kDefaultAlphaEstimator)
+        : mAlphaJitter(alphaJitter)
+        , mAlphaEstimator(alphaEstimator)
+        , mSampleRate(streams, sampleRate)
+        , mN(streams)
+        , mLastFrames(streams)
+        , mLastTimeNs(streams)
+        , mHasLast(streams)
+        , mAnchorFrames(streams)
+        , mAnchorTimeNs(streams)
+        , mJitterWeight(streams)
+        , mJitterMean(streams)
+        , mJitterM2(streams)
+        , mJitterMaxAbs(streams)
+        , mEstimatorWeight(streams)
+        , mMeanX(streams)
+        , mMeanY(streams)
+        , mVarX(streams)
+        , mCovXY(streams)
+    { }
+
+    size_t size() const { return mN.size(); }
+
+    /** adds a timestamp for each stream, from arrays of size() frames and timeNs.
+     *
+     * A negative time means the stream timestamp is not ready, and a timestamp
+     * identical to the last is ignored.
+     */
+    void add(const F *frames, const T *timeNs) {
+        const size_t streams = size();
+        for (size_t i = 0; i < streams; ++i) {
+            addToStream(i, frames[i], timeNs[i]);
+        }
+    }
+
+    /** adds a timestamp for one stream. */
+    void add(size_t stream, F frames, T timeNs) {
+        addToStream(stream, frames, timeNs);
+    }
+
+    /** registers a discontinuity of a stream, after which its frame position
+     * may restart from any value.  The local sample rate estimate is reset.
+     */
+    void discontinuity(size_t stream) {
+        mHasLast[stream] = 0;
+        mEstimatorWeight[stream] = 0.;
+        mMeanX[stream] = 0.;
+        mMeanY[stream] = 0.;
+        mVarX[stream] = 0.;
+        mCovXY[stream] = 0.;
+    }
+
+    /** sets the nominal sample rate of a stream, which is a discontinuity. */
+    void setSampleRate(size_t stream, uint32_t sampleRate) {
+        mSampleRate[stream] = sampleRate;
+        discontinuity(stream);
+    }
+
+    uint32_t getSampleRate(size_t stream) const { return mSampleRate[stream]; }
+
+    /** returns the number of timestamps added to the stream. */
+    int64_t getN(size_t stream) const { return mN[stream]; }
+
+    double getJitterMeanMs(size_t stream) const { return mJitterMean[stream]; }
+    double getJitterStdDevMs(size_t stream) const {
+        return mJitterWeight[stream] > 0.
+                ? std::sqrt(mJitterM2[stream] / mJitterWeight[stream]) : 0.;
+    }
+    double getJitterMaxAbsMs(size_t stream) const { return mJitterMaxAbs[stream]; }
+
+    /** returns the estimated local sample rate (dframes / dtime) of a stream,
+     * or 0 if there are fewer than 2 timestamps since the last discontinuity.
+     */
+    double estimateSampleRate(size_t stream) const {
+        return mVarX[stream] > 0. ? mCovXY[stream] / mVarX[stream] : 0.;
+    }
+
+    /** returns the relative drift in parts per million between the clocks of two
+     * streams, like estimateDriftPpm() for TimestampVerifier.
+     * Returns NaN if either stream has no sample rate estimate.
+     */
+    double estimateDriftPpm(size_t first, size_t second) const {
+        const double b1 = estimateSampleRate(first);
+        const double b2 = estimateSampleRate(second);
+        if (!(b1 > 0.) || !(b2 > 0.) || mSampleRate[first] == 0 || mSampleRate[second] == 0) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        return (b1 * mSampleRate[second] / (b2 * mSampleRate[first]) - 1.) * 1e6;
+    }
+
+    /** returns a string with the statistics of a stream.
+     *
+     * Should not be called from a SCHED_FIFO thread since it uses std::string.
+     */
+    std::string toString(size_t stream) const {
+        std::stringstream ss;
+        ss << "n=" << mN[stream]
+                << " jitterMs(mean=" << getJitterMeanMs(stream)
+                << " std=" << getJitterStdDevMs(stream)
+                << " maxAbs=" << getJitterMaxAbsMs(stream) << ")"
+                << " localSR=" << estimateSampleRate(stream);
+        return ss.str();
+    }
+
+private:
+    static constexpr double kDefaultAlphaJitter = 0.999;
+    static constexpr double kDefaultAlphaEstimator = 0.99;
+
+    // Returns left - right through the signed type, like TimestampVerifier::sub(),
+    // so the difference is negative if an unsigned F or T goes backwards.
+    template <typename V>
+    __attribute__((no_sanitize("integer")))
+    static constexpr double diff(V left, V right) {
+        return static_cast<std::make_signed_t<V>>(left - right);
+    }
+
+    // The update of one stream.  To keep the loop over streams free of branches,
+    // all the state is loaded, the new state is always computed,
+    // and then selected and stored, rather than branched on.
+    __attribute__((no_sanitize("integer")))
+    void addToStream(size_t i, F frames, T timeNs) {
+        const double sampleRate = mSampleRate[i];
+        const F lastFrames = mLastFrames[i];
+        const T lastTimeNs = mLastTimeNs[i];
+        const bool hasLast = mHasLast[i] != 0;
+        const F lastAnchorFrames = mAnchorFrames[i];
+        const T lastAnchorTimeNs = mAnchorTimeNs[i];
+        const double lastJitterWeight = mJitterWeight[i];
+        const double lastJitterMean = mJitterMean[i];
+        const double lastJitterM2 = mJitterM2[i];
+        const double lastJitterMaxAbs = mJitterMaxAbs[i];
+        const double lastWeight = mEstimatorWeight[i];
+        const double lastMeanX = mMeanX[i];
+        const double lastMeanY = mMeanY[i];
+        const double lastVarX = mVarX[i];
+        const double lastCovXY = mCovXY[i];
+
+        const bool ready = timeNs >= 0;
+        const bool duplicate = (frames == lastFrames) & (timeNs == lastTimeNs);
+        const bool anchor = ready & !hasLast;
+        const bool update = ready & hasLast & !duplicate;
+        const bool add = anchor | update;
+
+        // jitter between the last and this timestamp, exponentially weighted.
+        const double dFrames = diff(frames, lastFrames);
+        const double dTimeNs = diff(timeNs, lastTimeNs);
+        const double jitterMs = (dTimeNs - dFrames * 1e9 / sampleRate) * 1e-6;
+        const double jitterWeight = lastJitterWeight * mAlphaJitter + 1.;
+        const double jitterDelta = jitterMs - lastJitterMean;
+        const double jitterMean = lastJitterMean + jitterDelta / jitterWeight;
+        const double jitterM2 = lastJitterM2 * mAlphaJitter + jitterDelta * (jitterMs - jitterMean);
+        const double jitterMaxAbs = std::max(lastJitterMaxAbs, std::abs(jitterMs));
+
+        // frames y against time x in seconds, relative to the anchor timestamp
+        // for precision, exponentially weighted (Welford's update).
+        const F anchorFrames = anchor ? frames : lastAnchorFrames;
+        const T anchorTimeNs = anchor ? timeNs : lastAnchorTimeNs;
+        const double x = diff(timeNs, anchorTimeNs) * 1e-9;
+        const double y = diff(frames, anchorFrames);
+        const double weight = lastWeight * mAlphaEstimator + 1.;
+        const double dx = x - lastMeanX;
+        const double dy = y - lastMeanY;
+        const double meanX = lastMeanX + dx / weight;
+        const double meanY = lastMeanY + dy / weight;
+        const double varX = lastVarX * mAlphaEstimator + dx * (x - meanX);
+        const double covXY = lastCovXY * mAlphaEstimator + dx * (y - meanY);
+
+        mLastFrames[i] = add ? frames : lastFrames;
+        mLastTimeNs[i] = add ? timeNs : lastTimeNs;
+        mHasLast[i] = hasLast | ready;
+        mAnchorFrames[i] = anchorFrames;
+        mAnchorTimeNs[i] = anchorTimeNs;
+        mJitterWeight[i] = update ? jitterWeight : lastJitterWeight;
+        mJitterMean[i] = update ? jitterMean : lastJitterMean;
+        mJitterM2[i] = update ? jitterM2 : lastJitterM2;
+        mJitterMaxAbs[i] = update ? jitterMaxAbs : lastJitterMaxAbs;
+        mEstimatorWeight[i] = add ? weight : lastWeight;
+        mMeanX[i] = add ? meanX : lastMeanX;
+        mMeanY[i] = add ? meanY : lastMeanY;
+        mVarX[i] = add ? varX : lastVarX;
+        mCovXY[i] = add ? covXY : lastCovXY;
+        mN[i] += add;
+    }
+
+    const double mAlphaJitter;
+    const double mAlphaEstimator;
+
+    // per stream state, indexed by stream.
+    std::vector<uint32_t> mSampleRate;
+    std::vector<int64_t> mN;
+    std::vector<F> mLastFrames;
+    std::vector<T> mLastTimeNs;
+    std::vector<uint32_t> mHasLast;       // a timestamp since the last discontinuity
+    std::vector<F> mAnchorFrames;         // first timestamp since the last discontinuity
+    std::vector<T> mAnchorTimeNs;
+    std::vector<double> mJitterWeight;
+    std::vector<double> mJitterMean;
+    std::vector<double> mJitterM2;
+    std::vector<double> mJitterMaxAbs;
+    std::vector<double> mEstimatorWeight;
+    std::vector<double> mMeanX;           // seconds from the anchor
+    std::vector<double> mMeanY;           // frames from the anchor
+    std::vector<double> mVarX;            // exponentially weighted, not normalized
+    std::vector<double> mCovXY;
+};
+
 } // namespace android
 
 #endif // !ANDROID_AUDIO_UTILS_TIMESTAMP_VERIFIER_H
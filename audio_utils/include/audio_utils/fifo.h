@@ -46,6 +46,10 @@ enum audio_utils_fifo_sync {
  * The base class manipulates frame indices only, and has no knowledge of frame sizes or the buffer.
  * At most one reader, called the "throttling reader", can block the writer.
  * The "fill level", or unread frame count, is defined with respect to the throttling reader.
+ *
+ * With 64-bit indices, the writer may instead be throttled by up to N readers, each registered
+ * in one of N front index slots, and the fill level is defined with respect to the slowest
+ * registered reader.  Registration and throttling are lock-free.
  */
 class LIBAUDIOUTILS_EXPORT audio_utils_fifo_base {
 
@@ -59,6 +63,9 @@ public:
     uint32_t capacity() const
             { return mFrameCount; }
 
+    /** Maximum number of throttling reader slots. */
+    static const uint32_t kMaxThrottleFronts = 32;
+
 protected:
 
     /**
@@ -77,6 +84,31 @@ protected:
     audio_utils_fifo_base(uint32_t frameCount, audio_utils_fifo_index& writerRear,
             audio_utils_fifo_index *throttleFront = NULL,
             audio_utils_fifo_sync sync = AUDIO_UTILS_FIFO_SYNC_SHARED);
+
+    /**
+     * Construct FIFO base class with 64-bit indices.
+     *
+     *  \param frameCount    As above.
+     *  \param writerRear    Writer's rear index.  Passed by reference because it must be non-NULL.
+     *  \param throttleFronts Pointer to \p throttleFrontCount front index slots of the readers
+     *                       that throttle the writer, or NULL for no throttling.
+     *                       If \p throttleFrontCount is 0, this is the front index of at most one
+     *                       reader, which always throttles the writer as above.
+     *                       Otherwise each slot must be initialized to
+     *                       audio_utils_fifo_index64::kUnregistered before any reader is
+     *                       constructed, and the writer is not throttled while no reader is
+     *                       registered.
+     *  \param throttleFrontCount Number of front index slots, <= kMaxThrottleFronts.
+     *  \param sync          As above.
+     *  \param throttleFrontStride Distance in bytes between the front index slots, a multiple
+     *                       of sizeof(audio_utils_fifo_index64).  A cache line or more keeps
+     *                       the readers from sharing the cache line of the slots they write.
+     */
+    audio_utils_fifo_base(uint32_t frameCount, audio_utils_fifo_index64& writerRear,
+            audio_utils_fifo_index64 *throttleFronts = NULL, uint32_t throttleFrontCount = 0,
+            audio_utils_fifo_sync sync = AUDIO_UTILS_FIFO_SYNC_SHARED,
+            size_t throttleFrontStride = sizeof(audio_utils_fifo_index64));
+
     /*virtual*/ ~audio_utils_fifo_base();
 
     /** Return a new index as the sum of a validated index and a specified increment.
@@ -84,9 +116,9 @@ protected:
      * \param index     Caller should supply a validated mFront or mRear.
      * \param increment Value to be added to the index <= mFrameCount.
      *
-     * \return The sum of index plus increment.
+     * \return The sum of index plus increment, wrapped to the index width.
      */
-    uint32_t sum(uint32_t index, uint32_t increment) const;
+    uint64_t sum(uint64_t index, uint32_t increment) const;
 
     /** Return the difference between two indices: rear - front.
      *
@@ -101,7 +133,29 @@ protected:
      * \retval -EOVERFLOW  reader doesn't throttle writer, and frames were lost because reader
      *                     isn't keeping up with writer; see \p lost
      */
-    int32_t diff(uint32_t rear, uint32_t front, size_t *lost = NULL, bool flush = false) const;
+    int32_t diff(uint64_t rear, uint64_t front, size_t *lost = NULL, bool flush = false) const;
+
+    /** Return whether a writer may be throttled by a reader. */
+    bool isThrottled() const
+            { return !mThrottleFront.isNull() || mThrottleFrontCount > 0; }
+
+    /**
+     * Return the fill level with respect to the slowest throttling reader.
+     *
+     * \param rear       Writer's rear index.
+     * \param front      Set to the front index of the slowest reader.
+     * \param frontIndex Set to the front index of the slowest reader,
+     *                   or to no index if no reader is registered.
+     *
+     * \return The fill level as returned by diff(), or 0 if no reader is registered.
+     */
+    int32_t throttleFilled(uint64_t rear, uint64_t *front,
+            audio_utils_fifo_index_ref *frontIndex) const;
+
+    /** Return the front index slot \p i of mThrottleFronts. */
+    audio_utils_fifo_index64& throttleFrontSlot(uint32_t i) const
+            { return *(audio_utils_fifo_index64 *) ((char *) mThrottleFronts +
+                    i * mThrottleFrontStride); }
 
     /**
      * Mark the FIFO as shutdown (permanently unusable), usually due to an -EIO status from an API.
@@ -122,17 +176,26 @@ protected:
      */
     const uint32_t mFudgeFactor;
 
+    /** Mask of the valid index bits, the indices wrap at 2^32, or at 2^63 if they are 64-bit. */
+    const uint64_t                  mIndexMask;
+
     /** Reference to writer's rear index. */
-    audio_utils_fifo_index&         mWriterRear;
+    const audio_utils_fifo_index_ref mWriterRear;
     /** Indicates how synchronization is done for mWriterRear. */
     const audio_utils_fifo_sync     mWriterRearSync;
 
     /**
-     * Pointer to the front index of at most one reader that throttles the writer,
-     * or NULL for no throttling.
-     */
-    audio_utils_fifo_index* const   mThrottleFront;
-    /** Indicates how synchronization is done for mThrottleFront. */
+     * Reference to the front index of at most one reader that throttles the writer,
+     * or to no index for no throttling or for several throttling readers.
+     */
+    const audio_utils_fifo_index_ref mThrottleFront;
+    /** Front index slots of the readers that throttle the writer, or NULL. */
+    audio_utils_fifo_index64* const mThrottleFronts;
+    /** Number of slots in mThrottleFronts. */
+    const uint32_t                  mThrottleFrontCount;
+    /** Distance in bytes between the slots of mThrottleFronts. */
+    const size_t                    mThrottleFrontStride;
+    /** Indicates how synchronization is done for mThrottleFront and mThrottleFronts. */
     const audio_utils_fifo_sync     mThrottleFrontSync;
 
     /** Whether FIFO is marked as shutdown due to detection of an "impossible" error condition. */
@@ -171,6 +234,26 @@ public:
     audio_utils_fifo(uint32_t frameCount, uint32_t frameSize, void *buffer,
             audio_utils_fifo_index& writerRear, audio_utils_fifo_index *throttleFront = NULL);
 
+    /**
+     * Construct a FIFO object with 64-bit indices: multi-process.
+     * Index synchronization is not configurable; it is always AUDIO_UTILS_FIFO_SYNC_SHARED.
+     *
+     *  \param frameCount  As above.
+     *  \param frameSize   As above.
+     *  \param buffer      As above.
+     *  \param writerRear  Writer's rear index.  Passed by reference because it must be non-NULL.
+     *  \param throttleFronts Pointer to the front index slots of the readers that throttle the
+     *                       writer, or NULL for no throttling.
+     *  \param throttleFrontCount Number of front index slots, or 0 for at most one reader that
+     *                       always throttles the writer.  See audio_utils_fifo_base.
+     *  \param throttleFrontStride Distance in bytes between the front index slots.
+     *                       See audio_utils_fifo_base.
+     */
+    audio_utils_fifo(uint32_t frameCount, uint32_t frameSize, void *buffer,
+            audio_utils_fifo_index64& writerRear, audio_utils_fifo_index64 *throttleFronts = NULL,
+            uint32_t throttleFrontCount = 0,
+            size_t throttleFrontStride = sizeof(audio_utils_fifo_index64));
+
     /**
      * Construct a FIFO object: single-process.
      *  \param frameCount  Maximum usable frames to be stored in the FIFO > 0 && <= INT32_MAX,
@@ -213,11 +296,11 @@ private:
     void * const   mBuffer;     // non-NULL pointer to caller-allocated buffer
                                 // of size mFrameCount frames
 
-    // only used for single-process constructor
-    audio_utils_fifo_index      mSingleProcessSharedRear;
+    // only used for single-process constructor, 64-bit for the waiter flag
+    audio_utils_fifo_index64    mSingleProcessSharedRear;
 
     // only used for single-process constructor when throttlesWriter == true
-    audio_utils_fifo_index      mSingleProcessSharedFront;
+    audio_utils_fifo_index64    mSingleProcessSharedFront;
 };
 
 /**
@@ -313,6 +396,24 @@ public:
      */
     virtual ssize_t available() = 0;
 
+    /**
+     * Publish the frames released since the most recent publication to the partner(s),
+     * and wake the partner(s) if needed.  A no-op if no frames are pending publication.
+     * Only needed after setDeferredPublish(true).
+     */
+    virtual void publish() = 0;
+
+    /**
+     * Set whether release() publishes the released frames immediately, or defers publication
+     * until publish(), or until obtain() is about to block.  The default is immediate.
+     * While deferred, the partner(s) do not see the released frames, but a burst of small
+     * transfers costs only one index store and at most one wake.
+     * Changing back to immediate publishes any pending frames.
+     *
+     * \param deferred Whether to defer publication.
+     */
+    void setDeferredPublish(bool deferred);
+
     /**
      * Return the capacity, or statically configured maximum frame count.
      *
@@ -342,6 +443,12 @@ protected:
     /** Number of times to retry a futex wait that fails with EWOULDBLOCK. */
     static const int kRetries = 2;
 
+    /** Whether release() defers publication until publish(). */
+    bool        mDeferredPublish;
+
+    /** Number of frames released but not yet published. */
+    uint32_t    mUnpublished;
+
     /**
      * Total number of frames released since construction.
      * For a reader, this includes lost and flushed frames.
@@ -403,6 +510,7 @@ public:
             const struct timespec *timeout = NULL);
     virtual void release(size_t count);
     virtual ssize_t available();
+    virtual void publish();
 
     /**
      * Set the current effective buffer size.
@@ -433,6 +541,7 @@ public:
      * The default value for \p armLevel is mFifo.mFrameCount, which means always armed.
      * The default value for \p triggerLevel is zero,
      * which means every write() or release() will wake the readers.
+     * With 64-bit indices, readers are only woken if at least one of them is waiting.
      * For hysteresis, \p armLevel must be <= \p triggerLevel + 1.
      * Increasing \p armLevel will arm for wakeup, regardless of the current fill level.
      *
@@ -453,7 +562,7 @@ public:
 
 private:
     // Accessed by writer only using ordinary operations
-    uint32_t    mLocalRear; // frame index of next frame slot available to write, or write index
+    uint64_t    mLocalRear; // frame index of next frame slot available to write, or write index
 
     // TODO make a separate class and associate with the synchronization object
     uint32_t    mArmLevel;          // arm if filled < arm level before release()
@@ -481,9 +590,12 @@ public:
      *
      * \param fifo            Associated FIFO.  Passed by reference because it must be non-NULL.
      * \param throttlesWriter Whether this reader throttles the writer.
-     *                        At most one reader can specify throttlesWriter == true.
+     *                        At most one reader can specify throttlesWriter == true,
+     *                        unless the FIFO has several throttling reader slots.
      *                        A non-throttling reader does not see any data written
-     *                        prior to construction of the reader.
+     *                        prior to construction of the reader, and neither does a reader
+     *                        registered in a slot.  If all slots are in use, the reader
+     *                        does not throttle the writer.
      * \param flush           Whether to flush (discard) the entire buffer on -EOVERFLOW.
      *                        The advantage of flushing is that it increases the chance that next
      *                        read will be successful.  The disadvantage is that it loses more data.
@@ -531,6 +643,7 @@ public:
             const struct timespec *timeout = NULL);
     virtual void release(size_t count);
     virtual ssize_t available();
+    virtual void publish();
 
     /**
      * Same as audio_utils_fifo_provider::obtain, except has an additional parameter \p lost.
@@ -586,6 +699,7 @@ public:
      * The default value for \p armLevel is -1, which means always armed.
      * The default value for \p triggerLevel is mFifo.mFrameCount,
      * which means every read() or release() will wake the writer.
+     * With 64-bit indices, the writer is only woken if it is waiting.
      * For hysteresis, \p armLevel must be >= \p triggerLevel - 1.
      * Decreasing \p armLevel will arm for wakeup, regardless of the current fill level.
      * Note that the throttling reader is not directly aware of the writer's effective buffer size,
@@ -629,11 +743,12 @@ public:
 
 private:
     // Accessed by reader only using ordinary operations
-    uint32_t     mLocalFront;   // frame index of first frame slot available to read, or read index
+    uint64_t     mLocalFront;   // frame index of first frame slot available to read, or read index
 
-    // Points to shared front index if this reader throttles writer, or NULL if we don't throttle
-    // FIXME consider making it a boolean
-    audio_utils_fifo_index*     mThrottleFront;
+    // Refers to shared front index if this reader throttles writer, or to no index if we don't
+    audio_utils_fifo_index_ref  mThrottleFront;
+    // Whether mThrottleFront is a slot which must be unregistered on destruction
+    bool         mRegistered;
 
     bool        mFlush;             // whether to flush the entire buffer on -EOVERFLOW
 
@@ -95,7 +95,7 @@ public:
 private:
     // Linux futex is 32 bits regardless of platform.
     // It would make more sense to declare this as atomic_uint32_t, but there is no such type name.
-    // TODO Support 64-bit index with 32-bit futex in low-order bits.
+    // See audio_utils_fifo_index64 for a 64-bit index with 32-bit futex in low-order bits.
     std::atomic_uint_least32_t  mIndex; // accessed by both sides using atomic operations
     // TODO Should be a union with a simple non-atomic variable
     static_assert(sizeof(mIndex) == sizeof(uint32_t), "mIndex must be 32 bits");
@@ -104,109 +104,141 @@ private:
 static_assert(sizeof(audio_utils_fifo_index) == sizeof(uint32_t),
         "audio_utils_fifo_index must be 32 bits");
 
-// ----------------------------------------------------------------------------
-
-#if 0   // TODO not currently used, review this code later: bug 150627616
-
-// TODO
-// From a design POV, these next two classes should be related.
-// Extract a base class (that shares their property of being a reference to a fifo index)
-// This should be good in the case if there is a need for generic manipulations on these references.
-// Or can we perhaps define a template and make two specializations of it.
-// This is in the case when compile-time polymorphism is sufficient.
-
 /**
- * A reference to an audio_utils_fifo_index with deferred store-release and deferred wake.
- *
- * TODO Currently the index and futex share the same 32-bit cell.
- * In the future, the index may optionally be increased to 64-bits,
- * and the futex will either be the low-order 32 bits of the index,
- * or an unrelated 32-bit cell used as a set of event flags.
- * Both of these will require a change to the API.
+ * A 64-bit index that may optionally be placed in shared memory, see #audio_utils_fifo_index.
+ * The index does not wrap in practice, so a reader which does not throttle the writer
+ * detects an overrun however long it stops reading.
+ * The futex is the low-order 32 bits of the index, which change on every store of a new index.
+ * The most significant bit is a waiter flag, set by wait() and cleared by the next storeRelease(),
+ * so that the partner only issues a futex wake syscall when someone may be waiting.
  */
-class RefIndexDeferredStoreReleaseDeferredWake
-{
-public:
-    RefIndexDeferredStoreReleaseDeferredWake(audio_utils_fifo_index& index);
-    ~RefIndexDeferredStoreReleaseDeferredWake();
+class LIBAUDIOUTILS_EXPORT audio_utils_fifo_index64 {
 
-    // Place 'value' into the cache, but do not store it to memory yet.
-    void set(uint32_t value);
-
-    // If there is a new value in the cache, store it now with memory order 'release'.
-    void writeback();
-
-    // Place 'value' into the cache and then store it with memory order 'release'.
-    void writethrough(uint32_t value);
+public:
+    /** Waiter flag, not part of the index value. */
+    static constexpr uint64_t kWaiting = UINT64_C(1) << 63;
 
-    // op is FUTEX_WAKE or FUTEX_WAKE_PRIVATE
-    // TODO op should be set in the constructor, and should be abstracted.
-    // waiters is number of waiting threads to wake up
-    void wakeDeferred(int op, int waiters = 1);
-    void wakeNowIfNeeded();
-    // TODO op should be set in the constructor.
-    void wakeNow(int op, int waiters = 1);
+    /** Mask of the index value bits, the index wraps at 2^63. */
+    static constexpr uint64_t kMask = kWaiting - 1;
 
-private:
-    audio_utils_fifo_index& mIndex;     // reference to associated index
-    uint32_t                mValue;     // cached value to be stored
-    bool                    mWriteback; // whether the cached value needs to be stored
-    int                     mWaiters;   // number of waiters to wake
-    int                     mWakeOp;    // which kind of wake operation to use
-};
+    /** Value of the front index of a throttling reader slot which is not in use. */
+    static constexpr uint64_t kUnregistered = kMask;
 
-/**
- * A reference to an audio_utils_fifo_index with cached load-acquire, and deferred wait.
- *
- * TODO Same as RefIndexDeferredStoreReleaseDeferredWake.
- */
-class RefIndexCachedLoadAcquireDeferredWait
-{
-public:
-    RefIndexCachedLoadAcquireDeferredWait(audio_utils_fifo_index& index);
-    ~RefIndexCachedLoadAcquireDeferredWait();
+    explicit audio_utils_fifo_index64(uint64_t value = 0) : mIndex(value) { }
+    ~audio_utils_fifo_index64() { }
 
-    // If value is already cached, return the cached value.
-    // Otherwise load now with memory order 'acquire', cache for later use, and return the value.
-    uint32_t    get();
+    /** Same as audio_utils_fifo_index::loadSingleThreaded(), without the waiter flag. */
+    uint64_t loadSingleThreaded();
 
-    // If value is already cached, this is a no-op.
-    // Otherwise load now with memory order 'acquire' and cache the value for later use.
-    void        prefetch();
+    /** Same as audio_utils_fifo_index::loadAcquire(), without the waiter flag. */
+    uint64_t loadAcquire();
 
-    // Discard any value in the cache.
-    void        invalidate();
+    /** Same as audio_utils_fifo_index::storeSingleThreaded(), and clears the waiter flag. */
+    void storeSingleThreaded(uint64_t value);
 
-#if 0
     /**
-     * Load a fresh value for index, ignoring any previously cached information.
+     * Same as audio_utils_fifo_index::storeRelease(), and clears the waiter flag.
+     *
+     * \return Whether the waiter flag was set, in which case the caller should call wake()
+     *         or else setWaiting() to pass the flag on to a later store.
      */
-    uint32_t    readthrough();
-#endif
+    bool storeRelease(uint64_t value);
+
+    /** Set the waiter flag, for a store which did not wake the waiters. */
+    void setWaiting();
 
-    // TODO This is an immediate wait, but we needed deferred wait
     /**
-     * Wait for value of index to change from when it was most recently read with get().
-     * To avoid a race condition, the caller must have already read the index with get(),
-     * and then made the decision to call wait() based on that value.
+     * Replace the value of index by desired if it is equal to expected,
+     * with memory order 'acquire-release'.  The waiter flag is ignored and cleared.
      *
-     * \param op      Either FUTEX_WAIT or FUTEX_WAIT_PRIVATE.
-     * \param timeout Indicates the maximum time to block while waiting for value to change.
-     *                NULL means to block forever.
-     *                Time is expressed as relative CLOCK_MONOTONIC.
-     *                See above for explanation of why representation is struct timespec.
+     * \param expected Expected value of index, set to the actual value on failure.
+     * \param desired  New value to store into index.
      *
-     * \return Zero for success, or a negative error code as specified at "man 2 futex".
-     * \retval -EINVAL caller did not call get() prior to wait()
+     * \return Whether the value was replaced.
      */
-    int         wait(int op, const struct timespec *timeout);
+    bool compareExchange(uint64_t *expected, uint64_t desired);
+
+    /**
+     * Same as audio_utils_fifo_index::wait(), but sets the waiter flag first.
+     * The futex only compares the low-order 32 bits of \p expected.
+     */
+    int wait(int op, uint64_t expected, const struct timespec *timeout);
+
+    /** Same as audio_utils_fifo_index::wake(). */
+    int wake(int op, int waiters = 1);
 
 private:
-    audio_utils_fifo_index& mIndex;     // reference to associated index
-    uint32_t                mValue;     // most recently cached value
-    bool                    mLoaded;    // whether mValue is valid
+    std::atomic_uint_least64_t  mIndex; // accessed by both sides using atomic operations
+    static_assert(sizeof(mIndex) == sizeof(uint64_t), "mIndex must be 64 bits");
 };
 
-#endif  // 0
+static_assert(sizeof(audio_utils_fifo_index64) == sizeof(uint64_t),
+        "audio_utils_fifo_index64 must be 64 bits");
+
+/**
+ * Reference to either a 32-bit or a 64-bit index, or to no index.
+ * Values are 64 bits, and the values of a 32-bit index wrap at 2^32.
+ */
+class audio_utils_fifo_index_ref {
+
+public:
+    audio_utils_fifo_index_ref() : mIndex32(NULL), mIndex64(NULL) { }
+    audio_utils_fifo_index_ref(audio_utils_fifo_index *index) : mIndex32(index), mIndex64(NULL) { }
+    audio_utils_fifo_index_ref(audio_utils_fifo_index64 *index)
+            : mIndex32(NULL), mIndex64(index) { }
+
+    bool isNull() const
+            { return mIndex32 == NULL && mIndex64 == NULL; }
+
+    /** Return the mask of the valid index bits. */
+    uint64_t mask() const
+            { return mIndex64 != NULL ? audio_utils_fifo_index64::kMask : UINT32_MAX; }
+
+    /** Return whether storeRelease() knows if a partner is waiting. */
+    bool hasWaiterFlag() const
+            { return mIndex64 != NULL; }
+
+    uint64_t loadSingleThreaded() const
+            { return mIndex64 != NULL ? mIndex64->loadSingleThreaded()
+                    : mIndex32->loadSingleThreaded(); }
+
+    uint64_t loadAcquire() const
+            { return mIndex64 != NULL ? mIndex64->loadAcquire() : mIndex32->loadAcquire(); }
+
+    void storeSingleThreaded(uint64_t value) const {
+        if (mIndex64 != NULL) {
+            mIndex64->storeSingleThreaded(value);
+        } else {
+            mIndex32->storeSingleThreaded((uint32_t) value);
+        }
+    }
+
+    /** Return whether a partner may be waiting, always true for a 32-bit index. */
+    bool storeRelease(uint64_t value) const {
+        if (mIndex64 != NULL) {
+            return mIndex64->storeRelease(value);
+        }
+        mIndex32->storeRelease((uint32_t) value);
+        return true;
+    }
+
+    void setWaiting() const {
+        if (mIndex64 != NULL) {
+            mIndex64->setWaiting();
+        }
+    }
+
+    int wait(int op, uint64_t expected, const struct timespec *timeout) const
+            { return mIndex64 != NULL ? mIndex64->wait(op, expected, timeout)
+                    : mIndex32->wait(op, (uint32_t) expected, timeout); }
+
+    int wake(int op, int waiters = 1) const
+            { return mIndex64 != NULL ? mIndex64->wake(op, waiters)
+                    : mIndex32->wake(op, waiters); }
+
+private:
+    audio_utils_fifo_index   *mIndex32;
+    audio_utils_fifo_index64 *mIndex64;
+};
 
 #endif  // !ANDROID_AUDIO_FIFO_INDEX_H
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_FIFO_SHARED_H
+#define ANDROID_AUDIO_FIFO_SHARED_H
+
+#include <memory>
+
+#include <audio_utils/fifo.h>
+#include <audio_utils/libaudioutils_export.h>
+
+/**
+ * A multi-process FIFO in a shared memory region, so that callers don't have to place
+ * the buffer and the indices themselves.
+ *
+ * The region is a sealed memfd which holds, each starting on its own kIndexAlignment boundary:
+ *
+ *   header          frame count, frame size and number of reader slots
+ *   rear index      written by the writer
+ *   front index * N one slot for each reader that throttles the writer
+ *   buffer
+ *
+ * so that the writer and the readers never write to the same cache line.
+ * The indices are 64-bit, see audio_utils_fifo_index64.
+ *
+ * One process calls create(), and passes fd() to the other processes, which call map().
+ * Each process then constructs its audio_utils_fifo_writer or audio_utils_fifo_reader(s)
+ * on fifo().  Index synchronization is AUDIO_UTILS_FIFO_SYNC_SHARED.
+ */
+class LIBAUDIOUTILS_EXPORT audio_utils_fifo_shared {
+
+public:
+    /**
+     * Alignment in bytes of the header, indices and buffer in the region.  Two cache lines,
+     * as the adjacent line prefetcher of some CPUs pulls in cache lines by pairs.
+     */
+    static const size_t kIndexAlignment = 128;
+
+    /**
+     * Create a shared FIFO in a new memfd.
+     *
+     *  \param frameCount  Maximum usable frames to be stored in the FIFO > 0 && <= INT32_MAX.
+     *  \param frameSize   Size of each frame in bytes > 0,
+     *                     \p frameSize * \p frameCount <= INT32_MAX.
+     *  \param throttleFrontCount Number of reader slots, <= kMaxThrottleFronts.
+     *                     Readers which throttle the writer take a slot, see audio_utils_fifo.
+     *                     0 means the writer is never throttled.
+     *  \param name        Name of the memfd, for debugging.
+     *
+     * \return The shared FIFO, or nullptr if the parameters are invalid or the region
+     *         cannot be created.
+     */
+    static std::unique_ptr<audio_utils_fifo_shared> create(uint32_t frameCount,
+            uint32_t frameSize, uint32_t throttleFrontCount = 1,
+            const char *name = "audio_utils_fifo");
+
+    /**
+     * Map a shared FIFO created by another process.
+     *
+     *  \param fd  The fd() of the creator, possibly passed through binder or a unix socket.
+     *             Not closed, the shared FIFO keeps a duplicate.
+     *
+     * \return The shared FIFO, or nullptr if \p fd is not a valid region made by create().
+     */
+    static std::unique_ptr<audio_utils_fifo_shared> map(int fd);
+
+    ~audio_utils_fifo_shared();
+
+    /** Return the memfd of the region, owned by this object. */
+    int fd() const
+            { return mFd; }
+
+    /** Return the FIFO in the region. */
+    audio_utils_fifo& fifo()
+            { return mFifo; }
+
+    /** Return the size of the region in bytes. */
+    size_t size() const
+            { return mSize; }
+
+private:
+    audio_utils_fifo_shared(int fd, void *region, size_t size, uint32_t frameCount,
+            uint32_t frameSize, uint32_t throttleFrontCount);
+
+    const int    mFd;
+    void * const mRegion;
+    const size_t mSize;
+    audio_utils_fifo mFifo;
+};
+
+#endif  // !ANDROID_AUDIO_FIFO_SHARED_H
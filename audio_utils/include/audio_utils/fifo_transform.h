@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_FIFO_TRANSFORM_H
+#define ANDROID_AUDIO_FIFO_TRANSFORM_H
+
+#include <audio_utils/fifo.h>
+#include <audio_utils/libaudioutils_export.h>
+#include <system/audio.h>
+
+/**
+ * The helpers below move frames between a FIFO and another FIFO or a caller buffer,
+ * applying a transform on the way, directly from the obtained slice of the source
+ * to the obtained slice of the destination.
+ *
+ * Each slice has up to two fragments because of wraparound, and the fragments of the source
+ * and of the destination don't line up in general, so a transfer is split into up to three
+ * calls to audio_utils_fifo_transform::process(), each on virtually contiguous frames.
+ * A pipeline of stages connected by FIFOs thus makes a single pass over the data per stage,
+ * without an intermediate scratch buffer.
+ */
+
+/**
+ * A transform from source frames to destination frames, one destination frame per source frame.
+ */
+class LIBAUDIOUTILS_EXPORT audio_utils_fifo_transform {
+public:
+    /**
+     * \param srcFrameSize Size of each source frame in bytes > 0.
+     * \param dstFrameSize Size of each destination frame in bytes > 0.
+     */
+    audio_utils_fifo_transform(uint32_t srcFrameSize, uint32_t dstFrameSize);
+    virtual ~audio_utils_fifo_transform();
+
+    /**
+     * Transform \p frameCount virtually contiguous frames.
+     *
+     * \param dst        Destination of \p frameCount * dstFrameSize() bytes.
+     * \param src        Source of \p frameCount * srcFrameSize() bytes,
+     *                   which does not overlap \p dst.
+     * \param frameCount Number of frames > 0.
+     */
+    virtual void process(void *dst, const void *src, size_t frameCount) const = 0;
+
+    /** Return the size of each source frame in bytes. */
+    uint32_t srcFrameSize() const
+            { return mSrcFrameSize; }
+
+    /** Return the size of each destination frame in bytes. */
+    uint32_t dstFrameSize() const
+            { return mDstFrameSize; }
+
+private:
+    const uint32_t mSrcFrameSize;
+    const uint32_t mDstFrameSize;
+};
+
+/** Copies the frames unchanged. */
+class LIBAUDIOUTILS_EXPORT audio_utils_fifo_copy_transform : public audio_utils_fifo_transform {
+public:
+    explicit audio_utils_fifo_copy_transform(uint32_t frameSize);
+    virtual void process(void *dst, const void *src, size_t frameCount) const;
+};
+
+/** Converts the sample format with memcpy_by_audio_format(). */
+class LIBAUDIOUTILS_EXPORT audio_utils_fifo_format_transform : public audio_utils_fifo_transform {
+public:
+    /**
+     * \param dstFormat    Destination sample format, see memcpy_by_audio_format().
+     * \param srcFormat    Source sample format, see memcpy_by_audio_format().
+     * \param channelCount Number of channels > 0.
+     */
+    audio_utils_fifo_format_transform(audio_format_t dstFormat, audio_format_t srcFormat,
+            uint32_t channelCount);
+    virtual void process(void *dst, const void *src, size_t frameCount) const;
+
+private:
+    const audio_format_t mDstFormat;
+    const audio_format_t mSrcFormat;
+    const uint32_t       mChannelCount;
+};
+
+/** Changes the channel count with adjust_channels(). */
+class LIBAUDIOUTILS_EXPORT audio_utils_fifo_channel_transform : public audio_utils_fifo_transform {
+public:
+    /**
+     * \param dstChannelCount Number of destination channels > 0.
+     * \param srcChannelCount Number of source channels > 0.
+     * \param sampleSize      Size of each sample in bytes, see adjust_channels().
+     */
+    audio_utils_fifo_channel_transform(uint32_t dstChannelCount, uint32_t srcChannelCount,
+            uint32_t sampleSize);
+    virtual void process(void *dst, const void *src, size_t frameCount) const;
+
+private:
+    const uint32_t mDstChannelCount;
+    const uint32_t mSrcChannelCount;
+    const uint32_t mSampleSize;
+};
+
+/** Applies a gain to float samples. */
+class LIBAUDIOUTILS_EXPORT audio_utils_fifo_gain_transform : public audio_utils_fifo_transform {
+public:
+    /**
+     * \param channelCount Number of channels > 0.
+     * \param gain         Initial linear gain.
+     */
+    explicit audio_utils_fifo_gain_transform(uint32_t channelCount, float gain = 1.0f);
+    virtual void process(void *dst, const void *src, size_t frameCount) const;
+
+    /** Set the linear gain, for the next transfer.  Not thread safe with respect to process(). */
+    void setGain(float gain)
+            { mGain = gain; }
+
+    /** Return the linear gain. */
+    float gain() const
+            { return mGain; }
+
+private:
+    const uint32_t mChannelCount;
+    float          mGain;
+};
+
+/**
+ * Transform frames from a reader's FIFO to a writer's FIFO.
+ *
+ * \param reader    Reader of the source FIFO, with frame size transform.srcFrameSize().
+ * \param writer    Writer of the destination FIFO, with frame size transform.dstFrameSize().
+ * \param transform The transform to apply.
+ * \param count     The maximum number of frames to transfer.
+ * \param timeout   Maximum time to block for at least one frame from \p reader,
+ *                  and then again for space for at least one frame in \p writer,
+ *                  see audio_utils_fifo_provider::obtain().
+ * \param lost      See audio_utils_fifo_reader::obtain().
+ *
+ * \return Actual number of frames transferred, if greater than or equal to zero.
+ *         Guaranteed to be <= \p count.  Frames obtained from \p reader beyond that
+ *         are not released, and are available to the next call.
+ *  \retval -EINVAL     the frame sizes of the FIFOs don't match \p transform.
+ *  Otherwise the error of audio_utils_fifo_provider::obtain() from \p reader, or from \p writer.
+ */
+LIBAUDIOUTILS_EXPORT ssize_t audio_utils_fifo_transfer(audio_utils_fifo_reader& reader,
+        audio_utils_fifo_writer& writer, const audio_utils_fifo_transform& transform,
+        size_t count = SIZE_MAX, const struct timespec *timeout = NULL, size_t *lost = NULL);
+
+/**
+ * Transform frames from a reader's FIFO to a caller buffer, such as a device buffer.
+ * Same as audio_utils_fifo_reader::read(), except applies \p transform instead of memcpy().
+ *
+ * \param reader    Reader of the source FIFO, with frame size transform.srcFrameSize().
+ * \param buffer    Destination of \p count * transform.dstFrameSize() bytes.
+ * \param transform The transform to apply.
+ * \param count     See audio_utils_fifo_reader::read().
+ * \param timeout   See audio_utils_fifo_reader::read().
+ * \param lost      See audio_utils_fifo_reader::read().
+ *
+ * \return See audio_utils_fifo_reader::read().
+ *  \retval -EINVAL     the frame size of the FIFO doesn't match \p transform.
+ */
+LIBAUDIOUTILS_EXPORT ssize_t audio_utils_fifo_read(audio_utils_fifo_reader& reader,
+        void *buffer, const audio_utils_fifo_transform& transform, size_t count,
+        const struct timespec *timeout = NULL, size_t *lost = NULL);
+
+/**
+ * Transform frames from a caller buffer, such as a device buffer, to a writer's FIFO.
+ * Same as audio_utils_fifo_writer::write(), except applies \p transform instead of memcpy().
+ *
+ * \param writer    Writer of the destination FIFO, with frame size transform.dstFrameSize().
+ * \param buffer    Source of \p count * transform.srcFrameSize() bytes.
+ * \param transform The transform to apply.
+ * \param count     See audio_utils_fifo_writer::write().
+ * \param timeout   See audio_utils_fifo_writer::write().
+ *
+ * \return See audio_utils_fifo_writer::write().
+ *  \retval -EINVAL     the frame size of the FIFO doesn't match \p transform.
+ */
+LIBAUDIOUTILS_EXPORT ssize_t audio_utils_fifo_write(audio_utils_fifo_writer& writer,
+        const void *buffer, const audio_utils_fifo_transform& transform, size_t count,
+        const struct timespec *timeout = NULL);
+
+#endif  // !ANDROID_AUDIO_FIFO_TRANSFORM_H
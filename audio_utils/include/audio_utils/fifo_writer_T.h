@@ -86,12 +86,12 @@ public:
 
 private:
     // Accessed by writer only using ordinary operations
-    uint32_t    mLocalRear; // frame index of next frame slot available to write, or write index
+    uint64_t    mLocalRear; // frame index of next frame slot available to write, or write index
 
     // These fields are copied from fifo for better performance (avoids an extra de-reference)
     const uint32_t          mFrameCountP2;
     T * const               mBuffer;
-    audio_utils_fifo_index& mWriterRear;
+    const audio_utils_fifo_index_ref mWriterRear;
 };
 
 using audio_utils_fifo_writer32 = audio_utils_fifo_writer_T<int32_t>;
@@ -124,6 +124,43 @@ inline S vconvert(const T& in) {
   using alternative_15_t = struct { struct { float32x4x2_t a; struct { float v[7]; } b; } s; };
 */
 
+// absolute value
+template<typename T>
+static inline T vabs(T f) {
+    if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>) {
+        return f < 0 ? -f : f;
+
+#ifdef USE_NEON
+    } else if constexpr (std::is_same_v<T, float32x2_t>) {
+        return vabs_f32(f);
+    } else if constexpr (std::is_same_v<T, float32x4_t>) {
+        return vabsq_f32(f);
+#if defined(__aarch64__)
+    } else if constexpr (std::is_same_v<T, float64x2_t>) {
+        return vabsq_f64(f);
+#endif
+#endif // USE_NEON
+
+    } else /* constexpr */ {
+        T ret;
+        auto &[retval] = ret;  // single-member struct
+        const auto &[fval] = f;
+        if constexpr (std::is_array_v<decltype(retval)>) {
+#pragma unroll
+            for (size_t i = 0; i < std::size(fval); ++i) {
+                retval[i] = vabs(fval[i]);
+            }
+            return ret;
+        } else /* constexpr */ {
+             auto &[r1, r2] = retval;
+             const auto &[f1, f2] = fval;
+             r1 = vabs(f1);
+             r2 = vabs(f2);
+             return ret;
+        }
+    }
+}
+
 // add a + b
 template<typename T>
 static inline T vadd(T a, T b) {
@@ -281,6 +318,45 @@ static inline T vld1(const F *f) {
     }
 }
 
+// maximum of a and b
+template<typename T>
+static inline T vmax(T a, T b) {
+    if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>) {
+        return a > b ? a : b;
+
+#ifdef USE_NEON
+    } else if constexpr (std::is_same_v<T, float32x2_t>) {
+        return vmax_f32(a, b);
+    } else if constexpr (std::is_same_v<T, float32x4_t>) {
+        return vmaxq_f32(a, b);
+#if defined(__aarch64__)
+    } else if constexpr (std::is_same_v<T, float64x2_t>) {
+        return vmaxq_f64(a, b);
+#endif
+#endif // USE_NEON
+
+    } else /* constexpr */ {
+        T ret;
+        auto &[retval] = ret;  // single-member struct
+        const auto &[aval] = a;
+        const auto &[bval] = b;
+        if constexpr (std::is_array_v<decltype(retval)>) {
+#pragma unroll
+            for (size_t i = 0; i < std::size(aval); ++i) {
+                retval[i] = vmax(aval[i], bval[i]);
+            }
+            return ret;
+        } else /* constexpr */ {
+             auto &[r1, r2] = retval;
+             const auto &[a1, a2] = aval;
+             const auto &[b1, b2] = bval;
+             r1 = vmax(a1, b1);
+             r2 = vmax(a2, b2);
+             return ret;
+        }
+    }
+}
+
 /**
  * Returns c as follows:
  * c_i = a_i * b_i if a and b are the same vector type or
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <android-base/thread_annotations.h>
+#include <audio_utils/Histogram.h>
 #include <audio_utils/safe_math.h>
 #include <audio_utils/threads.h>
 #include <utils/Log.h>
@@ -28,6 +29,9 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 #if __has_include(<sys/syscall.h>)
 #include <sys/syscall.h>
 #endif
@@ -392,6 +396,29 @@ public:
     // the reader.
     static constexpr size_t mutex_stack_depth_ = 16;
 
+    // Set mutex_hold_time_enabled_ to true to measure the time each mutex
+    // is held, for the hold time histogram in the mutex statistics.
+    // This costs a systemTime() call on every lock and unlock,
+    // whereas the wait time is only measured when the lock is contended,
+    // so it is disabled by default.  It may be enabled by an attributes class
+    // derived from this one, as in audio_mutex_benchmark.
+    // Requires mutex_tracking_enabled_.
+    static constexpr bool mutex_hold_time_enabled_ = false;
+
+    // Adaptive spinning: on contention, a mutex constructed with adaptive_spin
+    // retries try_lock() with a cpu pause for a bounded number of iterations
+    // before it blocks in the kernel, which avoids a context switch for
+    // short critical sections.
+    //
+    // The spin budget per mutex order follows the running average of the spins
+    // needed (as glibc PTHREAD_MUTEX_ADAPTIVE_NP), capped to adaptive_spin_max_.
+    // No spinning is done for a mutex order whose average kernel wait exceeds
+    // adaptive_spin_wait_limit_ns_, as such critical sections are too long.
+    // Requires mutex_tracking_enabled_ for the statistics.
+    static constexpr bool adaptive_spin_default_ = false;
+    static constexpr int32_t adaptive_spin_max_ = 100;
+    static constexpr int64_t adaptive_spin_wait_limit_ns_ = 50'000;
+
     // Enable or disable log always fatal.
     // This also requires the mutex feature flag to be set.
     static constexpr bool abort_on_order_check_ = true;
@@ -498,6 +525,25 @@ using stats_atomic = relaxed_atomic<T>;
 template <typename T>
 using thread_atomic = unordered_atomic<T>;
 
+// Hint to the cpu that we are in a spin loop.
+inline void cpu_relax() {
+#ifdef _MSC_VER
+#if defined(_M_IX86) || defined(_M_X64)
+    _mm_pause();
+#elif defined(_M_ARM) || defined(_M_ARM64)
+    __yield();
+#else
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+#elif defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#else
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
 inline void compiler_memory_barrier() {
     // Reads or writes are not migrated or cached by the compiler across this barrier.
 #ifdef _MSC_VER
@@ -579,6 +625,87 @@ void atomic_add_to(unordered_atomic<AccumulateType> &dst, ValueType src,
     dst = dst + src;
 }
 
+/**
+ * log2_histogram is a multiple writer multiple reader histogram of
+ * nonnegative values, typically times in ns, with buckets of exponentially
+ * increasing width so that the tail is resolved with a fixed small memory.
+ *
+ * Bucket 0 counts the values <= 0, and bucket i > 0 counts the values v
+ * with 2^(i-1) <= v < 2^i.  The last bucket also counts all larger values.
+ *
+ * Like mutex_stat, the buckets are updated with relaxed atomics and without a lock,
+ * so a reader may see a slightly inconsistent snapshot.
+ */
+template <typename CounterType, size_t N>
+class log2_histogram {
+    static_assert(std::is_integral_v<CounterType>);
+    static_assert(N >= 2 && N <= 64);
+public:
+    void add(int64_t value) {
+        const size_t bucket = std::min(log2_bucket(value), N - 1);
+        ++buckets_[bucket];
+        int64_t max = max_;
+        while (value > max && !max_.compare_exchange_weak(max, value)) {}
+    }
+
+    CounterType count() const {
+        CounterType count = 0;
+        for (const auto& bucket : buckets_) count += bucket;
+        return count;
+    }
+
+    int64_t max() const { return max_; }
+
+    /**
+     * Returns an estimate of the q quantile (0 <= q <= 1), interpolated
+     * linearly within the bucket, and never greater than max().
+     * Returns 0 if there are no values.
+     */
+    double quantile(double q) const {
+        std::array<CounterType, N> buckets;
+        CounterType count = 0;
+        for (size_t i = 0; i < N; ++i) {
+            buckets[i] = buckets_[i];
+            count += buckets[i];
+        }
+        if (count == 0) return 0.;
+        const double rank = std::clamp(q, 0., 1.) * count;
+        double below = 0.;
+        for (size_t i = 0; i < N; ++i) {
+            if (buckets[i] == 0 || below + buckets[i] < rank) {
+                below += buckets[i];
+                continue;
+            }
+            if (i == 0) return 0.;
+            const double low = static_cast<double>(uint64_t{1} << (i - 1));
+            const double fraction = (rank - below) / buckets[i];
+            return std::min(low + fraction * low, static_cast<double>(max_));
+        }
+        return max_;
+    }
+
+    /**
+     * Returns the p50, p99, p99.9 and max, each scaled by scale,
+     * e.g. 1e-6 for ns to ms, as lines prefixed by prefix.
+     */
+    std::string to_string(std::string_view prefix, double scale) const {
+        std::string out;
+        constexpr std::pair<const char*, double> kQuantiles[] = {
+            {"_p50", 0.5}, {"_p99", 0.99}, {"_p999", 0.999}};
+        for (const auto& [name, q] : kQuantiles) {
+            out.append(prefix).append(name).append("_ms: ")
+                    .append(std::to_string(quantile(q) * scale)).append("\n");
+        }
+        out.append(prefix).append("_max_ms: ")
+                .append(std::to_string(max() * scale)).append("\n");
+        return out;
+    }
+
+private:
+    std::array<stats_atomic<CounterType>, N> buckets_{};
+    stats_atomic<int64_t> max_ = 0;
+};
+
 /**
  * mutex_stat is a struct composed of atomic members associated
  * with usage of a particular mutex order.
@@ -598,18 +725,51 @@ struct mutex_stat {
     stats_atomic<CounterType> locks = 0;        // number of times locked
     stats_atomic<CounterType> unlocks = 0;      // number of times unlocked
     stats_atomic<CounterType> waits = 0;         // number of locks that waited
+    stats_atomic<CounterType> spins = 0;         // number of locks acquired by spinning
+    stats_atomic<int32_t> spin_average = 0;     // running average of spin iterations
     stats_atomic<AccumulatorType> wait_sum_ns = 0.;    // sum of time waited.
     stats_atomic<AccumulatorType> wait_sumsq_ns = 0.;  // sumsq of time waited.
 
+    // 40 buckets reach 2^39 ns, about 9 minutes.
+    using histogram_t = log2_histogram<CounterType, 40>;
+    histogram_t wait_histogram;  // time waited, for the locks that waited.
+    histogram_t hold_histogram;  // time held, if mutex_hold_time_enabled_.
+
     template <typename WaitTimeType>
     void add_wait_time(WaitTimeType wait_ns) {
         AccumulatorType value_ns = wait_ns;
         atomic_add_to(wait_sum_ns, value_ns);
         atomic_add_to(wait_sumsq_ns, value_ns * value_ns);
+        wait_histogram.add(wait_ns);
+    }
+
+    void add_hold_time(int64_t hold_ns) {
+        hold_histogram.add(hold_ns);
+    }
+
+    /**
+     * Returns the maximum number of spin iterations for an adaptive lock.
+     */
+    int32_t spin_budget(int32_t spin_max, int64_t wait_limit_ns) const {
+        const CounterType wait_count = waits;
+        if (wait_count != 0 && wait_sum_ns > static_cast<AccumulatorType>(wait_limit_ns)
+                * static_cast<AccumulatorType>(wait_count)) {
+            return 0;
+        }
+        return std::min(spin_max, spin_average * 2 + 10);
+    }
+
+    /**
+     * Updates the running average of spin iterations with the latest count.
+     */
+    void add_spin_count(int32_t count, bool acquired) {
+        const int32_t average = spin_average;
+        spin_average = average + (count - average) / 8;
+        if (acquired) ++spins;
     }
 
     std::string to_string() const {
-        CounterType uncontested = locks - waits;
+        CounterType uncontested = locks - waits - spins;
         AccumulatorType recip = waits == 0 ? 0. : 1. / waits;
         AccumulatorType avg_wait_ms = waits == 0 ? 0. : wait_sum_ns * 1e-6 * recip;
         AccumulatorType std_wait_ms = waits < 2 ? 0. :
@@ -618,10 +778,14 @@ struct mutex_stat {
         return std::string("locks: ").append(std::to_string(locks))
             .append("\nuncontested: ").append(std::to_string(uncontested))
             .append("\nwaits: ").append(std::to_string(waits))
+            .append("\nspins: ").append(std::to_string(spins))
             .append("\nunlocks: ").append(std::to_string(unlocks))
             .append("\navg_wait_ms: ").append(std::to_string(avg_wait_ms))
             .append("\nstd_wait_ms: ").append(std::to_string(std_wait_ms))
-            .append("\n");
+            .append("\n")
+            .append(wait_histogram.to_string("wait", 1e-6))
+            .append(hold_histogram.count() == 0 ? std::string{} :
+                    hold_histogram.to_string("hold", 1e-6));
     }
 };
 
@@ -914,7 +1078,9 @@ public:
     // declared here, defined below due to use of thread_registry.
     ~thread_mutex_info();
 
-    void reset_waiter(MutexHandle waiter = nullptr) {
+    // waiter_time_ns is when the wait started, used by mutex_watchdog.
+    void reset_waiter(MutexHandle waiter = nullptr, int64_t waiter_time_ns = 0) {
+        mutex_wait_time_ns_ = waiter_time_ns;
         mutex_wait_ = waiter;
     }
 
@@ -1010,6 +1176,7 @@ public:
 
     const pid_t tid_;                                   // me
     thread_atomic<MutexHandle> mutex_wait_{};           // mutex waiting for
+    thread_atomic<int64_t> mutex_wait_time_ns_{};       // when the mutex wait started
     other_wait_info other_wait_info_;
     atomic_stack_t mutexes_held_;  // mutexes held
 };
@@ -1309,10 +1476,13 @@ public:
         : mutex_impl(mutex_get_enable_flag(), order)
     {}
 
-    // Constructor selects priority inheritance based on input argument.
+    // Constructor selects priority inheritance based on input argument,
+    // and adaptive spinning on contention, see AudioMutexAttributes.
     mutex_impl(bool priority_inheritance,
-            typename Attributes::order_t order = Attributes::order_default_)
+            typename Attributes::order_t order = Attributes::order_default_,
+            bool adaptive_spin = Attributes::adaptive_spin_default_)
         : order_(order)
+        , adaptive_spin_(adaptive_spin && Attributes::mutex_tracking_enabled_)
         , stat_{get_mutex_stat_array()[static_cast<size_t>(order)]}
     {
         LOG_ALWAYS_FATAL_IF(static_cast<size_t>(order) >= Attributes::order_size_,
@@ -1357,7 +1527,8 @@ public:
 
     void lock() ACQUIRE() {
         lock_scoped_stat_t::pre_lock(*this);
-        if (!m_.try_lock()) {  // if we directly use futex, we can optimize this with m_.lock().
+        // if we directly use futex, we can optimize this with m_.lock().
+        if (!m_.try_lock() && !(adaptive_spin_ && spin_lock())) {
             // lock_scoped_stat_t accumulates waiting time for the mutex lock call.
             lock_scoped_stat_t ls(*this);
             m_.lock();
@@ -1413,6 +1584,10 @@ public:
 
     using mutex_stat_t = mutex_stat<uint64_t, double>;
 
+    bool adaptive_spin() const {
+        return adaptive_spin_;
+    }
+
     mutex_stat_t& get_stat() const {
         return stat_;
     }
@@ -1485,11 +1660,11 @@ public:
 
     class [[nodiscard]] lock_scoped_stat_enabled {
     public:
-        explicit lock_scoped_stat_enabled(mutex& m)
+        explicit lock_scoped_stat_enabled(mutex_impl& m)
             : mutex_(m)
             , time_(systemTime()) {
            ++mutex_.stat_.waits;
-           mutex_.get_thread_mutex_info()->reset_waiter(&mutex_);
+           mutex_.get_thread_mutex_info()->reset_waiter(&mutex_, time_);
         }
 
         ~lock_scoped_stat_enabled() {
@@ -1501,8 +1676,11 @@ public:
             discard_wait_time_ = true;
         }
 
-        static void pre_unlock(mutex& m) {
+        static void pre_unlock(mutex_impl& m) {
             ++m.stat_.unlocks;
+            if constexpr (Attributes::mutex_hold_time_enabled_) {
+                m.stat_.add_hold_time(systemTime() - m.lock_time_ns_);
+            }
             const bool success = m.get_thread_mutex_info()->remove_held(&m);
             LOG_ALWAYS_FATAL_IF(Attributes::abort_on_invalid_unlock_
                     && !success,
@@ -1510,7 +1688,7 @@ public:
         }
 
         // before we lock, we check order and recursion.
-        static void pre_lock(mutex& m) {
+        static void pre_lock(mutex_impl& m) {
             if constexpr (!Attributes::abort_on_order_check_ &&
                     !Attributes::abort_on_recursion_check_) return;
 
@@ -1535,13 +1713,16 @@ public:
                     __func__, p_order, Attributes::order_names_[p_order]);
         }
 
-        static void post_lock(mutex& m) {
+        static void post_lock(mutex_impl& m) {
             ++m.stat_.locks;
             m.get_thread_mutex_info()->push_held(&m, m.order_);
+            if constexpr (Attributes::mutex_hold_time_enabled_) {
+                m.lock_time_ns_ = systemTime();
+            }
         }
 
     private:
-        mutex& mutex_;
+        mutex_impl& mutex_;
         const int64_t time_;
         bool discard_wait_time_ = false;
     };
@@ -1571,15 +1752,15 @@ public:
 
     class lock_scoped_stat_disabled {
     public:
-        explicit lock_scoped_stat_disabled(mutex&) {}
+        explicit lock_scoped_stat_disabled(mutex_impl&) {}
 
         void ignoreWaitTime() {}
 
-        static void pre_unlock(mutex&) {}
+        static void pre_unlock(mutex_impl&) {}
 
-        static void pre_lock(mutex&) {}
+        static void pre_lock(mutex_impl&) {}
 
-        static void post_lock(mutex&) {}
+        static void post_lock(mutex_impl&) {}
     };
 
     using lock_scoped_stat_t = std::conditional_t<Attributes::mutex_tracking_enabled_,
@@ -1588,9 +1769,12 @@ public:
     // helper class for registering statistics for a cv wait.
     class [[nodiscard]] cv_wait_scoped_stat_enabled {
     public:
-        explicit cv_wait_scoped_stat_enabled(mutex& m, pid_t notifier_tid = kInvalidTid)
+        explicit cv_wait_scoped_stat_enabled(mutex_impl& m, pid_t notifier_tid = kInvalidTid)
             : mutex_(m) {
             ++mutex_.stat_.unlocks;
+            if constexpr (Attributes::mutex_hold_time_enabled_) {
+                mutex_.stat_.add_hold_time(systemTime() - mutex_.lock_time_ns_);
+            }
             // metadata that we relinquish lock.
             const bool success = mutex_.get_thread_mutex_info()->remove_held_for_cv(
                     &mutex_, mutex_.order_, notifier_tid);
@@ -1603,13 +1787,16 @@ public:
             ++mutex_.stat_.locks;
             // metadata that we are reacquiring lock.
             mutex_.get_thread_mutex_info()->push_held_for_cv(&mutex_, mutex_.order_);
+            if constexpr (Attributes::mutex_hold_time_enabled_) {
+                mutex_.lock_time_ns_ = systemTime();
+            }
         }
     private:
-        mutex& mutex_;
+        mutex_impl& mutex_;
     };
 
     class [[nodiscard]] cv_wait_scoped_stat_disabled {
-        explicit cv_wait_scoped_stat_disabled(mutex&) {}
+        explicit cv_wait_scoped_stat_disabled(mutex_impl&) {}
     };
 
     using cv_wait_scoped_stat_t = std::conditional_t<Attributes::mutex_tracking_enabled_,
@@ -1630,13 +1817,35 @@ public:
     static stat_array_t& get_mutex_stat_array();
 
 private:
+    // Retries try_lock() for the spin budget of the mutex order.
+    // The thread is not registered as waiting while spinning, as the spin is bounded.
+    bool spin_lock() {
+        const int32_t budget = stat_.spin_budget(
+                Attributes::adaptive_spin_max_, Attributes::adaptive_spin_wait_limit_ns_);
+        if (budget <= 0) return false;
+        int32_t count = 0;
+        bool acquired = false;
+        while (count < budget) {
+            ++count;
+            cpu_relax();
+            if (m_.try_lock()) {
+                acquired = true;
+                break;
+            }
+        }
+        stat_.add_spin_count(count, acquired);
+        return acquired;
+    }
+
 #ifdef _MSC_VER
     shared_timed_recursive_mutex m_;
 #else
     std::mutex m_;
 #endif
     const typename Attributes::order_t order_;
+    const bool adaptive_spin_;
     mutex_stat_t& stat_;  // set in ctor
+    int64_t lock_time_ns_ = 0;  // when last locked, only accessed by the holder
 };
 
 // define the destructor to remove from registry.
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <audio_utils/libaudioutils_export.h>
+#include <audio_utils/mutex.h>
+#include <audio_utils/seqlock.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace android::audio_utils {
+
+/**
+ * event_log is a bounded log of trivially copyable events,
+ * keeping the most recent N events.
+ *
+ * push() is wait-free and must be called from a single writer thread.
+ * snapshot() is lock-free and may be called from any number of reader threads,
+ * concurrently with push(); an event overwritten while being read is skipped.
+ *
+ * Each slot is a seqlock tagged with the event number.
+ */
+template <typename T, size_t N>
+class event_log {
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+    static_assert(N > 0, "N must be positive");
+
+public:
+    static constexpr size_t capacity() { return N; }
+
+    /**
+     * Appends an event, overwriting the oldest if the log is full.
+     * Single writer thread only.
+     */
+    void push(const T& event) {
+        const uint64_t index = count_.load(std::memory_order_relaxed);
+        slots_[index % N].store(event, index);
+        count_.store(index + 1, std::memory_order_release);
+    }
+
+    /**
+     * Returns up to max_events of the most recent events, oldest first.
+     */
+    std::vector<T> snapshot(size_t max_events = N) const {
+        const uint64_t count = count_.load(std::memory_order_acquire);
+        const uint64_t size = std::min<uint64_t>({count, N, max_events});
+        std::vector<T> events;
+        events.reserve(size);
+        for (uint64_t index = count - size; index < count; ++index) {
+            T event;
+            uint64_t tag;
+            if (!slots_[index % N].try_load(&event, &tag) || tag != index) {
+                continue;  // being overwritten
+            }
+            events.push_back(event);
+        }
+        return events;
+    }
+
+    /**
+     * Returns the total number of events pushed, including those overwritten.
+     */
+    uint64_t count() const {
+        return count_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> count_{0};
+    std::array<seqlock<T>, N> slots_;
+};
+
+enum class mutex_event_type_t : uint32_t {
+    deadlock,            // a cycle of threads waiting on each other
+    long_wait,           // a thread waiting on a mutex for too long
+    priority_inversion,  // a real time thread waiting on a lower priority holder
+};
+
+inline constexpr const char* mutex_event_type_to_string(mutex_event_type_t type) {
+    switch (type) {
+    case mutex_event_type_t::deadlock: return "deadlock";
+    case mutex_event_type_t::long_wait: return "long_wait";
+    case mutex_event_type_t::priority_inversion: return "priority_inversion";
+    }
+    return "unknown";
+}
+
+/**
+ * mutex_event_t is a watchdog event, stored in the event_log.
+ *
+ * Priorities are unified priorities, see threads.h, or negative if unknown.
+ */
+struct LIBAUDIOUTILS_EXPORT mutex_event_t {
+    static constexpr size_t kMaxChain = 8;
+
+    mutex_event_type_t type;
+    pid_t tid;               // waiting tid
+    pid_t holder_tid;        // tid holding the mutex waited on
+    uint32_t order;          // MutexOrder of the mutex waited on, order_size_ if unknown
+    int32_t priority;        // of tid
+    int32_t holder_priority; // of holder_tid
+    int64_t time_ns;         // SYSTEM_TIME_REALTIME when detected
+    int64_t wait_ns;         // time tid has been waiting
+    uint32_t chain_size;     // size of the wait chain, may be greater than kMaxChain
+    pid_t chain[kMaxChain];  // wait chain after tid, for a deadlock the last tid repeats
+
+    std::string to_string() const;
+};
+
+/**
+ * mutex_watchdog is a thread which periodically samples the audio_utils::mutex
+ * thread registry for threads waiting on a mutex, and records in an event_log:
+ *
+ * 1) a deadlock, when the wait chain of a thread has a cycle
+ *    (the cycle is reported once, from its lowest tid).
+ * 2) a long wait, when a thread has waited on a mutex for long_wait_ns.
+ * 3) a priority inversion, when a real time thread has waited for
+ *    priority_inversion_ns on a mutex held by a lower priority thread.
+ *
+ * Each is reported once per mutex wait.  Only waits on audio_utils::mutex
+ * with mutex tracking enabled are seen, and like mutex::deadlock_detection()
+ * the thread state is read without locking, so there may be false negatives
+ * due to races.
+ *
+ * The sample costs a copy of the registry map, and for each thread waiting
+ * longer than the lower threshold, a deadlock_detection() and two priority queries;
+ * it does not affect the threads that lock mutexes.
+ */
+class LIBAUDIOUTILS_EXPORT mutex_watchdog {
+public:
+    using event_log_t = event_log<mutex_event_t, 64>;
+
+    struct options_t {
+        int64_t period_ns = 100'000'000;             // 0 for no thread, use sample()
+        int64_t long_wait_ns = 1'000'000'000;
+        int64_t priority_inversion_ns = 10'000'000;
+        // Returns the unified priority of a tid, replaceable for test.
+        std::function<int(pid_t)> get_priority = get_thread_priority;
+    };
+
+    mutex_watchdog() : mutex_watchdog(options_t{}) {}
+    explicit mutex_watchdog(options_t options);
+    ~mutex_watchdog();
+
+    mutex_watchdog(const mutex_watchdog&) = delete;
+    mutex_watchdog& operator=(const mutex_watchdog&) = delete;
+
+    /**
+     * Samples the thread registry once, and returns the number of new events.
+     *
+     * This is called periodically by the watchdog thread; if period_ns is 0
+     * it may be called directly, but not concurrently.
+     */
+    size_t sample();
+
+    /**
+     * Returns up to max_events of the most recent events, oldest first.
+     * This may be called from any thread.
+     */
+    std::vector<mutex_event_t> events(size_t max_events = event_log_t::capacity()) const {
+        return log_.snapshot(max_events);
+    }
+
+    /**
+     * Returns the total number of events detected.
+     */
+    uint64_t event_count() const {
+        return log_.count();
+    }
+
+    /**
+     * Returns the most recent events, one per line.
+     */
+    std::string to_string(size_t max_events = event_log_t::capacity()) const;
+
+private:
+    void threadLoop();
+
+    const options_t options_;
+
+    // The events reported for the current wait of a tid, only accessed by sample().
+    struct reported_t {
+        int64_t wait_time_ns;
+        uint32_t types;  // bitmask of mutex_event_type_t
+    };
+    std::unordered_map<pid_t, reported_t> reported_;
+
+    event_log_t log_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool quit_ GUARDED_BY(mutex_) = false;
+    std::thread thread_;  // last, started after the members are initialized
+};
+
+}  // namespace android::audio_utils
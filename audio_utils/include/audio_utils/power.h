@@ -107,6 +107,37 @@ LIBAUDIOUTILS_EXPORT void audio_utils_accumulate_energy(const void* buffer,
                                    size_t numChannels,
                                    float* out);
 
+/**
+ * \brief Compute for each channel signal energy (sum of squared amplitudes)
+ *        and peak absolute amplitude in one pass.
+ *
+ *   \param buffer       buffer of samples.
+ *   \param format       one of AUDIO_FORMAT_PCM_8_BIT, AUDIO_FORMAT_PCM_16_BIT,
+ *                       AUDIO_FORMAT_PCM_24_BIT_PACKED, AUDIO_FORMAT_PCM_8_24_BIT,
+ *                       AUDIO_FORMAT_PCM_32_BIT, AUDIO_FORMAT_PCM_FLOAT.
+ *   \param samples      number of samples in buffer.  This is not audio frames;
+ *                       usually the number of samples is the number of audio frames
+ *                       multiplied by channel count.
+ *   \param numChannels  the number of channels for which the energy and peak are computed.
+ *   \param energy       interleaved buffer containing for each channel the sample
+ *                       energy, as for audio_utils_accumulate_energy().
+ *   \param peak         interleaved buffer containing for each channel the peak
+ *                       absolute amplitude, normalized as the energy. Must be initialized
+ *                       with zero values or a pre-existing peak to accumulate to.
+ *
+ * \return
+ *   energy array is updated by adding for each channel the signal energy of the samples
+ *   in the buffer, peak array is updated to the maximum of the existing peak and the
+ *   absolute amplitude of the samples in the buffer. The RMS amplitude of a channel
+ *   is available from audio_utils_rms_from_energy().
+ */
+LIBAUDIOUTILS_EXPORT void audio_utils_accumulate_energy_and_peak(const void* buffer,
+                                            audio_format_t format,
+                                            size_t samples,
+                                            size_t numChannels,
+                                            float* energy,
+                                            float* peak);
+
 /**
  * \brief  Returns true if the format is supported for compute_energy_for_mono()
  *         and compute_power_for_mono().
@@ -138,6 +169,17 @@ static inline float audio_utils_power_from_energy(float energy)
     return 10.f * log10f(energy);
 }
 
+/**
+ * \brief  Returns the RMS amplitude from energy.
+ * \param  energy the signal energy of one channel. This should be non-negative.
+ * \param  frames the number of frames the energy was accumulated over, non-zero.
+ * \return RMS amplitude, normalized as the energy.
+ */
+static inline float audio_utils_rms_from_energy(float energy, size_t frames)
+{
+    return sqrtf(energy / frames);
+}
+
 /** \cond */
 __END_DECLS
 /** \endcond */
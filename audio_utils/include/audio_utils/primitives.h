@@ -688,6 +688,72 @@ LIBAUDIOUTILS_EXPORT size_t memcpy_by_index_array_initialization_src_index(int8_
 LIBAUDIOUTILS_EXPORT size_t memcpy_by_index_array_initialization_dst_index(int8_t *idxary, size_t idxcount,
         uint32_t dst_mask, uint32_t src_mask);
 
+/** Maximum number of source or destination channels of a memcpy_by_index_array_plan_t. */
+#define MEMCPY_BY_INDEX_ARRAY_PLAN_MAX_CHANNELS 32
+
+/** \cond */
+#define MEMCPY_BY_INDEX_ARRAY_PLAN_MAX_SHUFFLES 16
+/** \endcond */
+
+/**
+ * A precompiled index array for memcpy_by_index_array_with_plan().
+ *
+ * The plan is caller allocated and prepared once by memcpy_by_index_array_plan_initialization(),
+ * then reused for every buffer with the same channel arrangement.
+ * Where possible the index array is compiled into byte shuffle tables, so that
+ * groups of frames are rearranged by vector byte shuffles (NEON tbl or SSSE3 pshufb)
+ * instead of interpreting the index array for every sample.
+ *
+ * The fields are private to the implementation.
+ */
+typedef struct {
+    /** \cond */
+    uint32_t dst_channels;
+    uint32_t src_channels;
+    uint32_t sample_size;
+    uint32_t copy;              /* non-zero if the plan is a plain memcpy */
+    uint32_t group_frames;      /* frames per group of shuffles, 0 if shuffles are not used */
+    uint32_t shuffles;          /* 16 byte shuffles per group of frames */
+    uint8_t dst_offset[MEMCPY_BY_INDEX_ARRAY_PLAN_MAX_SHUFFLES];  /* byte offset in dst group */
+    uint8_t src_offset[MEMCPY_BY_INDEX_ARRAY_PLAN_MAX_SHUFFLES];  /* byte offset in src group */
+    uint8_t shuffle[MEMCPY_BY_INDEX_ARRAY_PLAN_MAX_SHUFFLES][16];  /* 0x80 is a zero byte */
+    int8_t idxary[MEMCPY_BY_INDEX_ARRAY_PLAN_MAX_CHANNELS];
+    /** \endcond */
+} memcpy_by_index_array_plan_t;
+
+/**
+ * Prepares a plan for memcpy_by_index_array_with_plan() from an index array,
+ * with the same meaning of the parameters as for memcpy_by_index_array().
+ *
+ *  \param plan          Caller allocated plan to initialize
+ *  \param dst_channels  Number of destination channels per frame,
+ *                       at most MEMCPY_BY_INDEX_ARRAY_PLAN_MAX_CHANNELS
+ *  \param src_channels  Number of source channels per frame,
+ *                       at most MEMCPY_BY_INDEX_ARRAY_PLAN_MAX_CHANNELS
+ *  \param idxary        Array of dst_channels indices representing channels in the source frame
+ *  \param sample_size   Size of each sample in bytes.  Must be 1, 2, 3, or 4.
+ *
+ * \return 0 on success, or -EINVAL if the parameters are out of range,
+ * in which case the plan must not be used.
+ */
+LIBAUDIOUTILS_EXPORT int memcpy_by_index_array_plan_initialization(
+        memcpy_by_index_array_plan_t *plan, uint32_t dst_channels, uint32_t src_channels,
+        const int8_t *idxary, size_t sample_size);
+
+/**
+ * Copy frames as memcpy_by_index_array() would, with the index array, channel counts
+ * and sample size from a plan prepared by memcpy_by_index_array_plan_initialization().
+ *
+ *  \param dst           Destination buffer
+ *  \param src           Source buffer
+ *  \param plan          Plan for the copy
+ *  \param count         Number of frames to copy
+ *
+ * The destination and source buffers must be completely separate (non-overlapping).
+ */
+LIBAUDIOUTILS_EXPORT void memcpy_by_index_array_with_plan(void *dst, const void *src,
+        const memcpy_by_index_array_plan_t *plan, size_t count);
+
 /**
  * Add and clamp signed 16-bit samples.
  *
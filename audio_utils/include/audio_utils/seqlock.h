@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace android::audio_utils {
+
+/**
+ * seqlock holds a trivially copyable value, with a tag such as a record number,
+ * which is read without a lock concurrently with the writer.
+ *
+ * The sequence is odd while the value is written.  The value is copied in and
+ * out through relaxed atomic words, so a torn read is detected by the sequence
+ * rather than being a data race.
+ *
+ * store() is wait-free and must not be called concurrently with another store().
+ * Several writers use try_begin_write() and end_write() instead, which never wait.
+ * try_load() is wait-free and may be called from any number of reader threads;
+ * it fails rather than waits if the value is being written.
+ */
+template <typename T>
+class seqlock {
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+
+public:
+    /**
+     * Stores the value and tag.  Single writer only.
+     */
+    void store(const T& value, uint64_t tag = 0) {
+        sequence_.store(sequence_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+        // the words must not be seen changed before the sequence is odd.
+        std::atomic_thread_fence(std::memory_order_release);
+        end_write(value, tag);
+    }
+
+    /**
+     * Makes the sequence odd for a store by end_write(), unless another writer
+     * has it odd.  Returns whether the caller may write.
+     */
+    bool try_begin_write() {
+        uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+        if ((sequence & 1) != 0 || !sequence_.compare_exchange_strong(
+                sequence, sequence + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Stores the value and tag and makes the sequence even,
+     * after store() or a successful try_begin_write().
+     */
+    void end_write(const T& value, uint64_t tag = 0) {
+        std::array<uint64_t, kWords> words{};
+        memcpy(words.data(), &value, sizeof(T));
+        tag_.store(tag, std::memory_order_relaxed);
+        for (size_t i = 0; i < kWords; ++i) {
+            words_[i].store(words[i], std::memory_order_relaxed);
+        }
+        sequence_.store(sequence_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+    }
+
+    /**
+     * Copies the value and tag, returning false if they were being written.
+     * tag may be nullptr.
+     */
+    bool try_load(T* value, uint64_t* tag = nullptr) const {
+        const uint64_t sequence = sequence_.load(std::memory_order_acquire);
+        if ((sequence & 1) != 0) return false;
+        const uint64_t stored_tag = tag_.load(std::memory_order_relaxed);
+        std::array<uint64_t, kWords> words;
+        for (size_t i = 0; i < kWords; ++i) {
+            words[i] = words_[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence_.load(std::memory_order_relaxed) != sequence) return false;
+        memcpy(value, words.data(), sizeof(T));
+        if (tag != nullptr) *tag = stored_tag;
+        return true;
+    }
+
+private:
+    static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint64_t> sequence_{0};
+    std::atomic<uint64_t> tag_{0};
+    std::array<std::atomic<uint64_t>, kWords> words_{};
+};
+
+}  // namespace android::audio_utils
@@ -49,6 +49,15 @@ typedef struct SNDFILE_ SNDFILE;
 #define SFM_READ    1
 #define SFM_WRITE   2
 
+// Access mode flags
+// SFM_READ | SFM_MMAP maps the file instead of reading it through stdio,
+// which allows sf_readf_mapped().  The file must not be truncated while open.
+// sf_open() fails with SFM_MMAP where mapping is not available, e.g. with MSVC.
+#define SFM_MMAP        4
+// SFM_WRITE | SFM_BUFFERED converts frames directly into a 1 MiB buffer, written when full,
+// which suits writing large files in small blocks.  A write error may be seen late.
+#define SFM_BUFFERED    8
+
 // Format
 #define SF_FORMAT_TYPEMASK  1
 #define SF_FORMAT_WAV       1 // without this bit set, raw data is written
@@ -73,6 +82,18 @@ sf_count_t sf_readf_short(SNDFILE *handle, int16_t *ptr, sf_count_t desired);
 sf_count_t sf_readf_float(SNDFILE *handle, float *ptr, sf_count_t desired);
 sf_count_t sf_readf_int(SNDFILE *handle, int *ptr, sf_count_t desired);
 
+/**
+ * Read interleaved frames without copying, from a file opened with SFM_READ | SFM_MMAP.
+ * The frames are in the file format, see SF_format_to_audio_format(), and are valid
+ * until sf_close().  They are aligned for their sample type only if the data chunk
+ * is aligned in the file, which is not the case for SF_FORMAT_FLOAT files written by
+ * sf_open(); the other sf_readf_*() functions handle this.
+ * \param ptr set to the first frame
+ * \return actual number of frames read, or 0 if the file is not mapped,
+ *         or on a big endian host for samples of more than one byte
+ */
+sf_count_t sf_readf_mapped(SNDFILE *handle, const void **ptr, sf_count_t desired);
+
 /**
  * Write interleaved frames
  * \return actual number of frames written
@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "audio_utils::mutex_watchdog"
+
+#include <audio_utils/mutex_watchdog.h>
+
+#include <audio_utils/clock.h>
+#include <utils/Log.h>
+#include <utils/Timers.h>
+
+namespace android::audio_utils {
+
+namespace {
+
+constexpr uint32_t type_bit(mutex_event_type_t type) {
+    return 1u << static_cast<uint32_t>(type);
+}
+
+// Returns the order of mutex_handle if held by tid, or order_size_ if unknown.
+uint32_t held_order(const std::unordered_map<pid_t,
+                std::weak_ptr<mutex::thread_mutex_info_t>>& registry_map,
+        pid_t tid, void* mutex_handle) {
+    constexpr uint32_t kUnknown = mutex::attributes_t::order_size_;
+    const auto info = mutex::thread_registry_t::tid_to_info(registry_map, tid);
+    if (info == nullptr) return kUnknown;
+    const auto& stack = info->mutexes_held_;
+    const size_t size = std::min(stack.size(), stack.capacity());
+    for (size_t i = 0; i < size; ++i) {
+        const auto& mutex_order_pair = stack.bottom(i);
+        if (mutex_order_pair.first.load() == mutex_handle) {
+            return static_cast<uint32_t>(mutex_order_pair.second.load());
+        }
+    }
+    return kUnknown;
+}
+
+}  // namespace
+
+std::string mutex_event_t::to_string() const {
+    std::string s(audio_utils_time_string_from_ns(time_ns).time);
+    s.append(" ").append(mutex_event_type_to_string(type))
+            .append(" tid: ").append(std::to_string(tid))
+            .append(" wait_ms: ").append(std::to_string(wait_ns / 1'000'000))
+            .append(" mutex: ").append(order < mutex::attributes_t::order_size_
+                    ? mutex::attributes_t::order_names_[order] : "unknown")
+            .append(" holder_tid: ").append(std::to_string(holder_tid));
+    if (type == mutex_event_type_t::priority_inversion) {
+        s.append(" priority: ").append(std::to_string(priority))
+                .append(" holder_priority: ").append(std::to_string(holder_priority));
+    }
+    if (type == mutex_event_type_t::deadlock) {
+        s.append(" cycle: [ ").append(std::to_string(tid));
+        for (size_t i = 0; i < std::min<size_t>(chain_size, kMaxChain); ++i) {
+            s.append(", ").append(std::to_string(chain[i]));
+        }
+        if (chain_size > kMaxChain) s.append(", ...");
+        s.append(" ]");
+    }
+    return s;
+}
+
+mutex_watchdog::mutex_watchdog(options_t options)
+    : options_(std::move(options)) {
+    if (options_.period_ns > 0) {
+        thread_ = std::thread([this]() { threadLoop(); });
+    }
+}
+
+mutex_watchdog::~mutex_watchdog() {
+    {
+        std::lock_guard l(mutex_);
+        quit_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) thread_.join();
+}
+
+void mutex_watchdog::threadLoop() {
+    std::unique_lock l(mutex_);
+    while (!quit_) {
+        cv_.wait_for(l, std::chrono::nanoseconds(options_.period_ns));
+        if (quit_) break;
+        l.unlock();
+        (void)sample();
+        l.lock();
+    }
+}
+
+size_t mutex_watchdog::sample() {
+    auto& registry = mutex::get_registry();
+    const auto registry_map = registry.copy_map();
+    const int64_t now = systemTime();
+    const int64_t realtime = systemTime(SYSTEM_TIME_REALTIME);
+    const int64_t threshold_ns = std::min(options_.long_wait_ns, options_.priority_inversion_ns);
+    size_t events = 0;
+
+    std::unordered_map<pid_t, reported_t> reported;
+    for (const auto& [tid, weak_info] : registry_map) {
+        const auto info = weak_info.lock();
+        if (info == nullptr) continue;
+        void* const mutex_handle = info->mutex_wait_.load();
+        const int64_t wait_time_ns = info->mutex_wait_time_ns_.load();
+        if (mutex_handle == nullptr || wait_time_ns <= 0 || wait_time_ns > now) continue;
+        const int64_t wait_ns = now - wait_time_ns;
+        if (wait_ns < threshold_ns) continue;
+
+        // keep the events already reported for this wait.
+        reported_t report{wait_time_ns, 0};
+        if (const auto it = reported_.find(tid);
+                it != reported_.end() && it->second.wait_time_ns == wait_time_ns) {
+            report = it->second;
+        }
+
+        const auto deadlock_info =
+                registry.deadlock_detection(tid, mutex::attributes_t::order_names_);
+        if (deadlock_info.chain.empty()) {  // holder not found, racing with unlock.
+            reported[tid] = report;
+            continue;
+        }
+
+        mutex_event_t event{};
+        event.tid = tid;
+        event.holder_tid = deadlock_info.chain[0].first;
+        event.order = held_order(registry_map, event.holder_tid, mutex_handle);
+        event.priority = -1;
+        event.holder_priority = -1;
+        event.time_ns = realtime;
+        event.wait_ns = wait_ns;
+        event.chain_size = deadlock_info.chain.size();
+        for (size_t i = 0; i < std::min(deadlock_info.chain.size(), mutex_event_t::kMaxChain);
+                ++i) {
+            event.chain[i] = deadlock_info.chain[i].first;
+        }
+
+        const auto report_event = [&](mutex_event_type_t type) {
+            if (report.types & type_bit(type)) return;
+            report.types |= type_bit(type);
+            event.type = type;
+            log_.push(event);
+            ALOGW("%s", event.to_string().c_str());
+            ++events;
+        };
+
+        // A cycle is reported by its lowest tid.  A tid waiting on a cycle
+        // without being part of it is just a long wait.
+        if (deadlock_info.has_cycle && deadlock_info.chain.back().first == tid) {
+            bool lowest = true;
+            for (const auto& [tid2, name] : deadlock_info.chain) {
+                lowest = lowest && tid <= tid2;
+            }
+            if (lowest) report_event(mutex_event_type_t::deadlock);
+        }
+
+        if (wait_ns >= options_.long_wait_ns) {
+            report_event(mutex_event_type_t::long_wait);
+        }
+
+        if (wait_ns >= options_.priority_inversion_ns
+                && !(report.types & type_bit(mutex_event_type_t::priority_inversion))) {
+            event.priority = options_.get_priority(tid);
+            if (is_realtime_priority(event.priority)) {
+                event.holder_priority = options_.get_priority(event.holder_tid);
+                // lower unified priority values are higher priority.
+                if (event.holder_priority > event.priority) {
+                    report_event(mutex_event_type_t::priority_inversion);
+                }
+            }
+        }
+        reported[tid] = report;
+    }
+    // forget waits which have ended.
+    reported_ = std::move(reported);
+    return events;
+}
+
+std::string mutex_watchdog::to_string(size_t max_events) const {
+    std::string s("mutex_watchdog events: ");
+    s.append(std::to_string(event_count())).append("\n");
+    for (const auto& event : events(max_events)) {
+        s.append(event.to_string()).append("\n");
+    }
+    return s;
+}
+
+}  // namespace android::audio_utils
@@ -20,6 +20,10 @@
 
 #include <audio_utils/power.h>
 
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
 #include <audio_utils/intrinsic_utils.h>
 #include <audio_utils/primitives.h>
 
@@ -127,29 +131,170 @@ inline float energyMonoRef(const void *amplitudes, size_t size)
     return accum;
 }
 
-template <audio_format_t FORMAT>
-inline void energyRef(const void *amplitudes, size_t size, size_t numChannels, float* out)
+template <audio_format_t FORMAT, bool PEAK>
+inline void energyRef(const void *amplitudes, size_t size, size_t numChannels,
+        float* energy, float* peak)
 {
     const size_t framesSize = size / numChannels;
     for (size_t i = 0; i < framesSize; ++i) {
         for (size_t c = 0; c < numChannels; ++c) {
             const float amplitude = convertToFloatAndIncrement<FORMAT>(&amplitudes);
-            out[c] += amplitude * amplitude;
+            energy[c] += amplitude * amplitude;
+            if constexpr (PEAK) peak[c] = std::max(peak[c], std::fabs(amplitude));
         }
     }
 }
 
+// Interleaved float samples are accumulated in kLanes wide vectors, kLanes being
+// a multiple of CHANNELS, so that lane j always holds channel j % CHANNELS.
+// The lanes are folded into the channels once per call.
+template <size_t CHANNELS, bool PEAK>
+void energyFixed(const float *in, size_t frames, float* energy, float* peak)
+{
+    using namespace android::audio_utils::intrinsics;
+
+    // a multiple of 4 for float32x4_t, at least 8 for throughput.
+    constexpr size_t kLanes = std::lcm(CHANNELS, 4) * (std::lcm(CHANNELS, 4) < 8 ? 2 : 1);
+#ifdef USE_NEON
+    using Vector = internal_array_t<float32x4_t, kLanes / 4>;
+#else
+    using Vector = internal_array_t<float, kLanes>;
+#endif
+
+    Vector accum = vdupn<Vector>(0.f);
+    Vector maxAbs = vdupn<Vector>(0.f);
+    const size_t size = frames * CHANNELS;
+    const size_t limit = size - size % kLanes;
+    size_t i;
+    for (i = 0; i < limit; i += kLanes) {
+        const Vector amplitude = vld1<Vector>(in + i);
+        accum = vmla(accum, amplitude, amplitude);
+        if constexpr (PEAK) maxAbs = vmax(maxAbs, vabs(amplitude));
+    }
+
+    float laneEnergy[kLanes];
+    float lanePeak[kLanes];
+    vst1(laneEnergy, accum);
+    vst1(lanePeak, maxAbs);
+    // trailing frames, limit is a multiple of CHANNELS so the lanes still match.
+    for (size_t j = 0; i < size; ++i, ++j) {
+        const float amplitude = in[i];
+        laneEnergy[j] += amplitude * amplitude;
+        if constexpr (PEAK) lanePeak[j] = std::max(lanePeak[j], std::fabs(amplitude));
+    }
+    for (size_t j = 0; j < kLanes; ++j) {
+        energy[j % CHANNELS] += laneEnergy[j];
+        if constexpr (PEAK) peak[j % CHANNELS] = std::max(peak[j % CHANNELS], lanePeak[j]);
+    }
+}
+
+using energy_fixed_func_t = void (*)(const float *, size_t, float*, float*);
+
+// Returns the fixed channel count kernel, or nullptr if there is none.
+template <bool PEAK>
+energy_fixed_func_t getEnergyFixed(size_t numChannels)
+{
+    switch (numChannels) {
+    case 1: return energyFixed<1, PEAK>;
+    case 2: return energyFixed<2, PEAK>;
+    case 3: return energyFixed<3, PEAK>;
+    case 4: return energyFixed<4, PEAK>;
+    case 5: return energyFixed<5, PEAK>;
+    case 6: return energyFixed<6, PEAK>;
+    case 7: return energyFixed<7, PEAK>;
+    case 8: return energyFixed<8, PEAK>;
+    case 10: return energyFixed<10, PEAK>;
+    case 12: return energyFixed<12, PEAK>;
+    case 16: return energyFixed<16, PEAK>;
+    case 24: return energyFixed<24, PEAK>;
+    default: return nullptr;
+    }
+}
+
+// Returns the amplitudes pointer advanced past the converted samples.
+// Indexing the source with its own type lets the compiler vectorize the conversion.
 template <audio_format_t FORMAT>
-inline float energyMono(const void *amplitudes, size_t size)
+inline const void *convertToFloatBlock(const void *amplitudes, float *out, size_t size)
+{
+    switch (FORMAT) {
+    case AUDIO_FORMAT_PCM_8_BIT: {
+        const uint8_t *in = reinterpret_cast<const uint8_t *>(amplitudes);
+        for (size_t i = 0; i < size; ++i) out[i] = float_from_u8(in[i]);
+        return in + size;
+    }
+
+    case AUDIO_FORMAT_PCM_16_BIT: {
+        const int16_t *in = reinterpret_cast<const int16_t *>(amplitudes);
+        for (size_t i = 0; i < size; ++i) out[i] = float_from_i16(in[i]);
+        return in + size;
+    }
+
+    case AUDIO_FORMAT_PCM_24_BIT_PACKED: {
+        const uint8_t *in = reinterpret_cast<const uint8_t *>(amplitudes);
+        for (size_t i = 0; i < size; ++i) out[i] = float_from_p24(in + i * 3);
+        return in + size * 3;
+    }
+
+    case AUDIO_FORMAT_PCM_8_24_BIT: {
+        const int32_t *in = reinterpret_cast<const int32_t *>(amplitudes);
+        for (size_t i = 0; i < size; ++i) out[i] = float_from_q8_23(in[i]);
+        return in + size;
+    }
+
+    case AUDIO_FORMAT_PCM_32_BIT: {
+        const int32_t *in = reinterpret_cast<const int32_t *>(amplitudes);
+        for (size_t i = 0; i < size; ++i) out[i] = float_from_i32(in[i]);
+        return in + size;
+    }
+
+    case AUDIO_FORMAT_PCM_FLOAT: {
+        const float *in = reinterpret_cast<const float *>(amplitudes);
+        std::copy(in, in + size, out);
+        return in + size;
+    }
+
+    default:
+        // static_assert cannot use false because the compiler may interpret it
+        // even though this code path may never be taken.
+        static_assert(isFormatSupported(FORMAT), "unsupported format");
+    }
+}
+
+// Integer formats are converted to float kEnergyBlockSize samples at a time
+// on the stack, float is processed in place.
+constexpr size_t kEnergyBlockSize = 1024;
+
+template <audio_format_t FORMAT, bool PEAK>
+inline void energyAndPeak(const void *amplitudes, size_t size, size_t numChannels,
+        float* energy, float* peak)
 {
-    return energyMonoRef<FORMAT>(amplitudes, size);
+    const auto energyFixedFunc = getEnergyFixed<PEAK>(numChannels);
+    if (energyFixedFunc == nullptr) {
+        energyRef<FORMAT, PEAK>(amplitudes, size, numChannels, energy, peak);
+        return;
+    }
+    size_t frames = size / numChannels;
+    if constexpr (FORMAT == AUDIO_FORMAT_PCM_FLOAT) {
+        energyFixedFunc(reinterpret_cast<const float *>(amplitudes), frames, energy, peak);
+    } else {
+        float block[kEnergyBlockSize];
+        const size_t blockFrames = kEnergyBlockSize / numChannels;
+        while (frames > 0) {
+            const size_t count = std::min(frames, blockFrames);
+            const size_t samples = count * numChannels;
+            amplitudes = convertToFloatBlock<FORMAT>(amplitudes, block, samples);
+            energyFixedFunc(block, count, energy, peak);
+            frames -= count;
+        }
+    }
 }
 
-// TODO: optimize with NEON
 template <audio_format_t FORMAT>
-inline void energy(const void *amplitudes, size_t size, size_t numChannels, float* out)
+inline float energyMono(const void *amplitudes, size_t size)
 {
-    energyRef<FORMAT>(amplitudes, size, numChannels, out);
+    float accum = 0.f;
+    energyAndPeak<FORMAT, false /* PEAK */>(amplitudes, size, 1 /* numChannels */, &accum, nullptr);
+    return accum;
 }
 
 // TODO(b/323611666) in some cases having a large kVectorWidth generic internal array is
@@ -282,27 +427,76 @@ void audio_utils_accumulate_energy(const void* buffer,
 {
     switch (format) {
     case AUDIO_FORMAT_PCM_8_BIT:
-        energy<AUDIO_FORMAT_PCM_8_BIT>(buffer, samples, numChannels, out);
+        energyAndPeak<AUDIO_FORMAT_PCM_8_BIT, false /* PEAK */>(
+                buffer, samples, numChannels, out, nullptr);
+        break;
+
+    case AUDIO_FORMAT_PCM_16_BIT:
+        energyAndPeak<AUDIO_FORMAT_PCM_16_BIT, false /* PEAK */>(
+                buffer, samples, numChannels, out, nullptr);
+        break;
+
+    case AUDIO_FORMAT_PCM_24_BIT_PACKED:
+        energyAndPeak<AUDIO_FORMAT_PCM_24_BIT_PACKED, false /* PEAK */>(
+                buffer, samples, numChannels, out, nullptr);
+        break;
+
+    case AUDIO_FORMAT_PCM_8_24_BIT:
+        energyAndPeak<AUDIO_FORMAT_PCM_8_24_BIT, false /* PEAK */>(
+                buffer, samples, numChannels, out, nullptr);
+        break;
+
+    case AUDIO_FORMAT_PCM_32_BIT:
+        energyAndPeak<AUDIO_FORMAT_PCM_32_BIT, false /* PEAK */>(
+                buffer, samples, numChannels, out, nullptr);
+        break;
+
+    case AUDIO_FORMAT_PCM_FLOAT:
+        energyAndPeak<AUDIO_FORMAT_PCM_FLOAT, false /* PEAK */>(
+                buffer, samples, numChannels, out, nullptr);
+        break;
+
+    default:
+        LOG_ALWAYS_FATAL("invalid format: %#x", format);
+    }
+}
+
+void audio_utils_accumulate_energy_and_peak(const void* buffer,
+                                            audio_format_t format,
+                                            size_t samples,
+                                            size_t numChannels,
+                                            float* energy,
+                                            float* peak)
+{
+    switch (format) {
+    case AUDIO_FORMAT_PCM_8_BIT:
+        energyAndPeak<AUDIO_FORMAT_PCM_8_BIT, true /* PEAK */>(
+                buffer, samples, numChannels, energy, peak);
         break;
 
     case AUDIO_FORMAT_PCM_16_BIT:
-        energy<AUDIO_FORMAT_PCM_16_BIT>(buffer, samples, numChannels, out);
+        energyAndPeak<AUDIO_FORMAT_PCM_16_BIT, true /* PEAK */>(
+                buffer, samples, numChannels, energy, peak);
         break;
 
     case AUDIO_FORMAT_PCM_24_BIT_PACKED:
-        energy<AUDIO_FORMAT_PCM_24_BIT_PACKED>(buffer, samples, numChannels, out);
+        energyAndPeak<AUDIO_FORMAT_PCM_24_BIT_PACKED, true /* PEAK */>(
+                buffer, samples, numChannels, energy, peak);
         break;
 
     case AUDIO_FORMAT_PCM_8_24_BIT:
-        energy<AUDIO_FORMAT_PCM_8_24_BIT>(buffer, samples, numChannels, out);
+        energyAndPeak<AUDIO_FORMAT_PCM_8_24_BIT, true /* PEAK */>(
+                buffer, samples, numChannels, energy, peak);
         break;
 
     case AUDIO_FORMAT_PCM_32_BIT:
-        energy<AUDIO_FORMAT_PCM_32_BIT>(buffer, samples, numChannels, out);
+        energyAndPeak<AUDIO_FORMAT_PCM_32_BIT, true /* PEAK */>(
+                buffer, samples, numChannels, energy, peak);
         break;
 
     case AUDIO_FORMAT_PCM_FLOAT:
-        energy<AUDIO_FORMAT_PCM_FLOAT>(buffer, samples, numChannels, out);
+        energyAndPeak<AUDIO_FORMAT_PCM_FLOAT, true /* PEAK */>(
+                buffer, samples, numChannels, energy, peak);
         break;
 
     default:
@@ -15,6 +15,7 @@
  */
 
 #include <audio_utils/primitives.h>
+#include <errno.h>
 #include <string.h>
 #include "private/private.h"
 
@@ -23,6 +24,14 @@
 #  define __builtin_popcount __popcnt
 #endif
 
+#if defined(__aarch64__) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define USE_NEON
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define USE_SSSE3
+#endif
+
 void ditherAndClamp(int32_t *out, const int32_t *sums, size_t pairs)
 {
     for (; pairs > 0; --pairs) {
@@ -593,6 +602,163 @@ size_t memcpy_by_index_array_initialization_dst_index(int8_t *idxary, size_t idx
     return dst_idx;
 }
 
+int memcpy_by_index_array_plan_initialization(memcpy_by_index_array_plan_t *plan,
+        uint32_t dst_channels, uint32_t src_channels, const int8_t *idxary, size_t sample_size)
+{
+    if (sample_size < 1 || sample_size > 4
+            || dst_channels > MEMCPY_BY_INDEX_ARRAY_PLAN_MAX_CHANNELS
+            || src_channels > MEMCPY_BY_INDEX_ARRAY_PLAN_MAX_CHANNELS) {
+        return -EINVAL;
+    }
+    uint32_t i;
+    for (i = 0; i < dst_channels; ++i) {
+        if (idxary[i] >= (int)src_channels) {
+            return -EINVAL;
+        }
+    }
+    memset(plan, 0, sizeof(*plan));
+    plan->dst_channels = dst_channels;
+    plan->src_channels = src_channels;
+    plan->sample_size = sample_size;
+    memcpy(plan->idxary, idxary, dst_channels);
+
+    plan->copy = dst_channels == src_channels;
+    for (i = 0; i < dst_channels; ++i) {
+        if (idxary[i] != (int)i) {
+            plan->copy = 0;
+        }
+    }
+    const uint32_t dst_frame_bytes = dst_channels * sample_size;
+    const uint32_t src_frame_bytes = src_channels * sample_size;
+    if (plan->copy || dst_frame_bytes == 0) {
+        return 0;
+    }
+
+    /*
+     * Small frames are shuffled in groups of frames fitting in 16 bytes, larger frames
+     * one frame at a time. The destination group is split into runs of samples,
+     * each at most 16 bytes long and with its source samples within a 16 byte window,
+     * which are each done by one 16 byte shuffle.
+     */
+    const uint32_t max_frame_bytes =
+            dst_frame_bytes > src_frame_bytes ? dst_frame_bytes : src_frame_bytes;
+    const uint32_t group_frames = max_frame_bytes <= 16 ? 16 / max_frame_bytes : 1;
+    const uint32_t dst_group_samples = group_frames * dst_channels;
+    uint32_t shuffles = 0;
+    uint32_t sample = 0;
+    while (sample < dst_group_samples) {
+        if (shuffles == MEMCPY_BY_INDEX_ARRAY_PLAN_MAX_SHUFFLES) {
+            return 0;  /* too many shuffles, use the index array */
+        }
+        /* extend the run while it fits in 16 bytes with a 16 byte source window */
+        const uint32_t first = sample;
+        int src_min = -1;
+        int src_max = -1;
+        for (; sample < dst_group_samples && (sample - first + 1) * sample_size <= 16; ++sample) {
+            const int index = idxary[sample % dst_channels];
+            if (index < 0) continue;
+            const int src_byte = sample / dst_channels * src_frame_bytes + index * sample_size;
+            const int new_min = src_min < 0 || src_byte < src_min ? src_byte : src_min;
+            const int new_max = src_byte > src_max ? src_byte : src_max;
+            if (new_max + (int)sample_size - new_min > 16) break;
+            src_min = new_min;
+            src_max = new_max;
+        }
+        if (src_min < 0) {
+            src_min = 0;  /* all zeros */
+        }
+        plan->dst_offset[shuffles] = first * sample_size;
+        plan->src_offset[shuffles] = src_min;
+        memset(plan->shuffle[shuffles], 0x80, 16);  /* zero for pshufb, out of range for tbl */
+        uint32_t run;
+        for (run = first; run < sample; ++run) {
+            const int index = idxary[run % dst_channels];
+            if (index < 0) continue;
+            const int src_byte = run / dst_channels * src_frame_bytes + index * sample_size;
+            uint32_t byte;
+            for (byte = 0; byte < sample_size; ++byte) {
+                plan->shuffle[shuffles][(run - first) * sample_size + byte] =
+                        src_byte + byte - src_min;
+            }
+        }
+        ++shuffles;
+    }
+    plan->group_frames = group_frames;
+    plan->shuffles = shuffles;
+    return 0;
+}
+
+#if defined(USE_NEON) || defined(USE_SSSE3)
+/* Rearranges 16 bytes from src to 16 bytes of dst by the shuffle table. */
+static inline void shuffle16(uint8_t *dst, const uint8_t *src, const uint8_t *shuffle)
+{
+#if defined(__aarch64__)
+    vst1q_u8(dst, vqtbl1q_u8(vld1q_u8(src), vld1q_u8(shuffle)));
+#elif defined(USE_NEON)
+    const uint8x16_t in = vld1q_u8(src);
+    const uint8x8x2_t table = {{ vget_low_u8(in), vget_high_u8(in) }};
+    vst1_u8(dst, vtbl2_u8(table, vld1_u8(shuffle)));
+    vst1_u8(dst + 8, vtbl2_u8(table, vld1_u8(shuffle + 8)));
+#else
+    _mm_storeu_si128((__m128i *)dst, _mm_shuffle_epi8(
+            _mm_loadu_si128((const __m128i *)src), _mm_loadu_si128((const __m128i *)shuffle)));
+#endif
+}
+#endif
+
+void memcpy_by_index_array_with_plan(void *dst, const void *src,
+        const memcpy_by_index_array_plan_t *plan, size_t count)
+{
+    const size_t dst_frame_bytes = plan->dst_channels * plan->sample_size;
+    const size_t src_frame_bytes = plan->src_channels * plan->sample_size;
+    if (plan->copy) {
+        memcpy(dst, src, dst_frame_bytes * count);
+        return;
+    }
+#if defined(USE_NEON) || defined(USE_SSSE3)
+    if (plan->group_frames > 0) {
+        /*
+         * Each shuffle reads and writes 16 bytes, possibly beyond the group.
+         * Writes beyond the group are overwritten by the next group, and
+         * the last groups that would access beyond the buffers are done below.
+         */
+        const size_t src_group_bytes = plan->group_frames * src_frame_bytes;
+        const size_t dst_group_bytes = plan->group_frames * dst_frame_bytes;
+        size_t src_end = 0;
+        uint32_t shuffle;
+        for (shuffle = 0; shuffle < plan->shuffles; ++shuffle) {
+            if (plan->src_offset[shuffle] + 16u > src_end) {
+                src_end = plan->src_offset[shuffle] + 16u;
+            }
+        }
+        const size_t dst_end = plan->dst_offset[plan->shuffles - 1] + 16u;
+        size_t groups = count / plan->group_frames;
+        while (groups > 0 && ((groups - 1) * src_group_bytes + src_end > count * src_frame_bytes
+                || (groups - 1) * dst_group_bytes + dst_end > count * dst_frame_bytes)) {
+            --groups;
+        }
+        uint8_t *udst = (uint8_t *)dst;
+        const uint8_t *usrc = (const uint8_t *)src;
+        size_t group;
+        for (group = 0; group < groups; ++group) {
+            for (shuffle = 0; shuffle < plan->shuffles; ++shuffle) {
+                shuffle16(udst + plan->dst_offset[shuffle], usrc + plan->src_offset[shuffle],
+                        plan->shuffle[shuffle]);
+            }
+            udst += dst_group_bytes;
+            usrc += src_group_bytes;
+        }
+        dst = udst;
+        src = usrc;
+        count -= groups * plan->group_frames;
+    }
+#else
+    (void)src_frame_bytes;
+#endif
+    memcpy_by_index_array(dst, plan->dst_channels, src, plan->src_channels,
+            plan->idxary, plan->sample_size, count);
+}
+
 void accumulate_i16(int16_t *dst, const int16_t *src, size_t count) {
     while (count--) {
         *dst = clamp16((int32_t)*dst + *src++);
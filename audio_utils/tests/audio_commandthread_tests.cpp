@@ -15,6 +15,7 @@
  */
 
 #include <audio_utils/CommandThread.h>
+#include <audio_utils/LockFreeCommandThread.h>
 
 #include <gtest/gtest.h>
 
@@ -76,3 +77,146 @@ TEST(commandthread, full) {
     stage = 6;
     cv.notify_one();
 }
+
+using android::audio_utils::LockFreeCommandThread;
+using android::audio_utils::SmallFunction;
+
+TEST(smallfunction, inline_and_heap) {
+    int count = 0;
+    auto small = [&count] { ++count; };
+    std::array<char, 128> big{};
+    auto large = [&count, big] { count += big.size(); };
+    static_assert(SmallFunction<48>::fitsInline<decltype(small)>());
+    static_assert(!SmallFunction<48>::fitsInline<decltype(large)>());
+
+    SmallFunction<48> f1(small);
+    SmallFunction<48> f2(large);
+    SmallFunction<48> f3(std::move(f2));
+    EXPECT_FALSE(f2);
+    f1();
+    f3();
+    EXPECT_EQ(129, count);
+
+    // destroys the capture exactly once, whether inline or on the heap
+    auto shared = std::make_shared<int>(0);
+    {
+        SmallFunction<48> g1([shared] {});
+        SmallFunction<16> g2([shared, big] {});
+        SmallFunction<48> g3;
+        g3 = std::move(g1);
+        EXPECT_EQ(3, shared.use_count());
+    }
+    EXPECT_EQ(1, shared.use_count());
+}
+
+TEST(lockfreecommandthread, order) {
+    std::mutex m;
+    std::condition_variable cv;
+    std::vector<int> order;
+    {
+        LockFreeCommandThread<> ct;
+        for (int i = 0; i < 10; ++i) {
+            EXPECT_TRUE(ct.add([&, i] {
+                std::lock_guard lg(m);
+                order.push_back(i);
+                cv.notify_one();
+            }));
+        }
+        std::unique_lock ul(m);
+        cv.wait(ul, [&] { return order.size() == 10; });
+    }
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), order);
+}
+
+TEST(lockfreecommandthread, lanes) {
+    std::mutex m;
+    std::condition_variable cv;
+    int stage = 0;
+    std::vector<int> order;
+    LockFreeCommandThread<2 /* Lanes */, 4 /* Capacity */> ct;
+
+    // block the worker thread.
+    EXPECT_TRUE(ct.add([&] {
+        std::unique_lock ul(m);
+        stage = 1;
+        cv.notify_one();
+        cv.wait(ul, [&] { return stage == 2; });
+    }));
+    {
+        std::unique_lock ul(m);
+        cv.wait(ul, [&] { return stage == 1; });
+    }
+
+    auto record = [&](int value) {
+        return [&, value] {
+            std::lock_guard lg(m);
+            order.push_back(value);
+            cv.notify_one();
+        };
+    };
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(ct.add(record(10 + i), 1 /* lane */));
+    }
+    EXPECT_FALSE(ct.add(record(-1), 1 /* lane */));  // lane full
+    EXPECT_FALSE(ct.add(record(-1), 2 /* lane */));  // no such lane
+    EXPECT_TRUE(ct.add(record(0), 0 /* lane */));
+    EXPECT_TRUE(ct.add(record(1), 0 /* lane */));
+    EXPECT_EQ(6, ct.size());
+
+    std::unique_lock ul(m);
+    stage = 2;
+    cv.notify_one();
+    cv.wait(ul, [&] { return order.size() == 6; });
+    EXPECT_EQ((std::vector<int>{0, 1, 10, 11, 12, 13}), order);
+}
+
+TEST(lockfreecommandthread, producers) {
+    constexpr int kProducers = 4;
+    constexpr int kCommands = 10000;
+    std::atomic<int> executed = 0;
+    {
+        LockFreeCommandThread<> ct;
+        std::vector<std::thread> producers;
+        for (int i = 0; i < kProducers; ++i) {
+            producers.emplace_back([&] {
+                for (int j = 0; j < kCommands; ++j) {
+                    while (!ct.add([&] { ++executed; })) {
+                        std::this_thread::yield();  // lane full
+                    }
+                }
+            });
+        }
+        for (auto& producer : producers) producer.join();
+        while (executed != kProducers * kCommands) {
+            std::this_thread::yield();
+        }
+    }
+    EXPECT_EQ(kProducers * kCommands, executed);
+}
+
+TEST(lockfreecommandthread, quit) {
+    std::mutex m;
+    std::condition_variable cv;
+    int stage = 0;
+    auto shared = std::make_shared<int>(0);
+    {
+        LockFreeCommandThread<> ct;
+        EXPECT_TRUE(ct.add([&] {
+            std::unique_lock ul(m);
+            stage = 1;
+            cv.notify_one();
+            cv.wait(ul, [&] { return stage == 2; });
+        }));
+        EXPECT_TRUE(ct.add([shared] { ADD_FAILURE() << "discarded command executed"; }));
+        {
+            std::unique_lock ul(m);
+            cv.wait(ul, [&] { return stage == 1; });
+        }
+        ct.quit();
+        EXPECT_FALSE(ct.add([] {}));
+        std::lock_guard lg(m);
+        stage = 2;
+        cv.notify_one();
+    }
+    EXPECT_EQ(1, shared.use_count());
+}
@@ -18,6 +18,7 @@
 #include <gtest/gtest.h>
 
 #include <thread>
+#include <vector>
 
 using namespace std::chrono_literals;
 
@@ -318,6 +319,168 @@ TEST(audio_mutex_tests, Stack) {
     EXPECT_EQ(0UL, as.true_size());
 }
 
+TEST(audio_mutex_tests, Log2Histogram) {
+    android::audio_utils::log2_histogram<uint64_t, 8> h;
+    EXPECT_EQ(0U, h.count());
+    EXPECT_EQ(0., h.quantile(0.5));
+
+    // 98 values in [64, 128) and one each in [1024...]
+    for (int i = 0; i < 98; ++i) h.add(100);
+    h.add(0);
+    h.add(5000);  // clamps to the last bucket [64, 128) U [128...]
+    EXPECT_EQ(100U, h.count());
+    EXPECT_EQ(5000, h.max());
+    const double p50 = h.quantile(0.5);
+    EXPECT_GE(p50, 64.);
+    EXPECT_LT(p50, 128.);
+    EXPECT_LE(h.quantile(1.), 5000.);
+    EXPECT_EQ(0., h.quantile(0.));
+
+    android::audio_utils::log2_histogram<uint64_t, 40> wide;
+    for (int i = 0; i < 999; ++i) wide.add(1000);           // ~1 us
+    wide.add(3'000'000);                                   // one 3 ms outlier
+    EXPECT_LT(wide.quantile(0.99), 2048.);
+    EXPECT_GE(wide.quantile(0.9995), 2'097'152.);          // 2^21 ns
+    EXPECT_EQ(3'000'000, wide.max());
+}
+
+// The hold time is disabled by default, as it costs two systemTime() calls per lock.
+class HoldTimeAttributes : public audio_utils::AudioMutexAttributes {
+public:
+    static constexpr bool mutex_hold_time_enabled_ = true;
+};
+
+using hold_time_mutex = audio_utils::mutex_impl<HoldTimeAttributes>;
+
+// The statistics and registry of each mutex_impl instantiation, as in mutex.cpp.
+template<>
+hold_time_mutex::stat_array_t& hold_time_mutex::get_mutex_stat_array() {
+    static constinit stat_array_t stat_array{};
+    return stat_array;
+}
+
+template<>
+hold_time_mutex::thread_registry_t& hold_time_mutex::get_registry() {
+    static thread_registry_t thread_registry{};
+    return thread_registry;
+}
+
+TEST(audio_mutex_tests, HoldTimeHistogram) {
+    if constexpr (!audio_utils::AudioMutexAttributes::mutex_tracking_enabled_) {
+        GTEST_SKIP() << "mutex tracking is not enabled";
+    }
+    {
+        audio_utils::mutex m(false /* priority_inheritance */);
+        m.lock();
+        m.unlock();
+        EXPECT_EQ(0u, m.get_stat().hold_histogram.count());
+    }
+
+    hold_time_mutex m(false /* priority_inheritance */,
+            audio_utils::MutexOrder::kMediaLogNotifier_Mutex);
+    const auto& stat = m.get_stat();
+    const uint64_t count = stat.hold_histogram.count();
+    m.lock();
+    std::this_thread::sleep_for(5ms);
+    m.unlock();
+    EXPECT_EQ(count + 1, stat.hold_histogram.count());
+    EXPECT_GE(stat.hold_histogram.max(), 5'000'000);
+
+    const std::string stats = hold_time_mutex::all_stats_to_string();
+    EXPECT_NE(std::string::npos, stats.find("hold_p99_ms: "));
+    EXPECT_NE(std::string::npos, stats.find("wait_p999_ms: "));
+}
+
+TEST(audio_mutex_tests, AdaptiveSpinBudget) {
+    android::audio_utils::mutex::mutex_stat_t stat;
+    EXPECT_EQ(10, stat.spin_budget(100 /* spin_max */, 50'000 /* wait_limit_ns */));
+
+    // the budget follows twice the average spins needed
+    for (int i = 0; i < 100; ++i) stat.add_spin_count(30, true /* acquired */);
+    EXPECT_GT(stat.spin_budget(100, 50'000), 50);
+    EXPECT_LE(stat.spin_budget(100, 50'000), 100);
+    EXPECT_EQ(100U, stat.spins);
+
+    // no spinning if the kernel waits are long
+    ++stat.waits;
+    stat.add_wait_time(1'000'000);
+    EXPECT_EQ(0, stat.spin_budget(100, 50'000));
+}
+
+// Blocks a thread on the locked mutex m until it waits in the kernel, then unlocks m.
+template <typename Mutex>
+static void waitForContendedLock(Mutex& m) NO_THREAD_SAFETY_ANALYSIS {
+    const auto& stat = m.get_stat();
+    const uint64_t waits = stat.waits;
+    m.lock();
+    std::thread t([&] {
+        audio_utils::lock_guard l(m);
+    });
+    while (stat.waits == waits) std::this_thread::sleep_for(1ms);
+    std::this_thread::sleep_for(1ms);  // longer than adaptive_spin_wait_limit_ns_.
+    m.unlock();
+    t.join();
+}
+
+TEST(audio_mutex_tests, AdaptiveSpinContention) {
+    constexpr int kThreads = 4;
+    constexpr int kIterations = 20'000;
+    audio_utils::mutex m(false /* priority_inheritance */,
+            audio_utils::MutexOrder::kMediaLogNotifier_Mutex, true /* adaptive_spin */);
+    EXPECT_EQ(audio_utils::AudioMutexAttributes::mutex_tracking_enabled_, m.adaptive_spin());
+    const auto& stat = m.get_stat();
+    const uint64_t locks = stat.locks;
+    const uint64_t waits = stat.waits;
+    const uint64_t spins = stat.spins;
+    int64_t counter = 0;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&] {
+            for (int j = 0; j < kIterations; ++j) {
+                audio_utils::lock_guard l(m);
+                ++counter;
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    {
+        audio_utils::lock_guard l(m);
+        EXPECT_EQ(kThreads * kIterations, counter);
+    }
+    EXPECT_EQ(locks + kThreads * kIterations + 1, stat.locks);
+    ALOGD("%s: spins:%llu waits:%llu", __func__,
+            (unsigned long long)stat.spins, (unsigned long long)stat.waits);
+    if constexpr (!audio_utils::AudioMutexAttributes::mutex_tracking_enabled_) return;
+
+    // Each contended lock first spins, which raises the average spins needed above zero.
+    if (stat.waits + stat.spins > waits + spins) {
+        EXPECT_GT(stat.spin_average, 0);
+    }
+
+    // The order is not used by other tests, so the statistics start at zero.
+    audio_utils::mutex m2(false /* priority_inheritance */,
+            audio_utils::MutexOrder::kAsyncCallbackThread_Mutex, true /* adaptive_spin */);
+    const auto& stat2 = m2.get_stat();
+    ASSERT_EQ(0u, stat2.waits);
+    EXPECT_EQ(10, stat2.spin_budget(audio_utils::AudioMutexAttributes::adaptive_spin_max_,
+            audio_utils::AudioMutexAttributes::adaptive_spin_wait_limit_ns_));
+
+    // The contended lock spins for the initial budget before it waits in the kernel.
+    waitForContendedLock(m2);
+    EXPECT_EQ(1u, stat2.waits);
+    EXPECT_EQ(0u, stat2.spins);
+    const int32_t spin_average = stat2.spin_average;
+    EXPECT_GT(spin_average, 0);
+
+    // The wait was too long for spinning to help, so the next contended lock does not spin.
+    EXPECT_EQ(0, stat2.spin_budget(audio_utils::AudioMutexAttributes::adaptive_spin_max_,
+            audio_utils::AudioMutexAttributes::adaptive_spin_wait_limit_ns_));
+    waitForContendedLock(m2);
+    EXPECT_EQ(2u, stat2.waits);
+    EXPECT_EQ(0u, stat2.spins);
+    EXPECT_EQ(spin_average, stat2.spin_average);
+}
+
 TEST(audio_mutex_tests, RecursiveLockDetection) {
     constexpr pid_t pid = 0;  // avoid registry shutdown.
     android::audio_utils::thread_mutex_info<int, int, 8 /* stack depth */> tmi(pid);
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "audio_mutex_watchdog_tests"
+
+#include <audio_utils/mutex_watchdog.h>
+#include <gtest/gtest.h>
+#include <utils/Log.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace android;
+using namespace android::audio_utils;
+using namespace std::chrono_literals;
+
+namespace {
+
+// tids beyond the kernel pid_max, so they don't collide with real threads.
+constexpr pid_t kFakeTid = 0x7ff00000;
+
+// A thread_mutex_info in the registry for a fake tid, used to build
+// synthetic wait chains without blocking real threads.
+class fake_thread {
+public:
+    explicit fake_thread(pid_t tid)
+        : info_(std::make_shared<mutex::thread_mutex_info_t>(tid)) {
+        mutex::get_registry().add_to_registry(info_);
+    }
+
+    void hold(void* handle, MutexOrder order = MutexOrder::kOtherMutex) {
+        info_->push_held(handle, order);
+    }
+
+    void wait(void* handle, int64_t wait_ns) {
+        info_->reset_waiter(handle, systemTime() - wait_ns);
+    }
+
+    pid_t tid() const { return info_->tid_; }
+
+private:
+    const std::shared_ptr<mutex::thread_mutex_info_t> info_;  // dtor removes from registry
+};
+
+mutex_watchdog::options_t test_options() {
+    mutex_watchdog::options_t options;
+    options.period_ns = 0;  // call sample() directly
+    options.long_wait_ns = 1'000'000'000;
+    options.priority_inversion_ns = 10'000'000;
+    options.get_priority = [](pid_t) { return -1; };
+    return options;
+}
+
+std::vector<mutex_event_t> events_of_type(
+        const mutex_watchdog& watchdog, mutex_event_type_t type) {
+    std::vector<mutex_event_t> events;
+    for (const auto& event : watchdog.events()) {
+        if (event.type == type) events.push_back(event);
+    }
+    return events;
+}
+
+}  // namespace
+
+TEST(audio_mutex_watchdog_tests, EventLog) {
+    event_log<int64_t, 8> log;
+    EXPECT_TRUE(log.snapshot().empty());
+    for (int64_t i = 0; i < 20; ++i) log.push(i);
+    EXPECT_EQ(20u, log.count());
+
+    const auto all = log.snapshot();
+    ASSERT_EQ(8u, all.size());
+    for (size_t i = 0; i < all.size(); ++i) {
+        EXPECT_EQ(12 + (int64_t)i, all[i]);  // the most recent, oldest first
+    }
+
+    const auto last = log.snapshot(3);
+    ASSERT_EQ(3u, last.size());
+    EXPECT_EQ(17, last[0]);
+    EXPECT_EQ(19, last[2]);
+}
+
+TEST(audio_mutex_watchdog_tests, EventLogConcurrentReaders) {
+    // the fields of each event are derived from the first,
+    // so a torn read would be inconsistent.
+    struct event_t {
+        int64_t value;
+        int64_t values[5];
+    };
+    constexpr int64_t kEvents = 200'000;
+    event_log<event_t, 16> log;
+    std::atomic<bool> done{false};
+    std::atomic<int64_t> inconsistent{0};
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 2; ++i) {
+        readers.emplace_back([&]() {
+            while (!done.load()) {
+                int64_t previous = -1;
+                for (const auto& event : log.snapshot()) {
+                    for (size_t j = 0; j < std::size(event.values); ++j) {
+                        if (event.values[j] != event.value * (int64_t)(j + 2)) ++inconsistent;
+                    }
+                    if (event.value <= previous) ++inconsistent;
+                    previous = event.value;
+                }
+            }
+        });
+    }
+    for (int64_t i = 0; i < kEvents; ++i) {
+        event_t event{i, {}};
+        for (size_t j = 0; j < std::size(event.values); ++j) event.values[j] = i * (j + 2);
+        log.push(event);
+    }
+    done = true;
+    for (auto& reader : readers) reader.join();
+    EXPECT_EQ(0, inconsistent);
+    EXPECT_EQ((uint64_t)kEvents, log.count());
+}
+
+// Three threads each hold a mutex and wait on the next thread's mutex,
+// and a fourth thread waits on the cycle.
+TEST(audio_mutex_watchdog_tests, SyntheticCycle) {
+    int handles[4];
+    fake_thread t0(kFakeTid), t1(kFakeTid + 1), t2(kFakeTid + 2), t3(kFakeTid + 3);
+    t0.hold(&handles[0], MutexOrder::kAudioFlinger_Mutex);
+    t1.hold(&handles[1], MutexOrder::kAudioFlinger_ClientMutex);
+    t2.hold(&handles[2]);
+    t3.hold(&handles[3]);
+    t0.wait(&handles[1], 2'000'000'000);
+    t1.wait(&handles[2], 2'000'000'000);
+    t2.wait(&handles[0], 2'000'000'000);
+    t3.wait(&handles[2], 2'000'000'000);
+
+    mutex_watchdog watchdog(test_options());
+    EXPECT_EQ(5u, watchdog.sample());  // 1 deadlock, 4 long waits
+    EXPECT_EQ(0u, watchdog.sample());  // reported once per wait
+    ALOGD("%s", watchdog.to_string().c_str());
+
+    const auto deadlocks = events_of_type(watchdog, mutex_event_type_t::deadlock);
+    ASSERT_EQ(1u, deadlocks.size());
+    const auto& deadlock = deadlocks[0];
+    EXPECT_EQ(t0.tid(), deadlock.tid);  // the lowest tid of the cycle
+    EXPECT_EQ(t1.tid(), deadlock.holder_tid);
+    EXPECT_EQ(static_cast<uint32_t>(MutexOrder::kAudioFlinger_ClientMutex), deadlock.order);
+    EXPECT_GE(deadlock.wait_ns, 2'000'000'000);
+    ASSERT_EQ(3u, deadlock.chain_size);
+    EXPECT_EQ(t1.tid(), deadlock.chain[0]);
+    EXPECT_EQ(t2.tid(), deadlock.chain[1]);
+    EXPECT_EQ(t0.tid(), deadlock.chain[2]);
+
+    EXPECT_EQ(4u, events_of_type(watchdog, mutex_event_type_t::long_wait).size());
+
+    // a new wait is reported again.
+    t3.wait(nullptr, 0);
+    EXPECT_EQ(0u, watchdog.sample());
+    t3.wait(&handles[2], 2'000'000'000);
+    EXPECT_EQ(1u, watchdog.sample());
+}
+
+TEST(audio_mutex_watchdog_tests, SyntheticPriorityInversion) {
+    int handles[2];
+    fake_thread holder(kFakeTid + 10), waiter(kFakeTid + 11), short_waiter(kFakeTid + 12);
+    holder.hold(&handles[0]);
+    holder.hold(&handles[1], MutexOrder::kMediaLogNotifier_Mutex);
+    waiter.wait(&handles[1], 20'000'000);
+    short_waiter.wait(&handles[0], 1'000'000);  // below threshold
+
+    auto options = test_options();
+    options.get_priority = [&](pid_t tid) {
+        if (tid == waiter.tid() || tid == short_waiter.tid()) {
+            return rtprio_to_unified_priority(2);
+        }
+        return nice_to_unified_priority(-19);
+    };
+    mutex_watchdog watchdog(options);
+    EXPECT_EQ(1u, watchdog.sample());
+    EXPECT_EQ(0u, watchdog.sample());
+
+    const auto inversions = events_of_type(watchdog, mutex_event_type_t::priority_inversion);
+    ASSERT_EQ(1u, inversions.size());
+    const auto& inversion = inversions[0];
+    EXPECT_EQ(waiter.tid(), inversion.tid);
+    EXPECT_EQ(holder.tid(), inversion.holder_tid);
+    EXPECT_EQ(static_cast<uint32_t>(MutexOrder::kMediaLogNotifier_Mutex), inversion.order);
+    EXPECT_EQ(rtprio_to_unified_priority(2), inversion.priority);
+    EXPECT_EQ(nice_to_unified_priority(-19), inversion.holder_priority);
+
+    // no inversion if the holder has a higher priority.
+    options.get_priority = [&](pid_t tid) {
+        return rtprio_to_unified_priority(tid == holder.tid() ? 3 : 2);
+    };
+    mutex_watchdog watchdog2(options);
+    EXPECT_EQ(0u, watchdog2.sample());
+}
+
+// A real thread blocked on an audio_utils::mutex, detected by the watchdog thread.
+TEST(audio_mutex_watchdog_tests, LongWait) {
+    if (!mutex::attributes_t::mutex_tracking_enabled_) {
+        GTEST_SKIP() << "mutex tracking disabled";
+    }
+    auto options = test_options();
+    options.period_ns = 5'000'000;
+    options.long_wait_ns = 20'000'000;
+    mutex_watchdog watchdog(options);
+
+    mutex m;
+    std::atomic<pid_t> waiter_tid{};
+    const pid_t holder_tid = gettid_wrapper();
+    unique_lock ul(m);
+    std::thread waiter([&]() {
+        waiter_tid = gettid_wrapper();
+        lock_guard l(m);
+    });
+    for (int i = 0; i < 400 && watchdog.event_count() == 0; ++i) {
+        std::this_thread::sleep_for(5ms);
+    }
+    ul.unlock();
+    waiter.join();
+
+    const auto waits = events_of_type(watchdog, mutex_event_type_t::long_wait);
+    ASSERT_EQ(1u, waits.size());
+    EXPECT_EQ(waiter_tid, waits[0].tid);
+    EXPECT_EQ(holder_tid, waits[0].holder_tid);
+    EXPECT_GE(waits[0].wait_ns, options.long_wait_ns);
+}
@@ -44,10 +44,18 @@ echo "format tests"
 adb push $OUT/data/nativetest/format_tests/format_tests /system/bin
 adb shell /system/bin/format_tests
 
+echo "histogram tests"
+adb push $OUT/data/nativetest/histogram_tests/histogram_tests /system/bin
+adb shell /system/bin/histogram_tests
+
 echo "simplelog tests"
 adb push $OUT/data/nativetest/simplelog_tests/simplelog_tests /system/bin
 adb shell /system/bin/simplelog_tests
 
+echo "sndfile tests"
+adb push $OUT/data/nativetest/sndfile_tests/sndfile_tests /system/bin
+adb shell /system/bin/sndfile_tests
+
 echo "statistics tests"
 adb push $OUT/data/nativetest/statistics_tests/statistics_tests /system/bin
 adb shell /system/bin/statistics_tests
@@ -14,6 +14,9 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <random>
+
 #include <audio_utils/ChannelMix.h>
 #include <audio_utils/Statistics.h>
 #include <gtest/gtest.h>
@@ -25,8 +28,13 @@ static constexpr audio_channel_mask_t kOutputChannelMasks[] = {
     AUDIO_CHANNEL_OUT_7POINT1,
     AUDIO_CHANNEL_OUT_7POINT1POINT4,
     AUDIO_CHANNEL_OUT_9POINT1POINT6,
+    AUDIO_CHANNEL_OUT_5POINT1POINT2,  // RuntimeChannelMix
+    AUDIO_CHANNEL_OUT_22POINT2,       // RuntimeChannelMix
 };
 
+// Output channel masks supported by the compile-time ChannelMix.
+static constexpr size_t kTemplateOutputChannelMasks = 5;
+
 static constexpr audio_channel_mask_t kInputChannelMasks[] = {
     AUDIO_CHANNEL_OUT_FRONT_LEFT, // Legacy: the ChannelMix effect treats MONO as FRONT_LEFT only.
                                   // The AudioMixer interprets MONO as a special case requiring
@@ -434,3 +442,105 @@ TEST(channelmix, input_channel_mask) {
     ASSERT_TRUE(channelMix.setInputChannelMask(AUDIO_CHANNEL_OUT_STEREO));
     ASSERT_EQ(AUDIO_CHANNEL_OUT_STEREO, channelMix.getInputChannelMask());
 }
+
+// --------------------------------------------------------------------------------------
+
+using RuntimeChannelMixParam = std::tuple<int /* output channel mask */,
+        int /* input channel mask */,
+        bool /* accumulate */>;
+
+class RuntimeChannelMixTest : public ::testing::TestWithParam<RuntimeChannelMixParam> {
+};
+
+// The RuntimeChannelMix must produce the same output as the compile-time ChannelMix.
+TEST_P(RuntimeChannelMixTest, matches_template) {
+    using namespace ::android::audio_utils::channels;
+    const audio_channel_mask_t outputChannelMask =
+            kOutputChannelMasks[std::get<OUTPUT_CHANNEL_MASK_POSITION>(GetParam())];
+    const audio_channel_mask_t inputChannelMask =
+            kInputChannelMasks[std::get<INPUT_CHANNEL_MASK_POSITION>(GetParam())];
+    const bool accumulate = std::get<ACCUMULATE_POSITION>(GetParam());
+
+    constexpr size_t frames = 301;  // not a multiple of the internal block size.
+    const size_t inChannels = audio_channel_count_from_out_mask(inputChannelMask);
+    const size_t outChannels = audio_channel_count_from_out_mask(outputChannelMask);
+    std::vector<float> input(frames * inChannels);
+    std::minstd_rand gen(42);
+    std::uniform_real_distribution<float> dis(-0.5f, 0.5f);
+    for (auto& v : input) v = dis(gen);
+    std::vector<float> expected(frames * outChannels, 0.25f);
+    std::vector<float> output(frames * outChannels, 0.25f);
+
+    auto reference = IChannelMix::create(outputChannelMask);
+    RuntimeChannelMix runtime(outputChannelMask);
+    ASSERT_TRUE(reference->process(
+            input.data(), expected.data(), frames, accumulate, inputChannelMask));
+    ASSERT_TRUE(runtime.process(
+            input.data(), output.data(), frames, accumulate, inputChannelMask));
+    ASSERT_EQ(inputChannelMask, runtime.getInputChannelMask());
+    for (size_t i = 0; i < output.size(); ++i) {
+        EXPECT_NEAR(expected[i], output[i], 1e-6f) << "index " << i;
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+        RuntimeChannelMixTestAll, RuntimeChannelMixTest,
+        ::testing::Combine(
+                ::testing::Range(0, (int)kTemplateOutputChannelMasks),
+                ::testing::Range(0, (int)std::size(kInputChannelMasks)),
+                ::testing::Bool() // accumulate off, on
+                ));
+
+TEST(channelmix, runtime_supported_masks) {
+    using namespace ::android::audio_utils::channels;
+    EXPECT_TRUE(IChannelMix::isOutputChannelMaskSupported(AUDIO_CHANNEL_OUT_5POINT1POINT2));
+    EXPECT_TRUE(IChannelMix::isOutputChannelMaskSupported(AUDIO_CHANNEL_OUT_22POINT2));
+    EXPECT_TRUE(IChannelMix::isOutputChannelMaskSupported(AUDIO_CHANNEL_INDEX_MASK_8));
+    EXPECT_FALSE(IChannelMix::isOutputChannelMaskSupported(AUDIO_CHANNEL_NONE));
+    EXPECT_FALSE(IChannelMix::isOutputChannelMaskSupported(
+            audio_channel_mask_t(1u << FCC_26)));  // unknown position.
+    EXPECT_NE(nullptr, IChannelMix::create(AUDIO_CHANNEL_OUT_5POINT1POINT2));
+    EXPECT_EQ(nullptr, IChannelMix::create(AUDIO_CHANNEL_NONE));
+
+    RuntimeChannelMix channelMix(AUDIO_CHANNEL_OUT_STEREO);
+    EXPECT_EQ(AUDIO_CHANNEL_NONE, channelMix.getInputChannelMask());
+    EXPECT_FALSE(channelMix.setInputChannelMask(AUDIO_CHANNEL_NONE));
+    float sample = 0.f;
+    EXPECT_FALSE(channelMix.process(&sample, &sample, 1, false /* accumulate */));
+}
+
+TEST(channelmix, runtime_matrix_cache) {
+    using namespace ::android::audio_utils::channels;
+    const auto matrix = getSparseChannelMatrix(
+            AUDIO_CHANNEL_OUT_22POINT2, AUDIO_CHANNEL_OUT_5POINT1POINT2);
+    ASSERT_NE(nullptr, matrix);
+    EXPECT_EQ(matrix, getSparseChannelMatrix(
+            AUDIO_CHANNEL_OUT_22POINT2, AUDIO_CHANNEL_OUT_5POINT1POINT2));
+    EXPECT_EQ(24u, matrix->inputChannelCount);
+    EXPECT_EQ(8u, matrix->outputChannelCount);
+    EXPECT_EQ(matrix->outputChannelCount + 1, matrix->offsets.size());
+    // Every input channel contributes to the output.
+    std::vector<bool> used(matrix->inputChannelCount);
+    for (const auto i : matrix->inputChannel) used[i] = true;
+    EXPECT_EQ(used.end(), std::find(used.begin(), used.end(), false));
+}
+
+TEST(channelmix, runtime_index_mask) {
+    using namespace ::android::audio_utils::channels;
+    RuntimeChannelMix channelMix(AUDIO_CHANNEL_INDEX_MASK_4);
+    constexpr size_t frames = 3;
+    const std::vector<float> input{
+        0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f,
+        -0.1f, -0.2f, -0.3f, -0.4f, -0.5f, -0.6f,
+        0.7f, 0.8f, 0.9f, 1.f, 1.1f, 1.2f,
+    };
+    std::vector<float> output(frames * 4);
+    ASSERT_TRUE(channelMix.process(input.data(), output.data(), frames,
+            false /* accumulate */, AUDIO_CHANNEL_INDEX_MASK_6));
+    const std::vector<float> expected{
+        0.1f, 0.2f, 0.3f, 0.4f,
+        -0.1f, -0.2f, -0.3f, -0.4f,
+        0.7f, 0.8f, 0.9f, 1.f,
+    };
+    EXPECT_EQ(expected, output);
+}
@@ -14,7 +14,9 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <math.h>
+#include <utility>
 #include <vector>
 
 #include <gtest/gtest.h>
@@ -251,3 +253,110 @@ TEST(audio_utils_channels, adjust_channels_non_destructive) {
     // Comparison array must be identical to reference.
     expectEq(u16inout, u16ref);
 }
+
+// Reference adjust_channels() one frame at a time, for the fixed channel count kernels.
+template<typename T>
+std::vector<T> referenceAdjustChannels(const std::vector<T>& in, size_t inChannels,
+        size_t outChannels, bool selected, const std::vector<T>& previous) {
+    const size_t frames = in.size() / inChannels;
+    std::vector<T> out = previous;
+    out.resize(frames * outChannels);
+    for (size_t i = 0; i < frames; ++i) {
+        const T* src = &in[i * inChannels];
+        T* dst = &out[i * outChannels];
+        if (outChannels < inChannels) {
+            if (outChannels == 1) {
+                const int32_t temp0 = src[0];
+                const int32_t temp1 = src[1];
+                dst[0] = (temp0 & temp1) + ((temp0 ^ temp1) >> 1);
+            } else {
+                std::copy(src, src + outChannels, dst);
+            }
+        } else if (selected) {
+            std::copy(src, src + inChannels, dst);
+        } else if (inChannels == 1) {
+            dst[0] = dst[1] = src[0];
+            std::fill(dst + 2, dst + outChannels, 0);
+        } else {
+            std::copy(src, src + inChannels, dst);
+            std::fill(dst + inChannels, dst + outChannels, 0);
+        }
+    }
+    return out;
+}
+
+template<typename T>
+void testAdjustChannels(size_t inChannels, size_t outChannels, size_t frames) {
+    SCOPED_TRACE(::testing::Message() << "sample size " << sizeof(T) << " in " << inChannels
+            << " out " << outChannels << " frames " << frames);
+    const size_t maxChannels = std::max(inChannels, outChannels);
+    std::vector<T> in(frames * inChannels);
+    for (size_t i = 0; i < in.size(); ++i) {
+        in[i] = (T)(i * 0x9E3779B1u);  // fill all the bits, including negative values.
+    }
+    std::vector<T> previous(frames * outChannels);
+    for (size_t i = 0; i < previous.size(); ++i) {
+        previous[i] = (T)~i;
+    }
+    const size_t numInBytes = in.size() * sizeof(T);
+
+    for (bool selected : { false, true }) {
+        const auto adjust = selected ? adjust_selected_channels : adjust_channels;
+        const auto expected = referenceAdjustChannels(in, inChannels, outChannels,
+                selected, previous);
+
+        std::vector<T> out = previous;
+        EXPECT_EQ(expected.size() * sizeof(T), adjust(in.data(), inChannels,
+                out.data(), outChannels, sizeof(T), numInBytes));
+        out.resize(expected.size());
+        expectEq(out, expected);
+
+        // In place.
+        std::vector<T> inout(frames * maxChannels);
+        std::copy(previous.begin(), previous.end(), inout.begin());
+        std::copy(in.begin(), in.end(), inout.begin());
+        EXPECT_EQ(expected.size() * sizeof(T), adjust(inout.data(), inChannels,
+                inout.data(), outChannels, sizeof(T), numInBytes));
+        if (selected && outChannels > inChannels) {
+            // Channels not selected were overwritten by the input, compare only those selected.
+            for (size_t i = 0; i < frames; ++i) {
+                for (size_t c = 0; c < inChannels; ++c) {
+                    ASSERT_EQ(expected[i * outChannels + c], inout[i * outChannels + c]);
+                }
+            }
+        } else {
+            inout.resize(expected.size());
+            expectEq(inout, expected);
+        }
+    }
+
+    // Non destructive round trip, first not in place, then in place.
+    std::vector<T> buffer(frames * maxChannels);
+    std::copy(in.begin(), in.end(), buffer.begin());
+    if (outChannels > inChannels) {
+        // Place the extra channels at the end of the input, as from a contraction.
+        std::copy(previous.begin(), previous.begin() + frames * (outChannels - inChannels),
+                buffer.begin() + in.size());
+    }
+    std::vector<T> out(buffer.size());
+    EXPECT_EQ(frames * outChannels * sizeof(T), adjust_channels_non_destructive(
+            buffer.data(), inChannels, out.data(), outChannels, sizeof(T), numInBytes));
+    EXPECT_EQ(numInBytes, adjust_channels_non_destructive(out.data(), outChannels,
+            out.data(), inChannels, sizeof(T), frames * outChannels * sizeof(T)));
+    expectEq(out, buffer);
+}
+
+TEST(audio_utils_channels, adjust_channels_fixed) {
+    // Channel pairs with fixed channel count kernels, and some without for comparison.
+    constexpr std::pair<size_t, size_t> kChannelPairs[] = {
+        {1, 2}, {2, 4}, {2, 6}, {2, 8}, {2, 1}, {4, 2}, {6, 2}, {8, 2},
+        {1, 4}, {3, 5}, {5, 3}, {4, 1},
+    };
+    for (const auto& [inChannels, outChannels] : kChannelPairs) {
+        for (size_t frames : { 1, 31, 32, 33, 1000 }) {
+            testAdjustChannels<int16_t>(inChannels, outChannels, frames);
+            testAdjustChannels<int32_t>(inChannels, outChannels, frames);
+            testAdjustChannels<uint8_t>(inChannels, outChannels, frames);
+        }
+    }
+}
@@ -18,9 +18,12 @@
 #define LOG_TAG "audio_utils_errorlog_tests"
 
 #include <audio_utils/ErrorLog.h>
+#include <audio_utils/LockFreeLog.h>
 #include <gtest/gtest.h>
+#include <atomic>
 #include <iostream>
 #include <log/log.h>
+#include <thread>
 
 using namespace android;
 
@@ -85,6 +88,78 @@ Errors: 4
      */
 }
 
+// The same sequence as basic, with the same dumps.
+TEST(audio_utils_errorlog, lock_free) {
+    LockFreeErrorLog<int32_t> elog;
+    const int64_t oneSecond = 1000000000;
+    auto writer = elog.createWriter();
+    ASSERT_NE(nullptr, writer);
+
+    EXPECT_EQ((size_t)1, countNewLines(elog.dumpToString()));
+
+    writer->log(1 /* code */, 0 /* nowNs */);
+    writer->log(2 /* code */, 1 /* nowNs */);
+    EXPECT_EQ((size_t)4, countNewLines(elog.dumpToString()));
+    writer->log(2 /* code */, oneSecond /* nowNs */);
+    EXPECT_EQ((size_t)4, countNewLines(elog.dumpToString()));
+    writer->log(2 /* code */, oneSecond * 2 /* nowNs */);
+    EXPECT_EQ((size_t)5, countNewLines(elog.dumpToString()));
+
+    EXPECT_EQ((size_t)3, countNewLines(elog.dumpToString("" /* prefix */, 3 /* lines */)));
+    EXPECT_EQ((size_t)4, countNewLines(
+            elog.dumpToString("" /* prefix */, 0 /* lines */, oneSecond /* limitNs */)));
+    EXPECT_EQ((size_t)3, countNewLines(
+            elog.dumpToString("" /* prefix */, 0 /* lines */, oneSecond + 1 /* limitNs */)));
+    EXPECT_EQ((size_t)1, countNewLines(
+            elog.dumpToString("" /* prefix */, 0 /* lines */, oneSecond * 2 + 1/* limitNs */)));
+
+    ErrorLog<int32_t> reference(100 /* lines */);
+    reference.log(1 /* code */, 0 /* nowNs */);
+    reference.log(2 /* code */, 1 /* nowNs */);
+    reference.log(2 /* code */, oneSecond /* nowNs */);
+    reference.log(2 /* code */, oneSecond * 2 /* nowNs */);
+    EXPECT_EQ(reference.dumpToString(), elog.dumpToString());
+
+    // a second writer is merged by time.
+    auto writer2 = elog.createWriter();
+    ASSERT_NE(nullptr, writer2);
+    EXPECT_NE(writer, writer2);
+    writer2->log(3 /* code */, oneSecond + 5 /* nowNs */);
+    const std::string s = elog.dumpToString();
+    EXPECT_EQ((size_t)6, countNewLines(s));
+    EXPECT_NE(std::string::npos, s.find("Errors: 5"));
+    EXPECT_LT(s.find("\n    3 "), s.rfind("\n    2 "));
+
+    // all writers in use
+    for (size_t i = 2; i < 4; ++i) EXPECT_NE(nullptr, elog.createWriter());
+    EXPECT_EQ(nullptr, elog.createWriter());
+    elog.releaseWriter(writer2);
+    EXPECT_EQ(writer2, elog.createWriter());
+}
+
+TEST(audio_utils_errorlog, lock_free_concurrent) {
+    LockFreeErrorLog<int32_t, 2 /* Writers */, 16 /* Capacity */> elog(10 /* aggregateNs */);
+    constexpr int64_t kErrors = 100000;
+    std::atomic<bool> done{false};
+    std::thread reader([&]() {
+        while (!done) {
+            const std::string s = elog.dumpToString();
+            EXPECT_GE((size_t)2 + 2 * 16, countNewLines(s));
+        }
+    });
+    std::vector<std::thread> writers;
+    for (int i = 0; i < 2; ++i) {
+        writers.emplace_back([&elog]() {
+            auto writer = elog.createWriter();
+            for (int64_t j = 0; j < kErrors; ++j) writer->log(j / 3 % 5 /* code */, j /* nowNs */);
+        });
+    }
+    for (auto& writer : writers) writer.join();
+    done = true;
+    reader.join();
+    EXPECT_NE(std::string::npos, elog.dumpToString().find("Errors: 200000"));
+}
+
 TEST(audio_utils_errorlog, c) {
     error_log_t *error_log =
             error_log_create(100 /* lines */, 1000000000 /* one second aggregation */);
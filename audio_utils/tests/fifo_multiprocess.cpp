@@ -16,6 +16,7 @@
 
 #include <errno.h>
 #include <stdio.h>
+#include <string.h>
 #include <string>
 #include <sys/mman.h>
 #include <sys/types.h>
@@ -25,14 +26,222 @@
 #include <new>
 
 #include <audio_utils/fifo.h>
+#include <audio_utils/fifo_shared.h>
 #include <cutils/ashmem.h>
 
 #define FRAME_COUNT 2048
 #define FRAME_SIZE sizeof(int16_t)
 #define BUFFER_SIZE (FRAME_COUNT * FRAME_SIZE)
 
-int main(int argc __attribute__((unused)), char **argv __attribute__((unused)))
+#define MULTI_READERS 2
+#define MULTI_FRAME_COUNT 4     // small, so that the slow reader throttles the writer
+
+// Fan-out of one writer process to several reader processes that all throttle the writer,
+// with 64-bit indices.  The rear index and the reader slots share one region.
+static int multi_reader_main()
+{
+    const size_t indexSize = sizeof(audio_utils_fifo_index64) * (1 + MULTI_READERS);
+    const int indexFd = ashmem_create_region("indices", indexSize);
+    const int dataFd = ashmem_create_region("buffer", BUFFER_SIZE);
+    if (indexFd < 0 || dataFd < 0) {
+        printf("ashmem_create_region failed\n");
+        return EXIT_FAILURE;
+    }
+
+    audio_utils_fifo_index64 *indices = (audio_utils_fifo_index64 *) mmap(NULL, indexSize,
+            PROT_READ | PROT_WRITE, MAP_SHARED, indexFd, (off_t) 0);
+    int16_t *data = (int16_t *) mmap(NULL, BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+            dataFd, (off_t) 0);
+    if (indices == MAP_FAILED || data == MAP_FAILED) {
+        printf("mmap failed\n");
+        return EXIT_FAILURE;
+    }
+
+    // index constructors must execute exactly once, so we do it in the parent
+    audio_utils_fifo_index64 *rearIndex = new(&indices[0]) audio_utils_fifo_index64();
+    audio_utils_fifo_index64 *frontIndices = &indices[1];
+    for (int i = 0; i < MULTI_READERS; i++) {
+        (void) new(&frontIndices[i])
+                audio_utils_fifo_index64(audio_utils_fifo_index64::kUnregistered);
+    }
+
+    // Readers register before the writer starts, so that they see all the data.
+    pid_t pidReaders[MULTI_READERS];
+    for (int i = 0; i < MULTI_READERS; i++) {
+        printf("fork reader %d:\n", i);
+        pidReaders[i] = fork();
+        if (!pidReaders[i]) {
+            audio_utils_fifo fifo(MULTI_FRAME_COUNT, FRAME_SIZE, data, *rearIndex, frontIndices,
+                    MULTI_READERS);
+            audio_utils_fifo_reader reader(fifo, true /*throttlesWriter*/);
+            int16_t expected = 1;
+            while (expected <= 20) {
+                int16_t value;
+                struct timespec timeout = {
+                    .tv_sec = 5,
+                    .tv_nsec = 0
+                };
+                const ssize_t actual = reader.read(&value, 1, &timeout);
+                if (actual != 1) {
+                    printf("reader %d read unexpected actual = %zd\n", i, actual);
+                    return EXIT_FAILURE;
+                }
+                if (value != expected) {
+                    printf("reader %d read %d, expected %d\n", i, value, expected);
+                    return EXIT_FAILURE;
+                }
+                printf("reader %d read %d\n", i, value);
+                expected++;
+                // the last reader is slow, and throttles the writer
+                if (i == MULTI_READERS - 1) {
+                    usleep(100000);
+                }
+            }
+            return EXIT_SUCCESS;
+        }
+    }
+    sleep(1);
+
+    printf("fork writer:\n");
+    const pid_t pidWriter = fork();
+    if (!pidWriter) {
+        audio_utils_fifo fifo(MULTI_FRAME_COUNT, FRAME_SIZE, data, *rearIndex, frontIndices,
+                MULTI_READERS);
+        audio_utils_fifo_writer writer(fifo);
+        for (int16_t value = 1; value <= 20; value++) {
+            struct timespec timeout = {
+                .tv_sec = 5,
+                .tv_nsec = 0
+            };
+            const ssize_t actual = writer.write(&value, 1, &timeout);
+            if (actual != 1) {
+                printf("wrote unexpected actual = %zd\n", actual);
+                return EXIT_FAILURE;
+            }
+        }
+        return EXIT_SUCCESS;
+    }
+
+    int ret = EXIT_SUCCESS;
+    int status;
+    if (waitpid(pidWriter, &status, 0) != pidWriter || status != 0) {
+        printf("writer failed with status %d\n", status);
+        ret = EXIT_FAILURE;
+    }
+    for (int i = 0; i < MULTI_READERS; i++) {
+        if (waitpid(pidReaders[i], &status, 0) != pidReaders[i] || status != 0) {
+            printf("reader %d failed with status %d\n", i, status);
+            ret = EXIT_FAILURE;
+        }
+    }
+    printf("multi reader test %s\n", ret == EXIT_SUCCESS ? "passed" : "failed");
+
+    (void) munmap(indices, indexSize);
+    (void) munmap(data, BUFFER_SIZE);
+    (void) close(indexFd);
+    (void) close(dataFd);
+    return ret;
+}
+
+// Same as multi_reader_main(), but the region is made by audio_utils_fifo_shared,
+// and each child maps it from the fd, as a process which did not fork would.
+static int shared_main()
+{
+    std::unique_ptr<audio_utils_fifo_shared> shared =
+            audio_utils_fifo_shared::create(MULTI_FRAME_COUNT, FRAME_SIZE, MULTI_READERS);
+    if (shared == nullptr) {
+        printf("audio_utils_fifo_shared::create failed\n");
+        return EXIT_FAILURE;
+    }
+    printf("region fd=%d size=%zu\n", shared->fd(), shared->size());
+    if (audio_utils_fifo_shared::map(-1) != nullptr) {
+        printf("map of an invalid fd succeeded\n");
+        return EXIT_FAILURE;
+    }
+
+    pid_t pidReaders[MULTI_READERS];
+    for (int i = 0; i < MULTI_READERS; i++) {
+        printf("fork reader %d:\n", i);
+        pidReaders[i] = fork();
+        if (!pidReaders[i]) {
+            std::unique_ptr<audio_utils_fifo_shared> mapped =
+                    audio_utils_fifo_shared::map(shared->fd());
+            if (mapped == nullptr) {
+                printf("reader %d map failed\n", i);
+                return EXIT_FAILURE;
+            }
+            audio_utils_fifo_reader reader(mapped->fifo(), true /*throttlesWriter*/);
+            for (int16_t expected = 1; expected <= 20; expected++) {
+                int16_t value;
+                struct timespec timeout = {
+                    .tv_sec = 5,
+                    .tv_nsec = 0
+                };
+                const ssize_t actual = reader.read(&value, 1, &timeout);
+                if (actual != 1 || value != expected) {
+                    printf("reader %d read actual = %zd value %d, expected %d\n",
+                            i, actual, value, expected);
+                    return EXIT_FAILURE;
+                }
+                if (i == MULTI_READERS - 1) {
+                    usleep(100000);
+                }
+            }
+            printf("reader %d done\n", i);
+            return EXIT_SUCCESS;
+        }
+    }
+    sleep(1);
+
+    printf("fork writer:\n");
+    const pid_t pidWriter = fork();
+    if (!pidWriter) {
+        std::unique_ptr<audio_utils_fifo_shared> mapped =
+                audio_utils_fifo_shared::map(shared->fd());
+        if (mapped == nullptr) {
+            printf("writer map failed\n");
+            return EXIT_FAILURE;
+        }
+        audio_utils_fifo_writer writer(mapped->fifo());
+        for (int16_t value = 1; value <= 20; value++) {
+            struct timespec timeout = {
+                .tv_sec = 5,
+                .tv_nsec = 0
+            };
+            const ssize_t actual = writer.write(&value, 1, &timeout);
+            if (actual != 1) {
+                printf("wrote unexpected actual = %zd\n", actual);
+                return EXIT_FAILURE;
+            }
+        }
+        return EXIT_SUCCESS;
+    }
+
+    int ret = EXIT_SUCCESS;
+    int status;
+    if (waitpid(pidWriter, &status, 0) != pidWriter || status != 0) {
+        printf("writer failed with status %d\n", status);
+        ret = EXIT_FAILURE;
+    }
+    for (int i = 0; i < MULTI_READERS; i++) {
+        if (waitpid(pidReaders[i], &status, 0) != pidReaders[i] || status != 0) {
+            printf("reader %d failed with status %d\n", i, status);
+            ret = EXIT_FAILURE;
+        }
+    }
+    printf("shared test %s\n", ret == EXIT_SUCCESS ? "passed" : "failed");
+    return ret;
+}
+
+int main(int argc, char **argv)
 {
+    if (argc > 1 && !strcmp(argv[1], "-m")) {
+        return multi_reader_main();
+    }
+    if (argc > 1 && !strcmp(argv[1], "-s")) {
+        return shared_main();
+    }
+
     // TODO Add error checking for ashmem_create_region and mmap
 
     const int frontFd = ashmem_create_region("front", sizeof(audio_utils_fifo_index));
@@ -17,6 +17,7 @@
 #include <errno.h>
 #include <pthread.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 #include <audio_utils/fifo.h>
 
@@ -95,8 +96,117 @@ void *output_routine(void *arg)
     return NULL;
 }
 
+// Fan-out of one writer to several readers that all throttle the writer, with 64-bit indices.
+
+#define MULTI_READERS 3
+#define MULTI_FRAMES 1000000
+
+struct MultiContext {
+    audio_utils_fifo_reader *mReader;
+    int mReaderIndex;
+    bool mFailed;
+};
+
+void *multi_reader_routine(void *arg)
+{
+    MultiContext *context = (MultiContext *) arg;
+    int32_t expected = 0;
+    while (expected < MULTI_FRAMES) {
+        struct timespec timeout;
+        timeout.tv_sec = 5;
+        timeout.tv_nsec = 0;
+        int32_t buffer[64];
+        // readers use different read sizes, and the last one is slow
+        ssize_t actual = context->mReader->read(buffer, 16 + context->mReaderIndex * 16, &timeout);
+        if (actual < 0) {
+            printf("reader %d read actual = %d\n", context->mReaderIndex, (int) actual);
+            context->mFailed = true;
+            break;
+        }
+        for (ssize_t i = 0; i < actual; i++) {
+            if (buffer[i] != expected++) {
+                printf("reader %d read %d, expected %d\n", context->mReaderIndex,
+                        (int) buffer[i], (int) expected - 1);
+                context->mFailed = true;
+                return NULL;
+            }
+        }
+        if (context->mReaderIndex == MULTI_READERS - 1 && expected % 65536 < 32) {
+            usleep(1000);
+        }
+    }
+    return NULL;
+}
+
+int multi_reader_test()
+{
+    int32_t buffer[1000];
+    audio_utils_fifo_index64 rear;
+    audio_utils_fifo_index64 fronts[MULTI_READERS + 1];
+    for (audio_utils_fifo_index64& front : fronts) {
+        front.storeSingleThreaded(audio_utils_fifo_index64::kUnregistered);
+    }
+    audio_utils_fifo fifo(sizeof(buffer) / sizeof(buffer[0]) /*frameCount*/,
+            sizeof(buffer[0]) /*frameSize*/, buffer, rear, fronts,
+            sizeof(fronts) / sizeof(fronts[0]) /*throttleFrontCount*/);
+    audio_utils_fifo_writer writer(fifo);
+
+    audio_utils_fifo_reader *readers[MULTI_READERS];
+    MultiContext contexts[MULTI_READERS];
+    pthread_t threads[MULTI_READERS];
+    for (int i = 0; i < MULTI_READERS; i++) {
+        readers[i] = new audio_utils_fifo_reader(fifo, true /*throttlesWriter*/);
+        contexts[i].mReader = readers[i];
+        contexts[i].mReaderIndex = i;
+        contexts[i].mFailed = false;
+    }
+    for (int i = 0; i < MULTI_READERS; i++) {
+        (void) pthread_create(&threads[i], (const pthread_attr_t *) NULL, multi_reader_routine,
+                (void *) &contexts[i]);
+    }
+
+    int ret = EXIT_SUCCESS;
+    for (int32_t value = 0; value < MULTI_FRAMES; ) {
+        struct timespec timeout;
+        timeout.tv_sec = 5;
+        timeout.tv_nsec = 0;
+        int32_t values[37];
+        int32_t count = MULTI_FRAMES - value < 37 ? MULTI_FRAMES - value : 37;
+        for (int32_t i = 0; i < count; i++) {
+            values[i] = value + i;
+        }
+        ssize_t actual = writer.write(values, count, &timeout);
+        if (actual < 0) {
+            printf("writer write actual = %d\n", (int) actual);
+            ret = EXIT_FAILURE;
+            break;
+        }
+        value += actual;
+    }
+
+    for (int i = 0; i < MULTI_READERS; i++) {
+        (void) pthread_join(threads[i], NULL);
+        if (contexts[i].mFailed) {
+            ret = EXIT_FAILURE;
+        }
+        delete readers[i];
+    }
+    for (audio_utils_fifo_index64& front : fronts) {
+        if (front.loadAcquire() != audio_utils_fifo_index64::kUnregistered) {
+            printf("reader slot not unregistered\n");
+            ret = EXIT_FAILURE;
+        }
+    }
+    printf("multi reader test %s\n", ret == EXIT_SUCCESS ? "passed" : "failed");
+    return ret;
+}
+
 int main(int argc, char **argv)
 {
+    if (argc > 1 && !strcmp(argv[1], "-m")) {
+        return multi_reader_test();
+    }
+
     set_conio_terminal_mode();
     argc = argc + 0;
     argv = &argv[0];
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <audio_utils/channels.h>
+#include <audio_utils/fifo_transform.h>
+#include <audio_utils/format.h>
+
+// A pipeline of three stages, on FIFOs with capacities that are not multiples of each other
+// nor of the transfer sizes, so that the fragments of source and destination don't line up.
+TEST(audio_utils_fifo_transform, pipeline) {
+    constexpr size_t kFrames = 1000;
+    constexpr uint32_t kInChannels = 2;
+    constexpr uint32_t kOutChannels = 4;
+    constexpr float kGain = 0.5f;
+
+    std::vector<int16_t> input(kFrames * kInChannels);
+    for (size_t i = 0; i < input.size(); ++i) {
+        input[i] = (int16_t) (i * 37);
+    }
+
+    // reference conversion on contiguous buffers
+    std::vector<int16_t> expanded(kFrames * kOutChannels);
+    adjust_channels(input.data(), kInChannels, expanded.data(), kOutChannels, sizeof(int16_t),
+            input.size() * sizeof(int16_t));
+    std::vector<float> expected(kFrames * kOutChannels);
+    memcpy_by_audio_format(expected.data(), AUDIO_FORMAT_PCM_FLOAT,
+            expanded.data(), AUDIO_FORMAT_PCM_16_BIT, expected.size());
+    for (float& sample : expected) {
+        sample *= kGain;
+    }
+
+    const audio_utils_fifo_channel_transform channelTransform(kOutChannels, kInChannels,
+            sizeof(int16_t));
+    const audio_utils_fifo_format_transform formatTransform(AUDIO_FORMAT_PCM_FLOAT,
+            AUDIO_FORMAT_PCM_16_BIT, kOutChannels);
+    const audio_utils_fifo_gain_transform gainTransform(kOutChannels, kGain);
+
+    std::vector<int16_t> buffer16(7 * kOutChannels);
+    audio_utils_fifo fifo16(7, kOutChannels * sizeof(int16_t), buffer16.data());
+    audio_utils_fifo_writer writer16(fifo16);
+    audio_utils_fifo_reader reader16(fifo16);
+
+    std::vector<float> bufferFloat(5 * kOutChannels);
+    audio_utils_fifo fifoFloat(5, kOutChannels * sizeof(float), bufferFloat.data());
+    audio_utils_fifo_writer writerFloat(fifoFloat);
+    audio_utils_fifo_reader readerFloat(fifoFloat);
+
+    std::vector<float> output(kFrames * kOutChannels);
+    size_t written = 0;
+    size_t read = 0;
+    for (size_t i = 0; read < kFrames; ++i) {
+        const size_t count = 1 + i % 6;
+        if (written < kFrames) {
+            const ssize_t actual = audio_utils_fifo_write(writer16,
+                    &input[written * kInChannels], channelTransform,
+                    std::min(count, kFrames - written));
+            ASSERT_GE(actual, 0);
+            written += actual;
+        }
+        ASSERT_GE(audio_utils_fifo_transfer(reader16, writerFloat, formatTransform, count), 0);
+        const ssize_t actual = audio_utils_fifo_read(readerFloat,
+                &output[read * kOutChannels], gainTransform, std::min(count, kFrames - read));
+        ASSERT_GE(actual, 0);
+        read += actual;
+        ASSERT_LT(i, kFrames * 10) << "no progress";
+    }
+    EXPECT_EQ(expected, output);
+}
+
+TEST(audio_utils_fifo_transform, frame_size_mismatch) {
+    std::vector<int16_t> buffer16(8);
+    audio_utils_fifo fifo16(8, sizeof(int16_t), buffer16.data());
+    audio_utils_fifo_writer writer16(fifo16);
+    audio_utils_fifo_reader reader16(fifo16);
+
+    std::vector<float> bufferFloat(8);
+    audio_utils_fifo fifoFloat(8, sizeof(float), bufferFloat.data());
+    audio_utils_fifo_writer writerFloat(fifoFloat);
+
+    // source and destination swapped
+    const audio_utils_fifo_format_transform transform(AUDIO_FORMAT_PCM_16_BIT,
+            AUDIO_FORMAT_PCM_FLOAT, 1 /*channelCount*/);
+    const ssize_t available = writerFloat.available();
+    float frame = 0.f;
+    EXPECT_EQ(-EINVAL, audio_utils_fifo_write(writerFloat, &frame, transform, 1));
+    EXPECT_EQ(-EINVAL, audio_utils_fifo_read(reader16, &frame, transform, 1));
+    EXPECT_EQ(-EINVAL, audio_utils_fifo_transfer(reader16, writerFloat, transform));
+    EXPECT_EQ(available, writerFloat.available());
+}
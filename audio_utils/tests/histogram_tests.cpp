@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <audio_utils/Histogram.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+using android::audio_utils::Histogram;
+using android::audio_utils::LogHistogram;
+
+TEST(histogram_tests, linear) {
+    Histogram histogram(10 /* numBinsInRange */, 5 /* binWidth */);
+    histogram.add(-1);
+    histogram.add(0);
+    histogram.add(12);
+    histogram.add(100);
+    EXPECT_EQ(4u, histogram.getCount());
+    EXPECT_EQ(1u, histogram.getCountBelowRange());
+    EXPECT_EQ(1u, histogram.getCount(0));
+    EXPECT_EQ(1u, histogram.getCount(2));
+    EXPECT_EQ(1u, histogram.getCountAboveRange());
+    histogram.clear();
+    EXPECT_EQ(0u, histogram.getCount());
+}
+
+TEST(histogram_tests, log_bins) {
+    using H = LogHistogram<4, 40>;
+    EXPECT_EQ(592u, H::kNumBins);
+
+    // each value is within its bin, and the bins are contiguous.
+    for (size_t i = 0; i + 1 < H::kNumBins; ++i) {
+        ASSERT_EQ(H::getBinStart(i) + H::getBinWidth(i), H::getBinStart(i + 1)) << i;
+        ASSERT_EQ(i, H::getBinIndex(H::getBinStart(i))) << i;
+        ASSERT_EQ(i, H::getBinIndex(H::getBinStart(i + 1) - 1)) << i;
+        // the relative width is bounded.
+        if (i >= 16) {
+            ASSERT_LE(H::getBinWidth(i) * 16, H::getBinStart(i)) << i;
+        }
+    }
+    EXPECT_EQ(0u, H::getBinIndex(-5));
+    EXPECT_EQ(H::kNumBins - 1, H::getBinIndex((int64_t{1} << 40) - 1));
+    EXPECT_EQ(H::kNumBins - 1, H::getBinIndex(int64_t{1} << 50));
+}
+
+TEST(histogram_tests, log_percentile) {
+    LogHistogram<> histogram;
+    EXPECT_EQ(0u, histogram.getCount());
+    EXPECT_EQ(0., histogram.getPercentile(50.));
+
+    // log-uniform values from 1 us to 1 s.
+    std::minstd_rand gen(42);
+    std::uniform_real_distribution<double> dis(3., 9.);
+    std::vector<int64_t> values;
+    for (int i = 0; i < 100'000; ++i) {
+        values.push_back(std::pow(10., dis(gen)));
+        histogram.add(values.back());
+    }
+    std::sort(values.begin(), values.end());
+    EXPECT_EQ(values.size(), histogram.getCount());
+    EXPECT_EQ(values.front(), histogram.getMin());
+    EXPECT_EQ(values.back(), histogram.getMax());
+    EXPECT_EQ(values.front(), histogram.getPercentile(0.));
+    EXPECT_EQ(values.back(), histogram.getPercentile(100.));
+    for (double percentile : {1., 10., 50., 90., 99., 99.9}) {
+        const double expected = values[percentile * 0.01 * (values.size() - 1)];
+        EXPECT_NEAR(expected, histogram.getPercentile(percentile), expected * 0.0625)
+                << percentile;
+    }
+    (void)histogram.toString();
+}
+
+TEST(histogram_tests, log_merge_serialize) {
+    LogHistogram<> a, b, merged;
+    for (int64_t i = 1; i <= 1000; ++i) {
+        a.add(i * 1000);
+        b.add(i * 7);
+    }
+    b.add(-3);
+    merged.merge(a);
+    merged.merge(b);
+    EXPECT_EQ(2001u, merged.getCount());
+    EXPECT_EQ(-3, merged.getMin());
+    EXPECT_EQ(1'000'000, merged.getMax());
+
+    const std::string s = merged.serialize();
+    LogHistogram<> copy;
+    ASSERT_TRUE(copy.deserialize(s));
+    EXPECT_EQ(s, copy.serialize());
+    EXPECT_EQ(merged.getMin(), copy.getMin());
+    EXPECT_EQ(merged.getMax(), copy.getMax());
+    for (size_t i = 0; i < LogHistogram<>::kNumBins; ++i) {
+        ASSERT_EQ(merged.getCount(i), copy.getCount(i)) << i;
+    }
+
+    LogHistogram<> empty;
+    ASSERT_TRUE(copy.deserialize(empty.serialize()));
+    EXPECT_EQ(0u, copy.getCount());
+
+    LogHistogram<5, 40> other;
+    EXPECT_FALSE(other.deserialize(s));
+    EXPECT_FALSE(copy.deserialize("4 40 0 1 1:x"));
+    EXPECT_FALSE(copy.deserialize("4 40 0 1 1000:1"));
+    EXPECT_EQ(0u, copy.getCount());
+}
+
+TEST(histogram_tests, log_concurrent) {
+    constexpr int kThreads = 4;
+    constexpr int64_t kItems = 100'000;
+    LogHistogram<> histogram;
+    std::atomic<bool> done{false};
+    std::thread reader([&]() {
+        uint64_t previous = 0;
+        while (!done) {
+            const uint64_t count = histogram.getCount();
+            EXPECT_GE(count, previous);  // counts only increase
+            previous = count;
+            (void)histogram.getPercentile(99.);
+        }
+    });
+    std::vector<std::thread> writers;
+    for (int t = 0; t < kThreads; ++t) {
+        writers.emplace_back([&histogram, t]() {
+            for (int64_t i = 0; i < kItems; ++i) histogram.add(t * kItems + i);
+        });
+    }
+    for (auto& writer : writers) writer.join();
+    done = true;
+    reader.join();
+    EXPECT_EQ(static_cast<uint64_t>(kThreads * kItems), histogram.getCount());
+    EXPECT_EQ(0, histogram.getMin());
+    EXPECT_EQ(kThreads * kItems - 1, histogram.getMax());
+}
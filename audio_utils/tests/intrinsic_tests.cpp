@@ -25,6 +25,12 @@ class IntrisicUtilsTest : public ::testing::Test { };
 using FloatTypes = ::testing::Types<float, double>;
 TYPED_TEST_CASE(IntrisicUtilsTest, FloatTypes);
 
+TYPED_TEST(IntrisicUtilsTest, vabs) {
+    constexpr TypeParam value = 3.125f;
+    ASSERT_EQ(value, android::audio_utils::intrinsics::vabs(-value));
+    ASSERT_EQ(value, android::audio_utils::intrinsics::vabs(value));
+}
+
 TYPED_TEST(IntrisicUtilsTest, vadd) {
     constexpr TypeParam a = 0.25f;
     constexpr TypeParam b = 0.5f;
@@ -42,6 +48,13 @@ TYPED_TEST(IntrisicUtilsTest, vld1) {
     ASSERT_EQ(value, android::audio_utils::intrinsics::vld1<TypeParam>(&value));
 }
 
+TYPED_TEST(IntrisicUtilsTest, vmax) {
+    constexpr TypeParam a = 2.25f;
+    constexpr TypeParam b = -2.5f;
+    ASSERT_EQ(a, android::audio_utils::intrinsics::vmax(a, b));
+    ASSERT_EQ(a, android::audio_utils::intrinsics::vmax(b, a));
+}
+
 TYPED_TEST(IntrisicUtilsTest, vmla) {
     constexpr TypeParam a = 2.125f;
     constexpr TypeParam b = 2.25f;
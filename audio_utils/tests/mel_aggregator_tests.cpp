@@ -19,6 +19,11 @@
 
 #include <audio_utils/MelAggregator.h>
 
+#include <cstdint>
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
@@ -36,6 +41,31 @@ using ::testing::ElementsAre;
 using ::testing::Pointwise;
 using ::testing::FloatNear;
 
+std::string journalPath(const char* name) {
+    const std::string path = ::testing::TempDir() + "/" + name;
+    unlink(path.c_str());
+    return path;
+}
+
+/** Overwrites part of a journal entry, as a write interrupted by a crash would leave it. */
+void tearJournalEntry(const std::string& path, size_t index) {
+    constexpr size_t kEntrySize = 32;
+    const int fd = open(path.c_str(), O_WRONLY);
+    ASSERT_GE(fd, 0);
+    const float value = 1234.f;  // differs from the test record values
+    ASSERT_EQ(pwrite(fd, &value, sizeof(value), (index + 1) * kEntrySize + 16),
+              static_cast<ssize_t>(sizeof(value)));
+    close(fd);
+}
+
+std::vector<int64_t> restoredTimestamps(CsdJournal& journal, float* csd) {
+    std::vector<CsdRecord> records;
+    journal.restore(csd, &records);
+    std::vector<int64_t> timestamps;
+    for (const auto& record : records) timestamps.push_back(record.timestamp);
+    return timestamps;
+}
+
 TEST(MelAggregatorTest, ResetAggregator) {
     MelAggregator aggregator{100};
 
@@ -168,5 +198,206 @@ TEST(MelAggregatorTest, CsdReaches100PercWith80dB) {
     EXPECT_NEAR(aggregator.getCsd(), 1.f, kMelFloatError);
 }
 
+TEST(MelAggregatorTest, CacheSpanLimitConvertsOlderValues) {
+    MelAggregator aggregator{/* csdWindowSeconds */ 3 * MelAggregator::kMelCacheSeconds};
+
+    // below the minimum CSD record value, kept in the cache
+    auto records = aggregator.aggregateAndAddNewMelRecord(
+        MelRecord(kTestPortId, {90.f, 90.f}, /* timestamp */0));
+    EXPECT_TRUE(records.empty());
+    EXPECT_EQ(aggregator.getCachedMelRecordsSize(), size_t{1});
+
+    // too far from the cached values to be cached together
+    records = aggregator.aggregateAndAddNewMelRecord(
+        MelRecord(kTestPortId, {90.f}, MelAggregator::kMelCacheSeconds));
+    ASSERT_EQ(records.size(), size_t{1});
+    EXPECT_EQ(records[0].timestamp, 0);
+    EXPECT_EQ(records[0].duration, size_t{2});
+    EXPECT_NEAR(records[0].averageMel, 90.f, kMelFloatError);
+    EXPECT_FLOAT_EQ(aggregator.getCsd(), records[0].value);
+    EXPECT_EQ(aggregator.getCachedMelRecordsSize(), size_t{1});
+}
+
+TEST(MelAggregatorTest, CsdRollingWindowMatchesRecords) {
+    constexpr int64_t kWindowSeconds = 24 * 3600;
+    MelAggregator aggregator{kWindowSeconds};
+
+    // two streams with overlapping callbacks over two days, with a few silent gaps.
+    for (int64_t time = 0; time < 2 * kWindowSeconds; time += 3) {
+        if (time % 7200 < 600) continue;
+        const float mel = 85.f + time % 20;
+        aggregator.aggregateAndAddNewMelRecord(MelRecord(kTestPortId, {mel, mel, mel}, time));
+        aggregator.aggregateAndAddNewMelRecord(MelRecord(kTestPortId + 1, {mel, mel}, time + 1));
+    }
+
+    float csd = 0.f;
+    int64_t previousTimestamp = INT64_MIN;
+    int64_t first = 0;
+    int64_t last = 0;
+    aggregator.foreachCsd([&](const CsdRecord& record) {
+        EXPECT_GE(record.timestamp, previousTimestamp);
+        if (previousTimestamp == INT64_MIN) first = record.timestamp;
+        previousTimestamp = record.timestamp;
+        last = record.timestamp + record.duration;
+        csd += record.value;
+    });
+    EXPECT_GT(aggregator.getCsdRecordsSize(), size_t{100});
+    EXPECT_LE(last - first, kWindowSeconds);
+    EXPECT_NEAR(aggregator.getCsd(), csd, csd * 1e-3f);
+}
+
+TEST(MelAggregatorTest, JournalRestoresCsdAfterRestart) {
+    constexpr int64_t kWindowSeconds = 24 * 3600;
+    const std::string path = journalPath("mel_aggregator_journal_restart");
+    MelAggregator aggregator{kWindowSeconds};
+    ASSERT_EQ(aggregator.openJournal(path), NO_ERROR);
+
+    // enough records for several checkpoints and records removed from the window
+    for (int64_t time = 0; time < 2 * kWindowSeconds; time += 3) {
+        const float mel = 90.f + time % 15;
+        aggregator.aggregateAndAddNewMelRecord(MelRecord(kTestPortId, {mel, mel, mel}, time));
+    }
+    ASSERT_GT(aggregator.getCsdRecordsSize(), CsdJournal::kCheckpointInterval);
+
+    MelAggregator restored{kWindowSeconds};
+    ASSERT_EQ(restored.openJournal(path), NO_ERROR);
+    EXPECT_EQ(restored.getCsd(), aggregator.getCsd());
+    std::vector<int64_t> expected;
+    aggregator.foreachCsd([&](const CsdRecord& record) { expected.push_back(record.timestamp); });
+    std::vector<int64_t> actual;
+    restored.foreachCsd([&](const CsdRecord& record) { actual.push_back(record.timestamp); });
+    EXPECT_EQ(actual, expected);
+
+    // reset is journaled as a checkpoint
+    restored.reset(0.5f, {CsdRecord(10, 1, 0.5f, 100.f)});
+    MelAggregator reset{kWindowSeconds};
+    ASSERT_EQ(reset.openJournal(path), NO_ERROR);
+    EXPECT_EQ(reset.getCsd(), 0.5f);
+    EXPECT_EQ(reset.getCsdRecordsSize(), size_t{1});
+}
+
+TEST(MelAggregatorTest, JournalIgnoresTornEntry) {
+    const std::string path = journalPath("mel_aggregator_journal_torn");
+    {
+        auto journal = CsdJournal::open(path);
+        ASSERT_NE(journal, nullptr);
+        ASSERT_EQ(journal->append({CsdRecord(1, 1, 0.1f, 90.f), CsdRecord(2, 1, 0.2f, 90.f),
+                                   CsdRecord(3, 1, 0.3f, 90.f)}), NO_ERROR);
+        ASSERT_EQ(journal->size(), size_t{4});
+    }
+    // crash while writing the last record
+    tearJournalEntry(path, 3);
+    {
+        auto journal = CsdJournal::open(path);
+        ASSERT_NE(journal, nullptr);
+        float csd;
+        EXPECT_THAT(restoredTimestamps(*journal, &csd), ElementsAre(1, 2));
+        EXPECT_FLOAT_EQ(csd, 0.3f);
+        ASSERT_EQ(journal->append({CsdRecord(4, 1, 0.4f, 90.f), CsdRecord(1, 1, -0.1f, 90.f)}),
+                  NO_ERROR);
+    }
+    auto journal = CsdJournal::open(path);
+    ASSERT_NE(journal, nullptr);
+    float csd;
+    EXPECT_THAT(restoredTimestamps(*journal, &csd), ElementsAre(2, 4));
+    EXPECT_FLOAT_EQ(csd, 0.6f);
+}
+
+TEST(MelAggregatorTest, JournalIgnoresIncompleteCheckpoint) {
+    const std::string path = journalPath("mel_aggregator_journal_checkpoint");
+    {
+        auto journal = CsdJournal::open(path);
+        ASSERT_NE(journal, nullptr);
+        ASSERT_EQ(journal->append({CsdRecord(1, 1, 0.1f, 90.f), CsdRecord(2, 1, 0.2f, 90.f)}),
+                  NO_ERROR);
+        // crash while writing the last record of the checkpoint, before the header update
+        ASSERT_EQ(journal->checkpoint(1.f, {CsdRecord(5, 1, 0.5f, 90.f),
+                                            CsdRecord(6, 1, 0.5f, 90.f)}), NO_ERROR);
+        ASSERT_EQ(journal->size(), size_t{6});
+    }
+    const int fd = open(path.c_str(), O_WRONLY);
+    ASSERT_GE(fd, 0);
+    const uint64_t previousCheckpoint = 0;
+    ASSERT_EQ(pwrite(fd, &previousCheckpoint, sizeof(previousCheckpoint), 16),
+              static_cast<ssize_t>(sizeof(previousCheckpoint)));
+    close(fd);
+    tearJournalEntry(path, 5);
+
+    auto journal = CsdJournal::open(path);
+    ASSERT_NE(journal, nullptr);
+    EXPECT_EQ(journal->size(), size_t{3});
+    float csd;
+    EXPECT_THAT(restoredTimestamps(*journal, &csd), ElementsAre(1, 2));
+    EXPECT_FLOAT_EQ(csd, 0.3f);
+
+    // a complete checkpoint not yet in the header is used
+    ASSERT_EQ(journal->checkpoint(1.f, {CsdRecord(5, 1, 0.5f, 90.f),
+                                        CsdRecord(6, 1, 0.5f, 90.f)}), NO_ERROR);
+    journal.reset();
+    const int fd2 = open(path.c_str(), O_WRONLY);
+    ASSERT_GE(fd2, 0);
+    ASSERT_EQ(pwrite(fd2, &previousCheckpoint, sizeof(previousCheckpoint), 16),
+              static_cast<ssize_t>(sizeof(previousCheckpoint)));
+    close(fd2);
+    journal = CsdJournal::open(path);
+    ASSERT_NE(journal, nullptr);
+    EXPECT_THAT(restoredTimestamps(*journal, &csd), ElementsAre(5, 6));
+    EXPECT_FLOAT_EQ(csd, 1.f);
+}
+
+TEST(MelAggregatorTest, JournalRestoresFromFirstCheckpoint) {
+    const std::string path = journalPath("mel_aggregator_journal_unsynced");
+    {
+        auto journal = CsdJournal::open(path);
+        ASSERT_NE(journal, nullptr);
+        ASSERT_EQ(journal->append({CsdRecord(1, 1, 0.1f, 90.f), CsdRecord(2, 1, 0.2f, 90.f)}),
+                  NO_ERROR);
+        ASSERT_EQ(journal->checkpoint(1.f, {CsdRecord(5, 1, 0.5f, 90.f),
+                                            CsdRecord(6, 1, 0.5f, 90.f)}), NO_ERROR);
+    }
+    // power loss with the header on storage, but not the checkpoint it refers to
+    tearJournalEntry(path, 3);
+
+    auto journal = CsdJournal::open(path);
+    ASSERT_NE(journal, nullptr);
+    EXPECT_EQ(journal->size(), size_t{3});
+    float csd;
+    EXPECT_THAT(restoredTimestamps(*journal, &csd), ElementsAre(1, 2));
+    EXPECT_FLOAT_EQ(csd, 0.3f);
+}
+
+TEST(MelAggregatorTest, JournalCompactsWhenFull) {
+    const std::string path = journalPath("mel_aggregator_journal_compact");
+    auto journal = CsdJournal::open(path, /* capacity */ 8);
+    ASSERT_NE(journal, nullptr);
+    std::vector<CsdRecord> records;
+    float csd = 0.f;
+    for (int64_t timestamp = 0; timestamp < 20; ++timestamp) {
+        records.emplace_back(timestamp, 1, 0.01f, 90.f);
+        csd += 0.01f;
+        if (journal->append({records.back()}) != NO_ERROR) {
+            ASSERT_EQ(journal->checkpoint(csd, records), NO_ERROR);
+        }
+    }
+    EXPECT_GE(journal->capacity(), records.size() + 1);
+    EXPECT_EQ(access((path + ".tmp").c_str(), F_OK), -1);
+
+    journal = CsdJournal::open(path);
+    ASSERT_NE(journal, nullptr);
+    float restoredCsd;
+    EXPECT_EQ(restoredTimestamps(*journal, &restoredCsd).size(), records.size());
+    EXPECT_FLOAT_EQ(restoredCsd, csd);
+
+    // not a journal
+    const int fd = open(path.c_str(), O_WRONLY | O_TRUNC);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(write(fd, "garbage", 7), 7);
+    close(fd);
+    journal = CsdJournal::open(path);
+    ASSERT_NE(journal, nullptr);
+    EXPECT_TRUE(restoredTimestamps(*journal, &restoredCsd).empty());
+    EXPECT_EQ(restoredCsd, 0.f);
+}
+
 }  // namespace
 }  // namespace android
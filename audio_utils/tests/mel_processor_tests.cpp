@@ -18,15 +18,46 @@
 #define LOG_TAG "audio_utils_mel_processor_tests"
 
 #include <audio_utils/MelProcessor.h>
+#include <audio_utils/primitives.h>
+#include <audio_utils/sndfile.h>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 #include <chrono>
 #include <cmath>
+#include <cstdlib>
+#include <condition_variable>
+#include <filesystem>
+#include <map>
+#include <mutex>
 #include <tuple>
 #include <unordered_map>
 #include <log/log.h>
+#include <new>
+
+// Counts the allocations of the current thread, see ProcessDoesNotAllocate.
+static thread_local bool tCountAllocations = false;
+static thread_local size_t tAllocationCount = 0;
+
+void* operator new(size_t size) {
+    if (tCountAllocations) {
+        ++tAllocationCount;
+    }
+    void* const ptr = malloc(size != 0 ? size : 1);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t /* size */) noexcept {
+    free(ptr);
+}
 
 namespace android::audio_utils {
 namespace {
@@ -110,6 +141,296 @@ TEST(MelProcessorTest, UnsupportedSamplerateCheck) {
     EXPECT_EQ(processor->process(buffer.data(), 1000), 0);
 }
 
+// Records the MEL values received for each device.
+class MelRecorder : public MelProcessor::MelCallback {
+public:
+    void onNewMelValues(const std::vector<float>& mels, size_t offset, size_t length,
+                        audio_port_handle_t deviceId, bool /* attenuated */) const override {
+        std::lock_guard l(mLock);
+        auto& deviceMels = mMels[deviceId];
+        deviceMels.insert(deviceMels.end(), mels.begin() + offset, mels.begin() + offset + length);
+        mCondVar.notify_all();
+    }
+
+    void onMomentaryExposure(float /* currentMel */,
+                             audio_port_handle_t /* deviceId */) const override {}
+
+    // Returns the MEL values of each device once all devices have count values.
+    std::map<audio_port_handle_t, std::vector<float>> waitForMels(size_t devices, size_t count) {
+        std::unique_lock l(mLock);
+        mCondVar.wait_for(l, std::chrono::seconds(5), [&] {
+            if (mMels.size() < devices) return false;
+            for (const auto& [_, mels] : mMels) {
+                if (mels.size() < count) return false;
+            }
+            return true;
+        });
+        return mMels;
+    }
+
+private:
+    mutable std::mutex mLock;
+    mutable std::condition_variable mCondVar;
+    mutable std::map<audio_port_handle_t, std::vector<float>> mMels;
+};
+
+size_t getProcessThreadCount() {
+    size_t threads = 0;
+    for ([[maybe_unused]] const auto& entry :
+            std::filesystem::directory_iterator("/proc/self/task")) {
+        ++threads;
+    }
+    return threads;
+}
+
+TEST(MelProcessorTest, ThreadCountIndependentOfProcessors) {
+    constexpr int32_t kSampleRate = 8000;
+    sp<MelRecorder> callback = sp<MelRecorder>::make();
+    auto first = sp<MelProcessor>::make(kSampleRate, 1, AUDIO_FORMAT_PCM_FLOAT, callback, 0, 100);
+    const size_t poolThreads = MelProcessor::getWorkerThreadCount();
+    const size_t threads = getProcessThreadCount();
+    EXPECT_GE(poolThreads, size_t{1});
+
+    std::vector<float> buffer;
+    appendSineWaveBuffer(buffer, 1000.0f, kSampleRate, kSampleRate);
+    std::vector<sp<MelProcessor>> processors;
+    for (int i = 1; i <= 64; ++i) {
+        processors.push_back(sp<MelProcessor>::make(
+                kSampleRate, 1, AUDIO_FORMAT_PCM_FLOAT, callback, i, 100, 1));
+        EXPECT_GT(processors.back()->process(buffer.data(), buffer.size() * sizeof(float)), 0);
+    }
+    callback->waitForMels(processors.size(), 1);
+
+    EXPECT_EQ(poolThreads, MelProcessor::getWorkerThreadCount());
+    EXPECT_EQ(threads, getProcessThreadCount());
+}
+
+TEST(MelProcessorTest, CallbacksOrderedPerProcessor) {
+    constexpr int32_t kSampleRate = 16000;
+    constexpr size_t kProcessors = 8;
+    constexpr size_t kSeconds = 10;
+    sp<MelRecorder> callback = sp<MelRecorder>::make();
+
+    // MEL increases every second, between RS1 and RS2.
+    std::vector<float> buffer;
+    for (size_t i = 0; i < kSeconds; ++i) {
+        appendSineWaveBuffer(buffer, 1000.0f, kSampleRate, kSampleRate, 0.1f * powf(1.1f, i));
+    }
+    std::vector<sp<MelProcessor>> processors;
+    for (size_t i = 0; i < kProcessors; ++i) {
+        processors.push_back(sp<MelProcessor>::make(
+                kSampleRate, 1, AUDIO_FORMAT_PCM_FLOAT, callback, i, 100, 1));
+    }
+    // interleave the processors so that the pool threads serve several at once.
+    for (size_t i = 0; i < kSeconds; ++i) {
+        for (const auto& processor : processors) {
+            EXPECT_GT(processor->process(&buffer[i * kSampleRate], kSampleRate * sizeof(float)),
+                      0);
+        }
+    }
+
+    const auto mels = callback->waitForMels(kProcessors, kSeconds);
+    ASSERT_EQ(kProcessors, mels.size());
+    for (const auto& [deviceId, deviceMels] : mels) {
+        ASSERT_EQ(kSeconds, deviceMels.size()) << "device " << deviceId;
+        EXPECT_TRUE(std::is_sorted(deviceMels.begin(), deviceMels.end())) << "device " << deviceId;
+    }
+}
+
+TEST(MelProcessorTest, SetWorkerThreadCount) {
+    sp<MelRecorder> callback = sp<MelRecorder>::make();
+    auto processor = sp<MelProcessor>::make(8000, 1, AUDIO_FORMAT_PCM_FLOAT, callback, 0, 100);
+
+    MelProcessor::setWorkerThreadCount(3);
+    EXPECT_EQ(size_t{3}, MelProcessor::getWorkerThreadCount());
+
+    // surplus threads exit asynchronously.
+    MelProcessor::setWorkerThreadCount(MelProcessor::kDefaultWorkerThreadCount);
+    for (int i = 0; i < 100
+            && MelProcessor::getWorkerThreadCount() != MelProcessor::kDefaultWorkerThreadCount;
+            ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(MelProcessor::kDefaultWorkerThreadCount, MelProcessor::getWorkerThreadCount());
+}
+
+TEST(MelProcessorTest, ProcessDoesNotAllocate) {
+    constexpr int32_t kSampleRate = 48000;
+    constexpr size_t kSeconds = 6;
+    constexpr size_t kFramesPerBuffer = 480;  // 10 ms
+    sp<MelRecorder> callback = sp<MelRecorder>::make();
+    // RS2 is set to its lower bound so that momentary exposures are reported as well.
+    auto processor = sp<MelProcessor>::make(
+            kSampleRate, 1, AUDIO_FORMAT_PCM_FLOAT, callback, 0, 80, 1);
+
+    std::vector<float> mono;
+    appendSineWaveBuffer(mono, 1000.0f, kSampleRate * kSeconds, kSampleRate);
+    std::vector<int16_t> buffer(mono.size() * 2);
+    for (size_t i = 0; i < mono.size(); ++i) {
+        buffer[2 * i] = buffer[2 * i + 1] = clamp16_from_float(mono[i]);
+    }
+
+    // the new format is published here and adopted by the next process() call.
+    processor->updateAudioFormat(kSampleRate, 2, AUDIO_FORMAT_PCM_16_BIT);
+    tAllocationCount = 0;
+    tCountAllocations = true;
+    for (size_t i = 0; i < buffer.size(); i += kFramesPerBuffer * 2) {
+        if (processor->process(&buffer[i], kFramesPerBuffer * 2 * sizeof(int16_t)) <= 0) {
+            break;
+        }
+    }
+    tCountAllocations = false;
+    EXPECT_EQ(size_t{0}, tAllocationCount);
+
+    const auto mels = callback->waitForMels(1, kSeconds);
+    ASSERT_EQ(size_t{1}, mels.size());
+    EXPECT_EQ(kSeconds, mels.begin()->second.size());
+}
+
+// Returns a stereo 1kHz sine wave whose MEL changes every second, between RS1 and RS2.
+std::vector<float> getStereoBuffer(int32_t sampleRate, size_t seconds) {
+    std::vector<float> mono;
+    for (size_t i = 0; i < seconds; ++i) {
+        appendSineWaveBuffer(mono, 1000.0f, sampleRate, sampleRate, 0.1f * powf(1.1f, i % 16));
+    }
+    std::vector<float> stereo(mono.size() * 2);
+    for (size_t i = 0; i < mono.size(); ++i) {
+        stereo[2 * i] = mono[i];
+        stereo[2 * i + 1] = mono[i] * 0.5f;
+    }
+    return stereo;
+}
+
+TEST(MelProcessorTest, ComputeMelsMatchesProcess) {
+    constexpr int32_t kSampleRate = 48000;
+    constexpr size_t kSeconds = 12;
+    const std::vector<float> buffer = getStereoBuffer(kSampleRate, kSeconds);
+
+    sp<MelRecorder> callback = sp<MelRecorder>::make();
+    auto processor = sp<MelProcessor>::make(
+            kSampleRate, 2, AUDIO_FORMAT_PCM_FLOAT, callback, 0, 100, 1);
+    EXPECT_GT(processor->process(buffer.data(), buffer.size() * sizeof(float)), 0);
+    const std::vector<float> expected = callback->waitForMels(1, kSeconds)[0];
+    ASSERT_EQ(kSeconds, expected.size());
+
+    for (size_t threadCount : {1, 2, 5, 16, 0}) {
+        const std::vector<float> mels = MelProcessor::computeMels(
+                buffer.data(), buffer.size() * sizeof(float), kSampleRate, 2,
+                AUDIO_FORMAT_PCM_FLOAT, 0.f /* attenuationDB */, threadCount);
+        ASSERT_EQ(kSeconds, mels.size()) << "threadCount " << threadCount;
+        for (size_t i = 0; i < kSeconds; ++i) {
+            EXPECT_NEAR(expected[i], mels[i], 1e-3f)
+                    << "threadCount " << threadCount << " second " << i;
+        }
+    }
+}
+
+TEST(MelProcessorTest, ComputeMelsFormatsAndAttenuation) {
+    constexpr int32_t kSampleRate = 44100;
+    constexpr size_t kSeconds = 4;
+    const std::vector<float> buffer = getStereoBuffer(kSampleRate, kSeconds);
+    const std::vector<float> expected = MelProcessor::computeMels(
+            buffer.data(), buffer.size() * sizeof(float), kSampleRate, 2, AUDIO_FORMAT_PCM_FLOAT);
+    ASSERT_EQ(kSeconds, expected.size());
+
+    std::vector<int16_t> buffer16(buffer.size());
+    memcpy_to_i16_from_float(buffer16.data(), buffer.data(), buffer.size());
+    // a trailing partial second is ignored.
+    const std::vector<float> mels16 = MelProcessor::computeMels(
+            buffer16.data(), (buffer16.size() - 2) * sizeof(int16_t), kSampleRate, 2,
+            AUDIO_FORMAT_PCM_16_BIT);
+    ASSERT_EQ(kSeconds - 1, mels16.size());
+    for (size_t i = 0; i < mels16.size(); ++i) {
+        EXPECT_NEAR(expected[i], mels16[i], 0.01f) << "second " << i;
+    }
+
+    constexpr float kAttenuationDB = 10.f;
+    const std::vector<float> attenuated = MelProcessor::computeMels(
+            buffer.data(), buffer.size() * sizeof(float), kSampleRate, 2, AUDIO_FORMAT_PCM_FLOAT,
+            kAttenuationDB);
+    ASSERT_EQ(kSeconds, attenuated.size());
+    for (size_t i = 0; i < kSeconds; ++i) {
+        EXPECT_NEAR(expected[i] - kAttenuationDB, attenuated[i], 1e-4f) << "second " << i;
+    }
+
+    EXPECT_TRUE(MelProcessor::computeMels(buffer.data(), buffer.size() * sizeof(float),
+            1000 /* sampleRate */, 2, AUDIO_FORMAT_PCM_FLOAT).empty());
+    EXPECT_TRUE(MelProcessor::computeMels(buffer.data(), buffer.size() * sizeof(float),
+            kSampleRate, 2, AUDIO_FORMAT_MP3).empty());
+}
+
+TEST(MelProcessorTest, ComputeMelsFromFile) {
+    // more than one block of seconds for a single thread.
+    constexpr int32_t kSampleRate = 8000;
+    constexpr size_t kSeconds = MelProcessor::kBatchSecondsPerThread + 5;
+    const std::vector<float> buffer = getStereoBuffer(kSampleRate, kSeconds);
+    const std::string path = ::testing::TempDir() + "/mel_processor_tests.wav";
+
+    SF_INFO info{};
+    info.samplerate = kSampleRate;
+    info.channels = 2;
+    info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+    SNDFILE* file = sf_open(path.c_str(), SFM_WRITE, &info);
+    ASSERT_NE(nullptr, file);
+    EXPECT_EQ((sf_count_t) (buffer.size() / 2),
+              sf_writef_float(file, buffer.data(), buffer.size() / 2));
+    sf_close(file);
+
+    file = sf_open(path.c_str(), SFM_READ, &info);
+    ASSERT_NE(nullptr, file);
+    // read in odd sized chunks, smaller than a block of seconds.
+    const auto reader = [file](float* buffer, size_t frames) -> size_t {
+        return sf_readf_float(file, buffer, std::min(frames, size_t{7919}));
+    };
+    const std::vector<float> mels = MelProcessor::computeMels(
+            reader, info.samplerate, info.channels, 0.f /* attenuationDB */, 1 /* threadCount */);
+    sf_close(file);
+    unlink(path.c_str());
+
+    const std::vector<float> expected = MelProcessor::computeMels(
+            buffer.data(), buffer.size() * sizeof(float), kSampleRate, 2, AUDIO_FORMAT_PCM_FLOAT,
+            0.f /* attenuationDB */, 4 /* threadCount */);
+    ASSERT_EQ(kSeconds, mels.size());
+    for (size_t i = 0; i < kSeconds; ++i) {
+        EXPECT_NEAR(expected[i], mels[i], 1e-4f) << "second " << i;
+    }
+}
+
+TEST(MelProcessorTest, ComputeMelsBufferIndependentOfThreadCount) {
+    // more than one buffer of seconds, which would be far larger per thread.
+    constexpr int32_t kSampleRate = 8000;
+    constexpr uint32_t kChannelCount = 64;
+    constexpr size_t kThreadCount = 4096;
+    constexpr size_t kBytesPerSecond = kSampleRate * kChannelCount * sizeof(float);
+    constexpr size_t kSeconds = MelProcessor::kBatchBufferBytes / kBytesPerSecond + 5;
+    const std::vector<float> stereo = getStereoBuffer(kSampleRate, kSeconds);
+    std::vector<float> buffer(stereo.size() / 2 * kChannelCount);
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        buffer[i] = stereo[i / kChannelCount * 2 + i % 2];
+    }
+
+    size_t offset = 0;
+    size_t maxFrames = 0;
+    const auto reader = [&](float* data, size_t frames) -> size_t {
+        maxFrames = std::max(maxFrames, frames);
+        frames = std::min(frames, (buffer.size() - offset) / kChannelCount);
+        std::copy_n(&buffer[offset], frames * kChannelCount, data);
+        offset += frames * kChannelCount;
+        return frames;
+    };
+    const std::vector<float> mels = MelProcessor::computeMels(
+            reader, kSampleRate, kChannelCount, 0.f /* attenuationDB */, kThreadCount);
+    EXPECT_LE(maxFrames * kChannelCount * sizeof(float), MelProcessor::kBatchBufferBytes);
+
+    const std::vector<float> expected = MelProcessor::computeMels(
+            buffer.data(), buffer.size() * sizeof(float), kSampleRate, kChannelCount,
+            AUDIO_FORMAT_PCM_FLOAT, 0.f /* attenuationDB */, 4 /* threadCount */);
+    ASSERT_EQ(kSeconds, mels.size());
+    for (size_t i = 0; i < kSeconds; ++i) {
+        EXPECT_NEAR(expected[i], mels[i], 1e-4f) << "second " << i;
+    }
+}
+
 TEST_P(MelProcessorFixtureTest, CheckNumberOfCallbacks) {
     if (mFrequency != 1000.0f) {
         ALOGV("NOTE: CheckNumberOfCallbacks disabled for frequency %d", mFrequency);
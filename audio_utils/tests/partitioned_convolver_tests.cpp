@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <audio_utils/FloatFFT.h>
+#include <audio_utils/PartitionedConvolver.h>
+
+using namespace android::audio_utils;
+
+static std::vector<float> randomVector(size_t size, std::minstd_rand& gen) {
+    std::uniform_real_distribution<float> dis(-1.f, 1.f);
+    std::vector<float> v(size);
+    for (auto& x : v) x = dis(gen);
+    return v;
+}
+
+// Reference direct-form convolution of interleaved data.
+static std::vector<float> convolve(const std::vector<float>& in, size_t channelCount,
+        const std::vector<std::vector<float>>& responses) {
+    const size_t frames = in.size() / channelCount;
+    std::vector<float> out(in.size());
+    for (size_t c = 0; c < channelCount; ++c) {
+        const auto& h = responses[responses.size() == 1 ? 0 : c];
+        for (size_t n = 0; n < frames; ++n) {
+            double accum = 0.;
+            for (size_t k = 0; k < h.size() && k <= n; ++k) {
+                accum += (double)h[k] * in[(n - k) * channelCount + c];
+            }
+            out[n * channelCount + c] = accum;
+        }
+    }
+    return out;
+}
+
+TEST(audio_utils_float_fft, forward_matches_dft) {
+    std::minstd_rand gen(42);
+    for (size_t size : { 4, 8, 64, 512 }) {
+        FloatFFT fft(size);
+        ASSERT_EQ(size / 2 + 1, fft.bins());
+        const auto in = randomVector(size, gen);
+        std::vector<float> re(fft.bins()), im(fft.bins());
+        fft.forward(in.data(), re.data(), im.data());
+        for (size_t k = 0; k < fft.bins(); ++k) {
+            double dre = 0., dim = 0.;
+            for (size_t n = 0; n < size; ++n) {
+                const double phase = -2. * M_PI * k * n / size;
+                dre += in[n] * cos(phase);
+                dim += in[n] * sin(phase);
+            }
+            EXPECT_NEAR(dre, re[k], 1e-4 * size) << "size " << size << " bin " << k;
+            EXPECT_NEAR(dim, im[k], 1e-4 * size) << "size " << size << " bin " << k;
+        }
+    }
+}
+
+TEST(audio_utils_float_fft, round_trip) {
+    std::minstd_rand gen(42);
+    for (size_t size = 4; size <= 8192; size *= 2) {
+        FloatFFT fft(size);
+        const auto in = randomVector(size, gen);
+        std::vector<float> re(fft.bins()), im(fft.bins()), out(size);
+        fft.forward(in.data(), re.data(), im.data());
+        fft.inverse(re.data(), im.data(), out.data());
+        for (size_t n = 0; n < size; ++n) {
+            EXPECT_NEAR(in[n], out[n] / size, 1e-5) << "size " << size << " index " << n;
+        }
+    }
+}
+
+TEST(audio_utils_partitioned_convolver, invalid_parameters) {
+    const std::vector<std::vector<float>> response{{1.f, 0.5f}};
+    EXPECT_EQ(nullptr, PartitionedConvolver::create(0 /* channelCount */, response));
+    EXPECT_EQ(nullptr, PartitionedConvolver::create(2, {{1.f}, {1.f}, {1.f}}));
+    EXPECT_EQ(nullptr, PartitionedConvolver::create(1, {{}}));
+    EXPECT_EQ(nullptr, PartitionedConvolver::create(1, response, 48 /* headSize */));
+    EXPECT_EQ(nullptr, PartitionedConvolver::create(1, response, 64, 32 /* maxBlockSize */));
+    EXPECT_NE(nullptr, PartitionedConvolver::create(1, response, 64, 256));
+}
+
+// Parameters: channelCount, tap count, headSize, maxBlockSize, shared response.
+class PartitionedConvolverTest
+        : public ::testing::TestWithParam<std::tuple<size_t, size_t, size_t, size_t, bool>> {
+};
+
+TEST_P(PartitionedConvolverTest, matches_direct_form) {
+    const auto [channelCount, taps, headSize, maxBlockSize, shared] = GetParam();
+    std::minstd_rand gen(42);
+    std::vector<std::vector<float>> responses(shared ? 1 : channelCount);
+    for (size_t i = 0; i < responses.size(); ++i) {
+        // Vary lengths per channel to exercise zero padding.
+        responses[i] = randomVector(taps - i * 3, gen);
+    }
+    auto convolver = PartitionedConvolver::create(
+            channelCount, responses, headSize, maxBlockSize);
+    ASSERT_NE(nullptr, convolver);
+    EXPECT_EQ(taps, convolver->getLength());
+
+    constexpr size_t kFrames = 6000;
+    const auto in = randomVector(kFrames * channelCount, gen);
+    const auto expected = convolve(in, channelCount, responses);
+
+    // Process in place with irregular chunk sizes.
+    std::vector<float> out = in;
+    std::uniform_int_distribution<size_t> chunkDis(1, 3 * headSize);
+    for (size_t frame = 0; frame < kFrames; ) {
+        const size_t chunk = std::min(chunkDis(gen), kFrames - frame);
+        convolver->process(&out[frame * channelCount], &out[frame * channelCount], chunk);
+        frame += chunk;
+    }
+    const float tolerance = 2e-6f * taps;
+    for (size_t i = 0; i < out.size(); ++i) {
+        ASSERT_NEAR(expected[i], out[i], tolerance) << "index " << i;
+    }
+
+    // After reset, output restarts from a cleared state.
+    convolver->reset();
+    std::vector<float> again(in.size());
+    convolver->process(in.data(), again.data(), kFrames);
+    for (size_t i = 0; i < again.size(); ++i) {
+        ASSERT_NEAR(expected[i], again[i], tolerance) << "index " << i;
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(PartitionedConvolverAll, PartitionedConvolverTest,
+        ::testing::Values(
+                std::make_tuple(1, 7, 16, 0, true),        // head only
+                std::make_tuple(1, 1000, 32, 0, true),     // uniform
+                std::make_tuple(2, 1000, 32, 256, false),  // non-uniform
+                std::make_tuple(3, 2047, 16, 512, false),
+                std::make_tuple(8, 513, 64, 0, true),
+                std::make_tuple(2, 4000, 64, 1024, true)));
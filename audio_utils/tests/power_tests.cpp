@@ -17,9 +17,13 @@
 //#define LOG_NDEBUG 0
 #define LOG_TAG "audio_utils_power_tests"
 
+#include <algorithm>
 #include <cmath>
 #include <math.h>
+#include <random>
+#include <vector>
 
+#include <audio_utils/format.h>
 #include <audio_utils/power.h>
 #include <gtest/gtest.h>
 #include <log/log.h>
@@ -171,3 +175,59 @@ TEST(audio_utils_power, power_from) {
     EXPECT_EQ(-INFINITY, audio_utils_power_from_energy(0.f));
     EXPECT_TRUE(std::isnan(audio_utils_power_from_energy(-1.f)));
 }
+
+TEST(audio_utils_power, accumulate_energy_and_peak) {
+    std::minstd_rand gen(42);
+    std::uniform_real_distribution<float> dis(-1.f, 1.f);
+
+    // 3, 9 and 30 channels do not have fixed channel count kernels.
+    for (size_t channels : { 1, 2, 3, 4, 6, 8, 9, 12, 16, 24, 30 }) {
+        for (size_t frames : { 1, 7, 100, 1000 }) {
+            std::vector<float> input(channels * frames);
+            for (auto& in : input) in = dis(gen);
+
+            for (audio_format_t format : {
+                    AUDIO_FORMAT_PCM_8_BIT, AUDIO_FORMAT_PCM_16_BIT,
+                    AUDIO_FORMAT_PCM_24_BIT_PACKED, AUDIO_FORMAT_PCM_8_24_BIT,
+                    AUDIO_FORMAT_PCM_32_BIT, AUDIO_FORMAT_PCM_FLOAT }) {
+                std::vector<uint8_t> buffer(input.size() * audio_bytes_per_sample(format));
+                memcpy_by_audio_format(buffer.data(), format, input.data(),
+                        AUDIO_FORMAT_PCM_FLOAT, input.size());
+                // the expected values are computed from the quantized samples.
+                std::vector<float> quantized(input.size());
+                memcpy_by_audio_format(quantized.data(), AUDIO_FORMAT_PCM_FLOAT, buffer.data(),
+                        format, input.size());
+                std::vector<double> expectedEnergy(channels, 1.);  // accumulate on 1.f
+                std::vector<float> expectedPeak(channels, 0.25f);  // accumulate on 0.25f
+                for (size_t i = 0; i < quantized.size(); ++i) {
+                    const float amplitude = quantized[i];
+                    expectedEnergy[i % channels] += (double)amplitude * amplitude;
+                    expectedPeak[i % channels] =
+                            std::max(expectedPeak[i % channels], std::fabs(amplitude));
+                }
+
+                std::vector<float> energy(channels, 1.f);
+                std::vector<float> peak(channels, 0.25f);
+                audio_utils_accumulate_energy_and_peak(buffer.data(), format, input.size(),
+                        channels, energy.data(), peak.data());
+                std::vector<float> energyOnly(channels, 1.f);
+                audio_utils_accumulate_energy(buffer.data(), format, input.size(),
+                        channels, energyOnly.data());
+                for (size_t c = 0; c < channels; ++c) {
+                    SCOPED_TRACE(testing::Message() << "format " << format << " channels "
+                            << channels << " frames " << frames << " channel " << c);
+                    EXPECT_NEAR(expectedEnergy[c], energy[c], 1e-5 * expectedEnergy[c]);
+                    EXPECT_EQ(energy[c], energyOnly[c]);
+                    EXPECT_EQ(expectedPeak[c], peak[c]);
+                }
+            }
+        }
+    }
+}
+
+TEST(audio_utils_power, rms_from_energy) {
+    // a full scale square wave has RMS amplitude 1, a sine wave 1 / sqrt(2).
+    EXPECT_FLOAT_EQ(1.f, audio_utils_rms_from_energy(480.f, 480));
+    EXPECT_FLOAT_EQ(M_SQRT1_2, audio_utils_rms_from_energy(240.f, 480));
+    EXPECT_EQ(0.f, audio_utils_rms_from_energy(0.f, 480));
+}
@@ -21,8 +21,11 @@
 
 #include <audio_utils/clock.h>
 #include <gtest/gtest.h>
+#include <atomic>
 #include <iostream>
 #include <log/log.h>
+#include <thread>
+#include <vector>
 
 using namespace android;
 
@@ -193,6 +196,61 @@ Signal power history (resolution: 0.0 ms):
     */
 }
 
+TEST(audio_utils_powerlog, concurrent_dump) {
+    const uint32_t kSampleRate = 48000;
+    const size_t kFramesPerBuffer = 480;
+    auto plog = std::make_unique<PowerLog>(
+            kSampleRate /* sampleRate */,
+            2 /* channelCount */,
+            AUDIO_FORMAT_PCM_16_BIT,
+            20000 /* entries */,
+            kFramesPerBuffer /* framesPerEntry */);
+    const std::vector<int16_t> buffer(kFramesPerBuffer * 2, 0x1000);
+    int64_t nowNs = 0;
+    const auto logBuffer = [&]() {
+        plog->log(buffer.data(), kFramesPerBuffer, nowNs);
+        nowNs += kFramesPerBuffer * NANOS_PER_SECOND / kSampleRate;
+    };
+    for (int i = 0; i < 20000; ++i) logBuffer();  // a long dump
+
+    // log() completes while a dump is in progress on another thread.
+    // The dump only starts running when it is scheduled, so try a few times.
+    bool logDuringDump = false;
+    for (int attempt = 0; attempt < 10 && !logDuringDump; ++attempt) {
+        std::atomic<bool> started{false};
+        std::atomic<bool> finished{false};
+        std::thread dumper([&]() {
+            started = true;
+            (void)plog->dumpToString();
+            finished = true;
+        });
+        while (!started) std::this_thread::yield();
+        for (int i = 0; i < 10; ++i) logBuffer();
+        logDuringDump = !finished;
+        dumper.join();
+    }
+    EXPECT_TRUE(logDuringDump);
+
+    // dumps while logging are well formed.
+    std::atomic<bool> done{false};
+    std::vector<std::thread> dumpers;
+    for (int i = 0; i < 2; ++i) {
+        dumpers.emplace_back([&]() {
+            while (!done) {
+                const std::string s = plog->dumpToString(
+                        "" /* prefix */, 10 /* lines */, 0 /* limitNs */, false /* logPlot */);
+                EXPECT_NE(std::string::npos, s.find("Signal power history"));
+                EXPECT_GE((size_t)10, countNewLines(s));
+            }
+        });
+    }
+    for (int i = 0; i < 100000; ++i) logBuffer();
+    done = true;
+    for (auto& dumper : dumpers) dumper.join();
+    EXPECT_EQ((size_t)10, countNewLines(plog->dumpToString(
+            "" /* prefix */, 10 /* lines */, 0 /* limitNs */, false /* logPlot */)));
+}
+
 TEST(audio_utils_powerlog, c) {
     power_log_t *power_log = power_log_create(
             48000 /* sample_rate */,
@@ -15,6 +15,7 @@
  */
 
 #include <math.h>
+#include <random>
 #include <vector>
 
 #include <gtest/gtest.h>
@@ -675,6 +676,56 @@ TEST(audio_utils_primitives, memcpy_by_index_array_src_index) {
     delete[] u24ary;
 }
 
+TEST(audio_utils_primitives, memcpy_by_index_array_with_plan) {
+    memcpy_by_index_array_plan_t plan;
+    const int8_t swap[] = { 1, 0 };
+    EXPECT_EQ(-EINVAL, memcpy_by_index_array_plan_initialization(&plan, 2, 2, swap, 0));
+    EXPECT_EQ(-EINVAL, memcpy_by_index_array_plan_initialization(&plan, 2, 2, swap, 5));
+    EXPECT_EQ(-EINVAL, memcpy_by_index_array_plan_initialization(&plan, 2, 1, swap, 2));
+    EXPECT_EQ(-EINVAL, memcpy_by_index_array_plan_initialization(&plan, 2, 33, swap, 2));
+    EXPECT_EQ(0, memcpy_by_index_array_plan_initialization(&plan, 2, 2, swap, 2));
+
+    // Compare against memcpy_by_index_array() for random index arrays, including
+    // swaps, replication, zero fill and channels dropped.
+    std::minstd_rand gen(42);
+    constexpr size_t kMaxFrames = 67;
+    std::vector<uint8_t> src(kMaxFrames * MEMCPY_BY_INDEX_ARRAY_PLAN_MAX_CHANNELS * 4);
+    for (auto& byte : src) {
+        byte = gen();
+    }
+    for (size_t sample_size = 1; sample_size <= 4; ++sample_size) {
+        for (uint32_t src_channels : { 1, 2, 3, 4, 6, 8, 12, 24 }) {
+            for (uint32_t dst_channels : { 1, 2, 4, 5, 6, 8, 16, 32 }) {
+                int8_t idxary[MEMCPY_BY_INDEX_ARRAY_PLAN_MAX_CHANNELS];
+                std::uniform_int_distribution<int> dis(-1, src_channels - 1);
+                for (auto pass = 0; pass < 4; ++pass) {
+                    for (uint32_t i = 0; i < dst_channels; ++i) {
+                        // pass 0 is a plain copy where possible, pass 1 swaps pairs.
+                        idxary[i] = pass == 0 ? std::min(i, src_channels - 1)
+                                : pass == 1 ? std::min(i ^ 1, src_channels - 1)
+                                : dis(gen);
+                    }
+                    ASSERT_EQ(0, memcpy_by_index_array_plan_initialization(
+                            &plan, dst_channels, src_channels, idxary, sample_size));
+                    for (size_t count : { (size_t)0, (size_t)1, (size_t)7, kMaxFrames }) {
+                        // Exactly sized buffers, so that accesses beyond are detected.
+                        const std::vector<uint8_t> in(
+                                src.begin(), src.begin() + count * src_channels * sample_size);
+                        std::vector<uint8_t> expected(count * dst_channels * sample_size);
+                        std::vector<uint8_t> out(expected.size());
+                        memcpy_by_index_array(expected.data(), dst_channels, in.data(),
+                                src_channels, idxary, sample_size, count);
+                        memcpy_by_index_array_with_plan(out.data(), in.data(), &plan, count);
+                        ASSERT_EQ(expected, out) << "sample_size " << sample_size
+                                << " src_channels " << src_channels
+                                << " dst_channels " << dst_channels << " count " << count;
+                    }
+                }
+            }
+        }
+    }
+}
+
 TEST(audio_utils_primitives, updown_mix) {
     const size_t size = 32767;
     std::vector<int16_t> i16ref(size * 2);
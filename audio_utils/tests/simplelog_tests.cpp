@@ -17,10 +17,14 @@
 //#define LOG_NDEBUG 0
 #define LOG_TAG "audio_utils_errorlog_tests"
 
+#include <audio_utils/LockFreeLog.h>
 #include <audio_utils/SimpleLog.h>
 #include <gtest/gtest.h>
+#include <atomic>
 #include <iostream>
 #include <log/log.h>
+#include <thread>
+#include <vector>
 
 using namespace android;
 
@@ -84,3 +88,80 @@ TEST(audio_utils_simplelog, basic) {
   12-31 16:00:02.000 Goodbye
      */
 }
+
+TEST(audio_utils_simplelog, lock_free) {
+    LockFreeSimpleLog<> slog;
+    const int64_t oneSecond = 1000000000;
+    auto writer = slog.createWriter();
+    auto writer2 = slog.createWriter();
+    ASSERT_NE(nullptr, writer);
+    ASSERT_NE(nullptr, writer2);
+
+    EXPECT_EQ((size_t)0, countNewLines(slog.dumpToString()));
+
+    // the writers are merged by time.
+    enum class Color { RED = 1, GREEN = 2 };
+    writer->log(oneSecond * 3 /* nowNs */, "Hello %d", 9);
+    writer2->log(oneSecond /* nowNs */, "%.2f %u%% %d", 1.5f, 42u, Color::GREEN);
+    writer->log(oneSecond * 4 /* nowNs */, "World\n");
+    writer2->log(oneSecond * 2 /* nowNs */, "%lld %p", (long long)-7, (void *)&slog);
+    EXPECT_EQ((size_t)4, countNewLines(slog.dumpToString()));
+
+    SimpleLog reference;
+    reference.log(oneSecond /* nowNs */, "%.2f %u%% %d", 1.5f, 42u, (int)Color::GREEN);
+    reference.log(oneSecond * 2 /* nowNs */, "%lld %p", (long long)-7, (void *)&slog);
+    EXPECT_EQ((size_t)0, slog.dumpToString().find(reference.dumpToString()));  // same format
+
+    // truncate on lines
+    EXPECT_EQ((size_t)1, countNewLines(slog.dumpToString("" /* prefix */, 1 /* lines */)));
+    EXPECT_NE(std::string::npos,
+            slog.dumpToString("" /* prefix */, 1 /* lines */).find(" World\n"));
+
+    // truncate on time
+    EXPECT_EQ((size_t)3, countNewLines(
+            slog.dumpToString("" /* prefix */, 0 /* lines */, oneSecond * 2 /* limitNs */)));
+
+    std::cout << slog.dumpToString() << std::flush;
+}
+
+TEST(audio_utils_simplelog, lock_free_overwrite) {
+    LockFreeSimpleLog<1 /* Writers */, 8 /* Capacity */> slog;
+    auto writer = slog.createWriter();
+    ASSERT_NE(nullptr, writer);
+    EXPECT_EQ(nullptr, slog.createWriter());
+    for (int i = 0; i < 20; ++i) writer->log(i /* nowNs */, "line %d", i);
+    const std::string s = slog.dumpToString();
+    EXPECT_EQ((size_t)8, countNewLines(s));
+    EXPECT_EQ(std::string::npos, s.find("line 11\n"));
+    EXPECT_NE(std::string::npos, s.find("line 12\n"));
+    EXPECT_NE(std::string::npos, s.find("line 19\n"));
+}
+
+TEST(audio_utils_simplelog, lock_free_concurrent) {
+    LockFreeSimpleLog<2 /* Writers */, 16 /* Capacity */> slog;
+    constexpr int kLines = 100000;
+    std::atomic<bool> done{false};
+    std::thread reader([&]() {
+        while (!done) {
+            // each line is consistent: the second value is twice the first.
+            std::istringstream is(slog.dumpToString());
+            std::string line;
+            while (std::getline(is, line)) {
+                int a, b;
+                ASSERT_EQ(2, sscanf(line.c_str() + line.find("line"), "line %d %d", &a, &b));
+                EXPECT_EQ(a * 2, b);
+            }
+        }
+    });
+    std::vector<std::thread> writers;
+    for (int i = 0; i < 2; ++i) {
+        writers.emplace_back([&slog]() {
+            auto writer = slog.createWriter();
+            for (int j = 0; j < kLines; ++j) writer->log("line %d %d", j, j * 2);
+        });
+    }
+    for (auto& writer : writers) writer.join();
+    done = true;
+    reader.join();
+    EXPECT_EQ((size_t)32, countNewLines(slog.dumpToString()));
+}
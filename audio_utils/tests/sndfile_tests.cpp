@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <audio_utils/sndfile.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int kChannels = 2;
+// more than the 1 MiB SFM_BUFFERED write buffer for all formats but 8 bit
+constexpr int kFrames = 200'000;
+constexpr int kBlockFrames = 1000;
+
+std::string tempPath(const char *name) {
+    return ::testing::TempDir() + "/sndfile_tests_" + name + ".wav";
+}
+
+float sampleAt(size_t i) {
+    return std::sin(i * 0.001f) * 0.9f;
+}
+
+// quantization step of the file format, for comparing samples
+float formatStep(int format) {
+    switch (format & SF_FORMAT_SUBMASK) {
+    case SF_FORMAT_PCM_U8: return 1.f / (1 << 7);
+    case SF_FORMAT_PCM_16: return 1.f / (1 << 15);
+    case SF_FORMAT_PCM_24: return 1.f / (1 << 23);
+    default: return 1e-6f;
+    }
+}
+
+void writeFile(const std::string &path, int format, int mode) {
+    SF_INFO info{};
+    info.samplerate = 48000;
+    info.channels = kChannels;
+    info.format = SF_FORMAT_WAV | format;
+    SNDFILE *handle = sf_open(path.c_str(), mode, &info);
+    ASSERT_NE(nullptr, handle);
+    std::vector<float> block(kBlockFrames * kChannels);
+    for (int frame = 0; frame < kFrames; frame += kBlockFrames) {
+        for (size_t i = 0; i < block.size(); ++i) {
+            block[i] = sampleAt(frame * kChannels + i);
+        }
+        ASSERT_EQ(kBlockFrames, sf_writef_float(handle, block.data(), kBlockFrames));
+    }
+    sf_close(handle);
+}
+
+void readFile(const std::string &path, int format, int mode) {
+    SF_INFO info{};
+    SNDFILE *handle = sf_open(path.c_str(), mode, &info);
+    ASSERT_NE(nullptr, handle);
+    EXPECT_EQ(kFrames, info.frames);
+    EXPECT_EQ(kChannels, info.channels);
+    EXPECT_EQ(SF_FORMAT_WAV | format, info.format);
+    const float step = formatStep(format);
+    std::vector<float> block(kBlockFrames * kChannels);
+    size_t sample = 0;
+    size_t errors = 0;
+    sf_count_t frames;
+    while ((frames = sf_readf_float(handle, block.data(), kBlockFrames)) > 0) {
+        for (size_t i = 0; i < (size_t) frames * kChannels; ++i, ++sample) {
+            errors += std::abs(block[i] - sampleAt(sample)) > step;
+        }
+    }
+    EXPECT_EQ((size_t) kFrames * kChannels, sample);
+    EXPECT_EQ(0u, errors);
+    sf_close(handle);
+}
+
+}  // namespace
+
+TEST(sndfile_tests, modes_and_formats) {
+    const int formats[] = {
+        SF_FORMAT_PCM_U8, SF_FORMAT_PCM_16, SF_FORMAT_PCM_24, SF_FORMAT_PCM_32, SF_FORMAT_FLOAT,
+    };
+    const std::string path = tempPath("modes");
+    for (int format : formats) {
+        for (int writeMode : {SFM_WRITE, SFM_WRITE | SFM_BUFFERED}) {
+            SCOPED_TRACE("format " + std::to_string(format) + " mode " + std::to_string(writeMode));
+            writeFile(path, format, writeMode);
+            readFile(path, format, SFM_READ);
+            readFile(path, format, SFM_READ | SFM_MMAP);
+        }
+    }
+    remove(path.c_str());
+}
+
+TEST(sndfile_tests, mapped) {
+    const std::string path = tempPath("mapped");
+    SF_INFO info{};
+    info.samplerate = 48000;
+    info.channels = kChannels;
+    info.format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+    SNDFILE *handle = sf_open(path.c_str(), SFM_WRITE | SFM_BUFFERED, &info);
+    ASSERT_NE(nullptr, handle);
+    std::vector<int16_t> data(kFrames * kChannels);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = i * 7;
+    }
+    // larger than the buffer, written directly
+    ASSERT_EQ(kFrames, sf_writef_short(handle, data.data(), kFrames));
+    sf_close(handle);
+
+    // not available without SFM_MMAP
+    handle = sf_open(path.c_str(), SFM_READ, &info);
+    ASSERT_NE(nullptr, handle);
+    const void *frames = nullptr;
+    EXPECT_EQ(0, sf_readf_mapped(handle, &frames, kFrames));
+    sf_close(handle);
+
+    handle = sf_open(path.c_str(), SFM_READ | SFM_MMAP, &info);
+    ASSERT_NE(nullptr, handle);
+    ASSERT_EQ(100, sf_readf_mapped(handle, &frames, 100));
+    EXPECT_EQ(0, memcmp(data.data(), frames, 100 * kChannels * sizeof(int16_t)));
+    // mixed with copying reads
+    std::vector<int16_t> copy(100 * kChannels);
+    ASSERT_EQ(100, sf_readf_short(handle, copy.data(), 100));
+    EXPECT_EQ(0, memcmp(&data[100 * kChannels], copy.data(), copy.size() * sizeof(int16_t)));
+    ASSERT_EQ(kFrames - 200, sf_readf_mapped(handle, &frames, kFrames));
+    EXPECT_EQ(0, memcmp(&data[200 * kChannels], frames,
+            (kFrames - 200) * kChannels * sizeof(int16_t)));
+    EXPECT_EQ(0, sf_readf_mapped(handle, &frames, kFrames));
+    sf_close(handle);
+    remove(path.c_str());
+}
+
+TEST(sndfile_tests, invalid_modes) {
+    const std::string path = tempPath("invalid");
+    SF_INFO info{};
+    info.samplerate = 48000;
+    info.channels = kChannels;
+    info.format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+    EXPECT_EQ(nullptr, sf_open(path.c_str(), SFM_WRITE | SFM_MMAP, &info));
+    EXPECT_EQ(nullptr, sf_open(path.c_str(), SFM_READ | SFM_BUFFERED, &info));
+}
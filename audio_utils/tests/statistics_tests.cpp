@@ -18,7 +18,10 @@
 #define LOG_TAG "audio_utils_statistics_tests"
 #include <audio_utils/Statistics.h>
 
+#include <atomic>
 #include <random>
+#include <thread>
+#include <vector>
 #include <stdio.h>
 #include <gtest/gtest.h>
 
@@ -569,3 +572,238 @@ TEST(StatisticsTest, simple_stats)
     simple_stats_to_string(&ss, buffer, sizeof(buffer));
     printf("simple_stats: %s", buffer);
 }
+
+// Check the sketch quantiles against the exact quantiles, within the relative accuracy.
+template <typename Sketch, typename T>
+static void verifyQuantiles(const Sketch& sketch, android::audio_utils::ReferenceQuantile<T>& rq)
+{
+    ASSERT_EQ(rq.getN(), sketch.getN());
+    for (const double q : { 0., 0.001, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.95, 0.99, 0.999, 1. }) {
+        const double exact = rq.getQuantile(q);
+        const double estimate = sketch.getQuantile(q);
+        EXPECT_LE(std::abs(estimate - exact), sketch.getAccuracy() * std::abs(exact) * 1.000001)
+                << "q:" << q << " exact:" << exact << " estimate:" << estimate;
+    }
+}
+
+TEST(StatisticsTest, quantile_sketch_accuracy)
+{
+    constexpr size_t kSamples = 100000;
+    std::minstd_rand gen(42);
+    std::exponential_distribution<double> exponential(1. / 5e6);  // callback time in ns
+    std::lognormal_distribution<double> lognormal(0., 2.);
+    std::normal_distribution<double> normal(0., 1e-3);            // signed jitter
+    std::uniform_real_distribution<double> uniform(1., 2.);
+
+    for (int distribution = 0; distribution < 4; ++distribution) {
+        android::audio_utils::QuantileSketch<double> sketch;
+        android::audio_utils::ReferenceQuantile<double> rq;
+        for (size_t i = 0; i < kSamples; ++i) {
+            const double value = distribution == 0 ? exponential(gen)
+                    : distribution == 1 ? lognormal(gen)
+                    : distribution == 2 ? normal(gen)
+                    : uniform(gen);
+            sketch.add(value);
+            rq.add(value);
+        }
+        verifyQuantiles(sketch, rq);
+        printf("distribution %d: %s\n", distribution, sketch.toString().c_str());
+    }
+
+    // integer samples and zeros, and a different accuracy.
+    android::audio_utils::QuantileSketch<int64_t, 256> sketch(0.05);
+    android::audio_utils::ReferenceQuantile<int64_t> rq;
+    for (int64_t i = -1000; i <= 10000; ++i) {
+        const int64_t value = i % 3 == 0 ? 0 : i;
+        sketch.add(value);
+        rq.add(value);
+    }
+    verifyQuantiles(sketch, rq);
+}
+
+TEST(StatisticsTest, quantile_sketch_merge)
+{
+    constexpr size_t kThreads = 4;
+    constexpr size_t kSamples = 10000;
+    std::minstd_rand gen(42);
+    std::lognormal_distribution<double> lognormal(0., 3.);
+
+    android::audio_utils::QuantileSketch<double> all;
+    android::audio_utils::QuantileSketch<double> sketches[kThreads];
+    android::audio_utils::ReferenceQuantile<double> rq;
+    for (size_t i = 0; i < kThreads * kSamples; ++i) {
+        const double value = (i % 7 == 0 ? -1. : 1.) * lognormal(gen);
+        all.add(value);
+        sketches[i % kThreads].add(value);
+        rq.add(value);
+    }
+
+    android::audio_utils::QuantileSketch<double> merged;
+    for (const auto& sketch : sketches) {
+        ASSERT_TRUE(merged.merge(sketch));
+    }
+    verifyQuantiles(merged, rq);
+    EXPECT_EQ(all.getMin(), merged.getMin());
+    EXPECT_EQ(all.getMax(), merged.getMax());
+    for (double q = 0.; q <= 1.; q += 0.01) {
+        EXPECT_EQ(all.getQuantile(q), merged.getQuantile(q)) << "q:" << q;
+    }
+
+    android::audio_utils::QuantileSketch<double> other(0.02);
+    other.add(1.);
+    EXPECT_FALSE(merged.merge(other));
+    EXPECT_EQ(rq.getN(), merged.getN());
+}
+
+TEST(StatisticsTest, quantile_sketch_collapse)
+{
+    // 64 buckets at 1% cover a ratio of only 3.6, so the lowest buckets are collapsed
+    // for samples over 10 decades, but the upper quantiles remain accurate.
+    android::audio_utils::QuantileSketch<double, 64> sketch;
+    android::audio_utils::ReferenceQuantile<double> rq;
+    std::minstd_rand gen(42);
+    std::uniform_real_distribution<double> exponent(-5., 5.);
+    for (size_t i = 0; i < 100000; ++i) {
+        const double value = std::pow(10., exponent(gen));
+        sketch.add(value);
+        rq.add(value);
+    }
+    for (const double q : { 0.99, 0.999, 1. }) {
+        const double exact = rq.getQuantile(q);
+        EXPECT_NEAR(exact, sketch.getQuantile(q), sketch.getAccuracy() * exact);
+    }
+    // collapsed quantiles are overestimated, but bounded by the min and max.
+    EXPECT_EQ(sketch.getMin(), sketch.getQuantile(0.));
+    EXPECT_GE(sketch.getQuantile(0.5), rq.getQuantile(0.5));
+    EXPECT_LE(sketch.getQuantile(0.5), sketch.getMax());
+
+    // a merge of a sketch of a distant range moves the buckets.
+    android::audio_utils::QuantileSketch<double, 64> low;
+    low.add(1e-20);
+    low.add(2e-20);
+    ASSERT_TRUE(low.merge(sketch));
+    EXPECT_EQ(sketch.getN() + 2, low.getN());
+    EXPECT_EQ(1e-20, low.getQuantile(0.));
+    EXPECT_NEAR(rq.getQuantile(0.999), low.getQuantile(0.999),
+            low.getAccuracy() * rq.getQuantile(0.999));
+}
+
+TEST(StatisticsTest, quantile_sketch_empty)
+{
+    android::audio_utils::QuantileSketch<float> sketch;
+    EXPECT_TRUE(std::isnan(sketch.getQuantile(0.5)));
+    EXPECT_EQ("unavail", sketch.toString());
+
+    sketch.add(std::numeric_limits<float>::quiet_NaN());  // ignored
+    EXPECT_EQ(0, sketch.getN());
+
+    sketch.add(3.f);
+    EXPECT_EQ(3., sketch.getQuantile(0.));
+    EXPECT_EQ(3., sketch.getQuantile(0.5));
+    EXPECT_EQ(3., sketch.getQuantile(1.));
+    EXPECT_TRUE(std::isnan(sketch.getQuantile(1.5)));
+
+    sketch.reset();
+    EXPECT_EQ(0, sketch.getN());
+    EXPECT_TRUE(std::isnan(sketch.getQuantile(0.5)));
+}
+
+TEST(StatisticsTest, stat_merge)
+{
+    constexpr size_t kSamples = 10000;
+    constexpr size_t kParts = 3;
+    std::vector<double> data(kSamples);
+    initNormal(data, 10., 3.);
+
+    android::audio_utils::Statistics<double> all;
+    android::audio_utils::Statistics<double> parts[kParts];
+    android::audio_utils::ReferenceStatistics<double> rstat;
+    for (size_t i = 0; i < kSamples; ++i) {
+        all.add(data[i]);
+        parts[i * kParts / kSamples].add(data[i]);  // contiguous parts of different means
+        rstat.add(data[i]);
+    }
+    android::audio_utils::Statistics<double> merged;
+    merged.merge(parts[0]);  // into empty
+    for (size_t i = 1; i < kParts; ++i) {
+        merged.merge(parts[i]);
+    }
+    merged.merge(android::audio_utils::Statistics<double>{});  // empty has no effect
+
+    EXPECT_EQ(all.getN(), merged.getN());
+    EXPECT_EQ(all.getMin(), merged.getMin());
+    EXPECT_EQ(all.getMax(), merged.getMax());
+    EXPECT_DOUBLE_EQ(all.getWeight(), merged.getWeight());
+    EXPECT_NEAR(rstat.getMean(), merged.getMean(), 1e-12);
+    EXPECT_NEAR(rstat.getVariance(), merged.getVariance(), 1e-9);
+    EXPECT_NEAR(rstat.getPopVariance(), merged.getPopVariance(), 1e-9);
+
+    // vector statistics merge per component.
+    android::audio_utils::LinearLeastSquaresFit<double> fit, fit1, fit2;
+    for (int i = 0; i < 100; ++i) {
+        const std::array<double, 2> xy{ (double)i, 3. * i + 2. };
+        fit.add(xy);
+        (i < 30 ? fit1 : fit2).add(xy);
+    }
+    fit1.merge(fit2);
+    double a, b, r2;
+    fit1.computeYLine(a, b, r2);
+    EXPECT_NEAR(2., a, 1e-9);
+    EXPECT_NEAR(3., b, 1e-9);
+    EXPECT_NEAR(1., r2, 1e-9);
+}
+
+TEST(StatisticsTest, sharded_statistics)
+{
+    constexpr size_t kThreads = 6;
+    constexpr size_t kSamples = 20000;
+    // fewer shards than threads, so that some threads share a shard.
+    android::audio_utils::ShardedStatistics<android::audio_utils::Statistics<double>, 4> sharded;
+    std::atomic<bool> done{false};
+    std::atomic<int64_t> inconsistent{0};
+
+    std::thread reader([&]() {
+        int64_t n = 0;
+        while (!done) {
+            const auto stats = sharded.get();
+            if (stats.getN() < n) ++inconsistent;  // must not go backwards
+            if (stats.getN() > 0 && (stats.getMin() < 1. || stats.getMax() > kThreads
+                    || stats.getMean() < stats.getMin() || stats.getMean() > stats.getMax())) {
+                ++inconsistent;
+            }
+            n = stats.getN();
+        }
+    });
+    std::vector<std::thread> writers;
+    for (size_t i = 0; i < kThreads; ++i) {
+        writers.emplace_back([&, i]() {
+            for (size_t j = 0; j < kSamples; ++j) {
+                sharded.add(double(i + 1));
+            }
+        });
+    }
+    for (auto& writer : writers) writer.join();
+    done = true;
+    reader.join();
+    EXPECT_EQ(0, inconsistent);
+
+    android::audio_utils::ReferenceStatistics<double> rstat;
+    for (size_t i = 0; i < kThreads; ++i) {
+        for (size_t j = 0; j < kSamples; ++j) rstat.add(double(i + 1));
+    }
+    const auto stats = sharded.get();
+    // a sample is dropped only if all the shards were being written.
+    const int64_t dropped = sharded.getDropped();
+    EXPECT_EQ(int64_t(kThreads * kSamples), stats.getN() + dropped);
+    if (dropped == 0) {
+        EXPECT_EQ(1., stats.getMin());
+        EXPECT_EQ(double(kThreads), stats.getMax());
+        EXPECT_NEAR(rstat.getMean(), stats.getMean(), 1e-9);
+        EXPECT_NEAR(rstat.getVariance(), stats.getVariance(), 1e-6);
+    }
+    printf("sharded: %s dropped: %lld\n", sharded.toString().c_str(), (long long)dropped);
+
+    sharded.reset();
+    EXPECT_EQ(0, sharded.get().getN());
+    EXPECT_EQ(0, sharded.getDropped());
+}
@@ -19,7 +19,9 @@
 
 #include <audio_utils/TimestampVerifier.h>
 
+#include <cmath>
 #include <stdio.h>
+#include <vector>
 #include <gtest/gtest.h>
 
 // Ensure that all TimestampVerifier mutators are really constexpr and free from
@@ -136,3 +138,102 @@ TEST(TimestampVerifier, discontinuity_zero)
     EXPECT_NE(96000*1.1, tv.getLastCorrectedTimestamp().mFrames);
     EXPECT_EQ(5100000000*0.9, tv.getLastCorrectedTimestamp().mTimeNs);
 }
+
+TEST(TimestampVerifier, batch)
+{
+    constexpr uint32_t kSampleRate = 48000;
+    int64_t frames[100];
+    int64_t timeNs[100];
+    for (size_t i = 0; i < std::size(frames); ++i) {
+        frames[i] = i * 480;
+        timeNs[i] = i * 10'000'000 + (i % 3) * 100'000;  // 0.1 ms jitter
+    }
+    android::TimestampVerifier<int64_t, int64_t> tv;
+    tv.add(frames, timeNs, std::size(frames), kSampleRate);
+    android::TimestampVerifier<int64_t, int64_t> reference;
+    for (size_t i = 0; i < std::size(frames); ++i) {
+        reference.add(frames[i], timeNs[i], kSampleRate);
+    }
+    EXPECT_EQ(reference.toString(), tv.toString());
+    EXPECT_EQ(100, tv.getN());
+}
+
+TEST(TimestampVerifier, drift)
+{
+    // two streams sharing a clock, and one 100 ppm fast, each with jitter.
+    constexpr uint32_t kSampleRate = 48000;
+    android::TimestampVerifier<int64_t, int64_t> a, b, c;
+    for (int64_t i = 0; i < 500; ++i) {
+        const int64_t timeNs = (i + 1) * 10'000'000;
+        const int64_t jitterNs = (i * 7919 % 11 - 5) * 20'000;  // +-0.1 ms
+        a.add(i * 480, timeNs + jitterNs, kSampleRate);
+        b.add(i * 480 * 2, timeNs - jitterNs, kSampleRate * 2);
+        c.add(i * 480 * 1.0001, timeNs + jitterNs / 2, kSampleRate);
+    }
+    EXPECT_NEAR(0., android::estimateDriftPpm(a, b), 20.);
+    EXPECT_NEAR(100., android::estimateDriftPpm(c, a), 20.);
+    EXPECT_NEAR(-100., android::estimateDriftPpm(a, c), 20.);
+
+    android::TimestampVerifier<int64_t, int64_t> empty;
+    EXPECT_TRUE(std::isnan(android::estimateDriftPpm(a, empty)));
+}
+
+TEST(TimestampVerifier, multi_stream)
+{
+    constexpr uint32_t kSampleRate = 48000;
+    constexpr size_t kStreams = 64;
+    android::MultiTimestampVerifier<int64_t, int64_t> mtv(kStreams, kSampleRate);
+    EXPECT_EQ(kStreams, mtv.size());
+    mtv.setSampleRate(1, kSampleRate * 2);
+
+    // stream 2 is not ready for the first 10 timestamps, and stream 3 is 100 ppm fast.
+    std::vector<int64_t> frames(kStreams);
+    std::vector<int64_t> timeNs(kStreams);
+    for (int64_t i = 0; i < 1000; ++i) {
+        for (size_t s = 0; s < kStreams; ++s) {
+            const int64_t jitterNs = ((i + s) * 7919 % 11 - 5) * 20'000;  // +-0.1 ms
+            frames[s] = i * 480 * (s == 1 ? 2 : 1) * (s == 3 ? 1.0001 : 1.);
+            timeNs[s] = s == 2 && i < 10 ? -1 : (i + 1) * 10'000'000 + jitterNs;
+        }
+        mtv.add(frames.data(), timeNs.data());
+        mtv.add(frames.data(), timeNs.data());  // duplicates are ignored
+    }
+
+    EXPECT_EQ(1000, mtv.getN(0));
+    EXPECT_EQ(990, mtv.getN(2));
+    EXPECT_NEAR(kSampleRate, mtv.estimateSampleRate(0), 1.);
+    EXPECT_NEAR(kSampleRate * 2, mtv.estimateSampleRate(1), 2.);
+    EXPECT_NEAR(0., mtv.getJitterMeanMs(0), 0.01);
+    EXPECT_GT(mtv.getJitterStdDevMs(0), 0.05);
+    EXPECT_LE(mtv.getJitterMaxAbsMs(0), 0.2 + 1e-9);
+    EXPECT_NEAR(0., mtv.estimateDriftPpm(0, 1), 20.);
+    EXPECT_NEAR(0., mtv.estimateDriftPpm(0, 2), 20.);
+    EXPECT_NEAR(100., mtv.estimateDriftPpm(3, 0), 20.);
+
+    // matches the TimestampVerifier estimate for the same stream, with the same alpha.
+    android::TimestampVerifier<int64_t, int64_t> tv;
+    for (int64_t i = 0; i < 1000; ++i) {
+        const int64_t jitterNs = (i * 7919 % 11 - 5) * 20'000;
+        tv.add(i * 480, (i + 1) * 10'000'000 + jitterNs, kSampleRate);
+    }
+    double a, b, r2;
+    tv.estimateSampleRate(a, b, r2);
+    EXPECT_NEAR(b, mtv.estimateSampleRate(0), 1e-3);
+
+    // a discontinuity resets the estimate, but not the jitter statistics.
+    mtv.discontinuity(0);
+    EXPECT_EQ(0., mtv.estimateSampleRate(0));
+    EXPECT_TRUE(std::isnan(mtv.estimateDriftPpm(0, 1)));
+    mtv.add(0, 123, 1'000'000'000);
+    mtv.add(0, 123 + 48000, 2'000'000'000);
+    EXPECT_NEAR(kSampleRate, mtv.estimateSampleRate(0), 1e-6);
+    EXPECT_EQ(1002, mtv.getN(0));
+    (void)mtv.toString(0);
+
+    // unsigned frames going backwards give a negative difference rather than wrapping.
+    android::MultiTimestampVerifier<uint32_t, int64_t> umtv(1 /* streams */, kSampleRate);
+    umtv.add(0, 48000u, 1'000'000'000);
+    umtv.add(0, 0u, 2'000'000'000);
+    EXPECT_NEAR(-48000., umtv.estimateSampleRate(0), 1e-6);
+    EXPECT_NEAR(2000., umtv.getJitterMeanMs(0), 1e-6);
+}
@@ -22,18 +22,36 @@
 #endif
 #include <string.h>
 #include <errno.h>
+#include <stdint.h>
+#ifndef _MSC_VER
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define HAVE_MMAP
+#endif
 
 #define WAVE_FORMAT_PCM         1
 #define WAVE_FORMAT_IEEE_FLOAT  3
 #define WAVE_FORMAT_EXTENSIBLE  0xFFFE
 
+// size of the SFM_BUFFERED write buffer, rounded down to a whole number of frames
+#define WRITE_BUFFER_BYTES      (1 << 20)
+
 struct SNDFILE_ {
     int mode;
-    uint8_t *temp;  // realloc buffer used for shrinking 16 bits to 8 bits and byte-swapping
-    FILE *stream;
+    uint8_t *temp;  // realloc buffer used for format conversion and byte-swapping
+    size_t tempSize;
+    FILE *stream;   // NULL if the file is mapped
     size_t bytesPerFrame;
     size_t remaining;   // frames unread for SFM_READ, frames written for SFM_WRITE
     SF_INFO info;
+    // SFM_MMAP
+    uint8_t *map;   // the whole file, or NULL
+    size_t mapSize;
+    const uint8_t *next;    // next unread frame in the map
+    // SFM_BUFFERED
+    uint8_t *buffer;    // frames converted but not yet written, or NULL
+    size_t bufferSize;  // a multiple of bytesPerFrame
+    size_t bufferFill;
 };
 
 static unsigned little2u(unsigned char *ptr)
@@ -62,7 +80,28 @@ static void my_swab(short *ptr, size_t numToSwap)
     }
 }
 
-static SNDFILE *sf_open_read(const char *path, SF_INFO *info)
+// Returns the temp buffer, grown to at least size bytes, or NULL if out of memory
+static void *sf_temp(SNDFILE *handle, size_t size)
+{
+    if (size > handle->tempSize) {
+        uint8_t *temp = realloc(handle->temp, size);
+        if (temp == NULL) {
+            return NULL;
+        }
+        handle->temp = temp;
+        handle->tempSize = size;
+    }
+    return handle->temp;
+}
+
+static void sf_init(SNDFILE *handle, int mode, FILE *stream)
+{
+    memset(handle, 0, sizeof(*handle));
+    handle->mode = mode;
+    handle->stream = stream;
+}
+
+static SNDFILE *sf_open_read(const char *path, SF_INFO *info, int map)
 {
     FILE *stream = fopen(path, "rb");
     if (stream == NULL) {
@@ -73,9 +112,11 @@ static SNDFILE *sf_open_read(const char *path, SF_INFO *info)
     }
 
     SNDFILE *handle = (SNDFILE *) malloc(sizeof(SNDFILE));
-    handle->mode = SFM_READ;
-    handle->temp = NULL;
-    handle->stream = stream;
+    if (handle == NULL) {
+        fclose(stream);
+        return NULL;
+    }
+    sf_init(handle, SFM_READ, stream);
     handle->info.format = SF_FORMAT_WAV;
 
     // don't attempt to parse all valid forms, just the most common ones
@@ -276,7 +317,39 @@ static SNDFILE *sf_open_read(const char *path, SF_INFO *info)
 #endif
         goto close;
     }
-    (void) fseek(stream, dataTell, SEEK_SET);
+    if (map) {
+#ifdef HAVE_MMAP
+        // Map the whole file, rather than only the data chunk, as the offset must be page aligned.
+        struct stat st;
+        if (fstat(fileno(stream), &st) != 0 || st.st_size < dataTell) {
+#ifdef HAVE_STDERR
+            fprintf(stderr, "fstat failed errno %d\n", errno);
+#endif
+            goto close;
+        }
+        size_t mapSize = (size_t) st.st_size;
+        void *addr = mmap(NULL, mapSize, PROT_READ, MAP_PRIVATE, fileno(stream), 0);
+        if (addr == MAP_FAILED) {
+#ifdef HAVE_STDERR
+            fprintf(stderr, "mmap %s failed errno %d\n", path, errno);
+#endif
+            goto close;
+        }
+        (void) madvise(addr, mapSize, MADV_SEQUENTIAL);
+        // a truncated data chunk is read short, as it is by fread
+        size_t available = (mapSize - (size_t) dataTell) / handle->bytesPerFrame;
+        if (handle->remaining > available) {
+            handle->remaining = available;
+        }
+        handle->map = (uint8_t *) addr;
+        handle->mapSize = mapSize;
+        handle->next = handle->map + dataTell;
+        handle->stream = NULL;
+        fclose(stream);
+#endif
+    } else {
+        (void) fseek(stream, dataTell, SEEK_SET);
+    }
     *info = handle->info;
     return handle;
 
@@ -294,7 +367,7 @@ static void write4u(unsigned char *ptr, unsigned u)
     ptr[3] = u >> 24;
 }
 
-static SNDFILE *sf_open_write(const char *path, SF_INFO *info)
+static SNDFILE *sf_open_write(const char *path, SF_INFO *info, int buffered)
 {
     int sub = info->format & SF_FORMAT_SUBMASK;
     if (!(
@@ -305,13 +378,19 @@ static SNDFILE *sf_open_write(const char *path, SF_INFO *info)
           )) {
         return NULL;
     }
+    SNDFILE *handle = (SNDFILE *) malloc(sizeof(SNDFILE));
+    if (handle == NULL) {
+        return NULL;
+    }
     FILE *stream = fopen(path, "w+b");
     if (stream == NULL) {
 #ifdef HAVE_STDERR
         fprintf(stderr, "fopen %s failed errno %d\n", path, errno);
 #endif
+        free(handle);
         return NULL;
     }
+    sf_init(handle, SFM_WRITE, stream);
 
     unsigned bitsPerSample;
     switch (sub) {
@@ -335,6 +414,19 @@ static SNDFILE *sf_open_write(const char *path, SF_INFO *info)
         break;
     }
     unsigned blockAlignment = (bitsPerSample >> 3) * info->channels;
+    if (buffered) {
+        // Frames are converted directly into our buffer, so stdio buffering would be a
+        // second copy.  setvbuf() must precede the first write.
+        handle->bufferSize = WRITE_BUFFER_BYTES / blockAlignment * blockAlignment;
+        handle->buffer = (uint8_t *) malloc(handle->bufferSize);
+        if (handle->buffer == NULL) {
+            fclose(stream);
+            remove(path);
+            free(handle);
+            return NULL;
+        }
+        (void) setvbuf(stream, NULL, _IONBF, 0);
+    }
     if ((info->format & SF_FORMAT_TYPEMASK) == SF_FORMAT_WAV) {
         unsigned char wav[58];
         memset(wav, 0, sizeof(wav));
@@ -366,12 +458,7 @@ static SNDFILE *sf_open_write(const char *path, SF_INFO *info)
         // dataSize is initially zero
         (void) fwrite(wav, 44 + extra, 1, stream);
     }
-    SNDFILE *handle = (SNDFILE *) malloc(sizeof(SNDFILE));
-    handle->mode = SFM_WRITE;
-    handle->temp = NULL;
-    handle->stream = stream;
     handle->bytesPerFrame = blockAlignment;
-    handle->remaining = 0;
     handle->info = *info;
     return handle;
 }
@@ -386,9 +473,13 @@ SNDFILE *sf_open(const char *path, int mode, SF_INFO *info)
     }
     switch (mode) {
     case SFM_READ:
-        return sf_open_read(path, info);
+#ifdef HAVE_MMAP
+    case SFM_READ | SFM_MMAP:
+#endif
+        return sf_open_read(path, info, mode & SFM_MMAP);
     case SFM_WRITE:
-        return sf_open_write(path, info);
+    case SFM_WRITE | SFM_BUFFERED:
+        return sf_open_write(path, info, mode & SFM_BUFFERED);
     default:
 #ifdef HAVE_STDERR
         fprintf(stderr, "mode=%d\n", mode);
@@ -397,12 +488,30 @@ SNDFILE *sf_open(const char *path, int mode, SF_INFO *info)
     }
 }
 
+// Writes the buffered frames, and returns 0 if they were not all written
+static int sf_flush(SNDFILE *handle)
+{
+    size_t actualBytes = fwrite(handle->buffer, sizeof(char), handle->bufferFill, handle->stream);
+    int ok = actualBytes == handle->bufferFill;
+    if (!ok) {
+        // the frames were counted when buffered
+        handle->remaining -= handle->bufferFill / handle->bytesPerFrame -
+                actualBytes / handle->bytesPerFrame;
+    }
+    handle->bufferFill = 0;
+    return ok;
+}
+
 void sf_close(SNDFILE *handle)
 {
     if (handle == NULL)
         return;
     free(handle->temp);
     if (handle->mode == SFM_WRITE) {
+        if (handle->bufferFill > 0) {
+            (void) sf_flush(handle);
+        }
+        free(handle->buffer);
         (void) fflush(handle->stream);
         if ((handle->info.format & SF_FORMAT_TYPEMASK) == SF_FORMAT_WAV) {
             rewind(handle->stream);
@@ -416,54 +525,102 @@ void sf_close(SNDFILE *handle)
             (void) fwrite(wav, 44 + extra, 1, handle->stream);
         }
     }
-    (void) fclose(handle->stream);
+#ifdef HAVE_MMAP
+    if (handle->map != NULL) {
+        (void) munmap(handle->map, handle->mapSize);
+    }
+#endif
+    if (handle->stream != NULL) {
+        (void) fclose(handle->stream);
+    }
     free(handle);
 }
 
-sf_count_t sf_readf_short(SNDFILE *handle, short *ptr, sf_count_t desiredFrames)
+// Returns the mapped frames, up to desiredFrames, and consumes them
+static const void *sf_map_frames(SNDFILE *handle, sf_count_t desiredFrames, size_t *actualFrames)
 {
-    if (handle == NULL || handle->mode != SFM_READ || ptr == NULL || !handle->remaining ||
-            desiredFrames <= 0) {
-        return 0;
+    size_t frames = handle->remaining < (size_t) desiredFrames ?
+            handle->remaining : (size_t) desiredFrames;
+    const uint8_t *data = handle->next;
+    handle->next += frames * handle->bytesPerFrame;
+    handle->remaining -= frames;
+    *actualFrames = frames;
+    return data;
+}
+
+// Returns the next frames of the data chunk, up to desiredFrames, in the file format.
+// Mapped frames are returned in place if they are aligned, otherwise the frames are
+// copied or read into dst if it is not NULL, else into the temp buffer.
+static const void *sf_read_frames(SNDFILE *handle, void *dst, sf_count_t desiredFrames,
+        size_t *actualFrames)
+{
+    if (handle->map != NULL) {
+        const void *data = sf_map_frames(handle, desiredFrames, actualFrames);
+        // 24 bit samples are packed bytes, the others are read as their type
+        size_t bytesPerSample = handle->bytesPerFrame / handle->info.channels;
+        if (bytesPerSample == 3 || ((uintptr_t) data & (bytesPerSample - 1)) == 0) {
+            return data;
+        }
+        size_t bytes = *actualFrames * handle->bytesPerFrame;
+        if (dst == NULL && (dst = sf_temp(handle, bytes)) == NULL) {
+            *actualFrames = 0;
+            return NULL;
+        }
+        memcpy(dst, data, bytes);
+        return dst;
     }
     if (handle->remaining < (size_t) desiredFrames) {
         desiredFrames = handle->remaining;
     }
     // does not check for numeric overflow
     size_t desiredBytes = desiredFrames * handle->bytesPerFrame;
-    size_t actualBytes;
-    void *temp = NULL;
+    if (dst == NULL && (dst = sf_temp(handle, desiredBytes)) == NULL) {
+        *actualFrames = 0;
+        return NULL;
+    }
+    size_t actualBytes = fread(dst, sizeof(char), desiredBytes, handle->stream);
+    *actualFrames = actualBytes / handle->bytesPerFrame;
+    handle->remaining -= *actualFrames;
+    return dst;
+}
+
+sf_count_t sf_readf_short(SNDFILE *handle, short *ptr, sf_count_t desiredFrames)
+{
+    if (handle == NULL || handle->mode != SFM_READ || ptr == NULL || !handle->remaining ||
+            desiredFrames <= 0) {
+        return 0;
+    }
     unsigned format = handle->info.format & SF_FORMAT_SUBMASK;
-    if (format == SF_FORMAT_PCM_32 || format == SF_FORMAT_FLOAT || format == SF_FORMAT_PCM_24) {
-        temp = malloc(desiredBytes);
-        actualBytes = fread(temp, sizeof(char), desiredBytes, handle->stream);
-    } else {
-        actualBytes = fread(ptr, sizeof(char), desiredBytes, handle->stream);
+    // samples which do not grow are read in place
+    size_t actualFrames;
+    const void *data = sf_read_frames(handle,
+            format == SF_FORMAT_PCM_U8 || format == SF_FORMAT_PCM_16 ? ptr : NULL,
+            desiredFrames, &actualFrames);
+    if (actualFrames == 0) {
+        return 0;
     }
-    size_t actualFrames = actualBytes / handle->bytesPerFrame;
-    handle->remaining -= actualFrames;
+    size_t count = actualFrames * handle->info.channels;
     switch (format) {
     case SF_FORMAT_PCM_U8:
-        memcpy_to_i16_from_u8(ptr, (unsigned char *) ptr, actualFrames * handle->info.channels);
+        memcpy_to_i16_from_u8(ptr, (const unsigned char *) data, count);
         break;
     case SF_FORMAT_PCM_16:
+        if (data != ptr)
+            memcpy(ptr, data, count * sizeof(short));
         if (!isLittleEndian())
-            my_swab(ptr, actualFrames * handle->info.channels);
+            my_swab(ptr, count);
         break;
     case SF_FORMAT_PCM_32:
-        memcpy_to_i16_from_i32(ptr, (const int *) temp, actualFrames * handle->info.channels);
-        free(temp);
+        memcpy_to_i16_from_i32(ptr, (const int *) data, count);
         break;
     case SF_FORMAT_FLOAT:
-        memcpy_to_i16_from_float(ptr, (const float *) temp, actualFrames * handle->info.channels);
-        free(temp);
+        memcpy_to_i16_from_float(ptr, (const float *) data, count);
         break;
     case SF_FORMAT_PCM_24:
-        memcpy_to_i16_from_p24(ptr, (const uint8_t *) temp, actualFrames * handle->info.channels);
-        free(temp);
+        memcpy_to_i16_from_p24(ptr, (const uint8_t *) data, count);
         break;
     default:
-        memset(ptr, 0, actualFrames * handle->info.channels * sizeof(short));
+        memset(ptr, 0, count * sizeof(short));
         break;
     }
     return actualFrames;
@@ -475,43 +632,34 @@ sf_count_t sf_readf_float(SNDFILE *handle, float *ptr, sf_count_t desiredFrames)
             desiredFrames <= 0) {
         return 0;
     }
-    if (handle->remaining < (size_t) desiredFrames) {
-        desiredFrames = handle->remaining;
-    }
-    // does not check for numeric overflow
-    size_t desiredBytes = desiredFrames * handle->bytesPerFrame;
-    size_t actualBytes;
-    void *temp = NULL;
     unsigned format = handle->info.format & SF_FORMAT_SUBMASK;
-    if (format == SF_FORMAT_PCM_16 || format == SF_FORMAT_PCM_U8 || format == SF_FORMAT_PCM_24) {
-        temp = malloc(desiredBytes);
-        actualBytes = fread(temp, sizeof(char), desiredBytes, handle->stream);
-    } else {
-        actualBytes = fread(ptr, sizeof(char), desiredBytes, handle->stream);
+    size_t actualFrames;
+    const void *data = sf_read_frames(handle,
+            format == SF_FORMAT_PCM_32 || format == SF_FORMAT_FLOAT ? ptr : NULL,
+            desiredFrames, &actualFrames);
+    if (actualFrames == 0) {
+        return 0;
     }
-    size_t actualFrames = actualBytes / handle->bytesPerFrame;
-    handle->remaining -= actualFrames;
+    size_t count = actualFrames * handle->info.channels;
     switch (format) {
     case SF_FORMAT_PCM_U8:
-        memcpy_to_float_from_u8(ptr, (const unsigned char *) temp,
-                actualFrames * handle->info.channels);
-        free(temp);
+        memcpy_to_float_from_u8(ptr, (const unsigned char *) data, count);
         break;
     case SF_FORMAT_PCM_16:
-        memcpy_to_float_from_i16(ptr, (const short *) temp, actualFrames * handle->info.channels);
-        free(temp);
+        memcpy_to_float_from_i16(ptr, (const short *) data, count);
         break;
     case SF_FORMAT_PCM_32:
-        memcpy_to_float_from_i32(ptr, (const int *) ptr, actualFrames * handle->info.channels);
+        memcpy_to_float_from_i32(ptr, (const int *) data, count);
         break;
     case SF_FORMAT_FLOAT:
+        if (data != ptr)
+            memcpy(ptr, data, count * sizeof(float));
         break;
     case SF_FORMAT_PCM_24:
-        memcpy_to_float_from_p24(ptr, (const uint8_t *) temp, actualFrames * handle->info.channels);
-        free(temp);
+        memcpy_to_float_from_p24(ptr, (const uint8_t *) data, count);
         break;
     default:
-        memset(ptr, 0, actualFrames * handle->info.channels * sizeof(float));
+        memset(ptr, 0, count * sizeof(float));
         break;
     }
     return actualFrames;
@@ -523,124 +671,215 @@ sf_count_t sf_readf_int(SNDFILE *handle, int *ptr, sf_count_t desiredFrames)
             desiredFrames <= 0) {
         return 0;
     }
-    if (handle->remaining < (size_t) desiredFrames) {
-        desiredFrames = handle->remaining;
-    }
-    // does not check for numeric overflow
-    size_t desiredBytes = desiredFrames * handle->bytesPerFrame;
-    void *temp = NULL;
     unsigned format = handle->info.format & SF_FORMAT_SUBMASK;
-    size_t actualBytes;
-    if (format == SF_FORMAT_PCM_16 || format == SF_FORMAT_PCM_U8 || format == SF_FORMAT_PCM_24) {
-        temp = malloc(desiredBytes);
-        actualBytes = fread(temp, sizeof(char), desiredBytes, handle->stream);
-    } else {
-        actualBytes = fread(ptr, sizeof(char), desiredBytes, handle->stream);
+    size_t actualFrames;
+    const void *data = sf_read_frames(handle,
+            format == SF_FORMAT_PCM_32 || format == SF_FORMAT_FLOAT ? ptr : NULL,
+            desiredFrames, &actualFrames);
+    if (actualFrames == 0) {
+        return 0;
     }
-    size_t actualFrames = actualBytes / handle->bytesPerFrame;
-    handle->remaining -= actualFrames;
+    size_t count = actualFrames * handle->info.channels;
     switch (format) {
     case SF_FORMAT_PCM_U8:
-        memcpy_to_i32_from_u8(ptr, (const unsigned char *) temp,
-                actualFrames * handle->info.channels);
-        free(temp);
+        memcpy_to_i32_from_u8(ptr, (const unsigned char *) data, count);
         break;
     case SF_FORMAT_PCM_16:
-        memcpy_to_i32_from_i16(ptr, (const short *) temp, actualFrames * handle->info.channels);
-        free(temp);
+        memcpy_to_i32_from_i16(ptr, (const short *) data, count);
         break;
     case SF_FORMAT_PCM_32:
+        if (data != ptr)
+            memcpy(ptr, data, count * sizeof(int));
         break;
     case SF_FORMAT_FLOAT:
-        memcpy_to_i32_from_float(ptr, (const float *) ptr, actualFrames * handle->info.channels);
+        memcpy_to_i32_from_float(ptr, (const float *) data, count);
         break;
     case SF_FORMAT_PCM_24:
-        memcpy_to_i32_from_p24(ptr, (const uint8_t *) temp, actualFrames * handle->info.channels);
-        free(temp);
+        memcpy_to_i32_from_p24(ptr, (const uint8_t *) data, count);
         break;
     default:
-        memset(ptr, 0, actualFrames * handle->info.channels * sizeof(int));
+        memset(ptr, 0, count * sizeof(int));
         break;
     }
     return actualFrames;
 }
 
+sf_count_t sf_readf_mapped(SNDFILE *handle, const void **ptr, sf_count_t desiredFrames)
+{
+    if (handle == NULL || handle->map == NULL || ptr == NULL || !handle->remaining ||
+            desiredFrames <= 0) {
+        return 0;
+    }
+    // the samples are little endian in the file
+    if (!isLittleEndian() && (handle->info.format & SF_FORMAT_SUBMASK) != SF_FORMAT_PCM_U8) {
+        return 0;
+    }
+    size_t actualFrames;
+    *ptr = sf_map_frames(handle, desiredFrames, &actualFrames);
+    return actualFrames;
+}
+
+// Converts count samples from src to the file format at dst
+typedef void (*sf_convert_t)(void *dst, const void *src, size_t count);
+
+#define SF_CONVERT(to, from) \
+static void convert_to_##to##_from_##from(void *dst, const void *src, size_t count) \
+{ \
+    memcpy_to_##to##_from_##from(dst, src, count); \
+}
+
+SF_CONVERT(u8, i16)
+SF_CONVERT(float, i16)
+SF_CONVERT(p24, i16)
+SF_CONVERT(i32, i16)
+SF_CONVERT(i16, float)
+SF_CONVERT(u8, float)
+SF_CONVERT(p24, float)
+SF_CONVERT(i32, float)
+SF_CONVERT(i16, i32)
+SF_CONVERT(u8, i32)
+SF_CONVERT(p24, i32)
+SF_CONVERT(float, i32)
+
+static void convert_to_i16_swab(void *dst, const void *src, size_t count)
+{
+    memcpy(dst, src, count * sizeof(short));
+    my_swab((short *) dst, count);
+}
+
+// Writes frames of srcFrameBytes each, converted by convert, or as is if convert is NULL.
+// Unbuffered frames are converted into the temp buffer and written at once;
+// buffered frames are converted into the write buffer, which is written when full.
+static sf_count_t sf_write_frames(SNDFILE *handle, const void *src, size_t srcFrameBytes,
+        sf_count_t desiredFrames, sf_convert_t convert)
+{
+    size_t channels = handle->info.channels;
+    size_t bytesPerFrame = handle->bytesPerFrame;
+    // does not check for numeric overflow
+    size_t desiredBytes = desiredFrames * bytesPerFrame;
+    size_t actualFrames = 0;
+    if (handle->buffer == NULL) {
+        if (convert != NULL) {
+            void *temp = sf_temp(handle, desiredBytes);
+            if (temp == NULL) {
+                return 0;
+            }
+            convert(temp, src, desiredFrames * channels);
+            src = temp;
+        }
+        actualFrames = fwrite(src, sizeof(char), desiredBytes, handle->stream) / bytesPerFrame;
+    } else {
+        while (actualFrames < (size_t) desiredFrames) {
+            const uint8_t *from = (const uint8_t *) src + actualFrames * srcFrameBytes;
+            size_t frames = desiredFrames - actualFrames;
+            if (convert == NULL && handle->bufferFill == 0 &&
+                    frames * bytesPerFrame >= handle->bufferSize) {
+                // no conversion needed and too large to buffer
+                actualFrames += fwrite(from, sizeof(char), frames * bytesPerFrame,
+                        handle->stream) / bytesPerFrame;
+                break;
+            }
+            if (handle->bufferFill == handle->bufferSize && !sf_flush(handle)) {
+                break;
+            }
+            size_t available = (handle->bufferSize - handle->bufferFill) / bytesPerFrame;
+            if (frames > available) {
+                frames = available;
+            }
+            uint8_t *to = handle->buffer + handle->bufferFill;
+            if (convert == NULL) {
+                memcpy(to, from, frames * bytesPerFrame);
+            } else {
+                convert(to, from, frames * channels);
+            }
+            handle->bufferFill += frames * bytesPerFrame;
+            actualFrames += frames;
+        }
+    }
+    handle->remaining += actualFrames;
+    return actualFrames;
+}
+
 sf_count_t sf_writef_short(SNDFILE *handle, const short *ptr, sf_count_t desiredFrames)
 {
     if (handle == NULL || handle->mode != SFM_WRITE || ptr == NULL || desiredFrames <= 0)
         return 0;
-    size_t desiredBytes = desiredFrames * handle->bytesPerFrame;
-    size_t actualBytes = 0;
+    sf_convert_t convert;
     switch (handle->info.format & SF_FORMAT_SUBMASK) {
     case SF_FORMAT_PCM_U8:
-        handle->temp = realloc(handle->temp, desiredBytes);
-        memcpy_to_u8_from_i16(handle->temp, ptr, desiredBytes);
-        actualBytes = fwrite(handle->temp, sizeof(char), desiredBytes, handle->stream);
+        convert = convert_to_u8_from_i16;
         break;
     case SF_FORMAT_PCM_16:
-        // does not check for numeric overflow
-        if (isLittleEndian()) {
-            actualBytes = fwrite(ptr, sizeof(char), desiredBytes, handle->stream);
-        } else {
-            handle->temp = realloc(handle->temp, desiredBytes);
-            memcpy(handle->temp, ptr, desiredBytes);
-            my_swab((short *) handle->temp, desiredFrames * handle->info.channels);
-            actualBytes = fwrite(handle->temp, sizeof(char), desiredBytes, handle->stream);
-        }
+        convert = isLittleEndian() ? NULL : convert_to_i16_swab;
         break;
     case SF_FORMAT_FLOAT:
-        handle->temp = realloc(handle->temp, desiredBytes);
-        memcpy_to_float_from_i16((float *) handle->temp, ptr,
-                desiredFrames * handle->info.channels);
-        actualBytes = fwrite(handle->temp, sizeof(char), desiredBytes, handle->stream);
+        convert = convert_to_float_from_i16;
         break;
-    default:
+    case SF_FORMAT_PCM_24:
+        convert = convert_to_p24_from_i16;
+        break;
+    case SF_FORMAT_PCM_32:
+        convert = convert_to_i32_from_i16;
         break;
+    default:
+        return 0;
     }
-    size_t actualFrames = actualBytes / handle->bytesPerFrame;
-    handle->remaining += actualFrames;
-    return actualFrames;
+    return sf_write_frames(handle, ptr, handle->info.channels * sizeof(short), desiredFrames,
+            convert);
 }
 
 sf_count_t sf_writef_float(SNDFILE *handle, const float *ptr, sf_count_t desiredFrames)
 {
     if (handle == NULL || handle->mode != SFM_WRITE || ptr == NULL || desiredFrames <= 0)
         return 0;
-    size_t desiredBytes = desiredFrames * handle->bytesPerFrame;
-    size_t actualBytes = 0;
+    sf_convert_t convert;
     switch (handle->info.format & SF_FORMAT_SUBMASK) {
     case SF_FORMAT_FLOAT:
-        actualBytes = fwrite(ptr, sizeof(char), desiredBytes, handle->stream);
+        convert = NULL;
         break;
     case SF_FORMAT_PCM_16:
-        handle->temp = realloc(handle->temp, desiredBytes);
-        memcpy_to_i16_from_float((short *) handle->temp, ptr,
-                desiredFrames * handle->info.channels);
-        actualBytes = fwrite(handle->temp, sizeof(char), desiredBytes, handle->stream);
+        convert = convert_to_i16_from_float;
         break;
-    case SF_FORMAT_PCM_U8:  // transcoding from float to byte not yet implemented
-    default:
+    case SF_FORMAT_PCM_U8:
+        convert = convert_to_u8_from_float;
+        break;
+    case SF_FORMAT_PCM_24:
+        convert = convert_to_p24_from_float;
         break;
+    case SF_FORMAT_PCM_32:
+        convert = convert_to_i32_from_float;
+        break;
+    default:
+        return 0;
     }
-    size_t actualFrames = actualBytes / handle->bytesPerFrame;
-    handle->remaining += actualFrames;
-    return actualFrames;
+    return sf_write_frames(handle, ptr, handle->info.channels * sizeof(float), desiredFrames,
+            convert);
 }
 
 sf_count_t sf_writef_int(SNDFILE *handle, const int *ptr, sf_count_t desiredFrames)
 {
     if (handle == NULL || handle->mode != SFM_WRITE || ptr == NULL || desiredFrames <= 0)
         return 0;
-    size_t desiredBytes = desiredFrames * handle->bytesPerFrame;
-    size_t actualBytes = 0;
+    sf_convert_t convert;
     switch (handle->info.format & SF_FORMAT_SUBMASK) {
     case SF_FORMAT_PCM_32:
-        actualBytes = fwrite(ptr, sizeof(char), desiredBytes, handle->stream);
+        convert = NULL;
+        break;
+    case SF_FORMAT_PCM_16:
+        convert = convert_to_i16_from_i32;
         break;
-    default:    // transcoding from other formats not yet implemented
+    case SF_FORMAT_PCM_U8:
+        convert = convert_to_u8_from_i32;
+        break;
+    case SF_FORMAT_PCM_24:
+        convert = convert_to_p24_from_i32;
+        break;
+    case SF_FORMAT_FLOAT:
+        convert = convert_to_float_from_i32;
         break;
+    default:
+        return 0;
     }
-    size_t actualFrames = actualBytes / handle->bytesPerFrame;
-    handle->remaining += actualFrames;
-    return actualFrames;
+    return sf_write_frames(handle, ptr, handle->info.channels * sizeof(int), desiredFrames,
+            convert);
 }